@@ -0,0 +1,87 @@
+/*****************************************************************//**
+ * \file   bench_analysis.c
+ * \brief  Measures how the difficulty analysis scales with the number of worker threads.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "difficulty.h"
+#include "report.h"
+
+/**
+ * \typedef AnalysisConfig
+ * \brief Board size and number of games of the analysis benchmark.
+ */
+typedef struct AnalysisConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    long long games; /**< Number of games played at every thread count. */
+} AnalysisConfig;
+
+/**
+ * \brief Returns the thread count measured after another one: none (the calling thread), then 1, doubling up to the logical processor count.
+ * \param threads The previous thread count.
+ * \param cpu_count Number of logical processors.
+ * \return The next thread count, above cpu_count after the last one.
+ */
+static int next_thread_count(int threads, int cpu_count) {
+    if (threads == 0)
+        return 1;
+    if (threads < cpu_count && threads * 2 > cpu_count)
+        return cpu_count;
+    return threads * 2;
+}
+
+/**
+ * \brief Runs the analysis benchmark: the same games are played on the calling thread, then on pools of
+ * 1 to one thread per logical processor, doubling the count each time.
+ *
+ * The games only depend on the seed, so the wins and 3BV columns must not change with the thread count.
+ */
+void bench_analysis(void) {
+    static const AnalysisConfig configs[] = {
+        { "easy", 8, 8, 10, 20000 },
+        { "hard", 16, 16, 40, 5000 },
+        { "expert", 16, 30, 99, 2000 },
+    };
+
+    static const char* const columns[] = { "preset", "board", "games", "threads", "time_ms", "games_per_s", "speedup", "wins", "mean_3bv" };
+    report_begin("analysis", "bot games of the difficulty analysis, on a growing number of threads", 9, columns);
+
+    int cpu_count = threadpool_cpu_count();
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        AnalysisConfig config = configs[c];
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+
+        double single = 0.0;
+        for (int threads = 0; threads <= cpu_count; threads = next_thread_count(threads, cpu_count)) {
+            ThreadPool pool;
+            ThreadPool* workers = threads > 0 && threadpool_create(threads, &pool) ? &pool : NULL;
+            if (threads > 0 && !workers)
+                break;
+
+            DifficultyReport report;
+            bool analyzed = analyze_difficulty(config.rows, config.cols, config.mines, config.games, 1, workers, &report);
+            if (workers)
+                threadpool_destroy(workers);
+            if (!analyzed)
+                break;
+            if (threads == 0)
+                single = report.seconds;
+
+            report_text(config.name);
+            report_text(size);
+            report_int(report.games);
+            report_int(threads);
+            report_double(report.seconds * 1e3, 1);
+            report_double(report.seconds > 0.0 ? report.games / report.seconds : 0.0, 0);
+            report_double(report.seconds > 0.0 ? single / report.seconds : 0.0, 2);
+            report_int(report.wins);
+            report_double(histogram_mean(&report.bv), 2);
+        }
+    }
+
+    report_end();
+}
@@ -0,0 +1,113 @@
+/*****************************************************************//**
+ * \file   bench_bitboard.c
+ * \brief  Compares the bitboard engine with the scalar cell path on large boards.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchmark.h"
+#include "bitboard.h"
+#include "report.h"
+
+/**
+ * \brief Recomputes every adjacency count cell by cell, with eight bounds-checked neighbour tests.
+ * \param board Pointer to the Board structure.
+ * \param cells Output buffer of rows * cols packed cells.
+ */
+static void scalar_count_adjacent(const Board* board, unsigned char* cells) {
+    for (int i = 0; i < board->rows; i++) {
+        for (int j = 0; j < board->cols; j++) {
+            unsigned char count = 0;
+            for (int x = -1; x <= 1; x++) {
+                for (int y = -1; y <= 1; y++) {
+                    int r = i + x;
+                    int c = j + y;
+                    if ((x || y) && r >= 0 && r < board->rows && c >= 0 && c < board->cols && cell_is_mine(board, r, c))
+                        count++;
+                }
+            }
+            cells[(size_t)i * board->cols + j] = count;
+        }
+    }
+}
+
+/**
+ * \brief Runs the scalar and the bitboard engine on the same boards and checks they agree.
+ */
+void bench_bitboard(void) {
+    static const int sizes[] = { 1024, 4096 };
+    static const int densities[] = { 0, 5, 15 };
+
+    static const char* const columns[] = { "board", "density", "count_ms", "bb_count_ms", "reveal_ms", "bb_reveal_ms", "identical" };
+#if defined(__AVX2__)
+    report_begin("bitboard", "bitboard engine (AVX2) vs scalar cells", 7, columns);
+#else
+    report_begin("bitboard", "bitboard engine (scalar words) vs scalar cells", 7, columns);
+#endif
+
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        for (int d = 0; d < (int)(sizeof(densities) / sizeof(densities[0])); d++) {
+            int size = sizes[s];
+            size_t cell_count = (size_t)size * size;
+
+            Board board;
+            generate_board(size, size, (int)(cell_count * densities[d] / 100), 1, size / 2, size / 2, &board);
+
+            Bitboard bb;
+            if (!bitboard_create(&bb, size, size)) {
+                free_board(&board);
+                continue;
+            }
+            unsigned char* scalar_counts = (unsigned char*)malloc(cell_count);
+            unsigned char* bitboard_counts = (unsigned char*)calloc(cell_count, 1);
+
+            double begin = bench_now();
+            scalar_count_adjacent(&board, scalar_counts);
+            double count_time = bench_now() - begin;
+
+            bitboard_load(&bb, &board);
+            begin = bench_now();
+            bitboard_count_adjacent(&bb, bitboard_counts);
+            double bitboard_count_time = bench_now() - begin;
+
+            begin = bench_now();
+            reveal_cell(size / 2, size / 2, &board);
+            double reveal_time = bench_now() - begin;
+
+            bool hit_mine;
+            begin = bench_now();
+            bitboard_reveal(&bb, size / 2, size / 2, &hit_mine);
+            double bitboard_reveal_time = bench_now() - begin;
+
+            bool identical = hit_mine == board.game_over;
+            for (int i = 0; i < size && identical; i++) {
+                for (int j = 0; j < size; j++) {
+                    size_t index = (size_t)i * size + j;
+                    if (scalar_counts[index] != (board.cells[index] & CELL_COUNT_MASK) || bitboard_counts[index] != scalar_counts[index]
+                        || bitboard_is_set(&bb, bb.revealed, i, j) != cell_is_revealed(&board, i, j)) {
+                        identical = false;
+                        break;
+                    }
+                }
+            }
+
+            char label[32];
+            snprintf(label, sizeof(label), "%dx%d", size, size);
+            report_text(label);
+            report_int(densities[d]);
+            report_double(count_time * 1e3, 3);
+            report_double(bitboard_count_time * 1e3, 3);
+            report_double(reveal_time * 1e3, 3);
+            report_double(bitboard_reveal_time * 1e3, 3);
+            report_text(identical ? "yes" : "no");
+
+            free(scalar_counts);
+            free(bitboard_counts);
+            bitboard_destroy(&bb);
+            free_board(&board);
+        }
+    }
+
+    report_end();
+}
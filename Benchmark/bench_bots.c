@@ -0,0 +1,77 @@
+/*****************************************************************//**
+ * \file   bench_bots.c
+ * \brief  Measures the actions per second the bot interface sustains, with the example rule bot built in.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "botplay.h"
+#include "report.h"
+
+/**
+ * \brief The entry point of the example plugin, linked into the benchmark rather than loaded.
+ */
+const BotInterface* bot_interface(void);
+
+/**
+ * \typedef BotsConfig
+ * \brief Board size and number of games of the bot benchmark.
+ */
+typedef struct BotsConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    long long games; /**< Number of games played. */
+} BotsConfig;
+
+/**
+ * \brief Runs the bot benchmark: the same games on the calling thread, then on one thread per logical processor.
+ *
+ * Games only depend on the seed, so the wins must not change with the thread count.
+ */
+void bench_bots(void) {
+    static const BotsConfig configs[] = {
+        { "easy", 8, 8, 10, 50000 },
+        { "hard", 16, 16, 40, 20000 },
+        { "expert", 16, 30, 99, 20000 },
+        { "custom", 1000, 1000, 150000, 4 },
+    };
+
+    static const char* const columns[] = { "preset", "board", "games", "threads", "time_ms", "games_per_s", "actions_per_s", "actions_per_turn", "wins" };
+    report_begin("bots", "rule bot games through the plugin interface, on the calling thread then on every processor", 9, columns);
+
+    const BotInterface* bot = bot_interface();
+    int cpu_count = threadpool_cpu_count();
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        BotsConfig config = configs[c];
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+
+        for (int threads = 0; threads <= cpu_count; threads += cpu_count) {
+            ThreadPool pool;
+            ThreadPool* workers = threads > 0 && threadpool_create(threads, &pool) ? &pool : NULL;
+            if (threads > 0 && !workers)
+                break;
+
+            BotReport report;
+            bool played = run_bot_games(bot, config.rows, config.cols, config.mines, config.games, 1, workers, &report);
+            if (workers)
+                threadpool_destroy(workers);
+            if (!played)
+                break;
+
+            report_text(config.name);
+            report_text(size);
+            report_int(report.games);
+            report_int(threads);
+            report_double(report.seconds * 1e3, 1);
+            report_double(report.seconds > 0.0 ? report.games / report.seconds : 0.0, 0);
+            report_double(report.seconds > 0.0 ? report.actions / report.seconds : 0.0, 0);
+            report_double(report.turns > 0 ? (double)report.actions / report.turns : 0.0, 2);
+            report_int(report.wins);
+            bot_report_free(&report);
+        }
+    }
+
+    report_end();
+}
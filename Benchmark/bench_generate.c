@@ -0,0 +1,65 @@
+/*****************************************************************//**
+ * \file   bench_generate.c
+ * \brief  Measures mine placement time at densities from 10% to 90%, and prints a hash of the generated boards.
+ *********************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "benchmark.h"
+#include "report.h"
+
+/**
+ * \brief Hashes the packed cells of a board (64-bit FNV-1a).
+ * \param board Pointer to the Board structure.
+ * \return The hash.
+ */
+static uint64_t hash_board(const Board* board) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    size_t cell_count = (size_t)board->rows * board->cols;
+    for (size_t i = 0; i < cell_count; i++) {
+        hash = (hash ^ board->cells[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * \brief Runs the mine placement benchmark on a 1024x1024 board with a growing mine density.
+ *
+ * Seeds are fixed, so the board_hash column must be the same on every platform and compiler.
+ */
+void bench_generate(void) {
+    const int size = 1024;
+    const int repeats = 10;
+
+    static const char* const columns[] = { "density", "mines", "ms_per_board", "ns_per_mine", "board_hash" };
+    report_begin("generate", "place_mines on a 1024x1024 board", 5, columns);
+
+    for (int density = 10; density <= 90; density += 10) {
+        int mines = (int)((long long)size * size * density / 100);
+        double total_time = 0.0;
+        uint64_t hash = 0;
+
+        for (int r = 0; r < repeats; r++) {
+            Board board;
+            initialize_board(size, size, mines, (uint64_t)r, &board);
+
+            double begin = bench_now();
+            place_mines(size / 2, size / 2, &board);
+            total_time += bench_now() - begin;
+
+            hash ^= hash_board(&board);
+            free_board(&board);
+        }
+
+        char hash_text[11];
+        snprintf(hash_text, sizeof(hash_text), "%010llx", (unsigned long long)(hash >> 24)); // The top 40 bits fit the column
+
+        report_int(density);
+        report_int(mines);
+        report_double(total_time * 1e3 / repeats, 3);
+        report_double(total_time * 1e9 / ((double)repeats * mines), 2);
+        report_text(hash_text);
+    }
+
+    report_end();
+}
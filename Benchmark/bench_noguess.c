@@ -0,0 +1,115 @@
+/*****************************************************************//**
+ * \file   bench_noguess.c
+ * \brief  Measures the generation of no-guess boards and the latency of taking one from a pool.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "noguess.h"
+#include "report.h"
+
+/**
+ * \typedef NoGuessConfig
+ * \brief Board size generated by the no-guess benchmark.
+ */
+typedef struct NoGuessConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    int boards; /**< Number of boards generated. */
+} NoGuessConfig;
+
+/**
+ * \brief Runs the no-guess benchmark: boards are generated on one worker per logical processor, then taken from a full pool.
+ *
+ * The generated boards are checked again with is_no_guess_board, the rejected column must stay at zero.
+ * Pool takes are timed once the pool is full, the wait for its jobs is not.
+ */
+void bench_noguess(void) {
+    static const NoGuessConfig configs[] = {
+        { "easy", 8, 8, 10, 500 },
+        { "medium", 12, 12, 20, 500 },
+        { "hard", 16, 16, 40, 200 },
+        { "expert", 16, 30, 99, 20 },
+    };
+
+    ThreadPool pool;
+    ThreadPool* workers = threadpool_create(0, &pool) ? &pool : NULL;
+
+    static const char* const columns[] = { "preset", "board", "mines", "boards", "attempts_per_board", "ms_per_board", "max_ms", "rejected", "us_per_take" };
+    report_begin("noguess", "no-guess board generation and pool takes", 9, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        NoGuessConfig config = configs[c];
+        double total_time = 0.0;
+        double max_time = 0.0;
+        long long attempts = 0;
+        int generated = 0;
+        int rejected = 0;
+
+        NoGuessChecker checker;
+        if (!no_guess_checker_create(config.rows, config.cols, config.mines, &checker))
+            continue;
+
+        for (int b = 0; b < config.boards; b++) {
+            Board board;
+            int start_row, start_col;
+
+            double begin = bench_now();
+            int attempt = generate_no_guess_board(config.rows, config.cols, config.mines, (uint64_t)b + 1, workers, NULL, &start_row, &start_col, &board);
+            double time = bench_now() - begin;
+            if (attempt < 0)
+                continue;
+
+            total_time += time;
+            if (time > max_time)
+                max_time = time;
+            attempts += attempt + 1;
+            generated++;
+            rejected += !is_no_guess_board(start_row, start_col, &board, &checker);
+            free_board(&board);
+        }
+        no_guess_checker_destroy(&checker);
+
+        double take_time = 0.0;
+        int takes = 0;
+        if (workers) {
+            NoGuessPool no_guess_pool;
+            no_guess_pool_init(42, workers, &no_guess_pool);
+            int size = no_guess_pool_add(config.rows, config.cols, config.mines, &no_guess_pool);
+
+            for (int t = 0; t < NO_GUESS_POOL_SIZE; t++) {
+                threadpool_wait_batch(&no_guess_pool.batch, workers); // Every slot is ready or refilled
+
+                Board board;
+                int start_row, start_col;
+                double begin = bench_now();
+                bool taken = no_guess_pool_take(size, &start_row, &start_col, &board, &no_guess_pool);
+                take_time += bench_now() - begin;
+
+                if (taken) {
+                    takes++;
+                    free_board(&board);
+                }
+            }
+            no_guess_pool_destroy(&no_guess_pool);
+        }
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+        report_text(config.name);
+        report_text(size);
+        report_int(config.mines);
+        report_int(generated);
+        report_double(generated > 0 ? (double)attempts / generated : 0.0, 1);
+        report_double(generated > 0 ? total_time * 1e3 / generated : 0.0, 2);
+        report_double(max_time * 1e3, 2);
+        report_int(rejected);
+        report_double(takes > 0 ? take_time * 1e6 / takes : 0.0, 2);
+    }
+
+    report_end();
+
+    if (workers)
+        threadpool_destroy(workers);
+}
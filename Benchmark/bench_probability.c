@@ -0,0 +1,109 @@
+/*****************************************************************//**
+ * \file   bench_probability.c
+ * \brief  Measures the mine probability engine on the guesses of solver-driven games.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "probability.h"
+#include "report.h"
+
+/**
+ * \typedef ProbabilityConfig
+ * \brief Board size played by the probability benchmark.
+ */
+typedef struct ProbabilityConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    int games; /**< Number of games played. */
+} ProbabilityConfig;
+
+/**
+ * \brief Runs the probability benchmark: games reveal the cells the solver proves safe and, when it is stuck,
+ * the cell the engine finds least likely to hold a mine.
+ *
+ * Only probability_compute is timed. The components are spread over one worker per logical processor.
+ */
+void bench_probability(void) {
+    static const ProbabilityConfig configs[] = {
+        { "hard", 16, 16, 40, 5000 },
+        { "expert", 16, 30, 99, 2000 },
+        { "custom", 100, 100, 2000, 50 },
+        { "custom", 300, 300, 18000, 5 },
+    };
+
+    ThreadPool pool;
+    ThreadPool* workers = threadpool_create(0, &pool) ? &pool : NULL;
+
+    static const char* const columns[] = { "preset", "board", "mines", "games", "win_pct", "guesses_per_game", "exact_pct", "us_per_guess", "max_ms" };
+    report_begin("probability", "exact mine probabilities at every guess of a solver-driven game", 9, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        ProbabilityConfig config = configs[c];
+        double total_time = 0.0;
+        double max_time = 0.0;
+        long long guesses = 0;
+        long long exact = 0;
+        int wins = 0;
+
+        ProbabilityEngine engine;
+        probability_init(workers, &engine);
+
+        Board board;
+        Solver solver;
+        initialize_board(config.rows, config.cols, config.mines, 0, &board);
+        solver_create(&board, &solver);
+        free_board(&board);
+
+        for (int g = 0; g < config.games; g++) {
+            initialize_board(config.rows, config.cols, config.mines, (uint64_t)g + 1, &board);
+            reveal_cell(config.rows / 2, config.cols / 2, &board);
+            solver_reset(&board, &solver);
+
+            while (!board.game_over && !board.game_won) {
+                int index = solver_next_safe(&board, &solver);
+                if (index < 0) {
+                    double begin = bench_now();
+                    probability_compute(&board, &solver, &engine);
+                    double time = bench_now() - begin;
+
+                    total_time += time;
+                    if (time > max_time)
+                        max_time = time;
+                    guesses++;
+                    exact += engine.exact;
+
+                    index = probability_safest_cell(&board, &engine);
+                    if (index < 0)
+                        break;
+                }
+
+                reveal_cell(index / config.cols, index % config.cols, &board);
+                solver_update(&board, &solver);
+            }
+
+            wins += board.game_won;
+            free_board(&board);
+        }
+        solver_destroy(&solver);
+        probability_destroy(&engine);
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+        report_text(config.name);
+        report_text(size);
+        report_int(config.mines);
+        report_int(config.games);
+        report_double(100.0 * wins / config.games, 1);
+        report_double((double)guesses / config.games, 2);
+        report_double(guesses > 0 ? 100.0 * exact / guesses : 100.0, 1);
+        report_double(guesses > 0 ? total_time * 1e6 / guesses : 0.0, 1);
+        report_double(max_time * 1e3, 2);
+    }
+
+    report_end();
+
+    if (workers)
+        threadpool_destroy(workers);
+}
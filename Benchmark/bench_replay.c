@@ -0,0 +1,154 @@
+/*****************************************************************//**
+ * \file   bench_replay.c
+ * \brief  Measures the size of recorded replays and the speed of verifying them, on one thread and on a pool.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "allocator.h"
+#include "replay.h"
+#include "report.h"
+#include "rng.h"
+
+/**
+ * \def BENCH_REPLAY_FILE
+ * \brief Temporary replay file written by the benchmark, removed afterwards.
+ */
+#define BENCH_REPLAY_FILE "saper_bench.rpl"
+
+/**
+ * \typedef ReplayConfig
+ * \brief Board size of the games recorded by the replay benchmark.
+ */
+typedef struct ReplayConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    int games; /**< Number of games recorded. */
+} ReplayConfig;
+
+/**
+ * \brief Plays and records one game: every mine is flagged and every safe cell clicked, in random order,
+ * a few hundred milliseconds apart. One game in four ends on a mine instead.
+ * \param config The board size.
+ * \param seed Seed of the board and of the order of the clicks.
+ * \param order Buffer of rows * cols cell indices.
+ * \param recorder Pointer to the ReplayRecorder structure the game is recorded in.
+ * \return Number of actions recorded.
+ */
+static int record_bot_game(const ReplayConfig* config, uint64_t seed, int* order, ReplayRecorder* recorder) {
+    Board board;
+    if (!initialize_board(config->rows, config->cols, config->mines, seed, &board))
+        return 0;
+    replay_begin(&board, recorder);
+
+    Rng rng;
+    rng_seed(~seed, &rng);
+    int cell_count = config->rows * config->cols;
+    for (int i = 0; i < cell_count; i++)
+        order[i] = i;
+    for (int i = cell_count - 1; i > 0; i--) { // Fisher-Yates shuffle
+        int j = (int)rng_below((uint32_t)i + 1, &rng);
+        int swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    bool lose = rng_below(4, &rng) == 0;
+
+    uint32_t time = 0;
+    int row = config->rows / 2, col = config->cols / 2;
+    reveal_cell(row, col, &board);
+    replay_record(time, REPLAY_REVEAL, row, col, recorder);
+    for (int i = 0; i < cell_count && !board.game_won && !board.game_over; i++) {
+        row = order[i] / config->cols;
+        col = order[i] % config->cols;
+        if (cell_is_revealed(&board, row, col))
+            continue;
+
+        time += 100 + rng_below(900, &rng);
+        if (cell_is_mine(&board, row, col) && !lose) {
+            toggle_flag(row, col, &board);
+            replay_record(time, REPLAY_FLAG, row, col, recorder);
+        }
+        else {
+            reveal_cell(row, col, &board);
+            replay_record(time, REPLAY_REVEAL, row, col, recorder);
+        }
+    }
+
+    int actions = recorder->action_count;
+    replay_append(BENCH_REPLAY_FILE, board.game_won ? REPLAY_WON : board.game_over ? REPLAY_LOST : REPLAY_UNFINISHED, recorder);
+    free_board(&board);
+    return actions;
+}
+
+/**
+ * \brief Runs the replay benchmark: games are recorded to a file, then verified on the calling thread and on
+ * one worker per logical processor.
+ *
+ * The file is in the page cache, as it is right after the games were written. The verified column must
+ * show every replay.
+ */
+void bench_replay(void) {
+    static const ReplayConfig configs[] = {
+        { "hard", 16, 16, 40, 20000 },
+        { "expert", 16, 30, 99, 20000 },
+        { "custom", 100, 100, 1600, 500 },
+    };
+
+    ThreadPool pool;
+    ThreadPool* workers = threadpool_create(0, &pool) ? &pool : NULL;
+
+    static const char* const columns[] = { "preset", "board", "replays", "actions", "bytes_per_action", "threads", "verify_ms", "mactions_per_s", "verified" };
+    report_begin("replay", "replays recorded in memory, appended to a file and verified headless", 9, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        ReplayConfig config = configs[c];
+        int* order = core_malloc((size_t)config.rows * config.cols * sizeof(int));
+        if (!order)
+            continue;
+
+        remove(BENCH_REPLAY_FILE);
+        ReplayRecorder recorder = { 0 };
+        long long actions = 0;
+        for (int g = 0; g < config.games; g++)
+            actions += record_bot_game(&config, (uint64_t)g + 1, order, &recorder);
+        replay_free(&recorder);
+        core_free(order);
+
+        ReplayBatch batch;
+        replay_batch_init(&batch);
+        if (!replay_batch_add_file(BENCH_REPLAY_FILE, &batch))
+            continue;
+        size_t file_size = batch.file_sizes[0];
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+        for (int run = 0; run < (workers ? 2 : 1); run++) {
+            ThreadPool* threads = run == 0 ? NULL : workers;
+            double begin = bench_now();
+            replay_batch_verify(threads, &batch);
+            double time = bench_now() - begin;
+
+            int verified = 0;
+            for (int i = 0; i < batch.check_count; i++)
+                verified += batch.checks[i].status == REPLAY_VERIFIED;
+
+            report_text(config.name);
+            report_text(size);
+            report_int(batch.check_count);
+            report_int(actions);
+            report_double(actions > 0 ? (double)file_size / actions : 0.0, 2);
+            report_int(threads ? threads->thread_count : 1);
+            report_double(time * 1e3, 2);
+            report_double(time > 0.0 ? actions / time / 1e6 : 0.0, 2);
+            report_int(verified);
+        }
+        replay_batch_free(&batch);
+    }
+
+    remove(BENCH_REPLAY_FILE);
+    if (workers)
+        threadpool_destroy(workers);
+    report_end();
+}
@@ -0,0 +1,78 @@
+/*****************************************************************//**
+ * \file   bench_restart.c
+ * \brief  Compares starting games on freshly allocated boards and on buffers recycled through a board cache.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "boardcache.h"
+#include "report.h"
+
+/**
+ * \typedef RestartConfig
+ * \brief Board size restarted by the restart benchmark.
+ */
+typedef struct RestartConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    int games; /**< Number of games started. */
+} RestartConfig;
+
+/**
+ * \brief Runs the restart benchmark: every game gets a board, reveals its middle cell and gives the board back.
+ *
+ * Only getting the board and the first reveal are timed, the first reveal being where a fresh board touches
+ * its pages for the first time.
+ */
+void bench_restart(void) {
+    static const RestartConfig configs[] = {
+        { "easy", 8, 8, 10, 100000 },
+        { "hard", 16, 16, 40, 100000 },
+        { "custom", 100, 100, 1600, 5000 },
+        { "custom", 1000, 1000, 160000, 100 },
+    };
+
+    static const char* const columns[] = { "preset", "board", "mines", "games", "fresh_us", "recycled_us", "speedup" };
+    report_begin("restart", "new game on fresh boards vs boards recycled through a board cache", 7, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        RestartConfig config = configs[c];
+
+        double fresh_time = 0.0;
+        for (int g = 0; g < config.games; g++) {
+            Board board;
+            double begin = bench_now();
+            initialize_board(config.rows, config.cols, config.mines, (uint64_t)g + 1, &board);
+            reveal_cell(config.rows / 2, config.cols / 2, &board);
+            fresh_time += bench_now() - begin;
+            free_board(&board);
+        }
+
+        BoardCache cache;
+        board_cache_init(&cache);
+        double recycled_time = 0.0;
+        for (int g = 0; g < config.games; g++) {
+            Board board;
+            double begin = bench_now();
+            board_cache_take(config.rows, config.cols, &board, &cache);
+            initialize_recycled_board(config.rows, config.cols, config.mines, (uint64_t)g + 1, &board);
+            reveal_cell(config.rows / 2, config.cols / 2, &board);
+            recycled_time += bench_now() - begin;
+            board_cache_release(&board, &cache);
+        }
+        board_cache_destroy(&cache);
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+        report_text(config.name);
+        report_text(size);
+        report_int(config.mines);
+        report_int(config.games);
+        report_double(fresh_time * 1e6 / config.games, 2);
+        report_double(recycled_time * 1e6 / config.games, 2);
+        report_double(recycled_time > 0.0 ? fresh_time / recycled_time : 0.0, 2);
+    }
+
+    report_end();
+}
@@ -0,0 +1,73 @@
+/*****************************************************************//**
+ * \file   bench_reveal.c
+ * \brief  Measures reveal_cell flood fill time on boards from 16x16 up to 4096x4096.
+ *********************************************************************/
+
+#include <stdio.h>
+#include "benchmark.h"
+#include "report.h"
+
+/**
+ * \brief Finds a cell without adjacent mines, so revealing it opens an area.
+ * \param board Pointer to the Board structure.
+ * \return Index of the cell, or -1 if the board has none.
+ */
+static int find_empty_cell(const Board* board) {
+    int cell_count = board->rows * board->cols;
+    for (int i = 0; i < cell_count; i++) {
+        if ((board->cells[i] & (CELL_MINE | CELL_COUNT_MASK)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * \brief Runs the reveal benchmark on square boards of growing size, empty and with 10% mines.
+ */
+void bench_reveal(void) {
+    static const int sizes[] = { 16, 64, 256, 1024, 4096 };
+    static const int densities[] = { 0, 10 };
+
+    static const char* const columns[] = { "board", "density", "opened", "ms_per_reveal", "ns_per_cell" };
+    report_begin("reveal", "reveal_cell flood fill", 5, columns);
+
+    for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+        for (int d = 0; d < (int)(sizeof(densities) / sizeof(densities[0])); d++) {
+            int size = sizes[s];
+            int mines = (int)((long long)size * size * densities[d] / 100);
+
+            // Small boards are repeated so that every configuration opens roughly the same number of cells
+            int repeats = (4096 * 4096) / (size * size);
+            if (repeats > 1000)
+                repeats = 1000;
+
+            double total_time = 0.0;
+            long long total_opened = 0;
+
+            for (int r = 0; r < repeats; r++) {
+                Board board;
+                generate_board(size, size, mines, (uint64_t)r + 1, size / 2, size / 2, &board);
+
+                int start = find_empty_cell(&board);
+                if (start >= 0) {
+                    double begin = bench_now();
+                    total_opened += reveal_cell(start / size, start % size, &board);
+                    total_time += bench_now() - begin;
+                }
+
+                free_board(&board);
+            }
+
+            char label[32];
+            snprintf(label, sizeof(label), "%dx%d", size, size);
+            report_text(label);
+            report_int(densities[d]);
+            report_int(total_opened / repeats);
+            report_double(total_time * 1e3 / repeats, 3);
+            report_double(total_opened ? total_time * 1e9 / total_opened : 0.0, 2);
+        }
+    }
+
+    report_end();
+}
@@ -0,0 +1,96 @@
+/*****************************************************************//**
+ * \file   bench_save.c
+ * \brief  Measures saving and resuming boards in each save file encoding.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "report.h"
+#include "savestate.h"
+
+/**
+ * \def BENCH_SAVE_FILE
+ * \brief Temporary save file written by the benchmark, removed afterwards.
+ */
+#define BENCH_SAVE_FILE "saper_bench.sav"
+
+/**
+ * \typedef SaveConfig
+ * \brief Board size saved by the save benchmark.
+ */
+typedef struct SaveConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+} SaveConfig;
+
+/**
+ * \brief Runs the save benchmark: a board with its middle opened is saved and loaded back in every encoding.
+ *
+ * Loading includes checking both checksums, the load of a mapped file therefore reads the whole file once.
+ * The file is in the page cache, as it is right after a save.
+ */
+void bench_save(void) {
+    static const SaveConfig configs[] = {
+        { "hard", 16, 16, 40 },
+        { "custom", 1000, 1000, 160000 },
+        { "custom", 5000, 5000, 4000000 },
+        { "custom", 10000, 10000, 16000000 },
+    };
+    static const char* const encodings[] = { "cells", "planes", "planes_rle" };
+
+    static const char* const columns[] = { "preset", "board", "encoding", "file_mb", "save_ms", "load_ms", "loaded" };
+    report_begin("save", "save files written with one write and loaded by mapping them", 7, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        SaveConfig config = configs[c];
+
+        Board board;
+        if (!initialize_board(config.rows, config.cols, config.mines, 1, &board))
+            continue;
+        reveal_cell(config.rows / 2, config.cols / 2, &board);
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+
+        for (int encoding = SAVE_CELLS; encoding <= SAVE_PLANES_RLE; encoding++) {
+            double begin = bench_now();
+            enum SaveStatus saved = save_board(BENCH_SAVE_FILE, 1.0, (enum SaveEncoding)encoding, &board);
+            double save_time = bench_now() - begin;
+
+            long file_size = 0;
+            FILE* file = fopen(BENCH_SAVE_FILE, "rb");
+            if (file) {
+                fseek(file, 0, SEEK_END);
+                file_size = ftell(file);
+                fclose(file);
+            }
+
+            Board loaded;
+            double elapsed_time;
+            begin = bench_now();
+            enum SaveStatus status = saved == SAVE_OK ? load_board(BENCH_SAVE_FILE, &elapsed_time, &loaded) : saved;
+            double load_time = bench_now() - begin;
+
+            bool same = status == SAVE_OK && loaded.revealed_count == board.revealed_count;
+            for (long long i = 0; same && i < (long long)config.rows * config.cols; i++) {
+                same = loaded.cells[i] == board.cells[i];
+            }
+            if (status == SAVE_OK)
+                free_board(&loaded);
+
+            report_text(config.name);
+            report_text(size);
+            report_text(encodings[encoding]);
+            report_double(file_size / 1048576.0, 2);
+            report_double(save_time * 1e3, 2);
+            report_double(load_time * 1e3, 2);
+            report_text(same ? "identical" : save_status_text(status));
+        }
+
+        free_board(&board);
+    }
+
+    remove(BENCH_SAVE_FILE);
+    report_end();
+}
@@ -0,0 +1,95 @@
+/*****************************************************************//**
+ * \file   bench_solver.c
+ * \brief  Measures the constraint propagation solver playing whole games without guessing.
+ *********************************************************************/
+
+#include "benchmark.h"
+#include "report.h"
+#include "solver.h"
+
+/**
+ * \typedef SolverConfig
+ * \brief Board size played by the solver benchmark.
+ */
+typedef struct SolverConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+    int games; /**< Number of games played. */
+} SolverConfig;
+
+/**
+ * \brief Runs the solver benchmark: every game starts in the middle and then only reveals the cells the solver proved safe.
+ *
+ * Only the solver calls are timed. A game is solved when the solver alone could finish it, the mistakes column
+ * counts revealed mines and must stay at zero.
+ */
+void bench_solver(void) {
+    static const SolverConfig configs[] = {
+        { "easy", 8, 8, 10, 20000 },
+        { "medium", 12, 12, 20, 20000 },
+        { "hard", 16, 16, 40, 20000 },
+        { "custom", 100, 100, 1600, 200 },
+    };
+
+    static const char* const columns[] = { "preset", "board", "mines", "games", "solved_pct", "steps_per_game", "msteps_per_sec", "us_per_game", "mistakes" };
+    report_begin("solver", "constraint propagation solver, no guessing", 9, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        SolverConfig config = configs[c];
+        double total_time = 0.0;
+        long long total_steps = 0;
+        int solved = 0;
+        int mistakes = 0;
+
+        Board board;
+        Solver solver;
+        initialize_board(config.rows, config.cols, config.mines, 0, &board);
+        solver_create(&board, &solver);
+        free_board(&board);
+
+        for (int g = 0; g < config.games; g++) {
+            initialize_board(config.rows, config.cols, config.mines, (uint64_t)g + 1, &board);
+            reveal_cell(config.rows / 2, config.cols / 2, &board);
+
+            double begin = bench_now();
+            solver_reset(&board, &solver);
+            total_time += bench_now() - begin;
+
+            while (!board.game_over && !board.game_won) {
+                begin = bench_now();
+                int index = solver_next_safe(&board, &solver);
+                total_time += bench_now() - begin;
+                if (index < 0)
+                    break;
+
+                reveal_cell(index / config.cols, index % config.cols, &board);
+
+                begin = bench_now();
+                solver_update(&board, &solver);
+                total_time += bench_now() - begin;
+            }
+
+            solved += board.game_won;
+            mistakes += board.game_over;
+            total_steps += solver.steps;
+            free_board(&board);
+        }
+        solver_destroy(&solver);
+
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", config.rows, config.cols);
+        report_text(config.name);
+        report_text(size);
+        report_int(config.mines);
+        report_int(config.games);
+        report_double(100.0 * solved / config.games, 1);
+        report_double((double)total_steps / config.games, 1);
+        report_double(total_steps / total_time / 1e6, 2);
+        report_double(total_time * 1e6 / config.games, 2);
+        report_int(mistakes);
+    }
+
+    report_end();
+}
@@ -0,0 +1,199 @@
+/*****************************************************************//**
+ * \file   bench_throughput.c
+ * \brief  Measures full headless games: generation, flags and reveals, allocations and memory.
+ *********************************************************************/
+
+#include <stdlib.h>
+#include "allocator.h"
+#include "benchmark.h"
+#include "report.h"
+#include "rng.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * \typedef ThroughputConfig
+ * \brief Board size played by the throughput benchmark.
+ */
+typedef struct ThroughputConfig {
+    const char* name; /**< Preset name, or "custom". */
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int mines; /**< Number of mines in the board. */
+} ThroughputConfig;
+
+static long long allocation_count;
+static long long allocated_bytes;
+
+/**
+ * \brief malloc that counts the allocations made by the core.
+ */
+static void* counting_malloc(size_t size) {
+    allocation_count++;
+    allocated_bytes += (long long)size;
+    return malloc(size);
+}
+
+/**
+ * \brief calloc that counts the allocations made by the core.
+ */
+static void* counting_calloc(size_t count, size_t size) {
+    allocation_count++;
+    allocated_bytes += (long long)(count * size);
+    return calloc(count, size);
+}
+
+/**
+ * \brief Returns the peak resident set size of the whole process.
+ * \return Peak memory in kilobytes.
+ */
+static long long peak_rss_kb(void) {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (long long)(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+#endif
+}
+
+/**
+ * \brief Returns the greatest common divisor of two positive numbers.
+ */
+static int gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * \brief Plays one complete game with an all-knowing player: first click, then every mine flagged and every safe cell revealed.
+ *
+ * Cells are visited in a pseudo-random order (a random start and a step coprime with the cell count),
+ * so the reveals hit a realistic mix of numbers and openings without any per-game allocation.
+ * \param config Size of the board.
+ * \param rng Pointer to the generator drawing the board seeds and the visiting order.
+ * \param times Accumulated seconds spent generating, flagging and revealing.
+ * \param flags Accumulated number of toggle_flag calls.
+ * \param reveals Accumulated number of reveal_cell calls after the first click.
+ * \return true if the game ended won, as it should.
+ */
+static bool play_game(const ThroughputConfig* config, Rng* rng, double times[3], long long* flags, long long* reveals) {
+    Board board;
+    int cell_count = config->rows * config->cols;
+
+    double begin = bench_now();
+    if (!initialize_board(config->rows, config->cols, config->mines, rng_next(rng), &board)) {
+        return false;
+    }
+    int first = (int)rng_below((uint32_t)cell_count, rng);
+    reveal_cell(first / config->cols, first % config->cols, &board);
+    double flag_begin = bench_now();
+    times[0] += flag_begin - begin;
+
+    int step = cell_count > 1 ? 1 + (int)rng_below((uint32_t)(cell_count - 1), rng) : 1;
+    while (gcd(step, cell_count) != 1)
+        step++;
+    int start = (int)rng_below((uint32_t)cell_count, rng);
+
+    int index = start;
+    for (int k = 0; k < cell_count; k++) {
+        if ((board.cells[index] & (CELL_MINE | CELL_FLAGGED)) == CELL_MINE) {
+            toggle_flag(index / config->cols, index % config->cols, &board);
+            (*flags)++;
+        }
+        index += step;
+        if (index >= cell_count)
+            index -= cell_count;
+    }
+    double reveal_begin = bench_now();
+    times[1] += reveal_begin - flag_begin;
+
+    for (int k = 0; k < cell_count && !board.game_won; k++) {
+        if (!(board.cells[index] & (CELL_MINE | CELL_REVEALED))) {
+            reveal_cell(index / config->cols, index % config->cols, &board);
+            (*reveals)++;
+        }
+        index += step;
+        if (index >= cell_count)
+            index -= cell_count;
+    }
+    check_game_won(&board);
+    times[2] += bench_now() - reveal_begin;
+
+    bool won = board.game_won && !board.game_over;
+    free_board(&board);
+    return won;
+}
+
+/**
+ * \brief Runs full games on every preset and on custom boards up to four million cells.
+ */
+void bench_throughput(void) {
+    static const ThroughputConfig configs[] = {
+        { "easy", 8, 8, 10 },
+        { "medium", 12, 12, 20 },
+        { "hard", 16, 16, 40 },
+        { "custom", 100, 100, 1560 },
+        { "custom", 1000, 1000, 156250 },
+        { "custom", 2000, 2000, 625000 },
+    };
+    static const char* const columns[] = { "preset", "board", "mines", "games", "games_per_sec", "generate_us", "ns_per_flag", "ns_per_reveal", "allocs_per_game", "kb_per_game", "peak_rss_kb", "all_won" };
+    const double budget = 0.5;
+
+    Allocator counting = { counting_malloc, counting_calloc, free };
+    set_allocator(&counting);
+
+    report_begin("throughput", "full game throughput (peak_rss_kb is the process peak so far)", 12, columns);
+
+    for (int c = 0; c < (int)(sizeof(configs) / sizeof(configs[0])); c++) {
+        const ThroughputConfig* config = &configs[c];
+        double times[3] = { 0.0, 0.0, 0.0 };
+        long long flags = 0;
+        long long reveals = 0;
+        long long games = 0;
+        bool all_won = true;
+        Rng rng;
+        rng_seed((uint64_t)c + 1, &rng);
+
+        allocation_count = 0;
+        allocated_bytes = 0;
+        double begin = bench_now();
+        do {
+            all_won &= play_game(config, &rng, times, &flags, &reveals);
+            games++;
+        } while (games < 3 || bench_now() - begin < budget);
+        double elapsed = bench_now() - begin;
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", config->rows, config->cols);
+        report_text(config->name);
+        report_text(label);
+        report_int(config->mines);
+        report_int(games);
+        report_double(games / elapsed, 1);
+        report_double(times[0] * 1e6 / games, 2);
+        report_double(flags ? times[1] * 1e9 / flags : 0.0, 2);
+        report_double(reveals ? times[2] * 1e9 / reveals : 0.0, 2);
+        report_double((double)allocation_count / games, 1);
+        report_double(allocated_bytes / 1024.0 / games, 1);
+        report_int(peak_rss_kb());
+        report_text(all_won ? "yes" : "no");
+    }
+
+    report_end();
+    set_allocator(NULL);
+}
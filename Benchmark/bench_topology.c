@@ -0,0 +1,93 @@
+/*****************************************************************//**
+ * \file   bench_topology.c
+ * \brief  Measures mine placement and flood fill in every topology, against a flood fill left unspecialized.
+ *********************************************************************/
+
+#include <stdio.h>
+#include "benchmark.h"
+#include "report.h"
+
+/**
+ * \brief Floods a board from one cell the way reveal_cell does, but asking board_neighbours for every cell.
+ *
+ * This is the loop the engine would run without a copy per topology, the reference the specialized ones beat.
+ * \param start Index of the first cell.
+ * \param board Pointer to the Board structure, without mines.
+ * \return The number of cells opened.
+ */
+static int flood_unspecialized(int start, Board* board) {
+    int opened_count = 0;
+    board->cells[start] |= CELL_REVEALED;
+    board->opened[opened_count++] = start;
+    for (int next = 0; next < opened_count; next++) {
+        int index = board->opened[next];
+        if (board->cells[index] & CELL_COUNT_MASK)
+            continue;
+
+        int neighbours[TOPOLOGY_MAX_NEIGHBOURS];
+        int count = board_neighbours(index, board, neighbours);
+        for (int n = 0; n < count; n++) {
+            if (board->cells[neighbours[n]] & (CELL_REVEALED | CELL_FLAGGED))
+                continue;
+            board->cells[neighbours[n]] |= CELL_REVEALED;
+            board->opened[opened_count++] = neighbours[n];
+        }
+    }
+    return opened_count;
+}
+
+/**
+ * \brief Runs the topology benchmark on 1024x1024 boards: 15% mines placed, then an empty board flooded.
+ *
+ * The classic rows must match the generate and reveal benchmarks, the topologies share no code path at run time.
+ */
+void bench_topology(void) {
+    enum { SIZE = 1024, DENSITY = 15, REPEATS = 8 };
+
+    static const char* const columns[] = { "topology", "board", "ms_per_board", "ns_per_mine", "ms_per_flood", "ns_per_cell", "unspecialized_ns_per_cell" };
+    report_begin("topology", "place_mines at 15% and reveal_cell flooding an empty board, in every topology", 7, columns);
+
+    int mines = SIZE * SIZE * DENSITY / 100;
+    for (int topology = 0; topology < TOPOLOGY_COUNT; topology++) {
+        double place_time = 0.0, flood_time = 0.0, unspecialized_time = 0.0;
+        long long opened = 0, unspecialized_opened = 0;
+
+        Board board;
+        if (!initialize_board(SIZE, SIZE, mines, 1, &board)) {
+            break;
+        }
+        for (int r = 0; r < REPEATS; r++) {
+            reset_board(mines, (uint64_t)r + 1, &board);
+            set_board_topology((enum Topology)topology, &board);
+            double begin = bench_now();
+            place_mines(SIZE / 2, SIZE / 2, &board);
+            place_time += bench_now() - begin;
+
+            reset_board(0, 1, &board); // Without mines, every cell is opened by the flood
+            set_board_topology((enum Topology)topology, &board);
+            board.mines_placed = true;
+            begin = bench_now();
+            opened += reveal_cell(SIZE / 2, SIZE / 2, &board);
+            flood_time += bench_now() - begin;
+
+            reset_board(0, 1, &board);
+            set_board_topology((enum Topology)topology, &board);
+            begin = bench_now();
+            unspecialized_opened += flood_unspecialized(SIZE / 2 * SIZE + SIZE / 2, &board);
+            unspecialized_time += bench_now() - begin;
+        }
+        free_board(&board);
+
+        char label[32];
+        snprintf(label, sizeof(label), "%dx%d", SIZE, SIZE);
+        report_text(topology_name((enum Topology)topology));
+        report_text(label);
+        report_double(place_time * 1e3 / REPEATS, 3);
+        report_double(place_time * 1e9 / ((double)mines * REPEATS), 2);
+        report_double(flood_time * 1e3 / REPEATS, 3);
+        report_double(opened ? flood_time * 1e9 / opened : 0.0, 2);
+        report_double(unspecialized_opened ? unspecialized_time * 1e9 / unspecialized_opened : 0.0, 2);
+    }
+
+    report_end();
+}
@@ -0,0 +1,79 @@
+/*****************************************************************//**
+ * \file   bench_world.c
+ * \brief  Measures the chunked world of the infinite mode: reveal speed and memory against the explored area.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "benchmark.h"
+#include "report.h"
+#include "world.h"
+
+/**
+ * \brief Small xorshift generator choosing the explored cells.
+ * \param state Pointer to the generator state, never zero.
+ * \return The next pseudo-random value.
+ */
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ * \brief Explores a strip of the world from a far away origin, flagging mines and revealing safe cells, and reports the cost.
+ */
+void bench_world(void) {
+    static const int origins[] = { 0, 1000000, 1000000000 };
+    static const int strips[] = { 2048, 16384 };
+    static const int max_expanded[] = { 64, 1024 };
+
+    static const char* const columns[] = { "origin", "strip", "max_expanded", "opened", "chunks", "memory_kb", "bytes_per_opened", "opened_per_s" };
+    report_begin("world", "infinite mode chunked world", 8, columns);
+
+    for (int o = 0; o < (int)(sizeof(origins) / sizeof(origins[0])); o++) {
+        for (int s = 0; s < (int)(sizeof(strips) / sizeof(strips[0])); s++) {
+            for (int m = 0; m < (int)(sizeof(max_expanded) / sizeof(max_expanded[0])); m++) {
+                World world;
+                if (!world_create(12345, 16, max_expanded[m], &world)) {
+                    continue;
+                }
+
+                int origin = origins[o];
+                uint64_t state = 0x9E3779B97F4A7C15ULL;
+                long long opened = world_reveal(origin, origin, &world);
+
+                // Moves along a 256 cell high strip, clicking around a window that slides by one cell per step
+                double begin = bench_now();
+                for (int step = 0; step < strips[s] * 4; step++) {
+                    int row = origin + (int)(next_random(&state) % 256) - 128;
+                    int col = origin + step / 4 + (int)(next_random(&state) % 64) - 32;
+                    unsigned char cell = world_cell(row, col, &world);
+                    if (cell & (CELL_REVEALED | CELL_FLAGGED))
+                        continue;
+                    if (cell & CELL_MINE)
+                        world_toggle_flag(row, col, &world);
+                    else
+                        opened += world_reveal(row, col, &world);
+                }
+                double time = bench_now() - begin;
+
+                char label[32];
+                snprintf(label, sizeof(label), "%d", origin);
+                report_text(label);
+                report_int(strips[s]);
+                report_int(max_expanded[m]);
+                report_int((int)opened);
+                report_int(world.chunk_count);
+                report_int((int)(world_memory_usage(&world) / 1024));
+                report_double(opened ? (double)world_memory_usage(&world) / opened : 0.0, 2);
+                report_double(opened / time, 0);
+
+                world_destroy(&world);
+            }
+        }
+    }
+
+    report_end();
+}
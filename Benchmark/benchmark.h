@@ -0,0 +1,37 @@
+/*****************************************************************//**
+ * \file   benchmark.h
+ * \brief  Shared helpers and entry points of the engine benchmarks.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include "board.h"
+
+/**
+ * \brief Returns a monotonic-enough wall clock time in seconds.
+ * \return Current time in seconds.
+ */
+static inline double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void bench_throughput(void);
+void bench_reveal(void);
+void bench_generate(void);
+void bench_bitboard(void);
+void bench_world(void);
+void bench_solver(void);
+void bench_probability(void);
+void bench_noguess(void);
+void bench_restart(void);
+void bench_save(void);
+void bench_replay(void);
+void bench_analysis(void);
+void bench_stats(void);
+void bench_bots(void);
+void bench_topology(void);
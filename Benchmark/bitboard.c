@@ -0,0 +1,407 @@
+/*****************************************************************//**
+ * \file   bitboard.c
+ * \brief  Bit-parallel adjacency counting and flood fill over row bitsets.
+ *********************************************************************/
+
+#include <string.h>
+#include "allocator.h"
+#include "bitboard.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * \brief Returns a pointer to the first word of a row of a plane, guard rows -1 and rows included.
+ */
+static inline uint64_t* plane_row(const Bitboard* bb, uint64_t* plane, int row) {
+    return plane + (size_t)(row + 1) * bb->stride + 1;
+}
+
+/**
+ * \brief Returns the mask of the bits of a row word that belong to the board.
+ */
+static inline uint64_t valid_mask(const Bitboard* bb, int word) {
+    int bits = bb->cols - word * 64;
+    return bits >= 64 ? ~0ull : (1ull << bits) - 1;
+}
+
+/**
+ * \brief Counts the set bits of a word.
+ */
+static inline int popcount64(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(value);
+#elif defined(__GNUC__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value) {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/**
+ * \brief Shifts a row so that bit j holds the cell at column j - 1.
+ */
+static inline uint64_t west(const uint64_t* row, int word) {
+    return (row[word] << 1) | (row[word - 1] >> 63);
+}
+
+/**
+ * \brief Shifts a row so that bit j holds the cell at column j + 1.
+ */
+static inline uint64_t east(const uint64_t* row, int word) {
+    return (row[word] >> 1) | (row[word + 1] << 63);
+}
+
+/**
+ * \brief Allocates the planes of a bitboard, all cleared.
+ * \param bb Pointer to the Bitboard structure.
+ * \param rows Number of rows in the board.
+ * \param cols Number of columns in the board.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool bitboard_create(Bitboard* bb, int rows, int cols) {
+    bb->rows = rows;
+    bb->cols = cols;
+    bb->words = (cols + 63) / 64;
+    bb->stride = ((bb->words + 3) & ~3) + 2; // Rows padded to whole AVX2 vectors, plus a guard word on each side
+
+    size_t plane_size = (size_t)(rows + 2) * bb->stride;
+    bb->memory = (uint64_t*)core_calloc(plane_size * 5 + 2 * (size_t)bb->stride, sizeof(uint64_t));
+    if (!bb->memory) {
+        return false;
+    }
+
+    bb->mines = bb->memory;
+    bb->empty = bb->mines + plane_size;
+    bb->revealed = bb->empty + plane_size;
+    bb->flagged = bb->revealed + plane_size;
+    bb->spread = bb->flagged + plane_size;
+    bb->scratch = bb->spread + plane_size;
+    return true;
+}
+
+/**
+ * \brief Frees the planes of a bitboard.
+ * \param bb Pointer to the Bitboard structure.
+ */
+void bitboard_destroy(Bitboard* bb) {
+    core_free(bb->memory);
+    bb->memory = NULL;
+}
+
+/**
+ * \brief Fills the mine, revealed and flagged planes from the packed cells of a board of the same size.
+ * \param bb Pointer to the Bitboard structure.
+ * \param board Pointer to the Board structure.
+ */
+void bitboard_load(Bitboard* bb, const Board* board) {
+    size_t plane_size = (size_t)(bb->rows + 2) * bb->stride;
+    memset(bb->memory, 0, (plane_size * 5 + 2 * (size_t)bb->stride) * sizeof(uint64_t));
+
+    for (int i = 0; i < bb->rows; i++) {
+        uint64_t* mines = plane_row(bb, bb->mines, i);
+        uint64_t* revealed = plane_row(bb, bb->revealed, i);
+        uint64_t* flagged = plane_row(bb, bb->flagged, i);
+        const unsigned char* cells = cell_at(board, i, 0);
+
+        for (int j = 0; j < bb->cols; j++) {
+            uint64_t bit = 1ull << (j & 63);
+            if (cells[j] & CELL_MINE)
+                mines[j >> 6] |= bit;
+            if (cells[j] & CELL_REVEALED)
+                revealed[j >> 6] |= bit;
+            if (cells[j] & CELL_FLAGGED)
+                flagged[j >> 6] |= bit;
+        }
+    }
+}
+
+/**
+ * \brief Adds eight one-bit planes into a four-bit count, one bit-sliced adder per bit position.
+ */
+static inline void add8(uint64_t a, uint64_t b, uint64_t c, uint64_t d, uint64_t e, uint64_t f, uint64_t g, uint64_t h, uint64_t sum[4]) {
+    uint64_t s0 = a ^ b ^ c, c0 = (a & b) | (c & (a ^ b));
+    uint64_t s1 = d ^ e ^ f, c1 = (d & e) | (f & (d ^ e));
+    uint64_t s2 = g ^ h, c2 = g & h;
+    uint64_t k = (s0 & s1) | (s2 & (s0 ^ s1));
+    uint64_t t0 = c0 ^ c1 ^ c2, t1 = (c0 & c1) | (c2 & (c0 ^ c1));
+    uint64_t u = t0 & k;
+    sum[0] = s0 ^ s1 ^ s2;
+    sum[1] = t0 ^ k;
+    sum[2] = t1 ^ u;
+    sum[3] = t1 & u;
+}
+
+#if defined(__AVX2__)
+/**
+ * \brief AVX2 version of add8, handling four row words at once.
+ */
+static inline void add8_avx2(__m256i a, __m256i b, __m256i c, __m256i d, __m256i e, __m256i f, __m256i g, __m256i h, __m256i sum[4]) {
+    __m256i ab = _mm256_xor_si256(a, b), de = _mm256_xor_si256(d, e);
+    __m256i s0 = _mm256_xor_si256(ab, c), c0 = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, ab));
+    __m256i s1 = _mm256_xor_si256(de, f), c1 = _mm256_or_si256(_mm256_and_si256(d, e), _mm256_and_si256(f, de));
+    __m256i s2 = _mm256_xor_si256(g, h), c2 = _mm256_and_si256(g, h);
+    __m256i s01 = _mm256_xor_si256(s0, s1), c01 = _mm256_xor_si256(c0, c1);
+    __m256i k = _mm256_or_si256(_mm256_and_si256(s0, s1), _mm256_and_si256(s2, s01));
+    __m256i t0 = _mm256_xor_si256(c01, c2), t1 = _mm256_or_si256(_mm256_and_si256(c0, c1), _mm256_and_si256(c2, c01));
+    __m256i u = _mm256_and_si256(t0, k);
+    sum[0] = _mm256_xor_si256(s01, s2);
+    sum[1] = _mm256_xor_si256(t0, k);
+    sum[2] = _mm256_xor_si256(t1, u);
+    sum[3] = _mm256_and_si256(t1, u);
+}
+
+/**
+ * \brief Loads four row words shifted like west().
+ */
+static inline __m256i west_avx2(const uint64_t* row, int word) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(row + word));
+    __m256i prev = _mm256_loadu_si256((const __m256i*)(row + word - 1));
+    return _mm256_or_si256(_mm256_slli_epi64(v, 1), _mm256_srli_epi64(prev, 63));
+}
+
+/**
+ * \brief Loads four row words shifted like east().
+ */
+static inline __m256i east_avx2(const uint64_t* row, int word) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(row + word));
+    __m256i next = _mm256_loadu_si256((const __m256i*)(row + word + 1));
+    return _mm256_or_si256(_mm256_srli_epi64(v, 1), _mm256_slli_epi64(next, 63));
+}
+#endif
+
+/**
+ * \brief Writes the counts of one row word into the packed cells and updates the empty plane.
+ */
+static void store_counts(Bitboard* bb, unsigned char* cells, int row, int word, const uint64_t sum[4]) {
+    uint64_t mines = plane_row(bb, bb->mines, row)[word];
+    plane_row(bb, bb->empty, row)[word] = ~(sum[0] | sum[1] | sum[2] | sum[3]) & ~mines & valid_mask(bb, word);
+
+    unsigned char* out = cells + (size_t)row * bb->cols + word * 64;
+    int bits = bb->cols - word * 64;
+    if (bits > 64)
+        bits = 64;
+    for (int k = 0; k < bits; k++) {
+        unsigned char count = (unsigned char)(((sum[0] >> k) & 1) | (((sum[1] >> k) & 1) << 1) | (((sum[2] >> k) & 1) << 2) | (((sum[3] >> k) & 1) << 3));
+        out[k] = (out[k] & ~CELL_COUNT_MASK) | count;
+    }
+}
+
+/**
+ * \brief Computes the number of adjacent mines of every cell from the mine plane.
+ *
+ * The eight neighbour planes of a row are built with shifted-word operations and summed with a
+ * bit-sliced adder, four words at a time with AVX2 when the compiler targets it.
+ * The result matches the counts kept by place_mines, and fills the empty plane used by bitboard_reveal.
+ * \param bb Pointer to the Bitboard structure.
+ * \param cells Packed cells of a rows * cols board, only their count bits are written.
+ */
+void bitboard_count_adjacent(Bitboard* bb, unsigned char* cells) {
+    for (int i = 0; i < bb->rows; i++) {
+        const uint64_t* up = plane_row(bb, bb->mines, i - 1);
+        const uint64_t* mid = plane_row(bb, bb->mines, i);
+        const uint64_t* down = plane_row(bb, bb->mines, i + 1);
+        int w = 0;
+
+#if defined(__AVX2__)
+        for (; w + 4 <= bb->words; w += 4) {
+            __m256i sum[4];
+            add8_avx2(west_avx2(up, w), _mm256_loadu_si256((const __m256i*)(up + w)), east_avx2(up, w),
+                west_avx2(mid, w), east_avx2(mid, w),
+                west_avx2(down, w), _mm256_loadu_si256((const __m256i*)(down + w)), east_avx2(down, w), sum);
+
+            uint64_t lanes[4][4];
+            for (int b = 0; b < 4; b++)
+                _mm256_storeu_si256((__m256i*)lanes[b], sum[b]);
+            for (int l = 0; l < 4; l++) {
+                uint64_t word_sum[4] = { lanes[0][l], lanes[1][l], lanes[2][l], lanes[3][l] };
+                store_counts(bb, cells, i, w + l, word_sum);
+            }
+        }
+#endif
+
+        for (; w < bb->words; w++) {
+            uint64_t sum[4];
+            add8(west(up, w), up[w], east(up, w), west(mid, w), east(mid, w), west(down, w), down[w], east(down, w), sum);
+            store_counts(bb, cells, i, w, sum);
+        }
+    }
+}
+
+/**
+ * \brief Extends the spread plane of one row: cells next to a spreading cell, then whole runs of empty cells.
+ * \return true if the row gained new spreading cells.
+ */
+static bool spread_row(Bitboard* bb, int row, uint64_t* seeds, uint64_t* allowed) {
+    uint64_t* spread = plane_row(bb, bb->spread, row);
+    const uint64_t* up = plane_row(bb, bb->spread, row - 1);
+    const uint64_t* down = plane_row(bb, bb->spread, row + 1);
+    const uint64_t* empty = plane_row(bb, bb->empty, row);
+    const uint64_t* revealed = plane_row(bb, bb->revealed, row);
+    const uint64_t* flagged = plane_row(bb, bb->flagged, row);
+
+    // Masked dilation of the spreading cells of this row and of its two neighbours
+    uint64_t previous = 0;
+    uint64_t current = up[0] | spread[0] | down[0];
+    bool any = false;
+    for (int w = 0; w < bb->words; w++) {
+        uint64_t next = up[w + 1] | spread[w + 1] | down[w + 1];
+        allowed[w] = empty[w] & ~revealed[w] & ~flagged[w];
+        seeds[w] = (current | (current << 1) | (previous >> 63) | (current >> 1) | (next << 63)) & allowed[w];
+        any |= seeds[w] != 0;
+        previous = current;
+        current = next;
+    }
+    if (!any) {
+        return false;
+    }
+    //
+
+    // Filling runs of allowed cells towards higher columns, the addition carry crosses word boundaries
+    uint64_t carry = 0;
+    for (int w = 0; w < bb->words; w++) {
+        uint64_t t = allowed[w] + seeds[w];
+        uint64_t c1 = t < allowed[w];
+        uint64_t s = t + carry;
+        carry = c1 | (s < t);
+        seeds[w] |= (s ^ allowed[w]) & allowed[w];
+    }
+    //
+
+    // Filling runs towards lower columns with an occluded Kogge-Stone fill
+    carry = 0;
+    bool changed = false;
+    for (int w = bb->words - 1; w >= 0; w--) {
+        uint64_t g = seeds[w] | ((carry << 63) & allowed[w]);
+        uint64_t p = allowed[w];
+        g |= p & (g >> 1);
+        p &= p >> 1;
+        g |= p & (g >> 2);
+        p &= p >> 2;
+        g |= p & (g >> 4);
+        p &= p >> 4;
+        g |= p & (g >> 8);
+        p &= p >> 8;
+        g |= p & (g >> 16);
+        p &= p >> 16;
+        g |= p & (g >> 32);
+        carry = g & 1;
+
+        if (g & ~spread[w]) {
+            spread[w] |= g;
+            changed = true;
+        }
+    }
+    //
+
+    return changed;
+}
+
+/**
+ * \brief Reveals a cell and, if it has no adjacent mines, the whole area around it, like reveal_cell.
+ *
+ * The empty cells connected to the revealed one are grown by repeated masked dilation, sweeping the rows
+ * down and up until nothing changes, then their neighbours are opened in one pass.
+ * bitboard_count_adjacent must have been called to fill the empty plane.
+ * \param bb Pointer to the Bitboard structure.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param hit_mine Set to true if the revealed cell contains a mine.
+ * \return The number of cells opened.
+ */
+int bitboard_reveal(Bitboard* bb, int row, int col, bool* hit_mine) {
+    *hit_mine = false;
+
+    if (row < 0 || row >= bb->rows || col < 0 || col >= bb->cols) {
+        return 0;
+    }
+    if (bitboard_is_set(bb, bb->revealed, row, col) || bitboard_is_set(bb, bb->flagged, row, col)) {
+        return 0;
+    }
+
+    uint64_t bit = 1ull << (col & 63);
+    if (!bitboard_is_set(bb, bb->empty, row, col)) {
+        plane_row(bb, bb->revealed, row)[col >> 6] |= bit;
+        *hit_mine = bitboard_is_set(bb, bb->mines, row, col);
+        return 1;
+    }
+
+    uint64_t* seeds = bb->scratch;
+    uint64_t* allowed = bb->scratch + bb->stride;
+
+    plane_row(bb, bb->spread, row)[col >> 6] |= bit;
+    int lo = row;
+    int hi = row;
+
+    bool changed = true;
+    for (bool downward = true; changed; downward = !downward) {
+        changed = false;
+        if (downward) {
+            for (int i = lo > 0 ? lo - 1 : 0; i <= hi + 1 && i < bb->rows; i++) {
+                if (spread_row(bb, i, seeds, allowed)) {
+                    changed = true;
+                    lo = i < lo ? i : lo;
+                    hi = i > hi ? i : hi;
+                }
+            }
+        }
+        else {
+            for (int i = hi + 1 < bb->rows ? hi + 1 : bb->rows - 1; i >= lo - 1 && i >= 0; i--) {
+                if (spread_row(bb, i, seeds, allowed)) {
+                    changed = true;
+                    lo = i < lo ? i : lo;
+                    hi = i > hi ? i : hi;
+                }
+            }
+        }
+    }
+
+    // Opening the spreading cells and all their neighbours
+    int opened = 0;
+    int first = lo > 0 ? lo - 1 : 0;
+    int last = hi + 1 < bb->rows ? hi + 1 : bb->rows - 1;
+    for (int i = first; i <= last; i++) {
+        const uint64_t* up = plane_row(bb, bb->spread, i - 1);
+        const uint64_t* mid = plane_row(bb, bb->spread, i);
+        const uint64_t* down = plane_row(bb, bb->spread, i + 1);
+        uint64_t* revealed = plane_row(bb, bb->revealed, i);
+        const uint64_t* flagged = plane_row(bb, bb->flagged, i);
+
+        for (int w = 0; w < bb->words; w++) {
+            uint64_t around = up[w] | mid[w] | down[w];
+            uint64_t left = up[w - 1] | mid[w - 1] | down[w - 1];
+            uint64_t right = up[w + 1] | mid[w + 1] | down[w + 1];
+            uint64_t open = (around | (around << 1) | (left >> 63) | (around >> 1) | (right << 63)) & ~revealed[w] & ~flagged[w] & valid_mask(bb, w);
+            opened += popcount64(open);
+            revealed[w] |= open;
+        }
+    }
+    for (int i = lo; i <= hi; i++) {
+        memset(plane_row(bb, bb->spread, i), 0, sizeof(uint64_t) * bb->words);
+    }
+    //
+
+    return opened;
+}
+
+/**
+ * \brief Checks if the bit of a cell is set in a plane.
+ * \param bb Pointer to the Bitboard structure.
+ * \param plane One of the planes of the bitboard.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \return true if the bit is set.
+ */
+bool bitboard_is_set(const Bitboard* bb, const uint64_t* plane, int row, int col) {
+    return (plane_row(bb, (uint64_t*)plane, row)[col >> 6] >> (col & 63)) & 1;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************//**
+ * \file   bitboard.h
+ * \brief  Experimental bitboard engine storing the board as row bitsets of 64-bit words, for classic boards only.
+ *
+ * Not part of the core: the game runs on the cell array, and bench_bitboard measures this engine against it.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include "board.h"
+
+/**
+ * \typedef Bitboard
+ * \brief Board planes stored as one bit per cell, 64 cells per word.
+ *
+ * Every plane has a zero guard row above and below the board and zero guard words on both sides of
+ * each row, so neighbour words can be read without bounds checks. Bits past the last column are always zero.
+ */
+typedef struct Bitboard {
+    int rows; /**< Number of rows in the board. */
+    int cols; /**< Number of columns in the board. */
+    int words; /**< Number of 64-bit words holding the cells of one row. */
+    int stride; /**< Number of words between the starts of two consecutive rows, guard words included. */
+    uint64_t* memory; /**< Single allocation holding all the planes. */
+    uint64_t* mines; /**< Plane of cells containing a mine. */
+    uint64_t* empty; /**< Plane of safe cells without adjacent mines, filled by bitboard_count_adjacent. */
+    uint64_t* revealed; /**< Plane of revealed cells. */
+    uint64_t* flagged; /**< Plane of flagged cells. */
+    uint64_t* spread; /**< Scratch plane used by bitboard_reveal. */
+    uint64_t* scratch; /**< Two scratch rows used by bitboard_reveal. */
+} Bitboard;
+
+bool bitboard_create(Bitboard* bb, int rows, int cols);
+void bitboard_destroy(Bitboard* bb);
+void bitboard_load(Bitboard* bb, const Board* board);
+void bitboard_count_adjacent(Bitboard* bb, unsigned char* cells);
+int bitboard_reveal(Bitboard* bb, int row, int col, bool* hit_mine);
+bool bitboard_is_set(const Bitboard* bb, const uint64_t* plane, int row, int col);
@@ -0,0 +1,86 @@
+/*****************************************************************//**
+ * \file   main.c
+ * \brief  The entry point of the engine benchmarks.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "benchmark.h"
+#include "report.h"
+
+/**
+ * \typedef Benchmark
+ * \brief A benchmark that can be selected on the command line.
+ */
+typedef struct Benchmark {
+    const char* name; /**< Name used on the command line. */
+    void (*run)(void); /**< Function running the benchmark. */
+} Benchmark;
+
+/**
+ * \brief Runs the selected benchmarks and prints the results to the standard output.
+ *
+ * Usage: saper_benchmark [--format text|csv|json] [throughput] [reveal] [generate] [bitboard] [world] [solver] [probability] [noguess] [restart] [save] [replay] [analysis] [stats] [bots] [topology].
+ * Without names, every benchmark runs, the throughput one first so its peak memory is not skewed by the others.
+ * \param argc Number of command line arguments.
+ * \param argv Command line arguments.
+ * \return 0 on success, 1 on invalid arguments.
+ */
+int main(int argc, char** argv) {
+    static const Benchmark benchmarks[] = {
+        { "throughput", bench_throughput },
+        { "reveal", bench_reveal },
+        { "generate", bench_generate },
+        { "bitboard", bench_bitboard },
+        { "world", bench_world },
+        { "solver", bench_solver },
+        { "probability", bench_probability },
+        { "noguess", bench_noguess },
+        { "restart", bench_restart },
+        { "save", bench_save },
+        { "replay", bench_replay },
+        { "analysis", bench_analysis },
+        { "stats", bench_stats },
+        { "bots", bench_bots },
+        { "topology", bench_topology },
+    };
+    const int benchmark_count = (int)(sizeof(benchmarks) / sizeof(benchmarks[0]));
+    bool selected[sizeof(benchmarks) / sizeof(benchmarks[0])] = { false };
+    bool any_selected = false;
+    ReportFormat format = REPORT_TEXT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "csv") == 0)
+                format = REPORT_CSV;
+            else if (strcmp(argv[i], "json") == 0)
+                format = REPORT_JSON;
+            else if (strcmp(argv[i], "text") != 0) {
+                fprintf(stderr, "Unknown format: %s\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+
+        int b = 0;
+        while (b < benchmark_count && strcmp(argv[i], benchmarks[b].name) != 0)
+            b++;
+        if (b == benchmark_count) {
+            fprintf(stderr, "Usage: %s [--format text|csv|json] [throughput] [reveal] [generate] [bitboard] [world] [solver] [probability] [noguess] [restart] [save] [replay] [analysis] [stats] [bots] [topology]\n", argv[0]);
+            return 1;
+        }
+        selected[b] = true;
+        any_selected = true;
+    }
+
+    report_open(format);
+    for (int b = 0; b < benchmark_count; b++) {
+        if (selected[b] || !any_selected) {
+            benchmarks[b].run();
+        }
+    }
+    report_close();
+
+    return 0;
+}
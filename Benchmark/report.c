@@ -0,0 +1,166 @@
+/*****************************************************************//**
+ * \file   report.c
+ * \brief  Benchmark result tables printed as aligned text, CSV or JSON.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "report.h"
+
+#define REPORT_MAX_COLUMNS 16
+
+static ReportFormat report_format = REPORT_TEXT;
+static const char* table_name;
+static const char* const* table_columns;
+static int table_column_count;
+static int table_widths[REPORT_MAX_COLUMNS];
+static int current_column;
+static int table_count;
+static int row_count;
+
+/**
+ * \brief Starts the report, must be called before any table.
+ * \param format Output format of every table.
+ */
+void report_open(ReportFormat format) {
+    report_format = format;
+    table_count = 0;
+    if (report_format == REPORT_JSON) {
+        printf("{\n  \"benchmarks\": [");
+    }
+}
+
+/**
+ * \brief Ends the report, closing the JSON document if needed.
+ */
+void report_close(void) {
+    if (report_format == REPORT_JSON) {
+        printf("\n  ]\n}\n");
+    }
+    fflush(stdout);
+}
+
+/**
+ * \brief Starts a table of results.
+ * \param name Machine-readable name of the table.
+ * \param title Human-readable title, only printed in text mode.
+ * \param column_count Number of columns, at most 16.
+ * \param columns Machine-readable names of the columns.
+ */
+void report_begin(const char* name, const char* title, int column_count, const char* const columns[]) {
+    table_name = name;
+    table_columns = columns;
+    table_column_count = column_count < REPORT_MAX_COLUMNS ? column_count : REPORT_MAX_COLUMNS;
+    current_column = 0;
+    row_count = 0;
+
+    switch (report_format) {
+    case REPORT_TEXT:
+        printf("%s%s\n", table_count ? "\n" : "", title);
+        for (int i = 0; i < table_column_count; i++) {
+            int length = (int)strlen(columns[i]) + 1;
+            table_widths[i] = length > 12 ? length : 12;
+            printf("%*s", table_widths[i], columns[i]);
+        }
+        printf("\n");
+        break;
+    case REPORT_CSV:
+        printf("benchmark");
+        for (int i = 0; i < table_column_count; i++) {
+            printf(",%s", columns[i]);
+        }
+        printf("\n");
+        break;
+    case REPORT_JSON:
+        printf("%s\n    { \"name\": \"%s\", \"rows\": [", table_count ? "," : "", name);
+        break;
+    }
+    table_count++;
+}
+
+/**
+ * \brief Prints the separator and key placed before the next value of the current row.
+ */
+static void begin_value(void) {
+    if (current_column == 0) {
+        if (report_format == REPORT_CSV) {
+            printf("%s", table_name);
+        }
+        else if (report_format == REPORT_JSON) {
+            printf("%s\n      {", row_count ? "," : "");
+        }
+    }
+
+    if (report_format == REPORT_CSV) {
+        printf(",");
+    }
+    else if (report_format == REPORT_JSON) {
+        printf("%s\"%s\": ", current_column ? ", " : " ", table_columns[current_column]);
+    }
+}
+
+/**
+ * \brief Finishes the current value, ending the row after its last column.
+ */
+static void end_value(void) {
+    if (++current_column < table_column_count) {
+        return;
+    }
+
+    if (report_format == REPORT_JSON) {
+        printf(" }");
+    }
+    else {
+        printf("\n");
+    }
+    current_column = 0;
+    row_count++;
+}
+
+/**
+ * \brief Adds a text value to the current row.
+ * \param value The text, without quotes, commas or backslashes.
+ */
+void report_text(const char* value) {
+    begin_value();
+    if (report_format == REPORT_TEXT) {
+        printf("%*s", table_widths[current_column], value);
+    }
+    else if (report_format == REPORT_CSV) {
+        printf("%s", value);
+    }
+    else {
+        printf("\"%s\"", value);
+    }
+    end_value();
+}
+
+/**
+ * \brief Adds an integer value to the current row.
+ * \param value The number.
+ */
+void report_int(long long value) {
+    begin_value();
+    printf("%*lld", report_format == REPORT_TEXT ? table_widths[current_column] : 0, value);
+    end_value();
+}
+
+/**
+ * \brief Adds a floating-point value to the current row.
+ * \param value The number.
+ * \param decimals Number of digits after the decimal point.
+ */
+void report_double(double value, int decimals) {
+    begin_value();
+    printf("%*.*f", report_format == REPORT_TEXT ? table_widths[current_column] : 0, decimals, value);
+    end_value();
+}
+
+/**
+ * \brief Ends the current table.
+ */
+void report_end(void) {
+    if (report_format == REPORT_JSON) {
+        printf("\n    ] }");
+    }
+}
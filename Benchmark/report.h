@@ -0,0 +1,24 @@
+/*****************************************************************//**
+ * \file   report.h
+ * \brief  Benchmark result tables printed as aligned text, CSV or JSON.
+ *********************************************************************/
+
+#pragma once
+
+/**
+ * \typedef ReportFormat
+ * \brief Output format of the benchmark results.
+ */
+typedef enum ReportFormat {
+    REPORT_TEXT, /**< Aligned tables for humans. */
+    REPORT_CSV, /**< One CSV header per table, each row prefixed by the table name. */
+    REPORT_JSON /**< A single JSON document holding every table. */
+} ReportFormat;
+
+void report_open(ReportFormat format);
+void report_close(void);
+void report_begin(const char* name, const char* title, int column_count, const char* const columns[]);
+void report_text(const char* value);
+void report_int(long long value);
+void report_double(double value, int decimals);
+void report_end(void);
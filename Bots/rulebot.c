@@ -0,0 +1,225 @@
+/*****************************************************************//**
+ * \file   rulebot.c
+ * \brief  Example bot plugin applying the two single-number rules, and guessing when they are stuck.
+ *
+ * A number whose flags account for all its mines has its other hidden neighbours safe. A number whose
+ * hidden neighbours are all needed for its mines has them all flagged. The rules only need checking around
+ * the cells changed by the last batch, so a turn costs what changed, not the size of the board.
+ *
+ * Built as a shared library, it depends on botapi.h only.
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "botapi.h"
+
+/**
+ * \typedef RuleBot
+ * \brief State of a bot, reused from game to game.
+ */
+typedef struct RuleBot {
+    int32_t rows; /**< Number of rows of the board. */
+    int32_t cols; /**< Number of columns of the board. */
+    int32_t* pending; /**< Numbers to check this turn. */
+    int32_t carried; /**< Numbers at the front of pending left unchecked by a full batch, checked first next turn. */
+    uint32_t* stamp; /**< Turn a cell was last queued or acted on, so each is handled once per turn. */
+    uint32_t turn; /**< Number of the current turn, never 0. */
+    uint64_t random; /**< State of the generator of the guesses. */
+} RuleBot;
+
+/**
+ * \brief Returns the next value of a splitmix64 generator.
+ */
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/**
+ * \brief Allocates a bot for boards of one size.
+ * \param rows Number of rows of the boards.
+ * \param cols Number of columns of the boards.
+ * \param mines Number of mines of the boards.
+ * \return The bot, NULL if the memory could not be allocated.
+ */
+static void* create_bot(int32_t rows, int32_t cols, int32_t mines) {
+    (void)mines;
+    RuleBot* bot = calloc(1, sizeof(RuleBot));
+    if (!bot) {
+        return NULL;
+    }
+    size_t cell_count = (size_t)rows * cols;
+    bot->rows = rows;
+    bot->cols = cols;
+    bot->pending = malloc(cell_count * sizeof(int32_t));
+    bot->stamp = calloc(cell_count, sizeof(uint32_t));
+    if (!bot->pending || !bot->stamp) {
+        free(bot->pending);
+        free(bot->stamp);
+        free(bot);
+        return NULL;
+    }
+    return bot;
+}
+
+/**
+ * \brief Frees a bot.
+ * \param state The bot.
+ */
+static void destroy_bot(void* state) {
+    RuleBot* bot = state;
+    free(bot->pending);
+    free(bot->stamp);
+    free(bot);
+}
+
+/**
+ * \brief Starts a game, seeding the guesses from its number so runs are reproducible.
+ * \param state The bot.
+ * \param game Number of the game in the run.
+ */
+static void start_game(void* state, int64_t game) {
+    RuleBot* bot = state;
+    bot->random = (uint64_t)game;
+    bot->carried = 0;
+}
+
+/**
+ * \brief Starts a new turn, clearing the stamps when the counter wraps around.
+ */
+static void next_turn(RuleBot* bot) {
+    if (++bot->turn == 0) {
+        memset(bot->stamp, 0, (size_t)bot->rows * bot->cols * sizeof(uint32_t));
+        bot->turn = 1;
+    }
+}
+
+/**
+ * \brief Queues the revealed numbers around and at a changed cell.
+ */
+static void queue_numbers(int32_t index, const BotView* view, RuleBot* bot, int32_t* pending_count) {
+    int32_t row = index / view->cols;
+    int32_t col = index % view->cols;
+    for (int32_t r = row - 1; r <= row + 1; r++) {
+        for (int32_t c = col - 1; c <= col + 1; c++) {
+            if (r < 0 || r >= view->rows || c < 0 || c >= view->cols)
+                continue;
+            int32_t neighbour = r * view->cols + c;
+            uint8_t value = view->cells[neighbour];
+            if (value >= 1 && value <= 8 && bot->stamp[neighbour] != bot->turn) {
+                bot->stamp[neighbour] = bot->turn;
+                bot->pending[(*pending_count)++] = neighbour;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Applies the two rules to one number, adding actions for its hidden neighbours.
+ * \return New number of actions.
+ */
+static int32_t apply_rules(int32_t index, const BotView* view, RuleBot* bot, BotAction* actions, int32_t count, int32_t capacity) {
+    int32_t row = index / view->cols;
+    int32_t col = index % view->cols;
+    int32_t hidden = 0;
+    int32_t flags = 0;
+    for (int32_t r = row - 1; r <= row + 1; r++) {
+        for (int32_t c = col - 1; c <= col + 1; c++) {
+            if (r < 0 || r >= view->rows || c < 0 || c >= view->cols)
+                continue;
+            uint8_t value = view->cells[r * view->cols + c];
+            hidden += value == BOT_CELL_HIDDEN;
+            flags += value == BOT_CELL_FLAG;
+        }
+    }
+
+    int32_t mines = view->cells[index];
+    int32_t kind;
+    if (hidden > 0 && flags == mines)
+        kind = BOT_REVEAL;
+    else if (hidden > 0 && mines - flags == hidden)
+        kind = BOT_FLAG;
+    else
+        return count;
+
+    for (int32_t r = row - 1; r <= row + 1 && count < capacity; r++) {
+        for (int32_t c = col - 1; c <= col + 1 && count < capacity; c++) {
+            if (r < 0 || r >= view->rows || c < 0 || c >= view->cols)
+                continue;
+            int32_t neighbour = r * view->cols + c;
+            if (view->cells[neighbour] != BOT_CELL_HIDDEN || bot->stamp[neighbour] == bot->turn)
+                continue;
+            bot->stamp[neighbour] = bot->turn; // Hidden cells are never queued, the stamp only marks actions
+            actions[count].index = neighbour;
+            actions[count].kind = kind;
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * \brief Plays a turn: the rules around the changed cells, or a random hidden cell when they find nothing.
+ * \param state The bot.
+ * \param view The visible board.
+ * \param actions Receives the actions.
+ * \param capacity Largest number of actions.
+ * \return Number of actions, 0 when no hidden cell is left.
+ */
+static int32_t play_turn(void* state, const BotView* view, BotAction* actions, int32_t capacity) {
+    RuleBot* bot = state;
+    next_turn(bot);
+
+    int32_t pending_count = bot->carried;
+    for (int32_t i = 0; i < pending_count; i++) {
+        bot->stamp[bot->pending[i]] = bot->turn;
+    }
+    for (int32_t i = 0; i < view->changed_count; i++) {
+        queue_numbers(view->changed[i], view, bot, &pending_count);
+    }
+    int32_t count = 0;
+    int32_t checked = 0;
+    for (; checked < pending_count && count < capacity; checked++) {
+        count = apply_rules(bot->pending[checked], view, bot, actions, count, capacity);
+    }
+
+    // Nothing changes around the numbers not checked, so they would never be queued again
+    bot->carried = pending_count - checked;
+    memmove(bot->pending, bot->pending + checked, (size_t)bot->carried * sizeof(int32_t));
+    if (count > 0) {
+        return count;
+    }
+    //
+
+    // Stuck, a few random picks find a hidden cell quickly while many are left, then a scan from a random cell
+    int32_t cell_count = view->rows * view->cols;
+    for (int attempt = 0; attempt < 16; attempt++) {
+        int32_t index = (int32_t)(next_random(&bot->random) % (uint64_t)cell_count);
+        if (view->cells[index] == BOT_CELL_HIDDEN) {
+            actions[0].index = index;
+            actions[0].kind = BOT_REVEAL;
+            return 1;
+        }
+    }
+    int32_t start = (int32_t)(next_random(&bot->random) % (uint64_t)cell_count);
+    for (int32_t i = 0; i < cell_count; i++) {
+        int32_t index = (start + i) % cell_count;
+        if (view->cells[index] == BOT_CELL_HIDDEN) {
+            actions[0].index = index;
+            actions[0].kind = BOT_REVEAL;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * \brief The entry point of the plugin.
+ * \return The interface of the bot.
+ */
+BOT_EXPORT const BotInterface* bot_interface(void) {
+    static const BotInterface rule_bot = { BOT_API_VERSION, "rulebot", create_bot, destroy_bot, start_game, play_turn };
+    return &rule_bot;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************//**
+ * \file   allocator.c
+ * \brief  Replaceable memory allocation functions used by the headless core.
+ *********************************************************************/
+
+#include <stdlib.h>
+#include "allocator.h"
+
+static Allocator current_allocator = { malloc, calloc, free };
+
+/**
+ * \brief Replaces the functions used by the core to allocate memory, for example to count allocations.
+ * \param allocator Pointer to the new functions, or NULL to go back to the C library ones.
+ */
+void set_allocator(const Allocator* allocator) {
+    if (allocator) {
+        current_allocator = *allocator;
+    }
+    else {
+        current_allocator.malloc_fn = malloc;
+        current_allocator.calloc_fn = calloc;
+        current_allocator.free_fn = free;
+    }
+}
+
+/**
+ * \brief Allocates uninitialized memory through the current allocator.
+ * \param size Number of bytes to allocate.
+ * \return Pointer to the memory, or NULL on failure.
+ */
+void* core_malloc(size_t size) {
+    return current_allocator.malloc_fn(size);
+}
+
+/**
+ * \brief Allocates zeroed memory through the current allocator.
+ * \param count Number of elements to allocate.
+ * \param size Size of one element in bytes.
+ * \return Pointer to the memory, or NULL on failure.
+ */
+void* core_calloc(size_t count, size_t size) {
+    return current_allocator.calloc_fn(count, size);
+}
+
+/**
+ * \brief Frees memory allocated through the current allocator.
+ * \param ptr Pointer to the memory, may be NULL.
+ */
+void core_free(void* ptr) {
+    if (ptr) {
+        current_allocator.free_fn(ptr);
+    }
+}
@@ -0,0 +1,23 @@
+/*****************************************************************//**
+ * \file   allocator.h
+ * \brief  Replaceable memory allocation functions used by the headless core.
+ *********************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * \typedef Allocator
+ * \brief Set of functions the core uses for all of its heap memory.
+ */
+typedef struct Allocator {
+    void* (*malloc_fn)(size_t size); /**< Allocates uninitialized memory, like malloc. */
+    void* (*calloc_fn)(size_t count, size_t size); /**< Allocates zeroed memory, like calloc. */
+    void (*free_fn)(void* ptr); /**< Frees memory returned by the two other functions, like free. */
+} Allocator;
+
+void set_allocator(const Allocator* allocator);
+void* core_malloc(size_t size);
+void* core_calloc(size_t count, size_t size);
+void core_free(void* ptr);
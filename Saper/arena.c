@@ -0,0 +1,61 @@
+/*****************************************************************//**
+ * \file   arena.c
+ * \brief  Bump allocator over one block, emptied all at once.
+ *********************************************************************/
+
+#include "allocator.h"
+#include "arena.h"
+
+/**
+ * \brief Empties an arena and makes its block hold at least a number of bytes.
+ *
+ * The block only grows: it is replaced when too small, and kept otherwise. Buffers taken before are invalid.
+ * \param size Number of bytes the arena must be able to hand out, alignment padding included.
+ * \param arena Pointer to the Arena structure.
+ * \return true on success, false if the memory could not be allocated, in which case the arena is empty.
+ */
+bool arena_reserve(size_t size, Arena* arena) {
+    arena->used = 0;
+    if (size <= arena->capacity) {
+        return true;
+    }
+
+    core_free(arena->memory);
+    arena->memory = core_malloc(size);
+    arena->capacity = arena->memory ? size : 0;
+    return arena->memory != NULL;
+}
+
+/**
+ * \brief Takes a buffer from an arena.
+ * \param size Size of the buffer in bytes.
+ * \param arena Pointer to the Arena structure.
+ * \return Pointer to the buffer, aligned to ARENA_ALIGNMENT and uninitialized, or NULL if the arena is full.
+ */
+void* arena_alloc(size_t size, Arena* arena) {
+    size_t start = (arena->used + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (start > arena->capacity || size > arena->capacity - start) {
+        return NULL;
+    }
+    arena->used = start + size;
+    return arena->memory + start;
+}
+
+/**
+ * \brief Empties an arena, keeping its block for the next buffers.
+ * \param arena Pointer to the Arena structure.
+ */
+void arena_reset(Arena* arena) {
+    arena->used = 0;
+}
+
+/**
+ * \brief Frees the block of an arena.
+ * \param arena Pointer to the Arena structure.
+ */
+void arena_destroy(Arena* arena) {
+    core_free(arena->memory);
+    arena->memory = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
@@ -0,0 +1,34 @@
+/*****************************************************************//**
+ * \file   arena.h
+ * \brief  Bump allocator over one block, emptied all at once.
+ *
+ * An arena gives its owner every buffer it needs from a single allocation and frees them together, so an
+ * object living through many short phases, like a session playing game after game, allocates only when a
+ * phase needs more memory than any before it.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * \def ARENA_ALIGNMENT
+ * \brief Alignment of every buffer taken from an arena, enough for any scalar type.
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * \typedef Arena
+ * \brief A block of memory handed out front to back. Starts zeroed.
+ */
+typedef struct Arena {
+    unsigned char* memory; /**< The block, NULL before the first arena_reserve. */
+    size_t capacity; /**< Size of the block in bytes. */
+    size_t used; /**< Bytes handed out since the arena was last emptied, alignment padding included. */
+} Arena;
+
+bool arena_reserve(size_t size, Arena* arena);
+void* arena_alloc(size_t size, Arena* arena);
+void arena_reset(Arena* arena);
+void arena_destroy(Arena* arena);
@@ -0,0 +1,93 @@
+/*****************************************************************//**
+ * \file   atomics.h
+ * \brief  Sequentially consistent atomic operations on integers and pointers, on GCC, Clang and MSVC.
+ *
+ * C11 <stdatomic.h> is not available on every MSVC version the project builds with, so the few
+ * operations the core needs are mapped to the compiler intrinsics.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * \typedef AtomicInt
+ * \brief Integer only accessed through the atomic_int_* functions.
+ */
+#if defined(_MSC_VER)
+typedef volatile long AtomicInt;
+#else
+typedef volatile int AtomicInt;
+#endif
+
+/**
+ * \brief Reads an atomic integer.
+ */
+static inline int atomic_int_load(AtomicInt* value) {
+#if defined(_MSC_VER)
+    return (int)_InterlockedOr(value, 0);
+#else
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * \brief Writes an atomic integer.
+ */
+static inline void atomic_int_store(AtomicInt* value, int desired) {
+#if defined(_MSC_VER)
+    _InterlockedExchange(value, desired);
+#else
+    __atomic_store_n(value, desired, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * \brief Adds to an atomic integer.
+ * \return The value before the addition.
+ */
+static inline int atomic_int_add(AtomicInt* value, int delta) {
+#if defined(_MSC_VER)
+    return (int)_InterlockedExchangeAdd(value, delta);
+#else
+    return __atomic_fetch_add(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * \brief Replaces an atomic integer if it still holds the expected value.
+ * \return true if the value was replaced.
+ */
+static inline bool atomic_int_compare_exchange(AtomicInt* value, int expected, int desired) {
+#if defined(_MSC_VER)
+    return _InterlockedCompareExchange(value, desired, expected) == expected;
+#else
+    return __atomic_compare_exchange_n(value, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * \brief Lowers an atomic integer to a value if the value is smaller.
+ */
+static inline void atomic_int_min(AtomicInt* value, int candidate) {
+    int current = atomic_int_load(value);
+    while (candidate < current && !atomic_int_compare_exchange(value, current, candidate)) {
+        current = atomic_int_load(value);
+    }
+}
+
+/**
+ * \brief Replaces an atomic pointer.
+ * \return The previous pointer.
+ */
+static inline void* atomic_pointer_exchange(void* volatile* pointer, void* desired) {
+#if defined(_MSC_VER)
+    return _InterlockedExchangePointer(pointer, desired);
+#else
+    return __atomic_exchange_n(pointer, desired, __ATOMIC_SEQ_CST);
+#endif
+}
@@ -0,0 +1,463 @@
+/*****************************************************************//**
+ * \file   board.c
+ * \brief  Board generation, reveal, flags and win/loss state of the headless core.
+ *********************************************************************/
+
+#include <string.h>
+#include "allocator.h"
+#include "board.h"
+#include "mapfile.h"
+#include "rng.h"
+
+/**
+ * \def TOPOLOGY_INLINE
+ * \brief Forces the inlining of the topology functions, so that a constant topology folds into a specialized copy.
+ */
+#if defined(_MSC_VER)
+#define TOPOLOGY_INLINE static __forceinline
+#elif defined(__GNUC__)
+#define TOPOLOGY_INLINE static inline __attribute__((always_inline))
+#else
+#define TOPOLOGY_INLINE static inline
+#endif
+
+// Neighbourhoods
+
+/**
+ * \brief Lists the neighbours of a cell in one topology, in row-major order.
+ *
+ * Called with a constant topology, the switch and the offsets fold away. Cells far enough from the edges take
+ * a path without any bounds check, and the torus wraps its edges with conditional moves instead of branches.
+ * \param topology The topology, a compile-time constant at every call.
+ * \param index Index of the cell.
+ * \param rows Number of rows of the board.
+ * \param cols Number of columns of the board.
+ * \param neighbours Receives the indices of up to TOPOLOGY_MAX_NEIGHBOURS neighbours.
+ * \return Number of neighbours.
+ */
+TOPOLOGY_INLINE int topology_neighbours(enum Topology topology, int index, int rows, int cols, int* neighbours) {
+    // Offsets of the bounded topologies, the hexagonal ones depending on the parity of the row
+    static const int classic_rows[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+    static const int classic_cols[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+    static const int knight_rows[8] = { -2, -2, -1, -1, 1, 1, 2, 2 };
+    static const int knight_cols[8] = { -1, 1, -2, 2, -2, 2, -1, 1 };
+    static const int hex_rows[6] = { -1, -1, 0, 0, 1, 1 };
+    static const int hex_cols[2][6] = { { -1, 0, -1, 1, -1, 0 }, { 0, 1, -1, 1, 0, 1 } };
+    //
+
+    int row = index / cols;
+    int col = index % cols;
+    if (topology == TOPOLOGY_TORUS) {
+        int above = (row == 0 ? rows - 1 : row - 1) * cols;
+        int here = row * cols;
+        int below = (row == rows - 1 ? 0 : row + 1) * cols;
+        int left = col == 0 ? cols - 1 : col - 1;
+        int right = col == cols - 1 ? 0 : col + 1;
+        neighbours[0] = above + left;
+        neighbours[1] = above + col;
+        neighbours[2] = above + right;
+        neighbours[3] = here + left;
+        neighbours[4] = here + right;
+        neighbours[5] = below + left;
+        neighbours[6] = below + col;
+        neighbours[7] = below + right;
+        return 8;
+    }
+
+    const int* row_offsets = topology == TOPOLOGY_KNIGHT ? knight_rows : topology == TOPOLOGY_HEX ? hex_rows : classic_rows;
+    const int* col_offsets = topology == TOPOLOGY_KNIGHT ? knight_cols : topology == TOPOLOGY_HEX ? hex_cols[row & 1] : classic_cols;
+    int size = topology == TOPOLOGY_HEX ? 6 : 8;
+    int margin = topology == TOPOLOGY_KNIGHT ? 2 : 1;
+
+    if (row >= margin && row < rows - margin && col >= margin && col < cols - margin) { // Every neighbour is on the board
+        for (int k = 0; k < size; k++) {
+            neighbours[k] = index + row_offsets[k] * cols + col_offsets[k];
+        }
+        return size;
+    }
+
+    int count = 0;
+    for (int k = 0; k < size; k++) {
+        int r = row + row_offsets[k];
+        int c = col + col_offsets[k];
+        if (r >= 0 && r < rows && c >= 0 && c < cols)
+            neighbours[count++] = r * cols + c;
+    }
+    return count;
+}
+
+/**
+ * \brief Chooses the neighbourhood of a board, before its first reveal.
+ *
+ * The torus needs at least 3 rows and 3 columns, so that no cell is its own neighbour or a neighbour twice.
+ * \param topology The topology.
+ * \param board Pointer to the Board structure.
+ * \return false if the board is too small for the topology, which is left unchanged.
+ */
+bool set_board_topology(enum Topology topology, Board* board) {
+    if ((int)topology < 0 || topology >= TOPOLOGY_COUNT || (topology == TOPOLOGY_TORUS && (board->rows < 3 || board->cols < 3))) {
+        return false;
+    }
+    board->topology = topology;
+    return true;
+}
+
+/**
+ * \brief Returns the name of a topology, as shown to the player.
+ * \param topology The topology.
+ * \return A static string, "Unknown" for a value out of range.
+ */
+const char* topology_name(enum Topology topology) {
+    switch (topology) {
+    case TOPOLOGY_CLASSIC: return "Classic";
+    case TOPOLOGY_TORUS: return "Torus";
+    case TOPOLOGY_HEX: return "Hex";
+    case TOPOLOGY_KNIGHT: return "Knight";
+    default: return "Unknown";
+    }
+}
+
+/**
+ * \brief Lists the neighbours of a cell in the topology of its board, for callers outside the specialized loops.
+ * \param index Index of the cell.
+ * \param board Pointer to the Board structure.
+ * \param neighbours Receives the indices of up to TOPOLOGY_MAX_NEIGHBOURS neighbours.
+ * \return Number of neighbours.
+ */
+int board_neighbours(int index, const Board* board, int* neighbours) {
+    switch (board->topology) {
+    case TOPOLOGY_TORUS: return topology_neighbours(TOPOLOGY_TORUS, index, board->rows, board->cols, neighbours);
+    case TOPOLOGY_HEX: return topology_neighbours(TOPOLOGY_HEX, index, board->rows, board->cols, neighbours);
+    case TOPOLOGY_KNIGHT: return topology_neighbours(TOPOLOGY_KNIGHT, index, board->rows, board->cols, neighbours);
+    default: return topology_neighbours(TOPOLOGY_CLASSIC, index, board->rows, board->cols, neighbours);
+    }
+}
+
+//
+
+/**
+ * \brief Allocates an empty board of arbitrary size. Mines are placed later, by the first reveal.
+ * \param rows Number of rows in the game board.
+ * \param cols Number of columns in the game board.
+ * \param mines Number of mines to place, clamped so that at least one cell is safe.
+ * \param seed Seed of the mine placement.
+ * \param board Pointer to the Board structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool initialize_board(int rows, int cols, int mines, uint64_t seed, Board* board) {
+    board->rows = rows;
+    board->cols = cols;
+    board->mines = mines < rows * cols ? mines : rows * cols - 1;
+    board->topology = TOPOLOGY_CLASSIC;
+    board->seed = seed;
+
+    // Allocating the whole board as a single block of packed cells
+    board->cells = (unsigned char*)core_calloc((size_t)rows * cols, sizeof(unsigned char));
+    board->mapping = NULL;
+    board->mapping_size = 0;
+    board->opened = (int*)core_malloc((size_t)rows * cols * sizeof(int));
+    board->opened_count = 0;
+    board->revealed_count = 0;
+    board->flags_placed = 0;
+    board->mines_placed = false;
+    board->safe_area = true;
+    board->game_over = false;
+    board->game_won = false;
+    //
+
+    if (!board->cells || !board->opened) {
+        free_board(board);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Clears a board for a new classic game of the same size, in the buffers it already has. Mines are placed later, by the first reveal.
+ * \param mines Number of mines to place, clamped so that at least one cell is safe.
+ * \param seed Seed of the mine placement.
+ * \param board Pointer to the Board structure, allocated by initialize_board.
+ */
+void reset_board(int mines, uint64_t seed, Board* board) {
+    int cell_count = board->rows * board->cols;
+    board->mines = mines < cell_count ? mines : cell_count - 1;
+    board->topology = TOPOLOGY_CLASSIC;
+    board->seed = seed;
+
+    memset(board->cells, 0, (size_t)cell_count);
+    board->opened_count = 0;
+    board->revealed_count = 0;
+    board->flags_placed = 0;
+    board->mines_placed = false;
+    board->safe_area = true;
+    board->game_over = false;
+    board->game_won = false;
+}
+
+/**
+ * \brief Frees the memory used by a board.
+ * \param board Pointer to the Board structure.
+ */
+void free_board(Board* board) {
+    if (board->cells) {
+        if (board->mapping) { // Cells loaded from a save file
+            unmap_file(board->mapping, board->mapping_size);
+            board->mapping = NULL;
+        }
+        else {
+            core_free(board->cells);
+        }
+        board->cells = NULL;
+    }
+
+    if (board->opened) {
+        core_free(board->opened);
+        board->opened = NULL;
+    }
+}
+
+/**
+ * \brief Generates a complete board as if its first reveal was the given cell, without revealing it.
+ *
+ * The board is a pure function of its arguments: the same rows, columns, mines, seed and safe cell give
+ * bit-identical cells on every platform, which replays, shared puzzles and parallel generation rely on.
+ * \param rows Number of rows in the game board.
+ * \param cols Number of columns in the game board.
+ * \param mines Number of mines to place, clamped so that at least one cell is safe.
+ * \param seed Seed of the mine placement.
+ * \param safe_row The row index of the cell that must not contain a mine.
+ * \param safe_col The column index of the cell that must not contain a mine.
+ * \param board Pointer to the Board structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool generate_board(int rows, int cols, int mines, uint64_t seed, int safe_row, int safe_col, Board* board) {
+    if (!initialize_board(rows, cols, mines, seed, board)) {
+        return false;
+    }
+    place_mines(safe_row, safe_col, board);
+    return true;
+}
+
+/**
+ * \brief Places the mines with Floyd's algorithm and counts them around, in one topology.
+ * \param topology The topology, a compile-time constant at every call.
+ * \param excluded Indices of the cells kept safe, in ascending order.
+ * \param excluded_count Number of excluded cells.
+ * \param board Pointer to the Board structure.
+ */
+TOPOLOGY_INLINE void scatter_mines(enum Topology topology, const int* excluded, int excluded_count, Board* board) {
+    int rows = board->rows;
+    int cols = board->cols;
+    unsigned char* cells = board->cells;
+
+    // Floyd's algorithm over the candidate cells, numbered from 0 while skipping the excluded ones
+    Rng rng;
+    rng_seed(board->seed, &rng);
+    int candidates = rows * cols - excluded_count;
+    for (int k = candidates - board->mines; k < candidates; k++) {
+        int pick = (int)rng_below((uint32_t)(k + 1), &rng);
+        int index = pick;
+        for (int e = 0; e < excluded_count; e++) {
+            if (index >= excluded[e])
+                index++;
+        }
+
+        if (cells[index] & CELL_MINE) { // Already taken, candidate k was never picked before
+            index = k;
+            for (int e = 0; e < excluded_count; e++) {
+                if (index >= excluded[e])
+                    index++;
+            }
+        }
+
+        cells[index] |= CELL_MINE;
+
+        // Setting up the number of mines surrounding the neighbours of the mine
+        int neighbours[TOPOLOGY_MAX_NEIGHBOURS];
+        int count = topology_neighbours(topology, index, rows, cols, neighbours);
+        for (int n = 0; n < count; n++) {
+            cells[neighbours[n]]++;
+        }
+        //
+    }
+    //
+}
+
+/**
+ * \brief Places the mines so that the given cell, and its neighbours if board->safe_area is set, stays safe.
+ *
+ * Uses Floyd's sampling algorithm, so the mines are drawn uniformly without replacement in time
+ * proportional to the number of mines, whatever the board density. Adjacency counts are updated
+ * around each placed mine instead of being recomputed for the whole board. The random numbers come
+ * from a generator seeded with board->seed, so the placement only depends on the board and the safe cell.
+ * \param safe_row The row index of the cell that must not contain a mine.
+ * \param safe_col The column index of the cell that must not contain a mine.
+ * \param board Pointer to the Board structure.
+ */
+void place_mines(int safe_row, int safe_col, Board* board) {
+    int cell_count = board->rows * board->cols;
+    int safe = safe_row * board->cols + safe_col;
+
+    // Collecting the excluded cells in ascending order, the order the Floyd loop skips them in
+    int excluded[TOPOLOGY_MAX_NEIGHBOURS + 1];
+    int excluded_count = board->safe_area ? board_neighbours(safe, board, excluded) : 0;
+    excluded[excluded_count++] = safe;
+    for (int e = 1; e < excluded_count; e++) {
+        int index = excluded[e];
+        int k = e;
+        for (; k > 0 && excluded[k - 1] > index; k--) {
+            excluded[k] = excluded[k - 1];
+        }
+        excluded[k] = index;
+    }
+    if (cell_count - excluded_count < board->mines) { // Not enough room around the safe area, only the cell itself stays safe
+        excluded[0] = safe;
+        excluded_count = 1;
+    }
+    //
+
+    switch (board->topology) {
+    case TOPOLOGY_TORUS: scatter_mines(TOPOLOGY_TORUS, excluded, excluded_count, board); break;
+    case TOPOLOGY_HEX: scatter_mines(TOPOLOGY_HEX, excluded, excluded_count, board); break;
+    case TOPOLOGY_KNIGHT: scatter_mines(TOPOLOGY_KNIGHT, excluded, excluded_count, board); break;
+    default: scatter_mines(TOPOLOGY_CLASSIC, excluded, excluded_count, board); break;
+    }
+
+    board->mines_placed = true;
+}
+
+/**
+ * \brief Runs the flood fill of a reveal in one topology, from the cells already in board->opened.
+ * \param topology The topology, a compile-time constant at every call.
+ * \param board Pointer to the Board structure.
+ */
+TOPOLOGY_INLINE void flood_cells(enum Topology topology, Board* board) {
+    int rows = board->rows;
+    int cols = board->cols;
+    unsigned char* cells = board->cells;
+    int* opened = board->opened;
+    int opened_count = board->opened_count;
+
+    for (int next = 0; next < opened_count; next++) {
+        int index = opened[next];
+        if (cells[index] & CELL_COUNT_MASK) {
+            continue;
+        }
+
+        int neighbours[TOPOLOGY_MAX_NEIGHBOURS];
+        int count = topology_neighbours(topology, index, rows, cols, neighbours);
+        for (int n = 0; n < count; n++) {
+            int neighbour = neighbours[n];
+            if (cells[neighbour] & (CELL_REVEALED | CELL_FLAGGED))
+                continue;
+
+            cells[neighbour] |= CELL_REVEALED;
+            opened[opened_count++] = neighbour;
+        }
+    }
+
+    board->opened_count = opened_count;
+}
+
+/**
+ * \brief Reveals the cell at the specified coordinates, opening the surrounding area if it has no adjacent mines.
+ *
+ * The flood fill is iterative: the board->opened buffer holds every cell opened so far and doubles as the
+ * breadth-first work queue, so no recursion is involved and no memory is allocated, whatever the board size.
+ * The flood fill is specialized for each topology, chosen once per call. The revealed cell counter is updated on the way, so game_over and game_won are known as soon as this returns.
+ * \param i The row index of the cell.
+ * \param j The column index of the cell.
+ * \param board Pointer to the Board structure.
+ * \return The number of cells opened, their indices are stored in board->opened.
+ */
+int reveal_cell(int i, int j, Board* board) {
+    board->opened_count = 0;
+
+    if (i < 0 || i >= board->rows || j < 0 || j >= board->cols) {
+        return 0;
+    }
+
+    unsigned char* cell = cell_at(board, i, j);
+    if (*cell & (CELL_REVEALED | CELL_FLAGGED)) {
+        return 0;
+    }
+
+    if (!board->mines_placed) { // The first revealed cell is always safe
+        place_mines(i, j, board);
+    }
+
+    *cell |= CELL_REVEALED;
+    board->opened[board->opened_count++] = i * board->cols + j;
+
+    if (*cell & CELL_MINE) { // Game over condition
+        board->game_over = true;
+        return board->opened_count;
+    }
+
+    // Reveal all empty adjacent cells, cells are marked as revealed when queued so each one is visited once
+    switch (board->topology) {
+    case TOPOLOGY_TORUS: flood_cells(TOPOLOGY_TORUS, board); break;
+    case TOPOLOGY_HEX: flood_cells(TOPOLOGY_HEX, board); break;
+    case TOPOLOGY_KNIGHT: flood_cells(TOPOLOGY_KNIGHT, board); break;
+    default: flood_cells(TOPOLOGY_CLASSIC, board); break;
+    }
+
+    board->revealed_count += board->opened_count;
+    check_game_won(board);
+
+    return board->opened_count;
+}
+
+/**
+ * \brief Toggles the flag state of the cell at the specified coordinates.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param board Pointer to the Board structure.
+ */
+void toggle_flag(int row, int col, Board* board) {
+    unsigned char* cell = cell_at(board, row, col);
+    if (!(*cell & CELL_REVEALED)) {
+        *cell ^= CELL_FLAGGED;
+        board->flags_placed += (*cell & CELL_FLAGGED) ? 1 : -1;
+    }
+}
+
+/**
+ * \brief Checks if the game is won, using the revealed cell counter kept up to date by reveal_cell.
+ * \param board Pointer to the Board structure.
+ */
+void check_game_won(Board* board) {
+    if (board->revealed_count == board->rows * board->cols - board->mines) { // Win condition
+        board->game_won = true;
+    }
+}
+
+/**
+ * \brief Gives the size of a board preset.
+ * \param difficulty The preset: 1 = easy, 2 = medium, 3 = hard, 4 to BOARD_PRESET_COUNT = large custom boards.
+ * \param rows Receives the number of rows.
+ * \param cols Receives the number of columns.
+ * \param mines Receives the number of mines.
+ * \return False if there is no such preset.
+ */
+bool get_board_preset(int difficulty, int* rows, int* cols, int* mines) {
+    // Rows, columns and mines of each preset, large boards keep the mine density of the hard one
+    static const int presets[BOARD_PRESET_COUNT][3] = {
+        { 8, 8, 10 },
+        { 12, 12, 20 },
+        { 16, 16, 40 },
+        { 100, 100, 1600 },
+        { 500, 500, 40000 },
+        { 1000, 1000, 160000 },
+        { 5000, 5000, 4000000 },
+        { 10000, 10000, 16000000 }
+    };
+
+    if (difficulty < 1 || difficulty > BOARD_PRESET_COUNT) {
+        return false;
+    }
+    *rows = presets[difficulty - 1][0];
+    *cols = presets[difficulty - 1][1];
+    *mines = presets[difficulty - 1][2];
+    return true;
+}
@@ -0,0 +1,144 @@
+/*****************************************************************//**
+ * \file   board.h
+ * \brief  Headless minesweeper core: board generation, reveal, flags and win/loss state.
+ *
+ * Nothing in the core depends on Allegro, so it can be built and run on display-less machines.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \def CELL_COUNT_MASK
+ * \brief Bits of a packed cell holding the number of adjacent mines (0-8), also kept for cells with a mine.
+ */
+#define CELL_COUNT_MASK 0x0F
+
+/**
+ * \def CELL_MINE
+ * \brief Bit of a packed cell set when the cell contains a mine.
+ */
+#define CELL_MINE 0x10
+
+/**
+ * \def CELL_REVEALED
+ * \brief Bit of a packed cell set when the cell is revealed.
+ */
+#define CELL_REVEALED 0x20
+
+/**
+ * \def CELL_FLAGGED
+ * \brief Bit of a packed cell set when the cell is flagged.
+ */
+#define CELL_FLAGGED 0x40
+
+/**
+ * \def TOPOLOGY_MAX_NEIGHBOURS
+ * \brief Largest number of neighbours of a cell, whatever the topology, so counts still fit CELL_COUNT_MASK.
+ */
+#define TOPOLOGY_MAX_NEIGHBOURS 8
+
+/**
+ * \def BOARD_PRESET_COUNT
+ * \brief Number of board presets: the three difficulties followed by the large custom boards.
+ */
+#define BOARD_PRESET_COUNT 8
+
+/**
+ * \enum Topology
+ * \brief Neighbourhoods a board can use, each with its own reveal and mine counting specialized at compile time.
+ */
+enum Topology {
+    TOPOLOGY_CLASSIC, /**< The eight surrounding cells, none past the edges. */
+    TOPOLOGY_TORUS, /**< The eight surrounding cells, the edges wrapping around to the opposite ones. */
+    TOPOLOGY_HEX, /**< The six cells around a hexagon, odd rows being shifted half a cell to the right. */
+    TOPOLOGY_KNIGHT, /**< The eight cells a chess knight reaches, none past the edges. */
+    TOPOLOGY_COUNT /**< Number of topologies. */
+};
+
+/**
+ * \typedef Board
+ * \brief Represents the cells and the state of one minesweeper board.
+ */
+typedef struct Board {
+    int rows; /**< Number of rows in the game board. */
+    int cols; /**< Number of columns in the game board. */
+    int mines; /**< Number of mines in the game board. */
+    int topology; /**< Neighbourhood of the cells, a value of enum Topology, classic unless set_board_topology chose another one. */
+    uint64_t seed; /**< Seed of the mine placement, the same seed and first revealed cell always give the same board. */
+    unsigned char* cells; /**< Row-major array of rows * cols packed cells, see the CELL_* bits. */
+    void* mapping; /**< Mapped save file the cells point into, NULL when the cells were allocated, see load_board. */
+    size_t mapping_size; /**< Size of the mapped save file in bytes. */
+    int* opened; /**< Preallocated buffer of rows * cols cell indices opened by the last reveal, also used as the flood fill work queue. */
+    int opened_count; /**< Number of cell indices stored in opened by the last reveal. */
+    int revealed_count; /**< Number of safe cells revealed so far. */
+    int flags_placed; /**< Number of flags currently placed on the board. */
+    bool mines_placed; /**< Indicates if the mines have been placed, which happens on the first reveal. */
+    bool safe_area; /**< Keeps the neighbours of the first revealed cell free of mines too, its 3x3 area on a classic board. */
+    bool game_over; /**< Indicates if a mine was revealed. */
+    bool game_won; /**< Indicates if all the safe cells were revealed. */
+} Board;
+
+/**
+ * \brief Returns a pointer to the packed cell at the specified coordinates.
+ * \param board Pointer to the Board structure.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \return Pointer to the packed cell.
+ */
+static inline unsigned char* cell_at(const Board* board, int row, int col) {
+    return &board->cells[(size_t)row * board->cols + col];
+}
+
+/**
+ * \brief Checks if the cell at the specified coordinates contains a mine.
+ */
+static inline bool cell_is_mine(const Board* board, int row, int col) {
+    return (*cell_at(board, row, col) & CELL_MINE) != 0;
+}
+
+/**
+ * \brief Checks if the cell at the specified coordinates is revealed.
+ */
+static inline bool cell_is_revealed(const Board* board, int row, int col) {
+    return (*cell_at(board, row, col) & CELL_REVEALED) != 0;
+}
+
+/**
+ * \brief Checks if the cell at the specified coordinates is flagged.
+ */
+static inline bool cell_is_flagged(const Board* board, int row, int col) {
+    return (*cell_at(board, row, col) & CELL_FLAGGED) != 0;
+}
+
+/**
+ * \brief Returns the number of mines adjacent to the cell at the specified coordinates.
+ */
+static inline int cell_adjacent_mines(const Board* board, int row, int col) {
+    return *cell_at(board, row, col) & CELL_COUNT_MASK;
+}
+
+/**
+ * \brief Returns the number of mines left to flag, as shown to the player.
+ * \param board Pointer to the Board structure.
+ * \return Number of mines minus the number of placed flags, negative if the player placed too many flags.
+ */
+static inline int mines_remaining(const Board* board) {
+    return board->mines - board->flags_placed;
+}
+
+bool initialize_board(int rows, int cols, int mines, uint64_t seed, Board* board);
+bool generate_board(int rows, int cols, int mines, uint64_t seed, int safe_row, int safe_col, Board* board);
+void reset_board(int mines, uint64_t seed, Board* board);
+void free_board(Board* board);
+bool set_board_topology(enum Topology topology, Board* board);
+const char* topology_name(enum Topology topology);
+int board_neighbours(int index, const Board* board, int* neighbours);
+void place_mines(int safe_row, int safe_col, Board* board);
+int reveal_cell(int i, int j, Board* board);
+void toggle_flag(int row, int col, Board* board);
+void check_game_won(Board* board);
+bool get_board_preset(int difficulty, int* rows, int* cols, int* mines);
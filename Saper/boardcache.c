@@ -0,0 +1,95 @@
+/*****************************************************************//**
+ * \file   boardcache.c
+ * \brief  Reuse of the buffers of finished boards.
+ *********************************************************************/
+
+#include "boardcache.h"
+
+/**
+ * \brief Sets up an empty cache.
+ * \param cache Pointer to the BoardCache structure.
+ */
+void board_cache_init(BoardCache* cache) {
+    cache->count = 0;
+}
+
+/**
+ * \brief Moves the buffers of a cached board of the given size to a board, newest first.
+ * \param rows Number of rows of the board.
+ * \param cols Number of columns of the board.
+ * \param board Pointer to the Board structure receiving the buffers, its cells are NULL if there was none.
+ * \param cache Pointer to the BoardCache structure.
+ * \return true if buffers were taken.
+ */
+bool board_cache_take(int rows, int cols, Board* board, BoardCache* cache) {
+    for (int i = cache->count - 1; i >= 0; i--) {
+        if (cache->boards[i].rows != rows || cache->boards[i].cols != cols) {
+            continue;
+        }
+
+        *board = cache->boards[i];
+        for (int j = i + 1; j < cache->count; j++) {
+            cache->boards[j - 1] = cache->boards[j];
+        }
+        cache->count--;
+        return true;
+    }
+
+    board->cells = NULL;
+    board->opened = NULL;
+    return false;
+}
+
+/**
+ * \brief Gives the buffers of a finished board to the cache, or frees them if the board is too large or loaded from a save file.
+ * \param board Pointer to the Board structure, its buffers are NULL afterwards. Boards without buffers are ignored.
+ * \param cache Pointer to the BoardCache structure.
+ */
+void board_cache_release(Board* board, BoardCache* cache) {
+    if (!board->cells || !board->opened || board->mapping || (long long)board->rows * board->cols > BOARD_CACHE_MAX_CELLS) { // Mapped save files are not kept open
+        free_board(board);
+        return;
+    }
+
+    if (cache->count == BOARD_CACHE_SIZE) { // Making room by dropping the oldest board
+        free_board(&cache->boards[0]);
+        for (int i = 1; i < cache->count; i++) {
+            cache->boards[i - 1] = cache->boards[i];
+        }
+        cache->count--;
+    }
+
+    cache->boards[cache->count++] = *board;
+    board->cells = NULL;
+    board->opened = NULL;
+}
+
+/**
+ * \brief Frees the boards of a cache.
+ * \param cache Pointer to the BoardCache structure.
+ */
+void board_cache_destroy(BoardCache* cache) {
+    for (int i = 0; i < cache->count; i++) {
+        free_board(&cache->boards[i]);
+    }
+    cache->count = 0;
+}
+
+/**
+ * \brief Initializes an empty board in the buffers taken from a cache, or in new ones if none were taken.
+ *
+ * Only touches the board, so it can run on another thread than the one owning the cache.
+ * \param rows Number of rows in the game board.
+ * \param cols Number of columns in the game board.
+ * \param mines Number of mines to place, clamped so that at least one cell is safe.
+ * \param seed Seed of the mine placement.
+ * \param board Pointer to the Board structure, filled by board_cache_take.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool initialize_recycled_board(int rows, int cols, int mines, uint64_t seed, Board* board) {
+    if (!board->cells) {
+        return initialize_board(rows, cols, mines, seed, board);
+    }
+    reset_board(mines, seed, board);
+    return true;
+}
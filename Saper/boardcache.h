@@ -0,0 +1,40 @@
+/*****************************************************************//**
+ * \file   boardcache.h
+ * \brief  Buffers of finished boards kept for the next boards of the same size.
+ *
+ * A new game takes the buffers of a finished one of the same size instead of allocating its own, so that
+ * memory stays flat over any number of games. The cache belongs to one thread: buffers taken from it can be
+ * initialized on another thread with initialize_recycled_board.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+
+/**
+ * \def BOARD_CACHE_SIZE
+ * \brief Number of boards a BoardCache keeps, the oldest one is freed to make room.
+ */
+#define BOARD_CACHE_SIZE 4
+
+/**
+ * \def BOARD_CACHE_MAX_CELLS
+ * \brief Largest board kept, in cells. Larger ones are freed: their zeroed pages come lazily from the system,
+ * which is cheaper than clearing them again, and keeping them would hold hundreds of megabytes.
+ */
+#define BOARD_CACHE_MAX_CELLS (1 << 22)
+
+/**
+ * \typedef BoardCache
+ * \brief Finished boards whose buffers can be taken again, oldest first.
+ */
+typedef struct BoardCache {
+    Board boards[BOARD_CACHE_SIZE]; /**< Finished boards, only their size and buffers matter. */
+    int count; /**< Number of boards kept. */
+} BoardCache;
+
+void board_cache_init(BoardCache* cache);
+bool board_cache_take(int rows, int cols, Board* board, BoardCache* cache);
+void board_cache_release(Board* board, BoardCache* cache);
+void board_cache_destroy(BoardCache* cache);
+bool initialize_recycled_board(int rows, int cols, int mines, uint64_t seed, Board* board);
@@ -0,0 +1,435 @@
+/*****************************************************************//**
+ * \file   boardstats.c
+ * \brief  One pass labelling of the openings and islands of a board, run by run, with a row-wide union-find.
+ *
+ * Every row is turned into bit masks of its zeros and of its numbers outside the borders, sixteen cells per
+ * load with SSE2 and eight otherwise. The runs of set bits of both masks are labelled against the runs of the previous row, so the work
+ * grows with the runs and not with the cells. A random board gives a mispredicted branch to any test on a
+ * run, so the runs of the previous row a run touches are counted from prefix counts of their ends instead of
+ * walked, and only the runs joining several groups go through the union-find, in a second loop.
+ *********************************************************************/
+
+#include <string.h>
+#include "allocator.h"
+#include "boardstats.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CELLS_PER_LOAD 16 /**< Cells classified at once by classify_cells. */
+#else
+#define CELLS_PER_LOAD 8
+#endif
+
+/**
+ * \typedef RowRuns
+ * \brief Runs of set bits of one row mask, in column order, the label of each and the masks of their ends.
+ */
+typedef struct RowRuns {
+    int* start; /**< Column of the first cell of every run, cols + 8 entries as the listing writes past the last run. */
+    int* last; /**< Column of the last cell of every run, cols + 8 entries. */
+    int* label; /**< Label of every run. */
+    uint64_t* first_bits; /**< Mask of the first cells of the runs, words + 1 words, the last one clear. */
+    uint64_t* last_bits; /**< Mask of the last cells of the runs, words + 1 words, the last one clear. */
+    int* firsts_before; /**< Number of runs starting before every word, words + 1 entries. */
+    int* lasts_before; /**< Number of runs ending before every word, words + 1 entries. */
+    int count; /**< Number of runs. */
+} RowRuns;
+
+/**
+ * \typedef RowLabels
+ * \brief Runs of one kind of cells in the previous and current rows, and the union-find joining their labels.
+ *
+ * Labels are compacted once half of them are used, which always leaves a new label for every run of the next row.
+ */
+typedef struct RowLabels {
+    RowRuns previous; /**< Runs of the previous row. */
+    RowRuns current; /**< Runs of the current row. */
+    int* parent; /**< Parent of every label in the union-find, capacity entries. */
+    int* remap; /**< Compact label of every root when the labels are compacted, capacity entries. */
+    int* merges; /**< First and end of the runs of the previous row touched by a run touching several, cols + 4 entries. */
+    int capacity; /**< Number of labels the union-find holds, 2 * (cols + 2). */
+    int label_count; /**< Labels used so far, those of the previous row included. */
+    int components; /**< Connected groups found so far: labels created minus labels joined. */
+} RowLabels;
+
+// Bit masks
+
+/**
+ * \brief Returns the index of the lowest set bit of a non-zero word.
+ */
+static inline int lowest_bit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int)index;
+#elif defined(__GNUC__)
+    return __builtin_ctzll(value);
+#else
+    int index = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/**
+ * \brief Counts the set bits of a word.
+ */
+static inline int popcount64(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(value);
+#elif defined(__GNUC__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value) {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+#if CELLS_PER_LOAD == 16
+
+/**
+ * \brief Classifies sixteen cells, cell i giving bit i of both masks.
+ * \param cells First of the cells.
+ * \param zero Receives the mask of the zeros, safe cells without adjacent mines.
+ * \param safe Receives the mask of the safe cells.
+ */
+static inline void classify_cells(const unsigned char* cells, uint64_t* zero, uint64_t* safe) {
+    __m128i value = _mm_loadu_si128((const __m128i*)cells);
+    __m128i none = _mm_setzero_si128();
+    *zero = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(value, _mm_set1_epi8(CELL_MINE | CELL_COUNT_MASK)), none));
+    *safe = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(value, _mm_set1_epi8(CELL_MINE)), none));
+}
+
+#else
+
+/**
+ * \brief Gathers the high bit of every byte of a word into eight bits, byte i into bit i.
+ */
+static inline uint64_t gather_bytes(uint64_t high_bits) {
+    return ((high_bits >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+/**
+ * \brief Classifies eight cells loaded into a word, cell i giving bit i of both masks.
+ * \param cells First of the cells.
+ * \param zero Receives the mask of the zeros, safe cells without adjacent mines.
+ * \param safe Receives the mask of the safe cells.
+ */
+static inline void classify_cells(const unsigned char* cells, uint64_t* zero, uint64_t* safe) {
+    uint64_t value;
+    memcpy(&value, cells, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    // The five low bits are zero for a zero, bit 4 is clear for a safe cell
+    uint64_t low = value & 0x1F1F1F1F1F1F1F1Full;
+    *zero = gather_bytes(~(low + 0x7F7F7F7F7F7F7F7Full) & 0x8080808080808080ull); // No carry crosses a byte, low <= 0x1F
+    *safe = gather_bytes(~(value << 3) & 0x8080808080808080ull);
+}
+
+#endif
+
+/**
+ * \brief Sets the bits of the zeros of a row, safe cells without adjacent mines, and of its safe cells.
+ * \param cells First cell of the row.
+ * \param cols Number of columns of the board.
+ * \param zeros Mask of (cols + 63) / 64 cleared words receiving the zeros.
+ * \param safe Mask of (cols + 63) / 64 cleared words receiving the safe cells.
+ */
+static void load_row(const unsigned char* cells, int cols, uint64_t* zeros, uint64_t* safe) {
+    int c = 0;
+    int end = cols >= CELLS_PER_LOAD ? cols : 0;
+    while (c < end) {
+        int step = end - c < CELLS_PER_LOAD ? end - c : CELLS_PER_LOAD; // The last cells are loaded with the ones before them, shifted out
+        uint64_t zero;
+        uint64_t clear;
+        classify_cells(cells + c + step - CELLS_PER_LOAD, &zero, &clear);
+        zeros[c >> 6] |= (zero >> (CELLS_PER_LOAD - step)) << (c & 63);
+        safe[c >> 6] |= (clear >> (CELLS_PER_LOAD - step)) << (c & 63);
+        c += step;
+    }
+    for (; c < cols; c++) { // Rows narrower than one load
+        if (!(cells[c] & (CELL_MINE | CELL_COUNT_MASK)))
+            zeros[c >> 6] |= 1ull << (c & 63);
+        if (!(cells[c] & CELL_MINE))
+            safe[c >> 6] |= 1ull << (c & 63);
+    }
+}
+
+/**
+ * \brief Appends the columns of the set bits of a word to a list.
+ *
+ * The first eight columns are written whatever the number of bits, the garbage past the count is overwritten
+ * by the next word, so the common word does not end its loop on a mispredicted branch.
+ * \param bits The word.
+ * \param base Column of the lowest bit of the word.
+ * \param columns The list, with room for eight columns past its count.
+ * \param count Number of columns in the list.
+ * \return The new number of columns in the list.
+ */
+static inline int list_bits(uint64_t bits, int base, int* columns, int count) {
+    int listed = count + popcount64(bits);
+    columns += count;
+    for (int i = 0; i < 8; i++) {
+        columns[i] = base + lowest_bit(bits | (1ull << 63));
+        bits &= bits - 1;
+    }
+    for (int i = 8; bits; i++) {
+        columns[i] = base + lowest_bit(bits);
+        bits &= bits - 1;
+    }
+    return listed;
+}
+
+/**
+ * \brief Lists the runs of set bits of a row mask, with the masks and prefix counts of their ends.
+ * \param mask The mask, with a zero guard word before and after its words.
+ * \param words Number of words of the row.
+ * \param runs Pointer to the RowRuns structure receiving the runs.
+ */
+static void find_runs(const uint64_t* mask, int words, RowRuns* runs) {
+    int starts = 0;
+    int lasts = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t word = mask[w];
+        uint64_t first = word & ~((word << 1) | (mask[w - 1] >> 63)); // Set with the cell on its left clear
+        uint64_t last = word & ~((word >> 1) | (mask[w + 1] << 63)); // Set with the cell on its right clear
+        runs->first_bits[w] = first;
+        runs->last_bits[w] = last;
+        runs->firsts_before[w] = starts;
+        runs->lasts_before[w] = lasts;
+        starts = list_bits(first, w * 64, runs->start, starts);
+        lasts = list_bits(last, w * 64, runs->last, lasts);
+    }
+    runs->first_bits[words] = 0;
+    runs->last_bits[words] = 0;
+    runs->firsts_before[words] = starts;
+    runs->lasts_before[words] = lasts;
+    runs->count = starts;
+}
+
+/**
+ * \brief Counts the runs whose first or last cell lies before a column.
+ * \param column The column, from 0 to words * 64.
+ * \param bits Mask of the first or last cells of the runs.
+ * \param before Number of runs starting or ending before every word.
+ * \return The number of runs.
+ */
+static inline int count_before(int column, const uint64_t* bits, const int* before) {
+    int w = column >> 6;
+    return before[w] + popcount64(bits[w] & ((1ull << (column & 63)) - 1));
+}
+
+//
+
+// Labels
+
+/**
+ * \brief Returns the root of a label, halving the path on the way.
+ */
+static inline int find_label(int label, int* parent) {
+    while (parent[label] != label) {
+        parent[label] = parent[parent[label]];
+        label = parent[label];
+    }
+    return label;
+}
+
+/**
+ * \brief Labels the runs of the current row, joining every run with the runs of the previous row it touches.
+ *
+ * Two runs touch when they overlap or when their ends are diagonal neighbours, so the runs of the previous row
+ * a run touches are those ending at or after the column before it and starting at or before the column after it.
+ * A run touching none of them gets a new label and one touching some gets the label of the first one, without
+ * a branch; the runs touching several are kept and joined afterwards.
+ * \param labels Pointer to the RowLabels structure, with the runs of the current row listed.
+ */
+static void label_runs(RowLabels* labels) {
+    const RowRuns* previous = &labels->previous;
+    RowRuns* current = &labels->current;
+    int* parent = labels->parent;
+    int* merges = labels->merges;
+    int count = current->count;
+    int label_count = labels->label_count;
+
+    int merge_count = 0;
+    for (int k = 0; k < count; k++) {
+        int start = current->start[k];
+        int first = count_before(start > 0 ? start - 1 : 0, previous->last_bits, previous->lasts_before);
+        int end = count_before(current->last[k] + 2, previous->first_bits, previous->firsts_before);
+        int fresh = first == end;
+        int above = previous->label[first]; // Read even for a fresh run, so that choosing the label is not a branch
+        parent[label_count] = label_count;
+        current->label[k] = above + ((label_count - above) & -fresh);
+        label_count += fresh;
+        merges[merge_count] = first;
+        merges[merge_count + 1] = end;
+        merge_count += end - first > 1 ? 2 : 0;
+    }
+    int components = labels->components + label_count - labels->label_count;
+
+    for (int m = 0; m < merge_count; m += 2) {
+        int label = find_label(previous->label[merges[m]], parent);
+        for (int i = merges[m] + 1; i < merges[m + 1]; i++) {
+            int above = find_label(previous->label[i], parent);
+            int low = above < label ? above : label;
+            int high = above < label ? label : above;
+            parent[high] = low;
+            components -= high != low;
+            label = low;
+        }
+    }
+    labels->label_count = label_count;
+    labels->components = components;
+}
+
+/**
+ * \brief Makes the current row the previous one, compacting the labels once half of them are used.
+ * \param labels Pointer to the RowLabels structure.
+ */
+static void finish_row(RowLabels* labels) {
+    RowRuns swap = labels->previous;
+    labels->previous = labels->current;
+    labels->current = swap;
+    if (labels->label_count <= labels->capacity / 2)
+        return;
+
+    // Only the labels of the previous row are still used, their roots are renumbered from 0
+    RowRuns* previous = &labels->previous;
+    for (int i = 0; i < labels->label_count; i++) {
+        labels->remap[i] = -1;
+    }
+    int count = 0;
+    for (int k = 0; k < previous->count; k++) {
+        int root = find_label(previous->label[k], labels->parent);
+        if (labels->remap[root] < 0)
+            labels->remap[root] = count++;
+        previous->label[k] = labels->remap[root];
+    }
+    for (int i = 0; i < count; i++) {
+        labels->parent[i] = i;
+    }
+    labels->label_count = count;
+    //
+}
+
+//
+
+/**
+ * \brief Computes the 3BV, openings and islands of a board in one pass over its cells.
+ * \param board Pointer to the Board structure, with its mines placed.
+ * \param stats Pointer to the BoardStats structure receiving the metrics.
+ * \return false if the memory could not be allocated.
+ */
+bool compute_board_stats(const Board* board, BoardStats* stats) {
+    memset(stats, 0, sizeof(BoardStats));
+    int rows = board->rows;
+    int cols = board->cols;
+    int words = (cols + 63) / 64;
+    size_t stride = (size_t)words + 2;
+
+    // Masks with a guard word on each side: zeros of the rows above, at and below the current one, safe cells
+    // of the current row and of the one below, zeros of the three rows together, numbers outside the borders,
+    // then the masks of the ends of the runs of both kinds in both rows
+    size_t run_ints = ((size_t)cols + 8) * 3 + ((size_t)words + 1) * 2;
+    int capacity = (cols + 2) * 2;
+    size_t kind_ints = run_ints * 2 + (size_t)capacity * 2 + (size_t)cols + 4;
+    uint64_t* masks = core_calloc(stride * 7 + ((size_t)words + 1) * 8, sizeof(uint64_t));
+    int* block = core_calloc(kind_ints * 2, sizeof(int));
+    if (!masks || !block) {
+        core_free(masks);
+        core_free(block);
+        return false;
+    }
+    uint64_t* zeros[3] = { masks + 1, masks + stride + 1, masks + stride * 2 + 1 };
+    uint64_t* safe[2] = { masks + stride * 3 + 1, masks + stride * 4 + 1 };
+    uint64_t* near_zero = masks + stride * 5 + 1;
+    uint64_t* island = masks + stride * 6 + 1;
+
+    RowLabels labels[2];
+    int* next = block;
+    uint64_t* next_bits = masks + stride * 7;
+    for (int k = 0; k < 2; k++) {
+        RowRuns* rows_of_kind[2] = { &labels[k].previous, &labels[k].current };
+        for (int r = 0; r < 2; r++) {
+            rows_of_kind[r]->start = next;
+            rows_of_kind[r]->last = next + cols + 8;
+            rows_of_kind[r]->label = next + (cols + 8) * 2;
+            rows_of_kind[r]->firsts_before = next + (cols + 8) * 3;
+            rows_of_kind[r]->lasts_before = next + (cols + 8) * 3 + words + 1;
+            rows_of_kind[r]->first_bits = next_bits;
+            rows_of_kind[r]->last_bits = next_bits + words + 1;
+            rows_of_kind[r]->count = 0;
+            next += run_ints;
+            next_bits += (words + 1) * 2;
+        }
+        labels[k].parent = next;
+        labels[k].remap = next + capacity;
+        labels[k].merges = next + capacity * 2;
+        labels[k].capacity = capacity;
+        labels[k].label_count = 0;
+        labels[k].components = 0;
+        next += kind_ints - run_ints * 2;
+    }
+    RowLabels* openings = &labels[0];
+    RowLabels* islands = &labels[1];
+    //
+
+    int island_cells = 0;
+    if (rows > 0) {
+        load_row(board->cells, cols, zeros[1], safe[0]);
+    }
+    for (int r = 0; r < rows; r++) {
+        if (r + 1 < rows) {
+            load_row(board->cells + (size_t)(r + 1) * cols, cols, zeros[2], safe[1]);
+        }
+
+        // A zero among the eight neighbours puts a number on the border of an opening
+        for (int w = 0; w < words; w++) {
+            near_zero[w] = zeros[0][w] | zeros[1][w] | zeros[2][w];
+        }
+        for (int w = 0; w < words; w++) {
+            uint64_t around = near_zero[w] | (near_zero[w] << 1) | (near_zero[w - 1] >> 63) | (near_zero[w] >> 1) | (near_zero[w + 1] << 63);
+            island[w] = safe[0][w] & ~around;
+            island_cells += popcount64(island[w]);
+        }
+        //
+
+        find_runs(zeros[1], words, &openings->current);
+        label_runs(openings);
+        finish_row(openings);
+        find_runs(island, words, &islands->current);
+        label_runs(islands);
+        finish_row(islands);
+
+        // The masks roll down one row, the row below the last one has no cells
+        uint64_t* above = zeros[0];
+        zeros[0] = zeros[1];
+        zeros[1] = zeros[2];
+        zeros[2] = above;
+        uint64_t* current = safe[0];
+        safe[0] = safe[1];
+        safe[1] = current;
+        memset(zeros[2], 0, (size_t)words * sizeof(uint64_t));
+        memset(safe[1], 0, (size_t)words * sizeof(uint64_t));
+        //
+    }
+
+    stats->openings = openings->components;
+    stats->islands = islands->components;
+    stats->bv = openings->components + island_cells;
+    core_free(masks);
+    core_free(block);
+    return true;
+}
@@ -0,0 +1,28 @@
+/*****************************************************************//**
+ * \file   boardstats.h
+ * \brief  Difficulty metrics of a board: 3BV, openings and islands.
+ *
+ * An opening is a connected area of safe cells without adjacent mines, one click reveals it with its border.
+ * The numbered cells outside every border need a click each, and an island is a connected group of them.
+ * The 3BV, the clicks a perfect player needs without flags, is the openings plus those numbered cells.
+ *
+ * The metrics come from one pass over the rows, labelling the runs of cells of both kinds with a union-find
+ * whose labels are compacted every few rows, so the memory used grows with the columns, not the cells.
+ * Only classic boards are measured, the scan relies on their 3x3 neighbourhoods.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+
+/**
+ * \typedef BoardStats
+ * \brief Difficulty metrics of a board whose mines are placed.
+ */
+typedef struct BoardStats {
+    int bv; /**< The 3BV: openings plus numbered cells outside the borders of the openings. */
+    int openings; /**< Number of connected areas of cells without adjacent mines. */
+    int islands; /**< Number of connected groups of numbered cells outside the borders of the openings. */
+} BoardStats;
+
+bool compute_board_stats(const Board* board, BoardStats* stats);
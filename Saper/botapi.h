@@ -0,0 +1,112 @@
+/*****************************************************************//**
+ * \file   botapi.h
+ * \brief  The C ABI of bot plugins: shared libraries playing games through batches of actions.
+ *
+ * A plugin exports BOT_ENTRY_NAME, a function returning its BotInterface. The engine creates one bot per
+ * worker thread and reuses it from game to game. Every game starts with the middle cell opened by the
+ * engine, so two bots given the same seed play the same boards.
+ *
+ * On every turn the bot reads a BotView, the visible board kept by the engine, and writes a batch of
+ * actions. The engine applies them in order, with the same code as a click, and the next view lists the
+ * cells they changed. The view points into engine memory: nothing is copied, and the bot must not keep
+ * the pointers past the call.
+ *
+ * This header is self-contained so that plugins build without the engine sources.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \def BOT_API_VERSION
+ * \brief Version of this interface, bumped on any change to its structures or calls.
+ */
+#define BOT_API_VERSION 1
+
+/**
+ * \def BOT_ENTRY_NAME
+ * \brief Name of the function a plugin exports, of type BotEntry.
+ */
+#define BOT_ENTRY_NAME "bot_interface"
+
+/**
+ * \def BOT_EXPORT
+ * \brief Marks the entry function of a plugin as exported from the shared library.
+ */
+#if defined(_WIN32)
+#define BOT_EXPORT __declspec(dllexport)
+#elif defined(__GNUC__)
+#define BOT_EXPORT __attribute__((visibility("default")))
+#else
+#define BOT_EXPORT
+#endif
+
+/**
+ * \def BOT_CELL_HIDDEN
+ * \brief Visible value of a cell neither revealed nor flagged. Revealed numbers are 0 to 8.
+ */
+#define BOT_CELL_HIDDEN 9
+
+/**
+ * \def BOT_CELL_FLAG
+ * \brief Visible value of a flagged cell.
+ */
+#define BOT_CELL_FLAG 10
+
+/**
+ * \def BOT_CELL_MINE
+ * \brief Visible value of a revealed mine, only seen once the game is lost.
+ */
+#define BOT_CELL_MINE 11
+
+/**
+ * \brief Kinds of actions a bot can take.
+ */
+enum BotActionKind {
+    BOT_REVEAL, /**< Reveals a cell, like a left click. */
+    BOT_FLAG /**< Toggles the flag of a cell, like a right click. */
+};
+
+/**
+ * \typedef BotAction
+ * \brief One action of a batch.
+ */
+typedef struct BotAction {
+    int32_t index; /**< Cell acted on, row * cols + col. */
+    int32_t kind; /**< A value of enum BotActionKind. */
+} BotAction;
+
+/**
+ * \typedef BotView
+ * \brief Read-only view of the visible board, valid during one call.
+ */
+typedef struct BotView {
+    int32_t rows; /**< Number of rows of the board. */
+    int32_t cols; /**< Number of columns of the board. */
+    int32_t mines; /**< Number of mines of the board. */
+    int32_t flags; /**< Number of flags placed. */
+    int32_t hidden; /**< Number of cells not revealed, flagged ones included. */
+    const uint8_t* cells; /**< Visible value of every cell in row order: 0 to 8, BOT_CELL_HIDDEN, BOT_CELL_FLAG or BOT_CELL_MINE. */
+    const int32_t* changed; /**< Cells whose value changed since the previous turn, or opened by the engine on the first one. */
+    int32_t changed_count; /**< Number of entries of changed. */
+} BotView;
+
+/**
+ * \typedef BotInterface
+ * \brief What a plugin provides: its name and the calls of its bots.
+ */
+typedef struct BotInterface {
+    int32_t api_version; /**< BOT_API_VERSION the plugin was built with. */
+    const char* name; /**< Name of the bot, for the reports. */
+    void* (*create)(int32_t rows, int32_t cols, int32_t mines); /**< Allocates a bot for boards of one size, NULL on failure. */
+    void (*destroy)(void* bot); /**< Frees a bot. */
+    void (*start)(void* bot, int64_t game); /**< Starts a game, numbered from 0 in the run, before its first turn. */
+    int32_t (*play)(void* bot, const BotView* view, BotAction* actions, int32_t capacity); /**< Writes up to capacity actions and returns their count, 0 to give up. */
+} BotInterface;
+
+/**
+ * \typedef BotEntry
+ * \brief The function a plugin exports under BOT_ENTRY_NAME.
+ */
+typedef const BotInterface* (*BotEntry)(void);
@@ -0,0 +1,349 @@
+/*****************************************************************//**
+ * \file   botplay.c
+ * \brief  Plugin loading, the visible view of a game and the workers playing bot games.
+ *********************************************************************/
+
+#include <string.h>
+#include "allocator.h"
+#include "botplay.h"
+#include "gamerun.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+/**
+ * \typedef BotRun
+ * \brief Bot and board size of one run, and where the workers write their results.
+ */
+typedef struct BotRun {
+    const BotInterface* bot; /**< The bot playing. */
+    int rows; /**< Number of rows of the boards. */
+    int cols; /**< Number of columns of the boards. */
+    int mines; /**< Number of mines of the boards. */
+    unsigned char* outcomes; /**< Outcome of every game, each written by the worker playing it. */
+    BotReport* report; /**< Sum of the counters of every worker. */
+} BotRun;
+
+/**
+ * \typedef BotWorker
+ * \brief The game, bot and counters of one worker.
+ */
+typedef struct BotWorker {
+    BotGame game; /**< The game being played, reset from game to game. */
+    void* bot; /**< State of the bot, created for the worker. */
+    BotAction* actions; /**< Batch of actions of a turn, BOT_BATCH_SIZE entries. */
+    long long wins; /**< Number of games won. */
+    long long stalls; /**< Number of games given up. */
+    long long turns; /**< Number of calls to the bot. */
+    long long actions_applied; /**< Number of actions applied. */
+} BotWorker;
+
+// Plugins
+
+/**
+ * \brief Loads a plugin and checks it was built for this interface.
+ * \param path Path of the shared library.
+ * \param plugin Pointer to the BotPlugin structure receiving it.
+ * \return false if the library cannot be loaded, exports no interface or another version of it.
+ */
+bool bot_plugin_load(const char* path, BotPlugin* plugin) {
+    plugin->library = NULL;
+    plugin->bot = NULL;
+#if defined(_WIN32)
+    HMODULE library = LoadLibraryA(path);
+    BotEntry entry = library ? (BotEntry)(void*)GetProcAddress(library, BOT_ENTRY_NAME) : NULL;
+#else
+    void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    BotEntry entry = NULL;
+    if (library) {
+        *(void**)&entry = dlsym(library, BOT_ENTRY_NAME); // A data pointer to a function pointer, as POSIX allows
+    }
+#endif
+    plugin->library = (void*)library;
+
+    const BotInterface* bot = entry ? entry() : NULL;
+    if (!bot || bot->api_version != BOT_API_VERSION || !bot->create || !bot->destroy || !bot->start || !bot->play) {
+        bot_plugin_unload(plugin);
+        return false;
+    }
+    plugin->bot = bot;
+    return true;
+}
+
+/**
+ * \brief Unloads a plugin. Its bots must have been destroyed.
+ * \param plugin Pointer to the BotPlugin structure.
+ */
+void bot_plugin_unload(BotPlugin* plugin) {
+    if (plugin->library) {
+#if defined(_WIN32)
+        FreeLibrary((HMODULE)plugin->library);
+#else
+        dlclose(plugin->library);
+#endif
+    }
+    plugin->library = NULL;
+    plugin->bot = NULL;
+}
+
+//
+
+// Games
+
+/**
+ * \brief Returns the visible value of a cell.
+ */
+static inline uint8_t visible_value(unsigned char cell) {
+    if (cell & CELL_REVEALED)
+        return (cell & CELL_MINE) ? BOT_CELL_MINE : (uint8_t)(cell & CELL_COUNT_MASK);
+    return (cell & CELL_FLAGGED) ? BOT_CELL_FLAG : BOT_CELL_HIDDEN;
+}
+
+/**
+ * \brief Allocates a game and its view.
+ * \param rows Number of rows of the board.
+ * \param cols Number of columns of the board.
+ * \param mines Number of mines of the board.
+ * \param game Pointer to the BotGame structure.
+ * \return false if the memory could not be allocated.
+ */
+bool bot_game_create(int rows, int cols, int mines, BotGame* game) {
+    memset(game, 0, sizeof(BotGame));
+    size_t cell_count = (size_t)rows * cols;
+    game->changed_capacity = (int)cell_count + BOT_BATCH_SIZE;
+    game->view = core_malloc(cell_count);
+    game->changed = core_malloc((size_t)game->changed_capacity * sizeof(int32_t));
+    bool created = initialize_board(rows, cols, mines, 0, &game->board);
+    return created && game->view && game->changed;
+}
+
+/**
+ * \brief Frees a game and its view.
+ * \param game Pointer to the BotGame structure.
+ */
+void bot_game_destroy(BotGame* game) {
+    free_board(&game->board);
+    core_free(game->view);
+    core_free(game->changed);
+    game->view = NULL;
+    game->changed = NULL;
+}
+
+/**
+ * \brief Starts a new game and opens its middle cell, which is safe, the opened cells being the first changes.
+ * \param seed Seed of the board.
+ * \param game Pointer to the BotGame structure.
+ */
+void bot_game_start(uint64_t seed, BotGame* game) {
+    Board* board = &game->board;
+    reset_board(board->mines, seed, board);
+    memset(game->view, BOT_CELL_HIDDEN, (size_t)board->rows * board->cols);
+
+    int opened = reveal_cell(board->rows / 2, board->cols / 2, board);
+    for (int i = 0; i < opened; i++) {
+        int index = board->opened[i];
+        game->view[index] = visible_value(board->cells[index]);
+        game->changed[i] = index;
+    }
+    game->changed_count = opened;
+}
+
+/**
+ * \brief Applies a batch of actions in order, through reveal_cell and toggle_flag, and lists the cells they changed.
+ *
+ * Actions out of the board or changing nothing are counted as invalid. Those after the end of the game are ignored.
+ * \param actions The actions.
+ * \param count Number of actions, at most BOT_BATCH_SIZE.
+ * \param game Pointer to the BotGame structure.
+ * \return Number of actions applied, the invalid ones included.
+ */
+int bot_game_apply(const BotAction* actions, int count, BotGame* game) {
+    Board* board = &game->board;
+    int cell_count = board->rows * board->cols;
+    game->changed_count = 0;
+
+    int applied = 0;
+    for (; applied < count && !board->game_over && !board->game_won; applied++) {
+        int index = actions[applied].index;
+        if (index < 0 || index >= cell_count) {
+            game->invalid++;
+            continue;
+        }
+
+        if (actions[applied].kind == BOT_FLAG) {
+            if (board->cells[index] & CELL_REVEALED) {
+                game->invalid++;
+                continue;
+            }
+            toggle_flag(index / board->cols, index % board->cols, board);
+            game->view[index] = visible_value(board->cells[index]);
+            game->changed[game->changed_count++] = index;
+        }
+        else {
+            int opened = reveal_cell(index / board->cols, index % board->cols, board); // Each cell is opened once per game, so changed has room
+            if (opened == 0)
+                game->invalid++;
+            for (int i = 0; i < opened; i++) {
+                int cell = board->opened[i];
+                game->view[cell] = visible_value(board->cells[cell]);
+                game->changed[game->changed_count++] = cell;
+            }
+        }
+    }
+    return applied;
+}
+
+/**
+ * \brief Fills the view of a game given to a bot.
+ * \param game Pointer to the BotGame structure.
+ * \param view Pointer to the BotView structure, pointing into the game afterwards.
+ */
+void bot_game_view(const BotGame* game, BotView* view) {
+    const Board* board = &game->board;
+    view->rows = board->rows;
+    view->cols = board->cols;
+    view->mines = board->mines;
+    view->flags = board->flags_placed;
+    view->hidden = board->rows * board->cols - board->revealed_count;
+    view->cells = game->view;
+    view->changed = game->changed;
+    view->changed_count = game->changed_count;
+}
+
+//
+
+// Workers
+
+/**
+ * \brief Plays one game with the bot of a worker and counts it.
+ * \param seed Seed of the board.
+ * \param number Number of the game in the run.
+ * \param context Pointer to the BotRun structure.
+ * \param state Pointer to the BotWorker structure.
+ * \return Always true, a game cannot stop the run.
+ */
+static bool play_game(uint64_t seed, long long number, void* context, void* state) {
+    const BotRun* run = context;
+    BotWorker* worker = state;
+    const BotInterface* bot = run->bot;
+    BotGame* game = &worker->game;
+    Board* board = &game->board;
+    bot_game_start(seed, game);
+    bot->start(worker->bot, number);
+
+    // Every turn either opens a cell or toggles a flag, a bot taking more turns than that is going in circles
+    long long turn_limit = 4LL * board->rows * board->cols + 16;
+    for (long long turn = 0; turn < turn_limit && !board->game_over && !board->game_won; turn++) {
+        BotView view;
+        bot_game_view(game, &view);
+        int count = bot->play(worker->bot, &view, worker->actions, BOT_BATCH_SIZE);
+        worker->turns++;
+        if (count <= 0)
+            break;
+        worker->actions_applied += bot_game_apply(worker->actions, count < BOT_BATCH_SIZE ? count : BOT_BATCH_SIZE, game);
+    }
+    //
+
+    // Taken from the board, so a game ended by the last allowed turn still counts as won or lost
+    unsigned char outcome = board->game_won ? BOT_WON : board->game_over ? BOT_LOST : BOT_STALLED;
+    run->outcomes[number] = outcome;
+    worker->wins += outcome == BOT_WON;
+    worker->stalls += outcome == BOT_STALLED;
+    return true;
+}
+
+/**
+ * \brief Allocates the game, bot and batch of a worker.
+ * \param context Pointer to the BotRun structure.
+ * \param state Pointer to the BotWorker structure, zeroed.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool create_worker(void* context, void* state) {
+    const BotRun* run = context;
+    BotWorker* worker = state;
+    bool created = bot_game_create(run->rows, run->cols, run->mines, &worker->game);
+    worker->actions = core_malloc(BOT_BATCH_SIZE * sizeof(BotAction));
+    worker->bot = run->bot->create(run->rows, run->cols, run->mines);
+    return created && worker->actions && worker->bot;
+}
+
+/**
+ * \brief Adds the counters of a worker to the report of the run.
+ * \param context Pointer to the BotRun structure.
+ * \param state Pointer to the BotWorker structure.
+ */
+static void merge_worker(void* context, const void* state) {
+    const BotRun* run = context;
+    const BotWorker* worker = state;
+    run->report->wins += worker->wins;
+    run->report->stalls += worker->stalls;
+    run->report->turns += worker->turns;
+    run->report->actions += worker->actions_applied;
+    run->report->invalid += worker->game.invalid;
+}
+
+/**
+ * \brief Frees the game, bot and batch of a worker.
+ * \param context Pointer to the BotRun structure.
+ * \param state Pointer to the BotWorker structure.
+ */
+static void destroy_worker(void* context, void* state) {
+    const BotRun* run = context;
+    BotWorker* worker = state;
+    if (worker->bot) {
+        run->bot->destroy(worker->bot);
+    }
+    bot_game_destroy(&worker->game);
+    core_free(worker->actions);
+}
+
+//
+
+/**
+ * \brief Plays games of one board size with a bot, on every worker of a pool, and reports how they went.
+ * \param bot The interface of the bot, from a plugin or built in.
+ * \param rows Number of rows of the boards.
+ * \param cols Number of columns of the boards.
+ * \param mines Number of mines of the boards, at most rows * cols - 9 so that the middle cell is an opening.
+ * \param games Number of games to play.
+ * \param seed Seed the boards are drawn from, the same seed gives the same boards to every bot.
+ * \param threads Workers playing the games, NULL to play them on the calling thread, which must not be one of them.
+ * \param report Pointer to the BotReport structure receiving the results, freed with bot_report_free.
+ * \return false if the arguments are out of range or the memory could not be allocated.
+ */
+bool run_bot_games(const BotInterface* bot, int rows, int cols, int mines, long long games, uint64_t seed, ThreadPool* threads, BotReport* report) {
+    memset(report, 0, sizeof(BotReport));
+    if (rows < 3 || cols < 3 || (long long)rows * cols > 100000000 || mines < 0 || mines > rows * cols - 9 || games <= 0) {
+        return false;
+    }
+    report->outcomes = core_malloc((size_t)games);
+    if (!report->outcomes) {
+        return false;
+    }
+    report->name = bot->name;
+    report->rows = rows;
+    report->cols = cols;
+    report->mines = mines;
+    report->games = games;
+
+    BotRun context = { bot, rows, cols, mines, report->outcomes, report };
+    GameRun run = { games, seed, sizeof(BotWorker), &context, create_worker, play_game, merge_worker, destroy_worker };
+    if (!run_games(&run, threads, &report->seconds)) {
+        bot_report_free(report);
+        memset(report, 0, sizeof(BotReport));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Frees the outcomes of a report.
+ * \param report Pointer to the BotReport structure.
+ */
+void bot_report_free(BotReport* report) {
+    core_free(report->outcomes);
+    report->outcomes = NULL;
+}
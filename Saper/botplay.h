@@ -0,0 +1,80 @@
+/*****************************************************************//**
+ * \file   botplay.h
+ * \brief  Loading bot plugins and playing many games with them, side by side on a thread pool.
+ *
+ * Games are played with run_games, as in the difficulty analysis, so game g has the same board whatever the
+ * bot and the number of workers. The outcome of every game is kept, which lets two bots be compared game by game.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include "board.h"
+#include "botapi.h"
+#include "threadpool.h"
+
+/**
+ * \def BOT_BATCH_SIZE
+ * \brief Largest number of actions a bot may return in one turn.
+ */
+#define BOT_BATCH_SIZE 1024
+
+/**
+ * \brief Ways a game of a bot can end.
+ */
+enum BotOutcome {
+    BOT_LOST, /**< A mine was revealed. */
+    BOT_WON, /**< Every safe cell was revealed. */
+    BOT_STALLED /**< The bot gave up, or took more turns than the board allows. */
+};
+
+/**
+ * \typedef BotPlugin
+ * \brief A loaded plugin.
+ */
+typedef struct BotPlugin {
+    void* library; /**< Handle of the shared library. */
+    const BotInterface* bot; /**< The interface it exports. */
+} BotPlugin;
+
+/**
+ * \typedef BotGame
+ * \brief A board with the visible view a bot plays on.
+ */
+typedef struct BotGame {
+    Board board; /**< The game being played. */
+    uint8_t* view; /**< Visible value of every cell, updated with the changes only. */
+    int32_t* changed; /**< Cells changed by the last batch. */
+    int changed_count; /**< Number of entries of changed. */
+    int changed_capacity; /**< Size of changed, the cells plus BOT_BATCH_SIZE. */
+    long long invalid; /**< Actions that changed nothing, since the game was created. */
+} BotGame;
+
+/**
+ * \typedef BotReport
+ * \brief Results of the games played by one bot.
+ */
+typedef struct BotReport {
+    const char* name; /**< Name of the bot. */
+    int rows; /**< Number of rows of the boards. */
+    int cols; /**< Number of columns of the boards. */
+    int mines; /**< Number of mines of the boards. */
+    long long games; /**< Number of games played. */
+    long long wins; /**< Number of games won. */
+    long long stalls; /**< Number of games the bot gave up. */
+    long long turns; /**< Number of calls to the bot. */
+    long long actions; /**< Number of actions applied. */
+    long long invalid; /**< Number of actions that changed nothing. */
+    unsigned char* outcomes; /**< Value of enum BotOutcome of every game, in game order. */
+    double seconds; /**< Time the games took, in seconds. */
+} BotReport;
+
+bool bot_plugin_load(const char* path, BotPlugin* plugin);
+void bot_plugin_unload(BotPlugin* plugin);
+bool bot_game_create(int rows, int cols, int mines, BotGame* game);
+void bot_game_destroy(BotGame* game);
+void bot_game_start(uint64_t seed, BotGame* game);
+int bot_game_apply(const BotAction* actions, int count, BotGame* game);
+void bot_game_view(const BotGame* game, BotView* view);
+bool run_bot_games(const BotInterface* bot, int rows, int cols, int mines, long long games, uint64_t seed, ThreadPool* threads, BotReport* report);
+void bot_report_free(BotReport* report);
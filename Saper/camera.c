@@ -0,0 +1,142 @@
+/*****************************************************************//**
+ * \file   camera.c
+ * \brief  Camera of the board viewport: pan, zoom and mapping from screen to board coordinates.
+ *********************************************************************/
+
+#include <math.h>
+#include "camera.h"
+
+/**
+ * \brief Keeps the camera inside the board, or centres the board when it is smaller than the viewport.
+ * \param board_size Size of the board along one axis, in unscaled pixels.
+ * \param view_size Size of the viewport along the same axis, in screen pixels.
+ * \param zoom The current zoom.
+ * \param position The camera position along the axis, in unscaled pixels.
+ * \return The clamped camera position.
+ */
+static float clamp_axis(float board_size, float view_size, float zoom, float position) {
+    float visible = view_size / zoom;
+    if (board_size <= visible) {
+        return (board_size - visible) / 2;
+    }
+    if (position < 0)
+        return 0;
+    if (position > board_size - visible)
+        return board_size - visible;
+    return position;
+}
+
+/**
+ * \brief Clamps both axes of the camera, except in infinite mode.
+ * \param game Pointer to the Game structure.
+ */
+static void clamp_camera(Game* game) {
+    if (game->infinite) { // The world has no edge
+        return;
+    }
+    game->camera_x = clamp_axis((float)board_pixel_width(game), (float)game->view_width, game->zoom, game->camera_x);
+    game->camera_y = clamp_axis((float)game->board.rows * CELL_SIZE, (float)game->view_height, game->zoom, game->camera_y);
+}
+
+/**
+ * \brief Shows the top left corner of the board at zoom 1, or cell (0, 0) in the middle of the viewport in infinite mode.
+ * \param game Pointer to the Game structure.
+ */
+void reset_camera(Game* game) {
+    game->zoom = 1.0f;
+    game->camera_x = 0.0f;
+    game->camera_y = 0.0f;
+    if (game->infinite) { // Cell (0, 0) in the middle of the viewport
+        game->camera_x = (CELL_SIZE - game->view_width) / 2.0f;
+        game->camera_y = (CELL_SIZE - game->view_height) / 2.0f;
+    }
+    clamp_camera(game);
+}
+
+/**
+ * \brief Moves the camera.
+ * \param dx Horizontal move, in screen pixels.
+ * \param dy Vertical move, in screen pixels.
+ * \param game Pointer to the Game structure.
+ */
+void pan_camera(float dx, float dy, Game* game) {
+    game->camera_x += dx / game->zoom;
+    game->camera_y += dy / game->zoom;
+    clamp_camera(game);
+}
+
+/**
+ * \brief Zooms the camera, keeping the board point under the given screen point in place.
+ * \param factor Zoom multiplier, the result is clamped to [MIN_ZOOM, MAX_ZOOM].
+ * \param x The x-coordinate of the fixed screen point.
+ * \param y The y-coordinate of the fixed screen point.
+ * \param game Pointer to the Game structure.
+ */
+void zoom_camera(float factor, int x, int y, Game* game) {
+    float board_x = game->camera_x + (x - game->start_x) / game->zoom;
+    float board_y = game->camera_y + (y - game->start_y) / game->zoom;
+
+    game->zoom *= factor;
+    if (game->zoom < MIN_ZOOM)
+        game->zoom = MIN_ZOOM;
+    if (game->zoom > MAX_ZOOM)
+        game->zoom = MAX_ZOOM;
+
+    game->camera_x = board_x - (x - game->start_x) / game->zoom;
+    game->camera_y = board_y - (y - game->start_y) / game->zoom;
+    clamp_camera(game);
+}
+
+/**
+ * \brief Finds the cell under a screen point, the row first since it tells how far the cells are shifted.
+ * \param x The x-coordinate of the screen point.
+ * \param y The y-coordinate of the screen point.
+ * \param row Receives the row index of the cell.
+ * \param col Receives the column index of the cell.
+ * \param game Pointer to the Game structure.
+ * \return True if the point is over a cell of the board inside the viewport.
+ */
+bool screen_to_cell(int x, int y, int* row, int* col, const Game* game) {
+    if (x < game->start_x || x >= game->start_x + game->view_width || y < game->start_y || y >= game->start_y + game->view_height) {
+        return false;
+    }
+
+    float board_x = game->camera_x + (x - game->start_x) / game->zoom;
+    float board_y = game->camera_y + (y - game->start_y) / game->zoom;
+
+    *row = (int)floorf(board_y / CELL_SIZE);
+    *col = (int)floorf((board_x - row_shift(*row, game)) / CELL_SIZE);
+    if (game->infinite) {
+        return true;
+    }
+    return *col >= 0 && *row >= 0 && *col < game->board.cols && *row < game->board.rows;
+}
+
+/**
+ * \brief Computes the range of cells intersecting the viewport, so that drawing can skip all the others.
+ * \param first_row Receives the first visible row.
+ * \param first_col Receives the first visible column.
+ * \param last_row Receives the last visible row.
+ * \param last_col Receives the last visible column.
+ * \param game Pointer to the Game structure.
+ */
+void visible_cells(int* first_row, int* first_col, int* last_row, int* last_col, const Game* game) {
+    *first_col = (int)floorf(game->camera_x / CELL_SIZE);
+    *first_row = (int)floorf(game->camera_y / CELL_SIZE);
+    *last_col = (int)floorf((game->camera_x + game->view_width / game->zoom) / CELL_SIZE);
+    *last_row = (int)floorf((game->camera_y + game->view_height / game->zoom) / CELL_SIZE);
+
+    if (game->infinite) {
+        return;
+    }
+    if (game->board.topology == TOPOLOGY_HEX) // The shifted rows show one more column on the left
+        (*first_col)--;
+    if (*first_col < 0)
+        *first_col = 0;
+    if (*first_row < 0)
+        *first_row = 0;
+    if (*last_col >= game->board.cols)
+        *last_col = game->board.cols - 1;
+    if (*last_row >= game->board.rows)
+        *last_row = game->board.rows - 1;
+}
@@ -0,0 +1,51 @@
+/*****************************************************************//**
+ * \file   camera.h
+ * \brief  Camera of the board viewport: pan, zoom and mapping from screen to board coordinates.
+ *********************************************************************/
+
+#pragma once
+
+#include "game.h"
+
+/**
+ * \def MIN_ZOOM
+ * \brief Smallest zoom, it bounds the number of cells visible at once and so the cost of a frame.
+ */
+#define MIN_ZOOM 0.25f
+
+/**
+ * \def MAX_ZOOM
+ * \brief Largest zoom.
+ */
+#define MAX_ZOOM 2.0f
+
+/**
+ * \def CAMERA_STEP
+ * \brief Distance the arrow keys move the camera, in screen pixels.
+ */
+#define CAMERA_STEP 90.0f
+
+/**
+ * \brief Returns how far a row is shifted to the right, half a cell for the odd rows of a hexagonal board.
+ * \param row The row index.
+ * \param game Pointer to the Game structure.
+ * \return The shift in unscaled pixels.
+ */
+static inline int row_shift(int row, const Game* game) {
+    return !game->infinite && game->board.topology == TOPOLOGY_HEX ? (row & 1) * (CELL_SIZE / 2) : 0;
+}
+
+/**
+ * \brief Returns the width of the board, its shifted rows included.
+ * \param game Pointer to the Game structure.
+ * \return The width in unscaled pixels.
+ */
+static inline int board_pixel_width(const Game* game) {
+    return game->board.cols * CELL_SIZE + (game->board.topology == TOPOLOGY_HEX && game->board.rows > 1 ? CELL_SIZE / 2 : 0);
+}
+
+void reset_camera(Game* game);
+void pan_camera(float dx, float dy, Game* game);
+void zoom_camera(float factor, int x, int y, Game* game);
+bool screen_to_cell(int x, int y, int* row, int* col, const Game* game);
+void visible_cells(int* first_row, int* first_col, int* last_row, int* last_col, const Game* game);
@@ -0,0 +1,174 @@
+/*****************************************************************//**
+ * \file   difficulty.c
+ * \brief  Bot games and the workers of the difficulty analysis.
+ *********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "boardstats.h"
+#include "difficulty.h"
+#include "gamerun.h"
+#include "probability.h"
+#include "solver.h"
+
+/**
+ * \typedef DifficultyRun
+ * \brief Board size of one analysis and the report the workers are merged into.
+ */
+typedef struct DifficultyRun {
+    int rows; /**< Number of rows of the boards. */
+    int cols; /**< Number of columns of the boards. */
+    int mines; /**< Number of mines of the boards. */
+    DifficultyReport* report; /**< Sum of the counters of every worker. */
+} DifficultyRun;
+
+/**
+ * \typedef DifficultyWorker
+ * \brief Buffers and counters of one worker, touched by no other thread until the games are over.
+ */
+typedef struct DifficultyWorker {
+    Board board; /**< Board of the game being played, reset from game to game. */
+    Solver solver; /**< Proves cells safe for the bot. */
+    ProbabilityEngine engine; /**< Finds the safest cell when the solver is stuck. */
+    DifficultyReport report; /**< Counters of the games played by the worker. */
+} DifficultyWorker;
+
+/**
+ * \brief Plays one game with the bot and adds it to the counters of a worker.
+ * \param seed Seed of the board.
+ * \param number Number of the game in the run.
+ * \param context Pointer to the DifficultyRun structure.
+ * \param state Pointer to the DifficultyWorker structure.
+ * \return false if the memory ran out, which stops the analysis.
+ */
+static bool play_bot_game(uint64_t seed, long long number, void* context, void* state) {
+    (void)number;
+    const DifficultyRun* run = context;
+    DifficultyWorker* worker = state;
+    Board* board = &worker->board;
+    reset_board(run->mines, seed, board);
+    reveal_cell(board->rows / 2, board->cols / 2, board); // Places the mines, the first click is always safe
+    BoardStats stats;
+    if (!compute_board_stats(board, &stats)) {
+        return false;
+    }
+    solver_reset(board, &worker->solver);
+
+    int guesses = 0;
+    while (!board->game_won && !board->game_over) {
+        int index = solver_next_safe(board, &worker->solver);
+        if (index < 0) { // The local rules are stuck, the mine count may still prove a cell safe
+            if (probability_compute(board, &worker->solver, &worker->engine)) {
+                index = probability_safest_cell(board, &worker->engine);
+                if (index >= 0 && probability_of_cell(index / board->cols, index % board->cols, board, &worker->engine) > 0.0)
+                    guesses++;
+            }
+            if (index < 0) { // Nothing computed, the first hidden cell is as good a guess as any
+                for (index = 0; board->cells[index] & CELL_REVEALED; index++) {
+                }
+                guesses++;
+            }
+        }
+
+        reveal_cell(index / board->cols, index % board->cols, board);
+        solver_update(board, &worker->solver);
+    }
+
+    DifficultyReport* report = &worker->report;
+    int bucket = guesses < DIFFICULTY_MAX_GUESSES ? guesses : DIFFICULTY_MAX_GUESSES;
+    report->games++;
+    report->guess_games[bucket]++;
+    report->guess_total += guesses;
+    histogram_record((uint64_t)stats.bv, &report->bv);
+    report->openings_total += stats.openings;
+    report->islands_total += stats.islands;
+    if (board->game_won) {
+        report->wins++;
+        report->guess_wins[bucket]++;
+    }
+    return true;
+}
+
+/**
+ * \brief Allocates the buffers and counters of a worker.
+ * \param context Pointer to the DifficultyRun structure.
+ * \param state Pointer to the DifficultyWorker structure, zeroed.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool create_worker(void* context, void* state) {
+    const DifficultyRun* run = context;
+    DifficultyWorker* worker = state;
+
+    probability_init(NULL, &worker->engine);
+    histogram_reset(&worker->report.bv);
+    if (!initialize_board(run->rows, run->cols, run->mines, 0, &worker->board)) {
+        return false;
+    }
+    worker->engine.time_limit = INFINITY; // Only the node budget bounds the enumeration, so the results do not depend on timing
+    return solver_create(&worker->board, &worker->solver);
+}
+
+/**
+ * \brief Adds the counters of a worker to the report of the analysis.
+ * \param context Pointer to the DifficultyRun structure.
+ * \param state Pointer to the DifficultyWorker structure.
+ */
+static void merge_worker(void* context, const void* state) {
+    const DifficultyRun* run = context;
+    const DifficultyReport* part = &((const DifficultyWorker*)state)->report;
+    DifficultyReport* report = run->report;
+
+    report->games += part->games;
+    report->wins += part->wins;
+    report->guess_total += part->guess_total;
+    report->openings_total += part->openings_total;
+    report->islands_total += part->islands_total;
+    for (int g = 0; g <= DIFFICULTY_MAX_GUESSES; g++) {
+        report->guess_games[g] += part->guess_games[g];
+        report->guess_wins[g] += part->guess_wins[g];
+    }
+    histogram_merge(&part->bv, &report->bv);
+}
+
+/**
+ * \brief Frees the buffers of a worker.
+ * \param context Pointer to the DifficultyRun structure.
+ * \param state Pointer to the DifficultyWorker structure.
+ */
+static void destroy_worker(void* context, void* state) {
+    (void)context;
+    DifficultyWorker* worker = state;
+    solver_destroy(&worker->solver);
+    probability_destroy(&worker->engine);
+    free_board(&worker->board);
+}
+
+/**
+ * \brief Plays games of one board size with the bot, on every worker of a pool, and reports how they went.
+ * \param rows Number of rows of the boards.
+ * \param cols Number of columns of the boards.
+ * \param mines Number of mines of the boards, at most rows * cols - 9 so that the first click is an opening.
+ * \param games Number of games to play.
+ * \param seed Seed the boards are drawn from, the same seed gives the same report.
+ * \param threads Workers playing the games, NULL to play them on the calling thread, which must not be one of them.
+ * \param report Pointer to the DifficultyReport structure receiving the results.
+ * \return false if the arguments are out of range or the memory could not be allocated.
+ */
+bool analyze_difficulty(int rows, int cols, int mines, long long games, uint64_t seed, ThreadPool* threads, DifficultyReport* report) {
+    memset(report, 0, sizeof(DifficultyReport));
+    if (rows < 3 || cols < 3 || (long long)rows * cols > DIFFICULTY_MAX_CELLS || mines < 0 || mines > rows * cols - 9 || games <= 0) {
+        return false;
+    }
+    histogram_reset(&report->bv);
+    report->rows = rows;
+    report->cols = cols;
+    report->mines = mines;
+
+    DifficultyRun context = { rows, cols, mines, report };
+    GameRun run = { games, seed, sizeof(DifficultyWorker), &context, create_worker, play_bot_game, merge_worker, destroy_worker };
+    if (!run_games(&run, threads, &report->seconds)) {
+        memset(report, 0, sizeof(DifficultyReport));
+        return false;
+    }
+    return true;
+}
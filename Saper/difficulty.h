@@ -0,0 +1,50 @@
+/*****************************************************************//**
+ * \file   difficulty.h
+ * \brief  Monte Carlo difficulty analysis: many games of one board size played by a solver-driven bot.
+ *
+ * The bot opens the middle cell, then reveals what the solver proves safe. When the solver is stuck it asks
+ * the probability engine for the safest cell, which is a forced guess unless its probability is zero. Every
+ * game also gets the 3BV, openings and islands of its board, from compute_board_stats.
+ *
+ * The games are played with run_games, whose workers keep their own counters, summed at the end, so the
+ * results only depend on the seed, not on the number of workers.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+#include "histogram.h"
+#include "threadpool.h"
+
+/**
+ * \def DIFFICULTY_MAX_GUESSES
+ * \brief Games needing this many forced guesses or more are counted together.
+ */
+#define DIFFICULTY_MAX_GUESSES 32
+
+/**
+ * \def DIFFICULTY_MAX_CELLS
+ * \brief Largest board analyzed, every worker holding a board, a solver and a probability engine of its size.
+ */
+#define DIFFICULTY_MAX_CELLS 10000000
+
+/**
+ * \typedef DifficultyReport
+ * \brief Results of the games played on one board size.
+ */
+typedef struct DifficultyReport {
+    int rows; /**< Number of rows of the boards. */
+    int cols; /**< Number of columns of the boards. */
+    int mines; /**< Number of mines of the boards. */
+    long long games; /**< Number of games played. */
+    long long wins; /**< Number of games won. */
+    long long guess_games[DIFFICULTY_MAX_GUESSES + 1]; /**< Number of games that needed g forced guesses, the last entry counting the games with more. */
+    long long guess_wins[DIFFICULTY_MAX_GUESSES + 1]; /**< Number of those games that were won. */
+    long long guess_total; /**< Sum of the forced guesses of every game. */
+    Histogram bv; /**< 3BV of every board, exact below HISTOGRAM_SUB_BUCKETS and within 1 / HISTOGRAM_SUB_BUCKETS above. */
+    long long openings_total; /**< Sum of the openings of every board. */
+    long long islands_total; /**< Sum of the islands of every board. */
+    double seconds; /**< Time the games took, in seconds. */
+} DifficultyReport;
+
+bool analyze_difficulty(int rows, int cols, int mines, long long games, uint64_t seed, ThreadPool* threads, DifficultyReport* report);
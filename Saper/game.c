@@ -3,9 +3,9 @@
  * \brief  Functions for initializing, managing, and cleaning up the game.
  *********************************************************************/
 
-#include <stdlib.h>
-#include <time.h>
+#include <stdio.h>
 #include "game.h"
+#include "camera.h"
 
  /**
   * \brief Initializes the game with the provided Allegro resources.
@@ -28,119 +28,481 @@ void initialize_game_state(Game* game, ALLEGRO_DISPLAY* display, ALLEGRO_EVENT_Q
     game->big_font = big_font;
     game->flag_image = flag_image;
     game->bomb_image = bomb_image;
-    game->game_over = false;
-    game->game_won = false;
+    game->sprite_atlas = NULL;
+    game->board_bitmap = NULL;
+    game->report_latency = false;
+    latency_stats_init(&game->latency);
+    game->board.cells = NULL;
+    game->board.opened = NULL;
+    game->world.table = NULL;
+    game->world.opened = NULL;
+    game->infinite = false;
+    game->fixed_seed = false;
+    game->fixed_seed_value = 0;
+    game->no_guess = false;
+    game->topology = TOPOLOGY_CLASSIC;
+    game->workers.thread_count = 0;
+    game->workers.state = NULL;
+    no_guess_pool_init(0, NULL, &game->no_guess_pool);
+    board_cache_init(&game->board_cache);
+    game->last_difficulty = 0;
+    game->prepared_ready = NULL;
+    game->preparing = false;
+    game->prepare_batch.pending = 0;
+    game->prepare_cancel = 0;
+    game->board.game_over = false;
+    game->board.game_won = false;
+    game->replay.data = NULL;
+    game->replay.size = 0;
+    game->replay.capacity = 0;
+    game->replay.active = false;
+    game->replay_start = 0.0;
 }
 
 /**
- * \brief Initializes the game board based on the selected difficulty.
- * \param difficulty The difficulty level of the game (1 = easy, 2 = medium, 3 = hard).
+ * \brief Starts the workers and the pool keeping no-guess boards ready for the no-guess presets.
+ *
+ * With a fixed seed the pool stays empty, the boards are generated from that seed when the games start.
+ * \param seed Seed the boards of the pool are drawn from.
  * \param game Pointer to the Game structure.
  */
-void initialize_game(int difficulty, Game* game) {
-    switch (difficulty) {
-    case 1:
-        game->rows = 8;
-        game->cols = 8;
-        game->mines = 10;
-        break;
-    case 2:
-        game->rows = 12;
-        game->cols = 12;
-        game->mines = 20;
-        break;
-    case 3:
-        game->rows = 16;
-        game->cols = 16;
-        game->mines = 40;
-        break;
+void start_no_guess_pool(uint64_t seed, Game* game) {
+    if (!threadpool_create(0, &game->workers)) {
+        return;
     }
 
-    game->start_x = (SCREEN_WIDTH - (game->cols * CELL_SIZE)) / 2;
-    game->start_y = (SCREEN_HEIGHT - (game->rows * CELL_SIZE)) / 2;
+    no_guess_pool_init(seed, &game->workers, &game->no_guess_pool);
+    if (game->fixed_seed) {
+        return;
+    }
+    for (int difficulty = 1; difficulty <= NO_GUESS_DIFFICULTY_COUNT; difficulty++) { // Board size difficulty - 1 of the pool
+        int rows, cols, mines;
+        get_board_preset(difficulty, &rows, &cols, &mines);
+        no_guess_pool_add(rows, cols, mines, &game->no_guess_pool);
+    }
+}
 
-    // Dynamically allocating memory for game boards 
-    game->board = (int**)malloc(game->rows * sizeof(int*));
-    for (int i = 0; i < game->rows; i++) {
-        game->board[i] = (int*)calloc(game->cols, sizeof(int));
+/**
+ * \brief Ends the current board or world before a new game, the buffers of the board go to the board cache.
+ * \param game Pointer to the Game structure.
+ */
+static void release_board(Game* game) {
+    game->replay.active = false; // Written by finish_game_replay when the game ended, dropped otherwise
+    if (game->infinite) {
+        world_destroy(&game->world);
+        game->infinite = false;
     }
+    board_cache_release(&game->board, &game->board_cache);
+}
 
-    game->revealed = (bool**)malloc(game->rows * sizeof(bool*));
-    for (int i = 0; i < game->rows; i++) {
-        game->revealed[i] = (bool*)calloc(game->cols, sizeof(bool));
+/**
+ * \brief Places the viewport of a newly initialized board and resets the camera and the elapsed time.
+ *
+ * A board fitting in the window is centred as a whole. A larger one is shown through a viewport
+ * filling the window, panned and zoomed by the camera.
+ * \param game Pointer to the Game structure.
+ */
+static void layout_board(Game* game) {
+    int rows = game->board.rows;
+    int width = board_pixel_width(game); // Wider by half a cell for the shifted rows of a hexagonal board
+    if (width <= SCREEN_WIDTH - 2 * VIEW_MARGIN && rows * CELL_SIZE <= SCREEN_HEIGHT - VIEW_TOP - VIEW_BOTTOM) {
+        game->start_x = (SCREEN_WIDTH - width) / 2;
+        game->start_y = (SCREEN_HEIGHT - (rows * CELL_SIZE)) / 2;
+        game->view_width = width;
+        game->view_height = rows * CELL_SIZE;
     }
+    else {
+        game->start_x = VIEW_MARGIN;
+        game->start_y = VIEW_TOP;
+        game->view_width = SCREEN_WIDTH - 2 * VIEW_MARGIN;
+        game->view_height = SCREEN_HEIGHT - VIEW_TOP - VIEW_BOTTOM;
+    }
+    reset_camera(game);
+
+    game->elapsed_time = 0.0;
+}
+
+/**
+ * \brief Checks if a preset is played on no-guess boards, which the generator only builds for the classic topology.
+ * \param difficulty The preset.
+ * \param game Pointer to the Game structure.
+ * \return True if the preset is played on no-guess boards.
+ */
+static bool plays_no_guess(int difficulty, const Game* game) {
+    return game->no_guess && difficulty <= NO_GUESS_DIFFICULTY_COUNT && game->topology == TOPOLOGY_CLASSIC;
+}
+
+/**
+ * \brief Initializes a game of a no-guess preset on a board finished by deduction alone, with its first click opened.
+ *
+ * The board is taken from the pool, or generated on every worker when the pool ran dry or the seed is fixed:
+ * the board of a fixed seed must come from that seed, so that it can be played again.
+ * \param difficulty The preset, 1 to NO_GUESS_DIFFICULTY_COUNT.
+ * \param seed Seed the candidates are derived from, when the board is generated.
+ * \param game Pointer to the Game structure.
+ * \return False if no board could be taken nor generated.
+ */
+static bool initialize_no_guess_game(int difficulty, uint64_t seed, Game* game) {
+    int rows, cols, mines, start_row, start_col;
+    get_board_preset(difficulty, &rows, &cols, &mines);
+
+    Board board;
+    if (game->fixed_seed || !no_guess_pool_take(difficulty - 1, &start_row, &start_col, &board, &game->no_guess_pool)) {
+        ThreadPool* workers = game->workers.state ? &game->workers : NULL;
+        if (generate_no_guess_board(rows, cols, mines, seed, workers, NULL, &start_row, &start_col, &board) < 0) {
+            return false;
+        }
+    }
+
+    release_board(game);
+    game->board = board;
+    layout_board(game);
+
+    replay_begin(&game->board, &game->replay);
+    replay_record(0, REPLAY_REVEAL, start_row, start_col, &game->replay);
+    reveal_cell(start_row, start_col, &game->board);
+    return true;
+}
+
+/**
+ * \brief Prepares the next game, the job run by a worker.
+ * \param arg Pointer to the Game structure, only its prepared game and prepare_cancel are used.
+ */
+static void prepare_game_job(void* arg) {
+    Game* game = arg;
+    PreparedGame* prepared = &game->prepared;
+
+    int rows, cols, mines;
+    get_board_preset(prepared->difficulty, &rows, &cols, &mines);
+    if (prepared->no_guess) { // Generated on this worker alone, the job cannot wait for other jobs of its pool
+        prepared->ready = generate_no_guess_board(rows, cols, mines, prepared->seed, NULL, &game->prepare_cancel, &prepared->start_row, &prepared->start_col, &prepared->board) >= 0;
+    }
+    else {
+        prepared->ready = initialize_recycled_board(rows, cols, mines, prepared->seed, &prepared->board);
+        if (prepared->ready) {
+            set_board_topology((enum Topology)prepared->topology, &prepared->board); // A board too small for it stays classic
+        }
+    }
+
+    atomic_pointer_exchange(&game->prepared_ready, prepared); // Publishes the board to the main thread
+}
 
-    game->flagged = (bool**)malloc(game->rows * sizeof(bool*));
-    for (int i = 0; i < game->rows; i++) {
-        game->flagged[i] = (bool*)calloc(game->cols, sizeof(bool));
+/**
+ * \brief Starts preparing a game of the given preset on a worker, while the game over screen or the menus are shown.
+ *
+ * The seed of the game is drawn now. Nothing is done while another game is being prepared, without workers,
+ * or for the infinite mode, whose world is generated while it is explored.
+ * \param difficulty The preset of the next game, usually the one of the last game.
+ * \param game Pointer to the Game structure.
+ */
+void prepare_next_game(int difficulty, Game* game) {
+    int rows, cols, mines;
+    if (game->preparing || !game->workers.state || !get_board_preset(difficulty, &rows, &cols, &mines)) {
+        return;
     }
-    //
 
-    // Randomly placing mines on the board
-    int placed_mines = 0;
-    while (placed_mines < game->mines) {
-        int i = rand() % game->rows;
-        int j = rand() % game->cols;
-        if (game->board[i][j] != -1) {
-            game->board[i][j] = -1;
-            placed_mines++;
+    PreparedGame* prepared = &game->prepared;
+    prepared->difficulty = difficulty;
+    prepared->no_guess = plays_no_guess(difficulty, game);
+    prepared->topology = game->topology;
+    prepared->seed = game->fixed_seed ? game->fixed_seed_value : rng_next(&game->rng);
+    prepared->board.cells = NULL;
+    prepared->board.opened = NULL;
+    prepared->ready = false;
+    game->preparing = true;
+
+    if (prepared->no_guess) {
+        if (!game->fixed_seed && no_guess_pool_take(difficulty - 1, &prepared->start_row, &prepared->start_col, &prepared->board, &game->no_guess_pool)) {
+            prepared->ready = true;
+            atomic_pointer_exchange(&game->prepared_ready, prepared);
+            return;
         }
     }
-    //
-
-    // Setting up the number of mines surrounding each cell
-    for (int i = 0; i < game->rows; i++) {
-        for (int j = 0; j < game->cols; j++) {
-            if (game->board[i][j] == -1) {
-                continue;
-            }
-            if (i - 1 >= 0 && game->board[i - 1][j] == -1)
-                game->board[i][j]++;
-            if (i + 1 < game->rows && game->board[i + 1][j] == -1)
-                game->board[i][j]++;
-            if (i - 1 >= 0 && j - 1 >= 0 && game->board[i - 1][j - 1] == -1)
-                game->board[i][j]++;
-            if (i + 1 < game->rows && j - 1 >= 0 && game->board[i + 1][j - 1] == -1)
-                game->board[i][j]++;
-            if (i - 1 >= 0 && j + 1 < game->cols && game->board[i - 1][j + 1] == -1)
-                game->board[i][j]++;
-            if (i + 1 < game->rows && j + 1 < game->cols && game->board[i + 1][j + 1] == -1)
-                game->board[i][j]++;
-            if (j - 1 >= 0 && game->board[i][j - 1] == -1)
-                game->board[i][j]++;
-            if (j + 1 < game->cols && game->board[i][j + 1] == -1)
-                game->board[i][j]++;
+    else {
+        board_cache_take(rows, cols, &prepared->board, &game->board_cache);
+    }
+
+    atomic_int_store(&game->prepare_cancel, 0);
+    if (!threadpool_submit_batch(prepare_game_job, game, &game->prepare_batch, &game->workers)) {
+        board_cache_release(&prepared->board, &game->board_cache);
+        game->preparing = false;
+    }
+}
+
+/**
+ * \brief Takes the prepared game back from its worker, waiting for it if it is not done yet.
+ * \param cancel Stops the generation of a no-guess board instead of waiting for it to finish.
+ * \param game Pointer to the Game structure.
+ * \return The prepared game, or NULL if there is none.
+ */
+static PreparedGame* take_prepared_game(bool cancel, Game* game) {
+    if (!game->preparing) {
+        return NULL;
+    }
+
+    if (!atomic_pointer_exchange(&game->prepared_ready, NULL)) {
+        if (cancel) {
+            atomic_int_store(&game->prepare_cancel, 1);
         }
+        threadpool_wait_batch(&game->prepare_batch, &game->workers);
+        atomic_pointer_exchange(&game->prepared_ready, NULL);
+    }
+
+    game->preparing = false;
+    return &game->prepared;
+}
+
+/**
+ * \brief Starts the prepared game if it was prepared for the selected preset, otherwise gives its board back to the cache.
+ * \param difficulty The selected preset.
+ * \param game Pointer to the Game structure.
+ * \return True if the prepared game was started.
+ */
+static bool start_prepared_game(int difficulty, Game* game) {
+    bool wanted = game->preparing && game->prepared.difficulty == difficulty && game->prepared.no_guess == plays_no_guess(difficulty, game)
+        && game->prepared.topology == game->topology;
+
+    PreparedGame* prepared = take_prepared_game(!wanted, game); // A wanted board is as far along as a new one would be
+    if (!prepared) {
+        return false;
+    }
+    if (!wanted || !prepared->ready) {
+        board_cache_release(&prepared->board, &game->board_cache);
+        return false;
+    }
+
+    release_board(game);
+    game->board = prepared->board;
+    layout_board(game);
+
+    replay_begin(&game->board, &game->replay);
+    if (prepared->no_guess) {
+        replay_record(0, REPLAY_REVEAL, prepared->start_row, prepared->start_col, &game->replay);
+        reveal_cell(prepared->start_row, prepared->start_col, &game->board);
+    }
+    return true;
+}
+
+/**
+ * \brief Initializes the game board based on the selected difficulty, with the next seed of game->rng or the fixed seed.
+ * \param difficulty The difficulty level of the game (1 = easy, 2 = medium, 3 = hard, 4 to BOARD_PRESET_COUNT = large custom boards, INFINITE_DIFFICULTY = infinite mode).
+ * \param game Pointer to the Game structure.
+ * \return false if the board could not be allocated, there is no game to play then.
+ */
+bool initialize_game(int difficulty, Game* game) {
+    game->last_difficulty = difficulty;
+    if (start_prepared_game(difficulty, game)) {
+        return true;
+    }
+
+    int rows, cols, mines;
+    uint64_t seed = game->fixed_seed ? game->fixed_seed_value : rng_next(&game->rng);
+    if (difficulty == INFINITE_DIFFICULTY) {
+        initialize_infinite_game(seed, game);
+        return game->infinite;
+    }
+    if (!get_board_preset(difficulty, &rows, &cols, &mines)) {
+        return false;
+    }
+    if (plays_no_guess(difficulty, game) && initialize_no_guess_game(difficulty, seed, game)) {
+        return true;
     }
-    //
+    return initialize_custom_game(rows, cols, mines, seed, game);
+}
+
+/**
+ * \brief Initializes a game board of arbitrary size, in the topology of game->topology. Mines are placed later, by the first reveal.
+ * \param rows Number of rows in the game board.
+ * \param cols Number of columns in the game board.
+ * \param mines Number of mines to place, clamped so that at least one cell is safe.
+ * \param seed Seed of the mine placement.
+ * \param game Pointer to the Game structure.
+ * \return false if the board could not be allocated, it is left empty then.
+ */
+bool initialize_custom_game(int rows, int cols, int mines, uint64_t seed, Game* game) {
+    release_board(game);
+    board_cache_take(rows, cols, &game->board, &game->board_cache); // The buffers of the last board when it had the same size
+    if (!initialize_recycled_board(rows, cols, mines, seed, &game->board)) {
+        return false;
+    }
+    set_board_topology((enum Topology)game->topology, &game->board); // A board too small for it stays classic
+    layout_board(game);
+    replay_begin(&game->board, &game->replay);
+    return true;
+}
+
+/**
+ * \brief Initializes an infinite mode game, on a world whose chunks are generated while it is explored.
+ * \param seed Seed the mines of the world are derived from.
+ * \param game Pointer to the Game structure.
+ */
+void initialize_infinite_game(uint64_t seed, Game* game) {
+    game->replay.active = false;
+    if (game->infinite) {
+        world_destroy(&game->world);
+    }
+    game->infinite = world_create(seed, INFINITE_MINE_PERCENT, INFINITE_MAX_EXPANDED, &game->world);
+
+    game->start_x = VIEW_MARGIN;
+    game->start_y = VIEW_TOP;
+    game->view_width = SCREEN_WIDTH - 2 * VIEW_MARGIN;
+    game->view_height = SCREEN_HEIGHT - VIEW_TOP - VIEW_BOTTOM;
+    reset_camera(game);
 
     game->elapsed_time = 0.0;
 }
 
+/**
+ * \brief Saves the board being played and its elapsed time. The infinite mode cannot be saved.
+ * \param path Path of the save file.
+ * \param game Pointer to the Game structure.
+ * \return SAVE_OK, or why the game could not be saved.
+ */
+enum SaveStatus save_game(const char* path, Game* game) {
+    if (game->infinite || !game->board.cells) {
+        return SAVE_IO_ERROR;
+    }
+
+    long long cell_count = (long long)game->board.rows * game->board.cols;
+    enum SaveEncoding encoding = cell_count >= SAVE_MAPPED_MIN_CELLS ? SAVE_CELLS : SAVE_PLANES_RLE;
+    return save_board(path, game->elapsed_time, encoding, &game->board);
+}
+
+/**
+ * \brief Resumes a saved game, in place of the current board or world.
+ * \param path Path of the save file.
+ * \param game Pointer to the Game structure.
+ * \return SAVE_OK, or why the file was rejected, in which case the game is untouched.
+ */
+enum SaveStatus resume_game(const char* path, Game* game) {
+    Board board;
+    double elapsed_time;
+    enum SaveStatus status = load_board(path, &elapsed_time, &board);
+    if (status != SAVE_OK) {
+        return status;
+    }
+
+    release_board(game);
+    game->board = board;
+    layout_board(game);
+    game->elapsed_time = elapsed_time;
+    return SAVE_OK;
+}
+
+/**
+ * \brief Returns the packed cell at the specified coordinates, from the board or from the world in infinite mode.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param game Pointer to the Game structure.
+ * \return The packed cell, see the CELL_* bits.
+ */
+unsigned char get_game_cell(int row, int col, Game* game) {
+    return game->infinite ? world_cell(row, col, &game->world) : *cell_at(&game->board, row, col);
+}
+
+/**
+ * \brief Reveals a cell of the board or of the world in infinite mode.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param game Pointer to the Game structure.
+ * \return Number of cells opened.
+ */
+int reveal_game_cell(int row, int col, Game* game) {
+    return game->infinite ? world_reveal(row, col, &game->world) : reveal_cell(row, col, &game->board);
+}
+
+/**
+ * \brief Toggles a flag on a cell of the board or of the world in infinite mode.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param game Pointer to the Game structure.
+ */
+void toggle_game_flag(int row, int col, Game* game) {
+    if (game->infinite)
+        world_toggle_flag(row, col, &game->world);
+    else
+        toggle_flag(row, col, &game->board);
+}
+
+/**
+ * \brief Records an action of the player in the replay of the game, if it is recorded.
+ * \param timestamp Time of the input event, on the clock of game->replay_start.
+ * \param action The action.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param game Pointer to the Game structure.
+ */
+void record_game_action(double timestamp, enum ReplayAction action, int row, int col, Game* game) {
+    double time = (timestamp - game->replay_start) * 1000.0;
+    replay_record(time > 0.0 ? (uint32_t)(time + 0.5) : 0, action, row, col, &game->replay);
+}
+
+/**
+ * \brief Appends the replay of the game to REPLAY_FILE_NAME, with its result, and stops recording.
+ *
+ * Called when the game ends, and when the program exits during a game, which is then unfinished.
+ * \param game Pointer to the Game structure.
+ */
+void finish_game_replay(Game* game) {
+    if (!game->replay.active) {
+        return;
+    }
+
+    enum ReplayOutcome outcome = game->board.game_won ? REPLAY_WON : game->board.game_over ? REPLAY_LOST : REPLAY_UNFINISHED;
+    if (!replay_append(REPLAY_FILE_NAME, outcome, &game->replay) && game->replay.action_count > 0) {
+        fprintf(stderr, "Cannot write the replay to %s.\n", REPLAY_FILE_NAME);
+    }
+}
+
+/**
+ * \brief Tells whether a mine was revealed.
+ * \param game Pointer to the Game structure.
+ * \return True if the game is lost.
+ */
+bool is_game_lost(const Game* game) {
+    return game->infinite ? game->world.game_over : game->board.game_over;
+}
+
+/**
+ * \brief Tells whether the game is over, lost or won. The infinite mode can only be lost.
+ * \param game Pointer to the Game structure.
+ * \return True if the game is over.
+ */
+bool is_game_finished(const Game* game) {
+    return is_game_lost(game) || (!game->infinite && game->board.game_won);
+}
+
 /**
  * \brief Cleans up all resources used by the game.
  * \param game Pointer to the Game structure.
  */
 void cleanup_resources(Game* game) {
-    if (game->board) {
-        for (int i = 0; i < game->rows; i++) {
-            free(game->board[i]);
-        }
-        free(game->board);
+    finish_game_replay(game);
+    replay_free(&game->replay);
+    if (game->report_latency && !write_latency_csv(LATENCY_CSV_FILE, &game->latency)) {
+        fprintf(stderr, "Cannot write the latency histograms to %s.\n", LATENCY_CSV_FILE);
     }
 
-    if (game->revealed) {
-        for (int i = 0; i < game->rows; i++) {
-            free(game->revealed[i]);
-        }
-        free(game->revealed);
+    PreparedGame* prepared = take_prepared_game(true, game);
+    if (prepared) {
+        free_board(&prepared->board);
     }
+    no_guess_pool_destroy(&game->no_guess_pool); // Its jobs run on the workers
+    threadpool_destroy(&game->workers);
 
-    if (game->flagged) {
-        for (int i = 0; i < game->rows; i++) {
-            free(game->flagged[i]);
-        }
-        free(game->flagged);
+    free_board(&game->board);
+    board_cache_destroy(&game->board_cache);
+
+    if (game->infinite) {
+        world_destroy(&game->world);
+    }
+
+    if (game->board_bitmap) { // Destroyed before the display it was created for
+        al_destroy_bitmap(game->board_bitmap);
+    }
+
+    if (game->sprite_atlas) {
+        al_destroy_bitmap(game->sprite_atlas);
     }
 
     if (game->event_queue) {
@@ -174,5 +536,4 @@ void cleanup_resources(Game* game) {
     if (game->bomb_image) {
         al_destroy_bitmap(game->bomb_image);
     }
-
 }
@@ -8,25 +8,121 @@
 #include "allegro5/allegro.h"
 #include "allegro5/allegro_font.h"
 #include "allegro5/allegro_primitives.h"
+#include "atomics.h"
+#include "board.h"
+#include "boardcache.h"
+#include "latency.h"
+#include "noguess.h"
+#include "replay.h"
+#include "rng.h"
+#include "savestate.h"
+#include "threadpool.h"
+#include "world.h"
 #include "utils.h"
 
+/**
+ * \def INFINITE_DIFFICULTY
+ * \brief Difficulty value selecting the infinite mode.
+ */
+#define INFINITE_DIFFICULTY (BOARD_PRESET_COUNT + 1)
+
+/**
+ * \def INFINITE_MINE_PERCENT
+ * \brief Mine density of the infinite mode, close to the hard preset.
+ */
+#define INFINITE_MINE_PERCENT 16
+
+/**
+ * \def INFINITE_MAX_EXPANDED
+ * \brief Expanded chunks the infinite mode keeps, a few times what the viewport shows at the smallest zoom.
+ */
+#define INFINITE_MAX_EXPANDED 1024
+
+/**
+ * \def SAVE_FILE_NAME
+ * \brief File the game is saved to and resumed from.
+ */
+#define SAVE_FILE_NAME "saper.sav"
+
+/**
+ * \def SAVE_MAPPED_MIN_CELLS
+ * \brief Boards of at least this many cells are saved as raw cells, mapped as they are when resumed.
+ * Smaller ones are saved as run-length encoded bit planes, a few times smaller.
+ */
+#define SAVE_MAPPED_MIN_CELLS (1 << 20)
+
+/**
+ * \def REPLAY_FILE_NAME
+ * \brief File the replay of every game is appended to.
+ */
+#define REPLAY_FILE_NAME "saper.rpl"
+
+/**
+ * \def NO_GUESS_DIFFICULTY_COUNT
+ * \brief Number of presets, from the first, that can be played without guessing. Larger boards take too long to generate.
+ */
+#define NO_GUESS_DIFFICULTY_COUNT 3
+
+/**
+ * \enum CellSprite
+ * \brief Sprites of the sprite atlas, one for every look a cell can have.
+ */
+enum CellSprite {
+    SPRITE_HIDDEN, /**< Unrevealed cell. */
+    SPRITE_EMPTY, /**< Revealed cell without adjacent mines, SPRITE_EMPTY + n shows the number n. */
+    SPRITE_FLAG = SPRITE_EMPTY + 9, /**< Flagged cell. */
+    SPRITE_MINE, /**< Mine on a red background. */
+    SPRITE_COUNT /**< Number of sprites. */
+};
+
+/**
+ * \typedef PreparedGame
+ * \brief Board of the next game, prepared by a worker while the game over screen or the menus are shown.
+ */
+typedef struct PreparedGame {
+    int difficulty; /**< Preset the board was prepared for. */
+    bool no_guess; /**< Indicates if the board is a no-guess board, whose first click is opened when the game starts. */
+    int topology; /**< Topology the board was prepared for, a value of enum Topology. */
+    uint64_t seed; /**< Seed of the board. */
+    Board board; /**< The prepared board, holding buffers taken from the board cache while it is prepared. */
+    int start_row; /**< Row of the first click of a no-guess board. */
+    int start_col; /**< Column of the first click of a no-guess board. */
+    bool ready; /**< Indicates if the board could be prepared. */
+} PreparedGame;
+
  /**
  * \typedef Game
  * \brief Represents the state and resources of the game.
  */
 
 typedef struct Game {
-    int rows; /**< Number of rows in the game board. */
-    int cols; /**< Number of columns in the game board. */
-    int mines; /**< Number of mines in the game board. */
-    int** board; /**< 2D array representing the game board. -1 indicates a mine, other values indicate the number of adjacent mines. */
-    bool** revealed; /**< 2D array indicating if a cell is revealed. */
-    bool** flagged; /**< 2D array indicating if a cell is flagged. */
-    bool game_over; /**< Indicates if the game is over. */
-    bool game_won; /**< Indicates if the game is won. */
-    int start_x; /**< Starting x-coordinate for rendering the game board. */
-    int start_y; /**< Starting y-coordinate for rendering the game board. */
+    Board board; /**< The board being played, managed by the headless core. */
+    World world; /**< The unbounded board played in infinite mode. */
+    bool infinite; /**< Indicates if the game is played on world instead of board. */
+    Rng rng; /**< Generator drawing the seed of every new game. */
+    bool fixed_seed; /**< Indicates if every game uses fixed_seed_value instead of a seed drawn from rng, to play a shared board. */
+    uint64_t fixed_seed_value; /**< Seed of every game when fixed_seed is set. */
+    bool no_guess; /**< Plays the first NO_GUESS_DIFFICULTY_COUNT presets on boards finished by deduction alone, from an opened first click. */
+    int topology; /**< Topology of the next boards, a value of enum Topology. No-guess boards are only generated for the classic one. */
+    ThreadPool workers; /**< Workers generating the no-guess boards, its state is NULL if they could not be started. */
+    NoGuessPool no_guess_pool; /**< Ready no-guess boards, one board size per no-guess preset. */
+    BoardCache board_cache; /**< Buffers of finished boards, reused by the next boards of the same size. Only used by the main thread. */
+    int last_difficulty; /**< Preset of the last game, the one prepared in the background, 0 before the first game. */
+    PreparedGame prepared; /**< Next game, owned by the worker preparing it until it is published in prepared_ready. */
+    void* volatile prepared_ready; /**< Points to prepared once the worker is done, swapped back to NULL when the game is taken. */
+    bool preparing; /**< Indicates if prepared was handed to a worker and not taken back yet. */
+    ThreadBatch prepare_batch; /**< Job preparing the next game. */
+    AtomicInt prepare_cancel; /**< Set to stop the preparation of a no-guess board that is no longer needed. */
+    int start_x; /**< Starting x-coordinate for rendering the game board, the left edge of the viewport. */
+    int start_y; /**< Starting y-coordinate for rendering the game board, the top edge of the viewport. */
+    int view_width; /**< Width of the viewport showing the board, in screen pixels. */
+    int view_height; /**< Height of the viewport showing the board, in screen pixels. */
+    float camera_x; /**< Board x-coordinate, in unscaled pixels, shown at the left edge of the viewport. */
+    float camera_y; /**< Board y-coordinate, in unscaled pixels, shown at the top edge of the viewport. */
+    float zoom; /**< Scale of the board in the viewport, 1 draws cells at CELL_SIZE. */
     double elapsed_time; /**< Time elapsed since the game started. */
+    ReplayRecorder replay; /**< Actions of the current game, not recorded for resumed games and the infinite mode. */
+    double replay_start; /**< Timestamp of the start of the clock, replay times are counted from it. */
     ALLEGRO_DISPLAY* display; /**< Pointer to the Allegro display. */
     ALLEGRO_EVENT_QUEUE* event_queue; /**< Pointer to the Allegro event queue. */
     ALLEGRO_TIMER* timer; /**< Pointer to the Allegro timer. */
@@ -35,11 +131,27 @@ typedef struct Game {
     ALLEGRO_FONT* big_font; /**< Pointer to the big font used in the game. */
     ALLEGRO_BITMAP* flag_image; /**< Pointer to the flag image bitmap. */
     ALLEGRO_BITMAP* bomb_image; /**< Pointer to the bomb image bitmap. */
-    ALLEGRO_COLOR color; /**< Color used for drawing text and graphics. */
+    ALLEGRO_BITMAP* sprite_atlas; /**< Every look of a cell pre-rendered at CELL_SIZE, indexed by CellSprite. */
+    ALLEGRO_BITMAP* board_bitmap; /**< Offscreen bitmap caching the rendered board, only changed cells are redrawn on it. */
+    bool report_latency; /**< Prints the click-to-photon latency of every game on the standard output, and writes the histograms to LATENCY_CSV_FILE on exit. */
+    LatencyStats latency; /**< Timings of the stages from input to frame, toggled on screen with F3. */
 } Game;
 
 void initialize_game_state(Game* game, ALLEGRO_DISPLAY* display, ALLEGRO_EVENT_QUEUE* event_queue, ALLEGRO_TIMER* timer, ALLEGRO_FONT* small_font, ALLEGRO_FONT* medium_font, ALLEGRO_FONT* big_font, ALLEGRO_BITMAP* flag_image, ALLEGRO_BITMAP* bomb_image);
-void initialize_game(int difficulty, Game* game);
+void start_no_guess_pool(uint64_t seed, Game* game);
+void prepare_next_game(int difficulty, Game* game);
+bool initialize_game(int difficulty, Game* game);
+bool initialize_custom_game(int rows, int cols, int mines, uint64_t seed, Game* game);
+void initialize_infinite_game(uint64_t seed, Game* game);
+enum SaveStatus save_game(const char* path, Game* game);
+enum SaveStatus resume_game(const char* path, Game* game);
+unsigned char get_game_cell(int row, int col, Game* game);
+int reveal_game_cell(int row, int col, Game* game);
+void toggle_game_flag(int row, int col, Game* game);
+void record_game_action(double timestamp, enum ReplayAction action, int row, int col, Game* game);
+void finish_game_replay(Game* game);
+bool is_game_lost(const Game* game);
+bool is_game_finished(const Game* game);
 void cleanup_resources(Game* game);
 
 
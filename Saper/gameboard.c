@@ -1,113 +1,279 @@
 /*****************************************************************//**
- * \file   gameboard.h
- * \brief  Functions for rendering the game graphics and managing game state updates.
+ * \file   gameboard.c
+ * \brief  Functions for rendering the game board, the timer and the mines counter.
  *********************************************************************/
 
+#include <stdio.h>
 #include "gameboard.h"
+#include "camera.h"
 
- /**
-  * \brief Draws the game board and updates the display.
-  * \param game Pointer to the Game structure.
-  */
-void draw_board(Game* game) {
-    al_clear_to_color(al_map_rgb(255, 255, 255));
-
-    for (int i = 0; i < game->rows; i++) {
-        for (int j = 0; j < game->cols; j++) {
-            int x = game->start_x + j * CELL_SIZE;
-            int y = game->start_y + i * CELL_SIZE;
-
-            al_draw_rectangle(x, y, x + CELL_SIZE, y + CELL_SIZE, al_map_rgb(0, 0, 0), 2);
-
-            if (game->revealed[i][j]) {
-                if (game->board[i][j] == -1) { // Revealing a cell with mine
-                    al_draw_filled_rectangle(x + 1, y + 1, x + CELL_SIZE - 1, y + CELL_SIZE - 1, al_map_rgb(255, 0, 0));
-                    al_draw_scaled_bitmap(game->bomb_image, 0, 0, al_get_bitmap_width(game->bomb_image), al_get_bitmap_height(game->bomb_image), x + 1, y + 1, CELL_SIZE - 2, CELL_SIZE - 2, 0);
-                }
-                else {
-                    al_draw_filled_rectangle(x + 1, y + 1, x + CELL_SIZE - 1, y + CELL_SIZE - 1, al_map_rgb(192, 192, 192));
-                    if (game->board[i][j] > 0) {
-                        switch (game->board[i][j]) { // Choosing a color based on how many mines are adjacent to the cell
-                        case 1: game->color = al_map_rgb(0, 0, 255); break;
-                        case 2: game->color = al_map_rgb(0, 128, 0); break;
-                        case 3: game->color = al_map_rgb(255, 0, 0); break;
-                        case 4: game->color = al_map_rgb(0, 0, 128); break;
-                        case 5: game->color = al_map_rgb(128, 0, 0); break;
-                        case 6: game->color = al_map_rgb(0, 128, 128); break;
-                        case 7: game->color = al_map_rgb(0, 0, 0); break;
-                        case 8: game->color = al_map_rgb(128, 128, 128); break;
-                        default: game->color = al_map_rgb(0, 0, 0); break;
-                        }
-                        al_draw_textf(game->small_font, game->color, x + CELL_SIZE / 2, y + CELL_SIZE / 2 - al_get_font_ascent(game->small_font) / 2, ALLEGRO_ALIGN_CENTER, "%d", game->board[i][j]);
-                    }
-                }
-            }
-            else if (game->flagged[i][j]) { // Flagging a cell
-                al_draw_scaled_bitmap(game->flag_image, 0, 0, al_get_bitmap_width(game->flag_image), al_get_bitmap_height(game->flag_image), x + 1, y + 1, CELL_SIZE - 2, CELL_SIZE - 2, 0);
-            }
-        }
-    }
-    update_timer(game);
-    al_flip_display();
+/**
+ * \brief Returns the x-coordinate of a sprite in the sprite atlas.
+ *
+ * Sprites are CELL_SIZE + 2 pixels wide, outline included, and separated by 2 pixels so that filtering
+ * never bleeds a neighbour in when the board is scaled.
+ * \param sprite The sprite index.
+ * \return The x-coordinate of the sprite's top left corner.
+ */
+static int sprite_x(int sprite) {
+    return sprite * (CELL_SIZE + 4) + 1;
 }
 
 /**
- * \brief Reveals the cell at the specified coordinates.
- * \param i The row index of the cell.
- * \param j The column index of the cell.
+ * \brief Builds the sprite atlas: every look a cell can have, pre-rendered at CELL_SIZE.
+ *
+ * Must be called once the display and the fonts and images are loaded.
  * \param game Pointer to the Game structure.
+ * \return True on success, false if the atlas bitmap could not be created.
  */
-void reveal_cell(int i, int j, Game* game) {
-    if (i < 0 || i >= game->rows || j < 0 || j >= game->cols || game->revealed[i][j] || game->flagged[i][j]) {
-        return;
+bool create_sprite_atlas(Game* game) {
+    // Colors of the numbers of adjacent mines, from 1 to 8
+    static const unsigned char digit_colors[8][3] = {
+        { 0, 0, 255 }, { 0, 128, 0 }, { 255, 0, 0 }, { 0, 0, 128 },
+        { 128, 0, 0 }, { 0, 128, 128 }, { 0, 0, 0 }, { 128, 128, 128 }
+    };
+
+    // Linear filtering keeps the numbers readable when the camera zooms
+    int flags = al_get_new_bitmap_flags();
+    al_set_new_bitmap_flags(flags | ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR);
+    game->sprite_atlas = al_create_bitmap(sprite_x(SPRITE_COUNT), CELL_SIZE + 4);
+    al_set_new_bitmap_flags(flags);
+    if (!game->sprite_atlas) {
+        return false;
     }
 
-    game->revealed[i][j] = true;
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    al_set_target_bitmap(game->sprite_atlas);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
 
-    if (game->board[i][j] == 0) { // Reveal all empty adjacent cells
-        for (int x = -1; x <= 1; x++) {
-            for (int y = -1; y <= 1; y++) {
-                if (x == 0 && y == 0)
-                    continue;
-                reveal_cell(i + x, j + y, game);
-            }
+    for (int sprite = 0; sprite < SPRITE_COUNT; sprite++) {
+        float x = sprite_x(sprite);
+        float y = 1;
+
+        ALLEGRO_COLOR fill = al_map_rgb(255, 255, 255);
+        if (sprite == SPRITE_MINE)
+            fill = al_map_rgb(255, 0, 0);
+        else if (sprite >= SPRITE_EMPTY && sprite <= SPRITE_EMPTY + 8)
+            fill = al_map_rgb(192, 192, 192);
+
+        // The 2 pixel outline, shared with the neighbouring cells
+        al_draw_filled_rectangle(x, y, x + CELL_SIZE + 2, y + CELL_SIZE + 2, al_map_rgb(0, 0, 0));
+        al_draw_filled_rectangle(x + 2, y + 2, x + CELL_SIZE, y + CELL_SIZE, fill);
+
+        if (sprite > SPRITE_EMPTY && sprite <= SPRITE_EMPTY + 8) {
+            int count = sprite - SPRITE_EMPTY;
+            const unsigned char* rgb = digit_colors[count - 1];
+            char digit[2] = { (char)('0' + count), '\0' };
+            al_draw_text(game->small_font, al_map_rgb(rgb[0], rgb[1], rgb[2]), x + 1 + CELL_SIZE / 2, y + 1 + CELL_SIZE / 2 - al_get_font_ascent(game->small_font) / 2, ALLEGRO_ALIGN_CENTER, digit);
+        }
+        else if (sprite == SPRITE_FLAG || sprite == SPRITE_MINE) {
+            ALLEGRO_BITMAP* image = sprite == SPRITE_FLAG ? game->flag_image : game->bomb_image;
+            al_draw_scaled_bitmap(image, 0, 0, al_get_bitmap_width(image), al_get_bitmap_height(image), x + 2, y + 2, CELL_SIZE - 2, CELL_SIZE - 2, 0);
         }
     }
 
-    if (game->board[i][j] == -1) { // Game over condition
-        game->game_over = true;
+    al_set_target_bitmap(target);
+    return true;
+}
+
+/**
+ * \brief Chooses the sprite showing a cell.
+ * \param cell The packed cell, see the CELL_* bits.
+ * \param show_mines Shows the mines of unrevealed cells too, as on the game over screen.
+ * \return The sprite index.
+ */
+static int cell_sprite(unsigned char cell, bool show_mines) {
+    if (cell & CELL_REVEALED) {
+        return (cell & CELL_MINE) ? SPRITE_MINE : SPRITE_EMPTY + (cell & CELL_COUNT_MASK);
     }
+    else if (show_mines && (cell & CELL_MINE)) { // Drawing all the other bombs after the game
+        return SPRITE_MINE;
+    }
+    else if (cell & CELL_FLAGGED) {
+        return SPRITE_FLAG;
+    }
+    return SPRITE_HIDDEN;
 }
 
 /**
- * \brief Toggles the flag state of the cell at the specified coordinates.
+ * \brief Draws one cell of the board on the current target bitmap, as a region of the sprite atlas.
+ *
+ * Callers hold bitmap drawing, so a whole board ends up in a handful of draw calls.
+ * \param game Pointer to the Game structure.
  * \param row The row index of the cell.
  * \param col The column index of the cell.
+ * \param x The x-coordinate of the top left corner of the cell.
+ * \param y The y-coordinate of the top left corner of the cell.
+ * \param show_mines Draws the mines of unrevealed cells too, as on the game over screen.
+ */
+static void draw_cell(Game* game, int row, int col, int x, int y, bool show_mines) {
+    int sprite = cell_sprite(get_game_cell(row, col, game), show_mines);
+    al_draw_bitmap_region(game->sprite_atlas, sprite_x(sprite), 1, CELL_SIZE + 2, CELL_SIZE + 2, x - 1, y - 1, 0);
+}
+
+/**
+ * \brief Draws a rectangular range of cells on the current target bitmap.
  * \param game Pointer to the Game structure.
+ * \param first_row The first row to draw.
+ * \param first_col The first column to draw.
+ * \param last_row The last row to draw.
+ * \param last_col The last column to draw.
+ * \param x The x-coordinate of the top left corner of the board.
+ * \param y The y-coordinate of the top left corner of the board.
+ * \param show_mines Draws the mines of unrevealed cells too.
  */
-void toggle_flag(int row, int col, Game* game) {
-    if (!game->revealed[row][col]) {
-        game->flagged[row][col] = !game->flagged[row][col];
+static void draw_cells(Game* game, int first_row, int first_col, int last_row, int last_col, int x, int y, bool show_mines) {
+    al_hold_bitmap_drawing(true);
+    for (int i = first_row; i <= last_row; i++) {
+        int row_x = x + row_shift(i, game);
+        for (int j = first_col; j <= last_col; j++) {
+            draw_cell(game, i, j, row_x + j * CELL_SIZE, y + i * CELL_SIZE, show_mines);
+        }
     }
+    al_hold_bitmap_drawing(false);
 }
 
 /**
- * \brief Checks if the game is won.
+ * \brief Draws every cell of the board directly on the current target bitmap, without the cached board bitmap.
+ *
+ * This is what every frame used to cost, it is kept to fill the cache and to compare frame times.
  * \param game Pointer to the Game structure.
+ * \param x The x-coordinate of the top left corner of the board.
+ * \param y The y-coordinate of the top left corner of the board.
+ * \param show_mines Draws the mines of unrevealed cells too.
  */
-void check_game_won(Game* game) {
-    int revealed_count = 0;
-    for (int i = 0; i < game->rows; i++) {
-        for (int j = 0; j < game->cols; j++) {
-            if (game->revealed[i][j]) {
-                revealed_count++;
+void draw_all_cells(Game* game, int x, int y, bool show_mines) {
+    draw_cells(game, 0, 0, game->board.rows - 1, game->board.cols - 1, x, y, show_mines);
+}
+
+/**
+ * \brief Creates the offscreen bitmap caching the rendered board and draws every cell on it.
+ *
+ * Only boards fitting in the window are cached, larger ones get no bitmap.
+ * Cell outlines are 2 pixels wide and stick out of the board by 1 pixel, so the bitmap has a 1 pixel margin.
+ * \param game Pointer to the Game structure.
+ */
+void create_board_bitmap(Game* game) {
+    if (game->board_bitmap) {
+        al_destroy_bitmap(game->board_bitmap);
+        game->board_bitmap = NULL;
+    }
+
+    // Boards larger than the window are drawn through the camera, only their visible cells every frame
+    if (game->infinite || game->view_width != board_pixel_width(game) || game->view_height != game->board.rows * CELL_SIZE) {
+        return;
+    }
+
+    game->board_bitmap = al_create_bitmap(board_pixel_width(game) + 2, game->board.rows * CELL_SIZE + 2);
+    if (!game->board_bitmap) {
+        return;
+    }
+
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    al_set_target_bitmap(game->board_bitmap);
+    al_clear_to_color(al_map_rgb(255, 255, 255));
+    draw_all_cells(game, 1, 1, false);
+    al_set_target_bitmap(target);
+}
+
+/**
+ * \brief Redraws some cells on the cached board bitmap, typically the ones listed in board.opened by the last reveal.
+ * \param game Pointer to the Game structure.
+ * \param indices Indices of the cells to redraw.
+ * \param count Number of indices.
+ * \param show_mines Draws the mines of unrevealed cells too.
+ */
+void update_board_cells(Game* game, const int* indices, int count, bool show_mines) {
+    if (!game->board_bitmap || count == 0) {
+        return;
+    }
+
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    al_set_target_bitmap(game->board_bitmap);
+    al_hold_bitmap_drawing(true);
+    for (int k = 0; k < count; k++) {
+        int row = indices[k] / game->board.cols;
+        int col = indices[k] % game->board.cols;
+        draw_cell(game, row, col, 1 + row_shift(row, game) + col * CELL_SIZE, 1 + row * CELL_SIZE, show_mines);
+    }
+    al_hold_bitmap_drawing(false);
+    al_set_target_bitmap(target);
+}
+
+/**
+ * \brief Draws the mines of all unrevealed cells on the cached board bitmap, for the game over screen.
+ * \param game Pointer to the Game structure.
+ */
+void show_all_mines(Game* game) {
+    if (!game->board_bitmap) {
+        return;
+    }
+
+    ALLEGRO_BITMAP* target = al_get_target_bitmap();
+    al_set_target_bitmap(game->board_bitmap);
+    al_hold_bitmap_drawing(true);
+    for (int i = 0; i < game->board.rows; i++) {
+        for (int j = 0; j < game->board.cols; j++) {
+            if (!cell_is_revealed(&game->board, i, j) && cell_is_mine(&game->board, i, j)) {
+                draw_cell(game, i, j, 1 + row_shift(i, game) + j * CELL_SIZE, 1 + i * CELL_SIZE, true);
             }
         }
     }
+    al_hold_bitmap_drawing(false);
+    al_set_target_bitmap(target);
+}
+
+/**
+ * \brief Draws the board in its viewport through the camera.
+ *
+ * The cached board bitmap is blitted when there is one. Otherwise only the cells intersecting
+ * the viewport are drawn, so the cost of a frame does not depend on the size of the board.
+ * \param game Pointer to the Game structure.
+ * \param show_mines Draws the mines of unrevealed cells too when there is no cached bitmap.
+ */
+void draw_board_cells(Game* game, bool show_mines) {
+    ALLEGRO_TRANSFORM previous;
+    al_copy_transform(&previous, al_get_current_transform());
+
+    ALLEGRO_TRANSFORM transform;
+    al_identity_transform(&transform);
+    al_translate_transform(&transform, -game->camera_x, -game->camera_y);
+    al_scale_transform(&transform, game->zoom, game->zoom);
+    al_translate_transform(&transform, game->start_x, game->start_y);
+    al_use_transform(&transform);
 
-    if (revealed_count == game->rows * game->cols - game->mines) { // Win condition
-        game->game_won = true;
+    // Outlines of the border cells stick out of the viewport by 1 pixel
+    int clip_x, clip_y, clip_width, clip_height;
+    al_get_clipping_rectangle(&clip_x, &clip_y, &clip_width, &clip_height);
+    al_set_clipping_rectangle(game->start_x - 1, game->start_y - 1, game->view_width + 2, game->view_height + 2);
+
+    if (game->board_bitmap) {
+        al_draw_bitmap(game->board_bitmap, -1, -1, 0);
+    }
+    else {
+        int first_row, first_col, last_row, last_col;
+        visible_cells(&first_row, &first_col, &last_row, &last_col, game);
+        draw_cells(game, first_row, first_col, last_row, last_col, 0, 0, show_mines);
     }
+
+    al_set_clipping_rectangle(clip_x, clip_y, clip_width, clip_height);
+    al_use_transform(&previous);
+}
+
+/**
+ * \brief Draws the game board and updates the display.
+ *
+ * The cells come from the cached board bitmap, so a frame is a single blit plus the timer, the counter and the latency overlay when it is shown.
+ * \param game Pointer to the Game structure.
+ */
+void draw_board(Game* game) {
+    al_clear_to_color(al_map_rgb(255, 255, 255));
+    draw_board_cells(game, false);
+    update_timer(game);
+    draw_mines_counter(game);
+    if (game->latency.overlay)
+        draw_latency_overlay(&game->latency, game->small_font);
+    al_flip_display();
 }
 
 /**
@@ -115,10 +281,23 @@ void check_game_won(Game* game) {
  * \param game Pointer to the Game structure.
  */
 void update_timer(Game* game) {
-    if (!game->game_over && !game->game_won) {
+    if (!is_game_finished(game)) {
         game->elapsed_time = al_get_timer_count(game->timer) / 60.0;
     }
     char buffer[50];
-    sprintf_s(buffer, sizeof(buffer), "%.2f", game->elapsed_time);
+    snprintf(buffer, sizeof(buffer), "%.2f", game->elapsed_time);
     al_draw_text(game->small_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, game->start_y - 50, ALLEGRO_ALIGN_CENTER, buffer);
 }
+
+/**
+ * \brief Draws the number of mines left to flag.
+ * \param game Pointer to the Game structure.
+ */
+void draw_mines_counter(Game* game) {
+    char buffer[50];
+    if (game->infinite) // There is no mine count to show, only how far the player got
+        snprintf(buffer, sizeof(buffer), "Cleared: %lld", game->world.revealed_count);
+    else
+        snprintf(buffer, sizeof(buffer), "Mines: %d", mines_remaining(&game->board));
+    al_draw_text(game->small_font, al_map_rgb(0, 0, 0), game->start_x, game->start_y - 50, ALLEGRO_ALIGN_LEFT, buffer);
+}
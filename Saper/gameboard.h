@@ -1,15 +1,19 @@
 /*****************************************************************//**
  * \file   gameboard.h
- * \brief  Functions for rendering the game graphics and managing game state updates.
+ * \brief  Functions for rendering the game board, the timer and the mines counter.
  *********************************************************************/
 
 #pragma once
 
 #include "game.h"
 
+bool create_sprite_atlas(Game* game);
+void draw_all_cells(Game* game, int x, int y, bool show_mines);
+void create_board_bitmap(Game* game);
+void update_board_cells(Game* game, const int* indices, int count, bool show_mines);
+void show_all_mines(Game* game);
+void draw_board_cells(Game* game, bool show_mines);
 void draw_board(Game* game);
-void reveal_cell(int i, int j, Game* game);
-void toggle_flag(int row, int col, Game* game);
-void check_game_won(Game* game);
 void update_timer(Game* game);
+void draw_mines_counter(Game* game);
 
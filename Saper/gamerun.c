@@ -0,0 +1,141 @@
+/*****************************************************************//**
+ * \file   gamerun.c
+ * \brief  Chunk seeding and the workers of a run of games.
+ *********************************************************************/
+
+#include <stdint.h>
+#include <time.h>
+#include "allocator.h"
+#include "atomics.h"
+#include "gamerun.h"
+#include "rng.h"
+
+/**
+ * \typedef GameChunks
+ * \brief Chunks shared by the workers of one run.
+ */
+typedef struct GameChunks {
+    const GameRun* run; /**< The games and their callbacks. */
+    int chunk_count; /**< Number of chunks the games are split in. */
+    Rng* chunk_rngs; /**< Generator of the board seeds of each chunk. */
+    AtomicInt next_chunk; /**< Next chunk to claim. */
+} GameChunks;
+
+/**
+ * \typedef GameWorker
+ * \brief One worker of a run.
+ */
+typedef struct GameWorker {
+    GameChunks* chunks; /**< The shared chunks. */
+    void* state; /**< State of the worker, worker_size bytes given to the callbacks. */
+    bool failed; /**< Indicates if a game stopped the worker. */
+} GameWorker;
+
+/**
+ * \brief Returns the time elapsed since an arbitrary origin, in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * \brief Plays chunks of games until none is left, the job run by a worker.
+ * \param arg Pointer to the GameWorker structure.
+ */
+static void play_chunks(void* arg) {
+    GameWorker* worker = arg;
+    GameChunks* chunks = worker->chunks;
+    const GameRun* run = chunks->run;
+
+    int chunk;
+    while (!worker->failed && (chunk = atomic_int_add(&chunks->next_chunk, 1)) < chunks->chunk_count) {
+        long long first = run->games * chunk / chunks->chunk_count;
+        long long last = run->games * (chunk + 1) / chunks->chunk_count;
+        Rng rng = chunks->chunk_rngs[chunk];
+        for (long long g = first; g < last && !worker->failed; g++) {
+            worker->failed = !run->play(rng_next(&rng), g, run->context, worker->state);
+        }
+    }
+}
+
+/**
+ * \brief Plays the games of a run on every worker of a pool, then merges the workers into the context.
+ * \param run Pointer to the GameRun structure.
+ * \param threads Workers playing the games, NULL to play them on the calling thread, which must not be one of them.
+ * \param seconds Receives the time the games took, in seconds.
+ * \return false if the memory could not be allocated or a game stopped the run, nothing is merged then.
+ */
+bool run_games(const GameRun* run, ThreadPool* threads, double* seconds) {
+    *seconds = 0.0;
+
+    // Generators of the chunks, each 2^128 steps after the previous one
+    GameChunks chunks;
+    chunks.run = run;
+    chunks.chunk_count = run->games < GAME_RUN_MAX_CHUNKS ? (int)run->games : GAME_RUN_MAX_CHUNKS;
+    chunks.next_chunk = 0;
+    chunks.chunk_rngs = core_malloc((size_t)chunks.chunk_count * sizeof(Rng));
+    if (!chunks.chunk_rngs) {
+        return false;
+    }
+    Rng rng;
+    rng_seed(run->seed, &rng);
+    for (int c = 0; c < chunks.chunk_count; c++) {
+        chunks.chunk_rngs[c] = rng;
+        rng_jump(&rng);
+    }
+    //
+
+    // One worker per thread, each playing whole chunks, their states on separate cache lines: the block is
+    // over-allocated by a line so that the first state starts on a line boundary
+    int worker_count = threads ? threads->thread_count : 1;
+    size_t state_size = (run->worker_size + 63) / 64 * 64;
+    GameWorker* workers = core_calloc((size_t)worker_count, sizeof(GameWorker));
+    unsigned char* state_block = core_calloc((size_t)worker_count * state_size + 63, 1);
+    unsigned char* states = (unsigned char*)(((uintptr_t)state_block + 63) & ~(uintptr_t)63);
+    bool created = workers && state_block;
+    if (!created) {
+        worker_count = 0;
+    }
+    for (int w = 0; created && w < worker_count; w++) {
+        workers[w].chunks = &chunks;
+        workers[w].state = states + w * state_size;
+        created = run->create(run->context, workers[w].state);
+        if (!created) {
+            worker_count = w + 1; // The failed worker is destroyed too, destroy frees what its create got before failing
+        }
+    }
+
+    double begin = now_seconds();
+    if (created) {
+        ThreadBatch batch = { 0 };
+        for (int w = 0; w < worker_count; w++) {
+            if (!threads || !threadpool_submit_batch(play_chunks, &workers[w], &batch, threads)) {
+                play_chunks(&workers[w]);
+            }
+        }
+        if (threads) {
+            threadpool_wait_batch(&batch, threads);
+        }
+    }
+    *seconds = now_seconds() - begin;
+    //
+
+    // Counters of every worker merged, none if a game stopped the run
+    for (int w = 0; created && w < worker_count; w++) {
+        created = !workers[w].failed;
+    }
+    for (int w = 0; created && w < worker_count; w++) {
+        run->merge(run->context, workers[w].state);
+    }
+    //
+
+    for (int w = 0; w < worker_count; w++) {
+        run->destroy(run->context, workers[w].state);
+    }
+    core_free(workers);
+    core_free(state_block);
+    core_free(chunks.chunk_rngs);
+    return created;
+}
@@ -0,0 +1,41 @@
+/*****************************************************************//**
+ * \file   gamerun.h
+ * \brief  Many games of one board size played side by side on a thread pool, with results independent of it.
+ *
+ * The games are split in chunks, each with a generator of its own taken from one seed with rng_jump. Workers
+ * claim chunks one at a time and keep their own counters, merged at the end, so the only shared write is the
+ * chunk claim and game g always gets the same board seed, whatever the number of workers.
+ *
+ * What a worker holds and how a game is played are left to callbacks, so the difficulty analysis and the bot
+ * runs share the chunking, the seeding and the fan-out to the workers.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threadpool.h"
+
+/**
+ * \def GAME_RUN_MAX_CHUNKS
+ * \brief Number of chunks the games are split in, when there are at least as many games.
+ */
+#define GAME_RUN_MAX_CHUNKS 4096
+
+/**
+ * \typedef GameRun
+ * \brief Games to play and the callbacks playing them. Every callback gets the context, then the state of one worker.
+ */
+typedef struct GameRun {
+    long long games; /**< Number of games to play. */
+    uint64_t seed; /**< Seed the board seeds are drawn from. */
+    size_t worker_size; /**< Size of the state of a worker, zeroed before it is created. */
+    void* context; /**< Data shared by the callbacks, read-only while the games are played. */
+    bool (*create)(void* context, void* worker); /**< Sets up a worker, false if the memory could not be allocated. */
+    bool (*play)(uint64_t seed, long long number, void* context, void* worker); /**< Plays game number on the board of seed, false to stop the run. */
+    void (*merge)(void* context, const void* worker); /**< Adds the counters of a worker to the context, once every game was played. */
+    void (*destroy)(void* context, void* worker); /**< Frees a worker, also called on the one whose creation failed. */
+} GameRun;
+
+bool run_games(const GameRun* run, ThreadPool* threads, double* seconds);
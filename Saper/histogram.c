@@ -0,0 +1,152 @@
+/*****************************************************************//**
+ * \file   histogram.c
+ * \brief  Recording values in log-linear buckets and reading percentiles back.
+ *********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "histogram.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * \brief Returns the index of the highest set bit of a non-zero value.
+ */
+static inline int highest_bit(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (int)index;
+#elif defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int index = 0;
+    while (value >>= 1)
+        index++;
+    return index;
+#endif
+}
+
+/**
+ * \brief Returns the bucket of a value.
+ *
+ * Values below HISTOGRAM_SUB_BUCKETS have a bucket each. Above, the highest set bit picks a group of
+ * HISTOGRAM_SUB_BUCKETS buckets and the HISTOGRAM_SUB_BUCKET_BITS bits below it pick the bucket in the group.
+ */
+static int bucket_of(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return (int)value;
+    }
+
+    int bit = highest_bit(value);
+    if (bit >= HISTOGRAM_MAX_BITS) {
+        return HISTOGRAM_BUCKET_COUNT - 1;
+    }
+    int shift = bit - HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)(value >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+/**
+ * \brief Empties a histogram.
+ * \param histogram Pointer to the Histogram structure.
+ */
+void histogram_reset(Histogram* histogram) {
+    memset(histogram->counts, 0, sizeof(histogram->counts));
+    histogram->count = 0;
+    histogram->total = 0;
+    histogram->min = UINT64_MAX;
+    histogram->max = 0;
+}
+
+/**
+ * \brief Records a value.
+ * \param value The value, usually a duration in nanoseconds.
+ * \param histogram Pointer to the Histogram structure.
+ */
+void histogram_record(uint64_t value, Histogram* histogram) {
+    histogram->counts[bucket_of(value)]++;
+    histogram->count++;
+    histogram->total += value;
+    if (value < histogram->min)
+        histogram->min = value;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+/**
+ * \brief Adds the values recorded by a histogram to another one, as if they had been recorded there.
+ * \param source Pointer to the Histogram structure whose values are added.
+ * \param histogram Pointer to the Histogram structure receiving them.
+ */
+void histogram_merge(const Histogram* source, Histogram* histogram) {
+    for (int b = 0; b < HISTOGRAM_BUCKET_COUNT; b++) {
+        histogram->counts[b] += source->counts[b];
+    }
+    histogram->count += source->count;
+    histogram->total += source->total;
+    if (source->min < histogram->min)
+        histogram->min = source->min;
+    if (source->max > histogram->max)
+        histogram->max = source->max;
+}
+
+/**
+ * \brief Returns the value below which a percentage of the recorded values are.
+ *
+ * The result is the highest value of the bucket holding the percentile, capped by the largest value recorded,
+ * so it is never below the exact percentile and at most 1 / HISTOGRAM_SUB_BUCKETS above it.
+ * \param percentile The percentage, 50 for the median, 100 for the maximum.
+ * \param histogram Pointer to the Histogram structure.
+ * \return The value, 0 if nothing was recorded.
+ */
+uint64_t histogram_percentile(double percentile, const Histogram* histogram) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    double rank = ceil(percentile / 100.0 * (double)histogram->count); // Number of values at or below the percentile
+    uint64_t wanted = rank < 1.0 ? 1 : (uint64_t)rank;
+    if (wanted >= histogram->count) {
+        return histogram->max;
+    }
+
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKET_COUNT; bucket++) {
+        seen += histogram->counts[bucket];
+        if (seen >= wanted) {
+            uint64_t low, high;
+            histogram_bucket_range(bucket, &low, &high);
+            return high < histogram->max ? high : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ * \brief Returns the exact mean of the recorded values.
+ * \param histogram Pointer to the Histogram structure.
+ * \return The mean, 0 if nothing was recorded.
+ */
+double histogram_mean(const Histogram* histogram) {
+    return histogram->count > 0 ? (double)histogram->total / (double)histogram->count : 0.0;
+}
+
+/**
+ * \brief Gives the values counted by a bucket.
+ * \param bucket The bucket, from 0 to HISTOGRAM_BUCKET_COUNT - 1.
+ * \param low Receives the lowest value of the bucket.
+ * \param high Receives the highest value of the bucket. The last bucket also counts every larger value.
+ */
+void histogram_bucket_range(int bucket, uint64_t* low, uint64_t* high) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        *low = (uint64_t)bucket;
+        *high = (uint64_t)bucket;
+        return;
+    }
+
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    *low = (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift;
+    *high = *low + ((uint64_t)1 << shift) - 1;
+}
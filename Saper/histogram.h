@@ -0,0 +1,56 @@
+/*****************************************************************//**
+ * \file   histogram.h
+ * \brief  Fixed-size histograms of durations with a bounded relative error, in the style of HdrHistogram.
+ *
+ * Every power of two is split in HISTOGRAM_SUB_BUCKETS buckets of equal width, so a recorded value is
+ * known within 1 / HISTOGRAM_SUB_BUCKETS of itself whatever its magnitude, from nanoseconds to minutes.
+ * Recording is a bit scan and an increment, nothing is allocated. Besides durations, the difficulty analysis
+ * records the 3BV of its boards in one.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \def HISTOGRAM_SUB_BUCKET_BITS
+ * \brief Number of bits of a value kept below its highest set bit, which sets the precision.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+
+/**
+ * \def HISTOGRAM_SUB_BUCKETS
+ * \brief Number of buckets per power of two, values below it have a bucket each.
+ */
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * \def HISTOGRAM_MAX_BITS
+ * \brief Values are counted up to 2^HISTOGRAM_MAX_BITS - 1, about 18 minutes in nanoseconds. Larger ones go to the last bucket.
+ */
+#define HISTOGRAM_MAX_BITS 40
+
+/**
+ * \def HISTOGRAM_BUCKET_COUNT
+ * \brief Number of buckets of a histogram.
+ */
+#define HISTOGRAM_BUCKET_COUNT ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * \typedef Histogram
+ * \brief Counts of recorded values per bucket, with their exact count, sum, minimum and maximum.
+ */
+typedef struct Histogram {
+    uint32_t counts[HISTOGRAM_BUCKET_COUNT]; /**< Number of values recorded in each bucket. */
+    uint64_t count; /**< Number of values recorded. */
+    uint64_t total; /**< Sum of the values recorded. */
+    uint64_t min; /**< Smallest value recorded, UINT64_MAX when there is none. */
+    uint64_t max; /**< Largest value recorded, 0 when there is none. */
+} Histogram;
+
+void histogram_reset(Histogram* histogram);
+void histogram_record(uint64_t value, Histogram* histogram);
+void histogram_merge(const Histogram* source, Histogram* histogram);
+uint64_t histogram_percentile(double percentile, const Histogram* histogram);
+double histogram_mean(const Histogram* histogram);
+void histogram_bucket_range(int bucket, uint64_t* low, uint64_t* high);
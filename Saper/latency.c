@@ -0,0 +1,100 @@
+/*****************************************************************//**
+ * \file   latency.c
+ * \brief  Recording stage timings, drawing them over the board and writing them to a CSV file.
+ *********************************************************************/
+
+#include <stdio.h>
+#include "allegro5/allegro_primitives.h"
+#include "latency.h"
+#include "utils.h"
+
+/**
+ * \brief Names of the stages, in the overlay and in the CSV file.
+ */
+static const char* const stage_names[STAGE_COUNT] = { "queue", "update", "cells", "draw", "input_to_flip" };
+
+/**
+ * \brief Empties every histogram and hides the overlay.
+ * \param stats Pointer to the LatencyStats structure.
+ */
+void latency_stats_init(LatencyStats* stats) {
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        histogram_reset(&stats->stages[stage]);
+    }
+    histogram_reset(&stats->game_input_to_flip);
+    stats->overlay = false;
+}
+
+/**
+ * \brief Records the duration of a stage. Click-to-photon latencies also go to the histogram of the current game.
+ * \param stage The stage.
+ * \param seconds The duration in seconds, as measured with al_get_time.
+ * \param stats Pointer to the LatencyStats structure.
+ */
+void record_latency(enum LatencyStage stage, double seconds, LatencyStats* stats) {
+    uint64_t nanoseconds = seconds > 0.0 ? (uint64_t)(seconds * 1e9 + 0.5) : 0;
+    histogram_record(nanoseconds, &stats->stages[stage]);
+    if (stage == STAGE_INPUT_TO_FLIP) {
+        histogram_record(nanoseconds, &stats->game_input_to_flip);
+    }
+}
+
+/**
+ * \brief Draws the count, median, 99th percentile and maximum of every stage in the top right corner, in milliseconds.
+ * \param stats Pointer to the LatencyStats structure.
+ * \param font Font of the overlay.
+ */
+void draw_latency_overlay(const LatencyStats* stats, ALLEGRO_FONT* font) {
+    static const char* const headers[] = { "count", "p50", "p99", "max" };
+    static const float columns[] = { 250, 340, 430, 520 }; // Right edges of the number columns, from the left of the box
+    float line_height = (float)al_get_font_line_height(font);
+    float width = 540;
+    float x = SCREEN_WIDTH - width - 10;
+    float y = 10;
+
+    al_draw_filled_rectangle(x, y, x + width, y + (STAGE_COUNT + 1) * line_height + 10, al_map_rgba(235, 235, 235, 235));
+
+    ALLEGRO_COLOR color = al_map_rgb(0, 0, 0);
+    al_draw_text(font, color, x + 10, y + 5, ALLEGRO_ALIGN_LEFT, "ms");
+    for (int c = 0; c < 4; c++) {
+        al_draw_text(font, color, x + columns[c], y + 5, ALLEGRO_ALIGN_RIGHT, headers[c]);
+    }
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Histogram* histogram = &stats->stages[stage];
+        float line_y = y + 5 + (stage + 1) * line_height;
+        al_draw_text(font, color, x + 10, line_y, ALLEGRO_ALIGN_LEFT, stage_names[stage]);
+        al_draw_textf(font, color, x + columns[0], line_y, ALLEGRO_ALIGN_RIGHT, "%llu", (unsigned long long)histogram->count);
+        al_draw_textf(font, color, x + columns[1], line_y, ALLEGRO_ALIGN_RIGHT, "%.2f", histogram_percentile(50.0, histogram) / 1e6);
+        al_draw_textf(font, color, x + columns[2], line_y, ALLEGRO_ALIGN_RIGHT, "%.2f", histogram_percentile(99.0, histogram) / 1e6);
+        al_draw_textf(font, color, x + columns[3], line_y, ALLEGRO_ALIGN_RIGHT, "%.2f", histogram->max / 1e6);
+    }
+}
+
+/**
+ * \brief Writes the non-empty buckets of every stage to a CSV file, for offline analysis.
+ *
+ * One row per bucket: the stage, the lowest and highest durations of the bucket in nanoseconds, and the count.
+ * \param path Path of the file, replaced if it exists.
+ * \param stats Pointer to the LatencyStats structure.
+ * \return false if the file could not be written.
+ */
+bool write_latency_csv(const char* path, const LatencyStats* stats) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "stage,low_ns,high_ns,count\n");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const Histogram* histogram = &stats->stages[stage];
+        for (int bucket = 0; bucket < HISTOGRAM_BUCKET_COUNT; bucket++) {
+            if (histogram->counts[bucket] == 0)
+                continue;
+            uint64_t low, high;
+            histogram_bucket_range(bucket, &low, &high);
+            fprintf(file, "%s,%llu,%llu,%lu\n", stage_names[stage], (unsigned long long)low, (unsigned long long)high, (unsigned long)histogram->counts[bucket]);
+        }
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,44 @@
+/*****************************************************************//**
+ * \file   latency.h
+ * \brief  Timings of the stages between an input and the frame showing it, kept in histograms.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include "allegro5/allegro_font.h"
+#include "histogram.h"
+
+/**
+ * \def LATENCY_CSV_FILE
+ * \brief File the histograms are written to on exit, when the game was started with --latency.
+ */
+#define LATENCY_CSV_FILE "saper_latency.csv"
+
+/**
+ * \enum LatencyStage
+ * \brief Stages timed between an input and the frame showing its result.
+ */
+enum LatencyStage {
+    STAGE_QUEUE, /**< From the timestamp of an event to its handling, the time it waited in the event queue. */
+    STAGE_UPDATE, /**< Engine update of a click: reveal, flood fill and win check, or the flag. */
+    STAGE_CELLS, /**< Redrawing the changed cells on the board bitmap. */
+    STAGE_DRAW, /**< Drawing a frame, al_flip_display included. */
+    STAGE_INPUT_TO_FLIP, /**< From the timestamp of a click to the flip of the frame showing its result. */
+    STAGE_COUNT /**< Number of stages. */
+};
+
+/**
+ * \typedef LatencyStats
+ * \brief Histograms of the durations of every stage since the program started, in nanoseconds.
+ */
+typedef struct LatencyStats {
+    Histogram stages[STAGE_COUNT]; /**< One histogram per LatencyStage, over every game played. */
+    Histogram game_input_to_flip; /**< Click-to-photon latencies of the current game only. */
+    bool overlay; /**< Indicates if the percentiles are drawn over the board. */
+} LatencyStats;
+
+void latency_stats_init(LatencyStats* stats);
+void record_latency(enum LatencyStage stage, double seconds, LatencyStats* stats);
+void draw_latency_overlay(const LatencyStats* stats, ALLEGRO_FONT* font);
+bool write_latency_csv(const char* path, const LatencyStats* stats);
@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "allegro5/allegro.h"
 #include "allegro5/allegro_primitives.h"
@@ -14,14 +15,35 @@
 #include "utils.h"
 #include "menu.h"
 #include "gameboard.h"
+#include "renderbench.h"
 
  /**
   * \brief The main function of the game.
+  *
+  * Started with --render-bench, prints the board frame time comparison instead of running the game.
+  * Started with --latency, prints the click-to-photon latency at the end of every game and writes the stage histograms to LATENCY_CSV_FILE on exit.
+  * Started with --seed N, every game uses the seed N shown in the window title of a previous game, so its board comes back.
+  * \param argc Number of command line arguments.
+  * \param argv Command line arguments.
   * \return 0 on success, non-zero on failure.
   */
 
-int main() {
-    srand(time(NULL));
+int main(int argc, char** argv) {
+    bool render_bench = false;
+    bool report_latency = false;
+    bool fixed_seed = false;
+    uint64_t seed = (uint64_t)time(NULL);
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--render-bench") == 0)
+            render_bench = true;
+        else if (strcmp(argv[i], "--latency") == 0)
+            report_latency = true;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            fixed_seed = true;
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+    }
 
     if (!al_init()) {
         fprintf(stderr, "Failed to initialize Allegro.\n");
@@ -30,6 +52,7 @@ int main() {
 
     // Allegro addons initialization
     al_install_mouse();
+    al_install_keyboard();
     al_init_primitives_addon();
     al_init_image_addon();
     al_init_font_addon();
@@ -37,6 +60,10 @@ int main() {
     //
 
     // Allegro structures initialization
+    al_set_new_display_flags(ALLEGRO_GENERATE_EXPOSE_EVENTS); // Screens are only drawn again when their content was lost
+    if (render_bench) {
+        al_set_new_display_option(ALLEGRO_VSYNC, 2, ALLEGRO_SUGGEST);
+    }
     ALLEGRO_DISPLAY* display = al_create_display(SCREEN_WIDTH, SCREEN_HEIGHT);
     ALLEGRO_EVENT_QUEUE* event_queue = al_create_event_queue();
     ALLEGRO_TIMER* timer = al_create_timer(1.0 / 60);
@@ -53,16 +80,32 @@ int main() {
 
     al_register_event_source(event_queue, al_get_display_event_source(display));
     al_register_event_source(event_queue, al_get_mouse_event_source());
-    al_register_event_source(event_queue, al_get_timer_event_source(timer));
-
-    al_start_timer(timer);
+    al_register_event_source(event_queue, al_get_keyboard_event_source());
+    al_register_event_source(event_queue, al_get_timer_event_source(timer)); // The timer only runs during a game
     //
 
     // Initialization of game resources
     Game game;
     initialize_game_state(&game, display, event_queue, timer, small_font, medium_font, big_font, flag_image, bomb_image);
+    game.report_latency = report_latency;
+    rng_seed(seed, &game.rng);
+    game.fixed_seed = fixed_seed;
+    game.fixed_seed_value = seed;
+    start_no_guess_pool(~seed, &game);
+
+    if (!create_sprite_atlas(&game)) {
+        fprintf(stderr, "Failed to create the sprite atlas.\n");
+        cleanup_resources(&game);
+        return -1;
+    }
     //
 
+    if (render_bench) {
+        run_render_benchmark(&game);
+        cleanup_resources(&game);
+        return 0;
+    }
+
     while (true) {
         // Showing main game menu
         show_main_menu(&game);
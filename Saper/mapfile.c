@@ -0,0 +1,102 @@
+/*****************************************************************//**
+ * \file   mapfile.c
+ * \brief  File mappings with mmap or MapViewOfFile.
+ *********************************************************************/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "mapfile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \brief Maps a whole file in memory. Pages are read from the file when first touched, and writing to them
+ * only changes a private copy, never the file.
+ * \param path Path of the file.
+ * \param size Receives the size of the file in bytes.
+ * \return The mapped file, or NULL if it could not be opened, is empty or could not be mapped.
+ */
+void* map_file(const char* path, size_t* size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 || (unsigned long long)file_size.QuadPart > SIZE_MAX) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return NULL;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping alive
+    if (!data) {
+        return NULL;
+    }
+    *size = (size_t)file_size.QuadPart;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0 || (unsigned long long)info.st_size > SIZE_MAX) {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *size = (size_t)info.st_size;
+    return data;
+#endif
+}
+
+/**
+ * \brief Unmaps a file mapped by map_file, dropping the changes made to it.
+ * \param data The mapped file.
+ * \param size Size of the file in bytes, as given by map_file.
+ */
+void unmap_file(void* data, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+/**
+ * \brief Renames a file over another one. The replaced file is not truncated, so mappings of it stay valid.
+ *
+ * On POSIX the mappings keep the replaced file alive. Windows refuses to replace a mapped file, which fails here.
+ * \param from Path of the new file.
+ * \param to Path of the file replaced, created if it does not exist.
+ * \return true on success.
+ */
+bool replace_file(const char* from, const char* to) {
+#if defined(_WIN32)
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
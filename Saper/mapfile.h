@@ -0,0 +1,13 @@
+/*****************************************************************//**
+ * \file   mapfile.h
+ * \brief  Copy-on-write memory mappings of whole files, and replacing files without touching mapped ones, on POSIX or the Windows API.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void* map_file(const char* path, size_t* size);
+void unmap_file(void* data, size_t size);
+bool replace_file(const char* from, const char* to);
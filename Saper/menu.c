@@ -3,39 +3,124 @@
  * \brief  Functions for displaying game menus.
  *********************************************************************/
 
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "menu.h"
+#include "boardstats.h"
 #include "gameboard.h"
 #include "game.h"
+#include "camera.h"
+
+/**
+ * \brief Tells whether an event means the window content was lost and the screen has to be drawn again.
+ * \param event Pointer to the event.
+ * \return True if the screen has to be drawn again.
+ */
+static bool needs_repaint(const ALLEGRO_EVENT* event) {
+    return event->type == ALLEGRO_EVENT_DISPLAY_EXPOSE || event->type == ALLEGRO_EVENT_DISPLAY_SWITCH_IN || event->type == ALLEGRO_EVENT_DISPLAY_FOUND;
+}
+
+/**
+ * \brief Moves the camera from the mouse wheel (zoom), middle button drags and arrow keys (pan).
+ * \param event Pointer to the event.
+ * \param dragging Whether the middle button is held, updated by the event.
+ * \param game Pointer to the Game structure.
+ * \return True if the camera moved.
+ */
+static bool handle_camera_event(const ALLEGRO_EVENT* event, bool* dragging, Game* game) {
+    switch (event->type) {
+    case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN:
+    case ALLEGRO_EVENT_MOUSE_BUTTON_UP:
+        if (event->mouse.button == 3)
+            *dragging = event->type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN;
+        return false;
+    case ALLEGRO_EVENT_MOUSE_AXES:
+        if (event->mouse.dz != 0) {
+            zoom_camera(powf(1.25f, (float)event->mouse.dz), event->mouse.x, event->mouse.y, game);
+            return true;
+        }
+        if (*dragging && (event->mouse.dx != 0 || event->mouse.dy != 0)) {
+            pan_camera((float)-event->mouse.dx, (float)-event->mouse.dy, game);
+            return true;
+        }
+        return false;
+    case ALLEGRO_EVENT_KEY_CHAR:
+        switch (event->keyboard.keycode) {
+        case ALLEGRO_KEY_LEFT: pan_camera(-CAMERA_STEP, 0, game); return true;
+        case ALLEGRO_KEY_RIGHT: pan_camera(CAMERA_STEP, 0, game); return true;
+        case ALLEGRO_KEY_UP: pan_camera(0, -CAMERA_STEP, game); return true;
+        case ALLEGRO_KEY_DOWN: pan_camera(0, CAMERA_STEP, game); return true;
+        case ALLEGRO_KEY_HOME: reset_camera(game); return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+/**
+ * \brief Plays the game just initialized or resumed, then shows the game over screen.
+ *
+ * The clock starts from the elapsed time of the game, zero unless it was resumed.
+ * \param game Pointer to the Game structure.
+ */
+static void run_game(Game* game) {
+    create_board_bitmap(game);
+
+    // The seed in the window title lets a board be shared and played again
+    char title[64];
+    snprintf(title, sizeof(title), "Minesweeper - seed %llu", (unsigned long long)(game->infinite ? game->world.seed : game->board.seed));
+    al_set_window_title(game->display, title);
+
+    al_set_timer_count(game->timer, (int64_t)(game->elapsed_time * 60.0));
+    al_start_timer(game->timer);
+    game->replay_start = al_get_time();
+    //
+
+    play_game(game);
+    al_stop_timer(game->timer); // Menus are static, they do not need timer events
+    finish_game_replay(game);
+    prepare_next_game(game->last_difficulty, game); // Ready by the time the player picks the same preset again
+    show_game_over_screen(game);
+}
 
  /**
   * \brief Displays the main menu of the game.
   * \param game Pointer to the Game structure.
   */
 void show_main_menu(Game* game) {
-    while (true) {
-        al_clear_to_color(al_map_rgb(255, 255, 255));
-
-        al_draw_text(game->big_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 5, ALLEGRO_ALIGN_CENTER, "Minesweeper");
+    bool redraw = true;
 
+    while (true) {
         // Main menu buttons heights
         float play_y = SCREEN_HEIGHT / 2 - 75;
-        float how_to_play_y = SCREEN_HEIGHT / 2;
-        float exit_y = SCREEN_HEIGHT / 2 + 75;
+        float resume_y = SCREEN_HEIGHT / 2;
+        float how_to_play_y = SCREEN_HEIGHT / 2 + 75;
+        float exit_y = SCREEN_HEIGHT / 2 + 150;
         //
 
         // Calculate the width of texts
         float play_width = al_get_text_width(game->medium_font, "Play");
+        float resume_width = al_get_text_width(game->medium_font, "Resume Saved Game");
         float how_to_play_width = al_get_text_width(game->medium_font, "How to Play");
         float exit_width = al_get_text_width(game->medium_font, "Exit");
         //
 
-        // Drawing main menu texts
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 75, ALLEGRO_ALIGN_CENTER, "Play");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, ALLEGRO_ALIGN_CENTER, "How to Play");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 75, ALLEGRO_ALIGN_CENTER, "Exit");
-        //
+        if (redraw) { // The menu is static, it is only drawn again after another screen or when the window needs it
+            al_clear_to_color(al_map_rgb(255, 255, 255));
+
+            al_draw_text(game->big_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 5, ALLEGRO_ALIGN_CENTER, "Minesweeper");
+
+            // Drawing main menu texts
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, play_y, ALLEGRO_ALIGN_CENTER, "Play");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, resume_y, ALLEGRO_ALIGN_CENTER, "Resume Saved Game");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, how_to_play_y, ALLEGRO_ALIGN_CENTER, "How to Play");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, exit_y, ALLEGRO_ALIGN_CENTER, "Exit");
+            //
 
-        al_flip_display();
+            al_flip_display();
+            redraw = false;
+        }
 
         ALLEGRO_EVENT event;
         al_wait_for_event(game->event_queue, &event);
@@ -44,6 +129,9 @@ void show_main_menu(Game* game) {
             cleanup_resources(game);
             exit(0);
         }
+        else if (needs_repaint(&event)) {
+            redraw = true;
+        }
         else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) {
             if (event.mouse.button & 1) {
                 int x = event.mouse.x;
@@ -52,50 +140,28 @@ void show_main_menu(Game* game) {
                 if (x >= SCREEN_WIDTH / 2 - play_width / 2 && x <= SCREEN_WIDTH / 2 + play_width / 2 && y >= play_y && y <= play_y + al_get_font_line_height(game->medium_font)) { // Difficulty menu button
                     // Difficulty selection
                     int difficulty = show_difficulty_menu(game);
+                    redraw = true;
                     if (difficulty == 0)
                         continue;
 
-                    // Game initialization
-                    initialize_game(difficulty, game);
-                    game->game_over = false;
-                    game->game_won = false;
-
-                    al_set_timer_count(game->timer, 0);
-                    //
-
-                    while (!game->game_over && !game->game_won) { // Main game loop
-                        ALLEGRO_EVENT event;
-                        al_wait_for_event(game->event_queue, &event);
-
-                        if (event.type == ALLEGRO_EVENT_DISPLAY_CLOSE) { // Closing the game by clicking the X button
-                            cleanup_resources(game);
-                            exit(0);
-                        }
-                        else if (event.type == ALLEGRO_EVENT_TIMER) { // Drawing main game board
-                            draw_board(game);
-                        }
-                        else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) { // Revealing a cell
-                            if (event.mouse.button & 1) {
-                                int col = (event.mouse.x - game->start_x) / CELL_SIZE;
-                                int row = (event.mouse.y - game->start_y) / CELL_SIZE;
-                                if (col >= 0 && col < game->cols && row >= 0 && row < game->rows) {
-                                    reveal_cell(row, col, game);
-                                    check_game_won(game);
-                                }
-                            }
-                            else if (event.mouse.button & 2) { // Placing a flag
-                                int col = (event.mouse.x - game->start_x) / CELL_SIZE;
-                                int row = (event.mouse.y - game->start_y) / CELL_SIZE;
-                                if (col >= 0 && col < game->cols && row >= 0 && row < game->rows) {
-                                    toggle_flag(row, col, game);
-                                }
-                            }
-                        }
+                    if (!initialize_game(difficulty, game)) {
+                        fprintf(stderr, "Cannot start the game: the board could not be allocated.\n");
+                        continue;
+                    }
+                    run_game(game);
+                }
+                else if (x >= SCREEN_WIDTH / 2 - resume_width / 2 && x <= SCREEN_WIDTH / 2 + resume_width / 2 && y >= resume_y && y <= resume_y + al_get_font_line_height(game->medium_font)) { // Resume saved game button
+                    enum SaveStatus status = resume_game(SAVE_FILE_NAME, game);
+                    redraw = true;
+                    if (status != SAVE_OK) {
+                        fprintf(stderr, "Cannot resume the game from %s: %s.\n", SAVE_FILE_NAME, save_status_text(status));
+                        continue;
                     }
-                    show_game_over_screen(game);
+                    run_game(game);
                 }
                 else if (x >= SCREEN_WIDTH / 2 - how_to_play_width / 2 && x <= SCREEN_WIDTH / 2 + how_to_play_width / 2 && y >= how_to_play_y && y <= how_to_play_y + al_get_font_line_height(game->medium_font)) { // How to play menu
                     show_how_to_play(game);
+                    redraw = true;
                 }
                 else if (x >= SCREEN_WIDTH / 2 - exit_width / 2 && x <= SCREEN_WIDTH / 2 + exit_width / 2 && y >= exit_y && y <= exit_y + al_get_font_line_height(game->medium_font)) { // Exit game button
                     cleanup_resources(game);
@@ -106,21 +172,135 @@ void show_main_menu(Game* game) {
     }
 }
 
+/**
+ * \brief Runs the main game loop until the game is lost or won.
+ *
+ * Every iteration drains the whole event queue before drawing: all inputs are applied first, timer ticks
+ * that piled up are merged into one frame, and nothing is drawn when neither the board nor the clock changed.
+ * The time events wait in the queue, the engine and bitmap updates of clicks, frame draws and click-to-photon
+ * latencies are recorded in game->latency. The board is drawn once more after the click ending the game,
+ * so that click counts in the latencies like every other one.
+ * \param game Pointer to the Game structure.
+ */
+void play_game(Game* game) {
+    bool redraw = true;
+    bool dragging = false;
+    double input_time = 0.0; // Timestamp of the oldest input not shown on screen yet
+
+    histogram_reset(&game->latency.game_input_to_flip);
+
+    while (!is_game_finished(game)) { // Main game loop
+        ALLEGRO_EVENT event;
+        al_wait_for_event(game->event_queue, &event);
+
+        do {
+            double received = al_get_time();
+            record_latency(STAGE_QUEUE, received - event.any.timestamp, &game->latency);
+
+            if (event.type == ALLEGRO_EVENT_DISPLAY_CLOSE) { // Closing the game by clicking the X button
+                cleanup_resources(game);
+                exit(0);
+            }
+            else if (event.type == ALLEGRO_EVENT_TIMER || needs_repaint(&event)) { // The clock changed, any number of ticks is a single frame
+                redraw = true;
+            }
+            else if (handle_camera_event(&event, &dragging, game)) {
+                redraw = true;
+            }
+            else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) {
+                int row, col;
+                if (!screen_to_cell(event.mouse.x, event.mouse.y, &row, &col, game)) {
+                    continue;
+                }
+
+                bool changed = false;
+                if (event.mouse.button == 1) { // Revealing a cell
+                    if (reveal_game_cell(row, col, game) > 0) {
+                        double updated = al_get_time();
+                        record_latency(STAGE_UPDATE, updated - received, &game->latency);
+                        record_game_action(event.any.timestamp, REPLAY_REVEAL, row, col, game);
+                        if (!game->infinite) {
+                            update_board_cells(game, game->board.opened, game->board.opened_count, false);
+                            record_latency(STAGE_CELLS, al_get_time() - updated, &game->latency);
+                        }
+                        changed = true;
+                    }
+                }
+                else if (event.mouse.button == 2) { // Placing a flag
+                    toggle_game_flag(row, col, game);
+                    double updated = al_get_time();
+                    record_latency(STAGE_UPDATE, updated - received, &game->latency);
+                    record_game_action(event.any.timestamp, REPLAY_FLAG, row, col, game);
+                    if (!game->infinite) {
+                        int index = row * game->board.cols + col;
+                        update_board_cells(game, &index, 1, false);
+                        record_latency(STAGE_CELLS, al_get_time() - updated, &game->latency);
+                    }
+                    changed = true;
+                }
+
+                if (changed) {
+                    redraw = true;
+                    if (input_time == 0.0)
+                        input_time = event.any.timestamp;
+                }
+            }
+            else if (event.type == ALLEGRO_EVENT_KEY_DOWN && event.keyboard.keycode == ALLEGRO_KEY_S && !game->infinite) { // Saving the game
+                game->elapsed_time = al_get_timer_count(game->timer) / 60.0;
+                enum SaveStatus status = save_game(SAVE_FILE_NAME, game);
+                if (status == SAVE_OK)
+                    printf("Game saved to %s.\n", SAVE_FILE_NAME);
+                else
+                    fprintf(stderr, "Cannot save the game to %s: %s.\n", SAVE_FILE_NAME, save_status_text(status));
+            }
+            else if (event.type == ALLEGRO_EVENT_KEY_DOWN && event.keyboard.keycode == ALLEGRO_KEY_F3) { // Showing or hiding the frame timings
+                game->latency.overlay = !game->latency.overlay;
+                redraw = true;
+            }
+        } while (!is_game_finished(game) && al_get_next_event(game->event_queue, &event));
+
+        if (redraw) { // Also after the click ending the game, so that its result is shown and its latency recorded
+            double draw_start = al_get_time();
+            draw_board(game);
+            double flipped = al_get_time();
+            record_latency(STAGE_DRAW, flipped - draw_start, &game->latency);
+            redraw = false;
+
+            if (input_time != 0.0) { // Click-to-photon latency, from the input event to the flipped frame showing its result
+                record_latency(STAGE_INPUT_TO_FLIP, flipped - input_time, &game->latency);
+                input_time = 0.0;
+            }
+        }
+    }
+
+    const Histogram* latencies = &game->latency.game_input_to_flip;
+    if (game->report_latency && latencies->count > 0) {
+        printf("Click-to-photon latency over %llu inputs: mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", (unsigned long long)latencies->count,
+            histogram_mean(latencies) / 1e6, histogram_percentile(50.0, latencies) / 1e6, histogram_percentile(99.0, latencies) / 1e6, latencies->max / 1e6);
+    }
+}
+
 /**
  * \brief Displays the "How to Play" menu.
  * \param game Pointer to the Game structure.
  */
 void show_how_to_play(Game* game) {
-    while (true) {
-        al_clear_to_color(al_map_rgb(255, 255, 255));
-
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 4, ALLEGRO_ALIGN_CENTER, "How to Play");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 100, ALLEGRO_ALIGN_CENTER, "Left click to reveal a cell.");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 50, ALLEGRO_ALIGN_CENTER, "Right click to flag a cell.");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, ALLEGRO_ALIGN_CENTER, "Avoid mines to win the game.");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 100, ALLEGRO_ALIGN_CENTER, "Click to return to main menu");
+    bool redraw = true;
 
-        al_flip_display();
+    while (true) {
+        if (redraw) {
+            al_clear_to_color(al_map_rgb(255, 255, 255));
+
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 4, ALLEGRO_ALIGN_CENTER, "How to Play");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 100, ALLEGRO_ALIGN_CENTER, "Left click to reveal a cell.");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 - 50, ALLEGRO_ALIGN_CENTER, "Right click to flag a cell.");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, ALLEGRO_ALIGN_CENTER, "Avoid mines to win the game.");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 50, ALLEGRO_ALIGN_CENTER, "Press S to save, F3 for frame timings.");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 + 100, ALLEGRO_ALIGN_CENTER, "Click to return to main menu");
+
+            al_flip_display();
+            redraw = false;
+        }
 
         ALLEGRO_EVENT event;
         al_wait_for_event(game->event_queue, &event);
@@ -129,6 +309,9 @@ void show_how_to_play(Game* game) {
             cleanup_resources(game);
             exit(0);
         }
+        else if (needs_repaint(&event)) {
+            redraw = true;
+        }
         else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) { // Backing to main menu
             return;
         }
@@ -138,26 +321,41 @@ void show_how_to_play(Game* game) {
 /**
  * \brief Displays the difficulty selection menu.
  * \param game Pointer to the Game structure.
- * \return The selected difficulty level (1 = easy, 2 = medium, 3 = hard).
+ * \return The selected difficulty level (1 = easy, 2 = medium, 3 = hard, 4 and above = large boards and infinite mode), 0 to return to the main menu.
  */
 int show_difficulty_menu(Game* game) {
-    while (true) {
-        al_clear_to_color(al_map_rgb(255, 255, 255));
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 4, ALLEGRO_ALIGN_CENTER, "Select Difficulty");
+    bool redraw = true;
+    prepare_next_game(game->last_difficulty > 0 ? game->last_difficulty : 1, game); // Unless a game is being prepared already
 
+    while (true) {
         // Texts heights
         int easy_y = SCREEN_HEIGHT / 2 - 100;
         int medium_y = SCREEN_HEIGHT / 2;
         int hard_y = SCREEN_HEIGHT / 2 + 100;
-        int return_y = SCREEN_HEIGHT / 2 + 250;
+        int large_y = SCREEN_HEIGHT / 2 + 200;
+        int return_y = SCREEN_HEIGHT / 2 + 300;
+        int no_guess_y = SCREEN_HEIGHT / 4 + 80;
+        int topology_y = SCREEN_HEIGHT / 4 + 120;
         //
 
-
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, easy_y, ALLEGRO_ALIGN_CENTER, "Easy (8x8, 10 mines)");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, medium_y, ALLEGRO_ALIGN_CENTER, "Medium (12x12, 20 mines)");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, hard_y, ALLEGRO_ALIGN_CENTER, "Hard (16x16, 40 mines)");
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, return_y, ALLEGRO_ALIGN_CENTER, "Return to Main Menu");
-        al_flip_display();
+        const char* no_guess_text = game->no_guess ? "No guessing: On" : "No guessing: Off";
+        char topology_text[32];
+        snprintf(topology_text, sizeof(topology_text), "Topology: %s", topology_name((enum Topology)game->topology));
+
+        if (redraw) {
+            al_clear_to_color(al_map_rgb(255, 255, 255));
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 4, ALLEGRO_ALIGN_CENTER, "Select Difficulty");
+            al_draw_text(game->small_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, no_guess_y, ALLEGRO_ALIGN_CENTER, no_guess_text);
+            al_draw_text(game->small_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, topology_y, ALLEGRO_ALIGN_CENTER, topology_text);
+
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, easy_y, ALLEGRO_ALIGN_CENTER, "Easy (8x8, 10 mines)");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, medium_y, ALLEGRO_ALIGN_CENTER, "Medium (12x12, 20 mines)");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, hard_y, ALLEGRO_ALIGN_CENTER, "Hard (16x16, 40 mines)");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, large_y, ALLEGRO_ALIGN_CENTER, "Large Boards");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, return_y, ALLEGRO_ALIGN_CENTER, "Return to Main Menu");
+            al_flip_display();
+            redraw = false;
+        }
 
         ALLEGRO_EVENT event;
         al_wait_for_event(game->event_queue, &event);
@@ -166,6 +364,9 @@ int show_difficulty_menu(Game* game) {
             cleanup_resources(game);
             exit(0);
         }
+        else if (needs_repaint(&event)) {
+            redraw = true;
+        }
         else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) {
             if (event.mouse.button & 1) {
                 int x = event.mouse.x;
@@ -178,15 +379,33 @@ int show_difficulty_menu(Game* game) {
                 int easy_width = al_get_text_width(game->medium_font, "Easy (8x8, 10 mines)");
                 int medium_width = al_get_text_width(game->medium_font, "Medium (12x12, 20 mines)");
                 int hard_width = al_get_text_width(game->medium_font, "Hard (16x16, 40 mines)");
+                int large_width = al_get_text_width(game->medium_font, "Large Boards");
                 int return_width = al_get_text_width(game->medium_font, "Return to Main Menu");
+                int no_guess_width = al_get_text_width(game->small_font, no_guess_text);
+                int no_guess_height = al_get_font_line_height(game->small_font);
+                int topology_width = al_get_text_width(game->small_font, topology_text);
                 //
 
-                if (y >= easy_y && y <= easy_y + font_height && x >= SCREEN_WIDTH / 2 - easy_width / 2 && x <= SCREEN_WIDTH / 2 + easy_width / 2)
+                if (y >= no_guess_y && y <= no_guess_y + no_guess_height && x >= SCREEN_WIDTH / 2 - no_guess_width / 2 && x <= SCREEN_WIDTH / 2 + no_guess_width / 2) {
+                    game->no_guess = !game->no_guess; // Only applies to the three difficulties
+                    redraw = true;
+                }
+                else if (y >= topology_y && y <= topology_y + no_guess_height && x >= SCREEN_WIDTH / 2 - topology_width / 2 && x <= SCREEN_WIDTH / 2 + topology_width / 2) {
+                    game->topology = (game->topology + 1) % TOPOLOGY_COUNT; // Applies to every board but the infinite mode
+                    redraw = true;
+                }
+                else if (y >= easy_y && y <= easy_y + font_height && x >= SCREEN_WIDTH / 2 - easy_width / 2 && x <= SCREEN_WIDTH / 2 + easy_width / 2)
                     return 1; // Easy mode
                 else if (y >= medium_y && y <= medium_y + font_height && x >= SCREEN_WIDTH / 2 - medium_width / 2 && x <= SCREEN_WIDTH / 2 + medium_width / 2)
                     return 2; // Medium mode
                 else if (y >= hard_y && y <= hard_y + font_height && x >= SCREEN_WIDTH / 2 - hard_width / 2 && x <= SCREEN_WIDTH / 2 + hard_width / 2)
                     return 3; // Hard mode
+                else if (y >= large_y && y <= large_y + font_height && x >= SCREEN_WIDTH / 2 - large_width / 2 && x <= SCREEN_WIDTH / 2 + large_width / 2) {
+                    int difficulty = show_large_board_menu(game); // Large board selection
+                    if (difficulty != 0)
+                        return difficulty;
+                    redraw = true;
+                }
                 else if (y >= return_y && y <= return_y + font_height && x >= SCREEN_WIDTH / 2 - return_width / 2 && x <= SCREEN_WIDTH / 2 + return_width / 2)
                     return 0; // Return to main menu
             }
@@ -195,67 +414,121 @@ int show_difficulty_menu(Game* game) {
 }
 
 /**
- * \brief Displays the game over screen.
+ * \brief Displays the selection menu of the large boards, the presets after the three difficulties, and of the infinite mode.
  * \param game Pointer to the Game structure.
+ * \return The selected preset (4 to BOARD_PRESET_COUNT), INFINITE_DIFFICULTY, or 0 to return to the difficulty menu.
  */
-void show_game_over_screen(Game* game) {
+int show_large_board_menu(Game* game) {
+    bool redraw = true;
+
+    // Texts of the presets
+    char labels[BOARD_PRESET_COUNT][64];
+    for (int difficulty = 4; difficulty <= BOARD_PRESET_COUNT; difficulty++) {
+        int rows, cols, mines;
+        get_board_preset(difficulty, &rows, &cols, &mines);
+        snprintf(labels[difficulty - 1], sizeof(labels[difficulty - 1]), "%dx%d, %d mines", rows, cols, mines);
+    }
+    int first_y = SCREEN_HEIGHT / 2 - 250;
+    int infinite_y = first_y + (BOARD_PRESET_COUNT - 3) * 90;
+    int return_y = SCREEN_HEIGHT / 2 + 300;
+    //
+
     while (true) {
-        al_clear_to_color(al_map_rgb(255, 255, 255));
-
-        for (int i = 0; i < game->rows; i++) {
-            for (int j = 0; j < game->cols; j++) {
-                int x = game->start_x + j * CELL_SIZE;
-                int y = game->start_y + i * CELL_SIZE;
-                al_draw_rectangle(x, y, x + CELL_SIZE, y + CELL_SIZE, al_map_rgb(0, 0, 0), 2);
-
-                if (game->revealed[i][j]) {
-                    if (game->board[i][j] == -1) { // Revealing a cell with mine
-                        al_draw_filled_rectangle(x + 1, y + 1, x + CELL_SIZE - 1, y + CELL_SIZE - 1, al_map_rgb(255, 0, 0));
-                        al_draw_scaled_bitmap(game->bomb_image, 0, 0, al_get_bitmap_width(game->bomb_image), al_get_bitmap_height(game->bomb_image), x + 1, y + 1, CELL_SIZE - 2, CELL_SIZE - 2, 0);
-                    }
-                    if (game->board[i][j] != -1) {
-                        al_draw_filled_rectangle(x + 1, y + 1, x + CELL_SIZE - 1, y + CELL_SIZE - 1, al_map_rgb(192, 192, 192));
-                        if (game->board[i][j] > 0) {
-                            switch (game->board[i][j]) { // Choosing a color based on how many mines are adjacent to the cell
-                            case 1: game->color = al_map_rgb(0, 0, 255); break;
-                            case 2: game->color = al_map_rgb(0, 128, 0); break;
-                            case 3: game->color = al_map_rgb(255, 0, 0); break;
-                            case 4: game->color = al_map_rgb(0, 0, 128); break;
-                            case 5: game->color = al_map_rgb(128, 0, 0); break;
-                            case 6: game->color = al_map_rgb(0, 128, 128); break;
-                            case 7: game->color = al_map_rgb(0, 0, 0); break;
-                            case 8: game->color = al_map_rgb(128, 128, 128); break;
-                            default: game->color = al_map_rgb(0, 0, 0); break;
-                            }
-                            al_draw_textf(game->small_font, game->color, x + CELL_SIZE / 2, y + CELL_SIZE / 2 - al_get_font_ascent(game->small_font) / 2, ALLEGRO_ALIGN_CENTER, "%d", game->board[i][j]);
-                        }
-                    }
-                }
-                else if (game->board[i][j] == -1) { // Drawing all the other bombs after lose
-                    al_draw_filled_rectangle(x + 1, y + 1, x + CELL_SIZE - 1, y + CELL_SIZE - 1, al_map_rgb(255, 0, 0));
-                    al_draw_scaled_bitmap(game->bomb_image, 0, 0, al_get_bitmap_width(game->bomb_image), al_get_bitmap_height(game->bomb_image), x + 1, y + 1, CELL_SIZE - 2, CELL_SIZE - 2, 0);
-                }
-                else if (game->flagged[i][j]) { // Flagging a cell
-                    al_draw_scaled_bitmap(game->flag_image, 0, 0, al_get_bitmap_width(game->flag_image), al_get_bitmap_height(game->flag_image), x + 1, y + 1, CELL_SIZE - 2, CELL_SIZE - 2, 0);
-                }
+        if (redraw) {
+            al_clear_to_color(al_map_rgb(255, 255, 255));
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, SCREEN_HEIGHT / 4 - 100, ALLEGRO_ALIGN_CENTER, "Select Board Size");
+
+            for (int difficulty = 4; difficulty <= BOARD_PRESET_COUNT; difficulty++) {
+                al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, first_y + (difficulty - 4) * 90, ALLEGRO_ALIGN_CENTER, labels[difficulty - 1]);
             }
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, infinite_y, ALLEGRO_ALIGN_CENTER, "Infinite");
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, return_y, ALLEGRO_ALIGN_CENTER, "Return");
+            al_flip_display();
+            redraw = false;
         }
 
-        update_timer(game);
+        ALLEGRO_EVENT event;
+        al_wait_for_event(game->event_queue, &event);
 
-        if (game->game_over) { // Losing text
-            al_draw_text(game->medium_font, al_map_rgb(255, 0, 0), SCREEN_WIDTH / 2, game->start_y - 150, ALLEGRO_ALIGN_CENTER, "Game Over!");
+        if (event.type == ALLEGRO_EVENT_DISPLAY_CLOSE) { // Closing the game by clicking the X button
+            cleanup_resources(game);
+            exit(0);
         }
-        else if (game->game_won) { // Winning text
-            al_draw_text(game->medium_font, al_map_rgb(0, 255, 0), SCREEN_WIDTH / 2, game->start_y - 150, ALLEGRO_ALIGN_CENTER, "You Win!");
+        else if (needs_repaint(&event)) {
+            redraw = true;
         }
+        else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) {
+            if (event.mouse.button & 1) {
+                int x = event.mouse.x;
+                int y = event.mouse.y;
+                int font_height = al_get_font_line_height(game->medium_font);
 
-        int button_y = game->start_y + game->rows * CELL_SIZE + 20;
+                for (int difficulty = 4; difficulty <= BOARD_PRESET_COUNT; difficulty++) {
+                    int text_y = first_y + (difficulty - 4) * 90;
+                    int width = al_get_text_width(game->medium_font, labels[difficulty - 1]);
+                    if (y >= text_y && y <= text_y + font_height && x >= SCREEN_WIDTH / 2 - width / 2 && x <= SCREEN_WIDTH / 2 + width / 2)
+                        return difficulty;
+                }
 
-        // Return to main menu button
-        al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, button_y, ALLEGRO_ALIGN_CENTER, "Click to return to main menu");
+                int infinite_width = al_get_text_width(game->medium_font, "Infinite");
+                if (y >= infinite_y && y <= infinite_y + font_height && x >= SCREEN_WIDTH / 2 - infinite_width / 2 && x <= SCREEN_WIDTH / 2 + infinite_width / 2)
+                    return INFINITE_DIFFICULTY; // Infinite mode
 
-        al_flip_display();
+                int return_width = al_get_text_width(game->medium_font, "Return");
+                if (y >= return_y && y <= return_y + font_height && x >= SCREEN_WIDTH / 2 - return_width / 2 && x <= SCREEN_WIDTH / 2 + return_width / 2)
+                    return 0; // Return to the difficulty menu
+            }
+        }
+    }
+}
+
+/**
+ * \brief Displays the game over screen, with the 3BV of a classic board, its openings and islands, and the 3BV per second of a win.
+ * \param game Pointer to the Game structure.
+ */
+void show_game_over_screen(Game* game) {
+    show_all_mines(game);
+
+    bool redraw = true;
+    bool dragging = false;
+    int button_y = game->start_y + game->view_height + 20;
+    int title_y = game->start_y - 150 > 0 ? game->start_y - 150 : 0;
+
+    // Difficulty of the board, computed once: 3BV/s only means something for a cleared board
+    char stats_text[96] = "";
+    BoardStats stats;
+    if (!game->infinite && game->board.mines_placed && game->board.topology == TOPOLOGY_CLASSIC && compute_board_stats(&game->board, &stats)) {
+        if (!is_game_lost(game) && game->elapsed_time > 0.0)
+            snprintf(stats_text, sizeof(stats_text), "3BV %d, %.2f 3BV/s, %d openings, %d islands", stats.bv, stats.bv / game->elapsed_time, stats.openings, stats.islands);
+        else
+            snprintf(stats_text, sizeof(stats_text), "3BV %d, %d openings, %d islands", stats.bv, stats.openings, stats.islands);
+    }
+    //
+
+    while (true) {
+        if (redraw) { // The clock is stopped, so the screen only changes with the camera or when the window needs it
+            al_clear_to_color(al_map_rgb(255, 255, 255));
+
+            draw_board_cells(game, true);
+
+            update_timer(game);
+            draw_mines_counter(game);
+
+            if (is_game_lost(game)) { // Losing text
+                al_draw_text(game->medium_font, al_map_rgb(255, 0, 0), SCREEN_WIDTH / 2, title_y, ALLEGRO_ALIGN_CENTER, "Game Over!");
+            }
+            else { // Winning text
+                al_draw_text(game->medium_font, al_map_rgb(0, 255, 0), SCREEN_WIDTH / 2, title_y, ALLEGRO_ALIGN_CENTER, "You Win!");
+            }
+
+            al_draw_text(game->small_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, title_y + 65, ALLEGRO_ALIGN_CENTER, stats_text);
+
+            // Return to main menu button
+            al_draw_text(game->medium_font, al_map_rgb(0, 0, 0), SCREEN_WIDTH / 2, button_y, ALLEGRO_ALIGN_CENTER, "Click to return to main menu");
+
+            al_flip_display();
+            redraw = false;
+        }
 
         ALLEGRO_EVENT event;
         al_wait_for_event(game->event_queue, &event);
@@ -264,8 +537,14 @@ void show_game_over_screen(Game* game) {
             cleanup_resources(game);
             exit(0);
         }
+        else if (needs_repaint(&event)) {
+            redraw = true;
+        }
+        else if (handle_camera_event(&event, &dragging, game)) { // The whole board can still be looked at
+            redraw = true;
+        }
         else if (event.type == ALLEGRO_EVENT_MOUSE_BUTTON_DOWN) { // Returning to main menu
-            if (event.mouse.button & 1) {
+            if (event.mouse.button == 1) {
                 int x = event.mouse.x;
                 int y = event.mouse.y;
 
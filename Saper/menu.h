@@ -8,8 +8,10 @@
 #include "game.h"
 
 void show_main_menu(Game* game);
+void play_game(Game* game);
 void show_how_to_play(Game* game);
 int show_difficulty_menu(Game* game);
+int show_large_board_menu(Game* game);
 void show_game_over_screen(Game* game);
 
 
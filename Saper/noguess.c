@@ -0,0 +1,360 @@
+/*****************************************************************//**
+ * \file   noguess.c
+ * \brief  Candidate search for no-guess boards, spread over a thread pool, and the pool of ready boards.
+ *********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "allocator.h"
+#include "noguess.h"
+
+/**
+ * \typedef NoGuessSearch
+ * \brief Candidates shared by the workers of one search.
+ *
+ * Worker w tries the attempts w, w + stride, w + 2 * stride... and stops at the first one it finds solvable
+ * or once it passes the lowest solvable attempt found so far. Every attempt below the final lowest one is
+ * therefore checked, so the result only depends on the seed, not on the number of workers or their timing.
+ */
+typedef struct NoGuessSearch {
+    int rows; /**< Number of rows of the boards. */
+    int cols; /**< Number of columns of the boards. */
+    int mines; /**< Number of mines of the boards. */
+    uint64_t seed; /**< Seed the candidate seeds are derived from. */
+    int stride; /**< Number of workers. */
+    AtomicInt best_attempt; /**< Lowest attempt found solvable, NO_GUESS_MAX_ATTEMPTS while there is none. */
+    AtomicInt failed; /**< Set when a worker could not allocate its checker, its attempts were never tried. */
+    AtomicInt* cancel; /**< Stops the search when set, NULL if it cannot be cancelled. */
+} NoGuessSearch;
+
+/**
+ * \typedef NoGuessWorker
+ * \brief Argument of a search job.
+ */
+typedef struct NoGuessWorker {
+    NoGuessSearch* search; /**< The shared search. */
+    int first_attempt; /**< First attempt of the worker. */
+} NoGuessWorker;
+
+/**
+ * \brief Returns the seed of a candidate.
+ */
+static uint64_t attempt_seed(uint64_t seed, int attempt) {
+    return seed + (uint64_t)attempt * 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+ * \brief Draws the first click of a candidate from its seed.
+ */
+static void attempt_start(uint64_t candidate, int rows, int cols, int* start_row, int* start_col) {
+    Rng rng;
+    rng_seed(~candidate, &rng);
+    *start_row = (int)rng_below((uint32_t)rows, &rng);
+    *start_col = (int)rng_below((uint32_t)cols, &rng);
+}
+
+/**
+ * \brief Plays the board of a checker from its first click, only revealing the cells that are proven safe.
+ * \param start_row The row index of the first click.
+ * \param start_col The column index of the first click.
+ * \param checker Pointer to the NoGuessChecker structure.
+ * \return true if every safe cell could be revealed.
+ */
+static bool play_candidate(int start_row, int start_col, NoGuessChecker* checker) {
+    Board* board = &checker->board;
+    reveal_cell(start_row, start_col, board);
+    solver_reset(board, &checker->solver);
+
+    while (!board->game_won) {
+        if (board->game_over) {
+            return false;
+        }
+
+        int index = solver_next_safe(board, &checker->solver);
+        if (index < 0) { // The local rules are stuck, the mine count may still prove a cell safe
+            if (!probability_compute(board, &checker->solver, &checker->engine) || !checker->engine.exact) {
+                return false;
+            }
+            index = probability_safest_cell(board, &checker->engine);
+            if (index < 0 || probability_of_cell(index / board->cols, index % board->cols, board, &checker->engine) > 0.0) {
+                return false;
+            }
+        }
+
+        reveal_cell(index / board->cols, index % board->cols, board);
+        solver_update(board, &checker->solver);
+    }
+    return true;
+}
+
+/**
+ * \brief Allocates the buffers used to play candidates of one board size.
+ * \param rows Number of rows of the boards.
+ * \param cols Number of columns of the boards.
+ * \param mines Number of mines of the boards.
+ * \param checker Pointer to the NoGuessChecker structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool no_guess_checker_create(int rows, int cols, int mines, NoGuessChecker* checker) {
+    if (!initialize_board(rows, cols, mines, 0, &checker->board)) {
+        return false;
+    }
+    if (!solver_create(&checker->board, &checker->solver)) {
+        free_board(&checker->board);
+        return false;
+    }
+    probability_init(NULL, &checker->engine);
+    checker->engine.time_limit = INFINITY; // Only the node budget bounds the enumeration, so a board is accepted or not whatever the machine
+    return true;
+}
+
+/**
+ * \brief Frees the buffers of a checker.
+ * \param checker Pointer to the NoGuessChecker structure.
+ */
+void no_guess_checker_destroy(NoGuessChecker* checker) {
+    probability_destroy(&checker->engine);
+    solver_destroy(&checker->solver);
+    free_board(&checker->board);
+}
+
+/**
+ * \brief Tells whether a board can be finished from a first click without ever guessing.
+ * \param start_row The row index of the first click.
+ * \param start_col The column index of the first click.
+ * \param board Pointer to the Board structure, with its mines placed. It is not modified.
+ * \param checker Pointer to a NoGuessChecker created for the size of the board.
+ * \return true if deduction alone reveals every safe cell.
+ */
+bool is_no_guess_board(int start_row, int start_col, const Board* board, NoGuessChecker* checker) {
+    Board* copy = &checker->board;
+    size_t cell_count = (size_t)board->rows * board->cols;
+    for (size_t i = 0; i < cell_count; i++) {
+        copy->cells[i] = board->cells[i] & ~(CELL_REVEALED | CELL_FLAGGED);
+    }
+    copy->mines = board->mines;
+    copy->seed = board->seed;
+    copy->opened_count = 0;
+    copy->revealed_count = 0;
+    copy->flags_placed = 0;
+    copy->mines_placed = true;
+    copy->game_over = false;
+    copy->game_won = false;
+
+    return play_candidate(start_row, start_col, checker);
+}
+
+/**
+ * \brief Tries the candidates of one worker, the job run by the thread pool.
+ * \param arg Pointer to the NoGuessWorker structure.
+ */
+static void search_attempts(void* arg) {
+    NoGuessWorker* worker = arg;
+    NoGuessSearch* search = worker->search;
+
+    NoGuessChecker checker;
+    if (!no_guess_checker_create(search->rows, search->cols, search->mines, &checker)) { // The search cannot be trusted anymore
+        atomic_int_store(&search->failed, 1);
+        return;
+    }
+
+    for (int attempt = worker->first_attempt; attempt < atomic_int_load(&search->best_attempt); attempt += search->stride) {
+        if (atomic_int_load(&search->failed) || (search->cancel && atomic_int_load(search->cancel))) {
+            break;
+        }
+
+        uint64_t candidate = attempt_seed(search->seed, attempt);
+        int start_row, start_col;
+        attempt_start(candidate, search->rows, search->cols, &start_row, &start_col);
+        reset_board(search->mines, candidate, &checker.board);
+
+        if (play_candidate(start_row, start_col, &checker)) {
+            atomic_int_min(&search->best_attempt, attempt);
+            break;
+        }
+    }
+
+    no_guess_checker_destroy(&checker);
+}
+
+/**
+ * \brief Generates a board that can be finished from its first click by deduction alone.
+ *
+ * The candidates are spread over the workers, which stop as soon as a solvable one is known to be the first.
+ * The same seed always gives the same board, whatever the number of workers.
+ * \param rows Number of rows in the game board.
+ * \param cols Number of columns in the game board.
+ * \param mines Number of mines to place.
+ * \param seed Seed the candidates are derived from.
+ * \param threads Workers trying the candidates, NULL to try them on the calling thread, which must not be one of them.
+ * \param cancel Stops the search when set, NULL if it cannot be cancelled.
+ * \param start_row Receives the row index of the first click.
+ * \param start_col Receives the column index of the first click.
+ * \param board Pointer to the Board structure receiving the board, with its mines placed and nothing revealed.
+ * \return Number of candidates rejected before it, or -1 if none of the NO_GUESS_MAX_ATTEMPTS candidates was solvable,
+ * the search was cancelled or the memory ran out.
+ */
+int generate_no_guess_board(int rows, int cols, int mines, uint64_t seed, ThreadPool* threads, AtomicInt* cancel, int* start_row, int* start_col, Board* board) {
+    int worker_count = threads ? threads->thread_count : 1;
+    NoGuessWorker* workers = core_malloc((size_t)worker_count * sizeof(NoGuessWorker));
+    if (!workers) {
+        return -1;
+    }
+
+    NoGuessSearch search;
+    search.rows = rows;
+    search.cols = cols;
+    search.mines = mines;
+    search.seed = seed;
+    search.stride = worker_count;
+    search.best_attempt = NO_GUESS_MAX_ATTEMPTS;
+    search.failed = 0;
+    search.cancel = cancel;
+
+    ThreadBatch batch = { 0 };
+    for (int w = 0; w < worker_count; w++) {
+        workers[w].search = &search;
+        workers[w].first_attempt = w;
+        if (!threads || !threadpool_submit_batch(search_attempts, &workers[w], &batch, threads)) {
+            search_attempts(&workers[w]);
+        }
+    }
+    if (threads) {
+        threadpool_wait_batch(&batch, threads);
+    }
+    core_free(workers);
+
+    int attempt = atomic_int_load(&search.best_attempt);
+    if (attempt >= NO_GUESS_MAX_ATTEMPTS || atomic_int_load(&search.failed) || (cancel && atomic_int_load(cancel))) {
+        return -1;
+    }
+
+    // A board is a pure function of its seed and first click, so the winning candidate is simply generated again
+    uint64_t candidate = attempt_seed(seed, attempt);
+    attempt_start(candidate, rows, cols, start_row, start_col);
+    if (!generate_board(rows, cols, mines, candidate, *start_row, *start_col, board)) {
+        return -1;
+    }
+    return attempt;
+}
+
+/**
+ * \brief Generates the board of a slot, the job run by the thread pool.
+ * \param arg Pointer to the NoGuessSlot structure.
+ */
+static void fill_slot(void* arg) {
+    NoGuessSlot* slot = arg;
+    NoGuessPool* pool = slot->pool;
+    int size = slot->size;
+
+    int attempt = generate_no_guess_board(pool->rows[size], pool->cols[size], pool->mines[size], slot->seed, NULL, &pool->stopping, &slot->start_row, &slot->start_col, &slot->board);
+    atomic_int_store(&slot->state, attempt >= 0 ? SLOT_READY : SLOT_EMPTY);
+}
+
+/**
+ * \brief Starts a job for every empty slot.
+ * \param pool Pointer to the NoGuessPool structure.
+ */
+static void refill_pool(NoGuessPool* pool) {
+    if (!pool->threads || atomic_int_load(&pool->stopping)) {
+        return;
+    }
+
+    for (int size = 0; size < pool->size_count; size++) {
+        for (int i = 0; i < NO_GUESS_POOL_SIZE; i++) {
+            NoGuessSlot* slot = &pool->slots[size][i];
+            if (!atomic_int_compare_exchange(&slot->state, SLOT_EMPTY, SLOT_FILLING)) {
+                continue;
+            }
+            slot->seed = rng_next(&pool->rng);
+            if (!threadpool_submit_batch(fill_slot, slot, &pool->batch, pool->threads)) {
+                atomic_int_store(&slot->state, SLOT_EMPTY);
+            }
+        }
+    }
+}
+
+/**
+ * \brief Sets up an empty pool.
+ * \param seed Seed the seeds of the searches are drawn from.
+ * \param threads Workers generating the boards, NULL to keep no boards ready.
+ * \param pool Pointer to the NoGuessPool structure.
+ */
+void no_guess_pool_init(uint64_t seed, ThreadPool* threads, NoGuessPool* pool) {
+    memset(pool, 0, sizeof(NoGuessPool));
+    pool->threads = threads;
+    rng_seed(seed, &pool->rng);
+}
+
+/**
+ * \brief Adds a board size to a pool and starts generating its boards in the background.
+ * \param rows Number of rows of the boards.
+ * \param cols Number of columns of the boards.
+ * \param mines Number of mines of the boards.
+ * \param pool Pointer to the NoGuessPool structure.
+ * \return Index of the board size, passed to no_guess_pool_take, or -1 if the pool holds NO_GUESS_MAX_SIZES sizes already.
+ */
+int no_guess_pool_add(int rows, int cols, int mines, NoGuessPool* pool) {
+    if (pool->size_count == NO_GUESS_MAX_SIZES) {
+        return -1;
+    }
+
+    int size = pool->size_count++;
+    pool->rows[size] = rows;
+    pool->cols[size] = cols;
+    pool->mines[size] = mines;
+    for (int i = 0; i < NO_GUESS_POOL_SIZE; i++) {
+        pool->slots[size][i].size = size;
+        pool->slots[size][i].pool = pool;
+    }
+
+    refill_pool(pool);
+    return size;
+}
+
+/**
+ * \brief Takes a ready board, and starts generating the one replacing it.
+ * \param size Index of the board size.
+ * \param start_row Receives the row index of the first click.
+ * \param start_col Receives the column index of the first click.
+ * \param board Pointer to the Board structure receiving the board, with its mines placed and nothing revealed.
+ * \param pool Pointer to the NoGuessPool structure.
+ * \return true on success, false if no board of that size is ready yet.
+ */
+bool no_guess_pool_take(int size, int* start_row, int* start_col, Board* board, NoGuessPool* pool) {
+    bool taken = false;
+    for (int i = 0; i < NO_GUESS_POOL_SIZE && !taken; i++) {
+        NoGuessSlot* slot = &pool->slots[size][i];
+        if (atomic_int_compare_exchange(&slot->state, SLOT_READY, SLOT_FILLING)) { // Claimed, no job touches it meanwhile
+            *board = slot->board;
+            *start_row = slot->start_row;
+            *start_col = slot->start_col;
+            atomic_int_store(&slot->state, SLOT_EMPTY);
+            taken = true;
+        }
+    }
+
+    refill_pool(pool);
+    return taken;
+}
+
+/**
+ * \brief Stops the jobs of a pool and frees its ready boards.
+ * \param pool Pointer to the NoGuessPool structure.
+ */
+void no_guess_pool_destroy(NoGuessPool* pool) {
+    atomic_int_store(&pool->stopping, 1);
+    if (pool->threads) {
+        threadpool_wait_batch(&pool->batch, pool->threads);
+    }
+
+    for (int size = 0; size < pool->size_count; size++) {
+        for (int i = 0; i < NO_GUESS_POOL_SIZE; i++) {
+            if (atomic_int_load(&pool->slots[size][i].state) == SLOT_READY) {
+                free_board(&pool->slots[size][i].board);
+            }
+            atomic_int_store(&pool->slots[size][i].state, SLOT_EMPTY);
+        }
+    }
+    pool->size_count = 0;
+}
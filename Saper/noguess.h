@@ -0,0 +1,100 @@
+/*****************************************************************//**
+ * \file   noguess.h
+ * \brief  Generation of boards that can be finished from their first click by deduction alone.
+ *
+ * Candidates are generated from consecutive seeds and played by the solver, helped by the probability engine
+ * when the local rules are stuck, and the first one the deductions finish is kept. The first click is part of
+ * the board: it is drawn from the seed of the candidate and opened for the player when the game starts.
+ * A NoGuessPool keeps a few such boards ready per board size, filled in the background on a thread pool.
+ * The boards are classic ones, as the solver only deduces over 3x3 neighbourhoods.
+ *********************************************************************/
+
+#pragma once
+
+#include "atomics.h"
+#include "board.h"
+#include "probability.h"
+#include "rng.h"
+#include "solver.h"
+#include "threadpool.h"
+
+/**
+ * \def NO_GUESS_MAX_ATTEMPTS
+ * \brief Number of candidates tried before giving up, so that impossible densities do not search forever.
+ */
+#define NO_GUESS_MAX_ATTEMPTS 100000
+
+/**
+ * \def NO_GUESS_POOL_SIZE
+ * \brief Number of ready boards a NoGuessPool keeps per board size.
+ */
+#define NO_GUESS_POOL_SIZE 4
+
+/**
+ * \def NO_GUESS_MAX_SIZES
+ * \brief Number of board sizes a NoGuessPool can keep boards for.
+ */
+#define NO_GUESS_MAX_SIZES 4
+
+/**
+ * \typedef NoGuessChecker
+ * \brief Board, solver and probability engine used to play a candidate.
+ */
+typedef struct NoGuessChecker {
+    Board board; /**< The candidate being played. */
+    Solver solver; /**< Proves cells with the local rules. */
+    ProbabilityEngine engine; /**< Proves cells with the mine count when the solver is stuck. */
+} NoGuessChecker;
+
+/**
+ * \enum NoGuessSlotState
+ * \brief States of a slot of a NoGuessPool.
+ */
+enum NoGuessSlotState {
+    SLOT_EMPTY, /**< No board, and no job filling the slot. */
+    SLOT_FILLING, /**< A job of the thread pool is generating the board. */
+    SLOT_READY /**< The board is ready to be taken. */
+};
+
+/**
+ * \typedef NoGuessSlot
+ * \brief One pre-generated board of a NoGuessPool.
+ *
+ * The state changes with atomic operations only: the main thread moves an empty slot to filling and a ready
+ * one to empty, the job moves it from filling to ready or empty. The board belongs to whoever moved it last.
+ */
+typedef struct NoGuessSlot {
+    AtomicInt state; /**< One of NoGuessSlotState. */
+    Board board; /**< The ready board, mines placed and nothing revealed. */
+    int start_row; /**< Row of the first click of the board. */
+    int start_col; /**< Column of the first click of the board. */
+    uint64_t seed; /**< Seed the job starts its search from. */
+    int size; /**< Board size of the slot, an index in the sizes of the pool. */
+    struct NoGuessPool* pool; /**< Pool owning the slot. */
+} NoGuessSlot;
+
+/**
+ * \typedef NoGuessPool
+ * \brief Ready no-guess boards per board size, refilled in the background.
+ */
+typedef struct NoGuessPool {
+    ThreadPool* threads; /**< Workers generating the boards, NULL to keep no boards ready. */
+    Rng rng; /**< Seeds of the searches, only drawn on the thread owning the pool. */
+    int size_count; /**< Number of board sizes. */
+    int rows[NO_GUESS_MAX_SIZES]; /**< Number of rows of each board size. */
+    int cols[NO_GUESS_MAX_SIZES]; /**< Number of columns of each board size. */
+    int mines[NO_GUESS_MAX_SIZES]; /**< Number of mines of each board size. */
+    NoGuessSlot slots[NO_GUESS_MAX_SIZES][NO_GUESS_POOL_SIZE]; /**< Ready or pending boards of each board size. */
+    ThreadBatch batch; /**< Jobs filling the slots. */
+    AtomicInt stopping; /**< Set when the pool is destroyed, the running jobs give up. */
+} NoGuessPool;
+
+bool no_guess_checker_create(int rows, int cols, int mines, NoGuessChecker* checker);
+void no_guess_checker_destroy(NoGuessChecker* checker);
+bool is_no_guess_board(int start_row, int start_col, const Board* board, NoGuessChecker* checker);
+int generate_no_guess_board(int rows, int cols, int mines, uint64_t seed, ThreadPool* threads, AtomicInt* cancel, int* start_row, int* start_col, Board* board);
+
+void no_guess_pool_init(uint64_t seed, ThreadPool* threads, NoGuessPool* pool);
+int no_guess_pool_add(int rows, int cols, int mines, NoGuessPool* pool);
+bool no_guess_pool_take(int size, int* start_row, int* start_col, Board* board, NoGuessPool* pool);
+void no_guess_pool_destroy(NoGuessPool* pool);
@@ -0,0 +1,983 @@
+/*****************************************************************//**
+ * \file   probability.c
+ * \brief  Frontier decomposition, per-component backtracking and binomial combination of the solutions.
+ *********************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include "allocator.h"
+#include "probability.h"
+#include "rng.h"
+
+/**
+ * \def MIN_SAMPLES
+ * \brief Number of solutions a sampled component draws even when the time limit is already over.
+ */
+#define MIN_SAMPLES 16
+
+/**
+ * \typedef Search
+ * \brief Backtracking state of one component, owned by the thread enumerating it.
+ */
+typedef struct Search {
+    const ProbabilityVariable* vars; /**< Variables of the component. */
+    const ProbabilityConstraint* constraints; /**< Constraints of the component. */
+    int var_start; /**< Index of the first variable of the component, subtracted from the variables of a constraint. */
+    int constraint_start; /**< Index of the first constraint, subtracted from the constraints of a variable. */
+    int var_count; /**< Number of variables. */
+    int constraint_count; /**< Number of constraints. */
+    signed char* value; /**< Value of each variable: 1 for a mine, 0 for a safe cell, -1 while unassigned. */
+    unsigned char* tried; /**< Number of values already tried for each variable. */
+    unsigned char* first; /**< Value tried first for each variable. */
+    int* constraint_mines; /**< Mines assigned so far among the variables of each constraint. */
+    int* constraint_left; /**< Unassigned variables of each constraint. */
+    int mines; /**< Mines assigned so far. */
+    long long nodes; /**< Nodes visited by the current run. */
+    long long node_limit; /**< Nodes after which the current run gives up. */
+    double deadline; /**< Time after which the current run gives up. */
+} Search;
+
+/**
+ * \brief Returns the current time in seconds.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * \brief Grows a buffer so it holds at least the needed number of elements, keeping its content.
+ * \param buffer Pointer to the buffer pointer, NULL for a buffer never allocated.
+ * \param capacity Pointer to the number of elements the buffer holds.
+ * \param needed Number of elements needed.
+ * \param size Size of an element.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool grow_buffer(void** buffer, int* capacity, int needed, size_t size) {
+    if (needed <= *capacity)
+        return true;
+
+    int new_capacity = *capacity > 0 ? *capacity : 64;
+    while (new_capacity < needed)
+        new_capacity *= 2;
+
+    void* grown = core_malloc((size_t)new_capacity * size);
+    if (!grown)
+        return false;
+    if (*buffer) {
+        memcpy(grown, *buffer, (size_t)*capacity * size);
+        core_free(*buffer);
+    }
+    *buffer = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * \brief Returns the slot of the table holding a cell, or the free slot where it belongs.
+ */
+static int map_slot(int cell, const ProbabilityEngine* engine) {
+    unsigned int mask = (unsigned int)engine->map_capacity - 1;
+    unsigned int slot = ((unsigned int)cell * 2654435761u) & mask;
+    while (engine->map_keys[slot] >= 0 && engine->map_keys[slot] != cell) {
+        slot = (slot + 1) & mask;
+    }
+    return (int)slot;
+}
+
+/**
+ * \brief Empties the table, allocating it with the given number of slots if it is smaller.
+ * \param capacity Number of slots, a power of two.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool map_clear(int capacity, ProbabilityEngine* engine) {
+    if (capacity > engine->map_capacity) {
+        int* keys = core_malloc((size_t)capacity * sizeof(int));
+        int* values = core_malloc((size_t)capacity * sizeof(int));
+        if (!keys || !values) {
+            core_free(keys);
+            core_free(values);
+            return false;
+        }
+        core_free(engine->map_keys);
+        core_free(engine->map_values);
+        engine->map_keys = keys;
+        engine->map_values = values;
+        engine->map_capacity = capacity;
+    }
+    memset(engine->map_keys, 0xFF, (size_t)engine->map_capacity * sizeof(int));
+    return true;
+}
+
+/**
+ * \brief Returns the variable of a frontier cell, creating it on the first call for the cell.
+ * \param cell Index of the cell on the board.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return Index of the variable, or -1 if the memory could not be allocated.
+ */
+static int map_insert(int cell, ProbabilityEngine* engine) {
+    int slot = map_slot(cell, engine);
+    if (engine->map_keys[slot] == cell)
+        return engine->map_values[slot];
+
+    int id = engine->frontier_count;
+    if (id >= engine->vars_capacity) {
+        int capacity = engine->vars_capacity;
+        int cells_capacity = capacity;
+        int probability_capacity = capacity;
+        if (!grow_buffer((void**)&engine->vars, &capacity, id + 1, sizeof(ProbabilityVariable))
+            || !grow_buffer((void**)&engine->frontier_cells, &cells_capacity, id + 1, sizeof(int))
+            || !grow_buffer((void**)&engine->frontier_probability, &probability_capacity, id + 1, sizeof(double)))
+            return -1;
+        engine->vars_capacity = capacity;
+    }
+
+    // Keeping the table at most half full keeps the probes short
+    if ((id + 1) * 2 > engine->map_capacity) {
+        int old_capacity = engine->map_capacity;
+        int* old_keys = engine->map_keys;
+        int* old_values = engine->map_values;
+        engine->map_keys = NULL;
+        engine->map_values = NULL;
+        engine->map_capacity = 0;
+        if (!map_clear(old_capacity * 2, engine)) {
+            engine->map_keys = old_keys;
+            engine->map_values = old_values;
+            engine->map_capacity = old_capacity;
+            return -1;
+        }
+        for (int i = 0; i < old_capacity; i++) {
+            if (old_keys[i] >= 0) {
+                int moved = map_slot(old_keys[i], engine);
+                engine->map_keys[moved] = old_keys[i];
+                engine->map_values[moved] = old_values[i];
+            }
+        }
+        core_free(old_keys);
+        core_free(old_values);
+        slot = map_slot(cell, engine);
+    }
+
+    engine->map_keys[slot] = cell;
+    engine->map_values[slot] = id;
+    engine->vars[id].cell = cell;
+    engine->vars[id].constraint_count = 0;
+    engine->frontier_count++;
+    return id;
+}
+
+/**
+ * \brief Assigns a value to a variable if no constraint becomes impossible to satisfy.
+ * \param v Variable, relative to the component.
+ * \param value 1 for a mine, 0 for a safe cell.
+ * \param search Pointer to the Search structure.
+ * \return true if the value was assigned, false if it breaks a constraint.
+ */
+static bool assign_variable(int v, int value, Search* search) {
+    const ProbabilityVariable* var = &search->vars[v];
+    bool valid = true;
+
+    for (int i = 0; i < var->constraint_count; i++) {
+        int c = var->constraints[i] - search->constraint_start;
+        int mines = search->constraint_mines[c] += value;
+        int left = --search->constraint_left[c];
+        int required = search->constraints[c].required;
+        if (mines > required || mines + left < required)
+            valid = false;
+    }
+
+    if (!valid) {
+        for (int i = 0; i < var->constraint_count; i++) {
+            int c = var->constraints[i] - search->constraint_start;
+            search->constraint_mines[c] -= value;
+            search->constraint_left[c]++;
+        }
+        return false;
+    }
+
+    search->value[v] = (signed char)value;
+    search->mines += value;
+    return true;
+}
+
+/**
+ * \brief Removes the value of a variable.
+ * \param v Variable, relative to the component.
+ * \param search Pointer to the Search structure.
+ */
+static void unassign_variable(int v, Search* search) {
+    const ProbabilityVariable* var = &search->vars[v];
+    int value = search->value[v];
+
+    for (int i = 0; i < var->constraint_count; i++) {
+        int c = var->constraints[i] - search->constraint_start;
+        search->constraint_mines[c] -= value;
+        search->constraint_left[c]++;
+    }
+    search->value[v] = -1;
+    search->mines -= value;
+}
+
+/**
+ * \brief Backtracks over the variables in their breadth-first order, so constraints are closed early.
+ *
+ * Enumerating, it calls record for every solution and returns once all of them were found. Sampling, the value
+ * tried first is drawn at random for each variable and it returns at the first solution, leaving it assigned.
+ * \param rng Generator drawing the first values, NULL to enumerate.
+ * \param mine_threshold A variable is tried as a mine first when 64 random bits are below it.
+ * \param record Function called with every solution while enumerating.
+ * \param component Component passed to record.
+ * \param search Pointer to the Search structure.
+ * \return true if the enumeration finished or a sample was found, false if the budget ran out first.
+ */
+static bool run_search(Rng* rng, uint64_t mine_threshold, void (*record)(const Search*, ProbabilityComponent*), ProbabilityComponent* component, Search* search) {
+    int n = search->var_count;
+    memset(search->value, 0xFF, (size_t)n);
+    memset(search->constraint_mines, 0, (size_t)search->constraint_count * sizeof(int));
+    for (int c = 0; c < search->constraint_count; c++) {
+        search->constraint_left[c] = search->constraints[c].var_count;
+    }
+    search->mines = 0;
+    search->nodes = 0;
+
+    int depth = 0;
+    search->tried[0] = 0;
+    search->first[0] = rng ? rng_next(rng) < mine_threshold : 0;
+
+    while (depth >= 0) {
+        if (depth == n) {
+            if (!rng) {
+                record(search, component);
+                depth--;
+                continue;
+            }
+            return true;
+        }
+
+        if (search->value[depth] >= 0)
+            unassign_variable(depth, search);
+        if (search->tried[depth] == 2) {
+            depth--;
+            continue;
+        }
+
+        int value = search->first[depth] ^ search->tried[depth];
+        search->tried[depth]++;
+
+        if (++search->nodes > search->node_limit)
+            return false;
+        if ((search->nodes & 1023) == 0 && now_seconds() > search->deadline)
+            return false;
+
+        if (assign_variable(depth, value, search)) {
+            depth++;
+            if (depth < n) {
+                search->tried[depth] = 0;
+                search->first[depth] = rng ? rng_next(rng) < mine_threshold : 0;
+            }
+        }
+    }
+    return !rng;
+}
+
+/**
+ * \brief Counts an enumerated solution in the tables of its component.
+ * \param search Pointer to the Search structure holding the solution.
+ * \param component Pointer to the ProbabilityComponent structure.
+ */
+static void record_solution(const Search* search, ProbabilityComponent* component) {
+    int k = search->mines;
+    component->counts[k] += 1.0;
+    for (int v = 0; v < search->var_count; v++) {
+        if (search->value[v] > 0)
+            component->mine_counts[(size_t)v * component->k_width + k] += 1.0;
+    }
+}
+
+/**
+ * \brief Counts every solution of a small component.
+ * \param component Pointer to the ProbabilityComponent structure.
+ * \param search Pointer to the Search structure.
+ * \return true on success, false if the memory or the budget ran out.
+ */
+static bool enumerate_component(ProbabilityComponent* component, Search* search) {
+    int n = component->var_count;
+    component->k_min = 0;
+    component->k_width = n + 1;
+    component->counts = core_calloc((size_t)n + 1, sizeof(double));
+    component->mine_counts = core_calloc((size_t)n * (n + 1), sizeof(double));
+    if (!component->counts || !component->mine_counts)
+        return false;
+
+    search->node_limit = component->engine->node_limit;
+    search->deadline = component->engine->deadline;
+    bool finished = run_search(NULL, 0, record_solution, component, search);
+    component->nodes += search->nodes;
+    return finished;
+}
+
+/**
+ * \brief Approximates the solution counts of a component too large or too slow to enumerate by drawing random solutions.
+ *
+ * The solutions are found by backtracking with random value orders, which does not draw them exactly uniformly,
+ * so the counts are only an approximation.
+ * \param component Pointer to the ProbabilityComponent structure.
+ * \param search Pointer to the Search structure.
+ */
+static void sample_component(ProbabilityComponent* component, Search* search) {
+    const ProbabilityEngine* engine = component->engine;
+    int n = component->var_count;
+    int words = (n + 63) / 64;
+    int wanted = engine->sample_count > MIN_SAMPLES ? engine->sample_count : MIN_SAMPLES;
+
+    core_free(component->counts);
+    core_free(component->mine_counts);
+    component->counts = NULL;
+    component->mine_counts = NULL;
+    component->k_width = 0;
+
+    uint64_t* bits = core_calloc((size_t)wanted * words, sizeof(uint64_t));
+    int* mines = core_malloc((size_t)wanted * sizeof(int));
+    if (!bits || !mines) {
+        core_free(bits);
+        core_free(mines);
+        return;
+    }
+
+    // Each variable is tried as a mine first with the average density of the unknown cells
+    int unknown = engine->frontier_count + engine->interior_count;
+    double density = unknown > 0 ? (double)engine->mines_left / unknown : 0.0;
+    uint64_t mine_threshold = density <= 0.0 ? 0 : density >= 1.0 ? UINT64_MAX : (uint64_t)(density * 18446744073709551615.0);
+
+    Rng rng;
+    rng_seed((uint64_t)component->var_start * 0x9E3779B97F4A7C15ULL + (uint64_t)n, &rng);
+    search->node_limit = 64LL * n + 1024;
+    search->deadline = INFINITY;
+
+    int found = 0;
+    for (int attempt = 0; found < wanted && attempt < wanted * 4; attempt++) {
+        if (found >= MIN_SAMPLES && now_seconds() > engine->deadline)
+            break;
+
+        bool solved = run_search(&rng, mine_threshold, NULL, component, search);
+        component->nodes += search->nodes;
+        if (!solved)
+            continue;
+
+        uint64_t* sample = bits + (size_t)found * words;
+        for (int v = 0; v < n; v++) {
+            if (search->value[v] > 0)
+                sample[v / 64] |= 1ull << (v % 64);
+        }
+        mines[found++] = search->mines;
+    }
+
+    if (found > 0) {
+        int k_min = mines[0];
+        int k_max = mines[0];
+        for (int s = 1; s < found; s++) {
+            if (mines[s] < k_min)
+                k_min = mines[s];
+            if (mines[s] > k_max)
+                k_max = mines[s];
+        }
+
+        int width = k_max - k_min + 1;
+        component->counts = core_calloc((size_t)width, sizeof(double));
+        component->mine_counts = core_calloc((size_t)n * width, sizeof(double));
+        if (component->counts && component->mine_counts) {
+            component->k_min = k_min;
+            component->k_width = width;
+            for (int s = 0; s < found; s++) {
+                int k = mines[s] - k_min;
+                const uint64_t* sample = bits + (size_t)s * words;
+                component->counts[k] += 1.0;
+                for (int v = 0; v < n; v++) {
+                    if ((sample[v / 64] >> (v % 64)) & 1)
+                        component->mine_counts[(size_t)v * width + k] += 1.0;
+                }
+            }
+        }
+    }
+
+    core_free(bits);
+    core_free(mines);
+}
+
+/**
+ * \brief Counts the solutions of one component, the job run by the thread pool.
+ * \param arg Pointer to the ProbabilityComponent structure.
+ */
+static void solve_component(void* arg) {
+    ProbabilityComponent* component = arg;
+    const ProbabilityEngine* engine = component->engine;
+    int n = component->var_count;
+    int m = component->constraint_count;
+
+    Search search;
+    search.vars = engine->vars + component->var_start;
+    search.constraints = engine->constraints + component->constraint_start;
+    search.var_start = component->var_start;
+    search.constraint_start = component->constraint_start;
+    search.var_count = n;
+    search.constraint_count = m;
+
+    // One block holds the per-variable and per-constraint state of the search
+    size_t state_size = (size_t)m * 2 * sizeof(int) + (size_t)n * 3;
+    unsigned char* state = core_malloc(state_size);
+    if (!state)
+        return;
+    search.constraint_mines = (int*)state;
+    search.constraint_left = search.constraint_mines + m;
+    search.value = (signed char*)(search.constraint_left + m);
+    search.tried = (unsigned char*)search.value + n;
+    search.first = search.tried + n;
+
+    if (n <= PROBABILITY_MAX_EXACT_CELLS && enumerate_component(component, &search)) {
+        component->exact = true;
+    }
+    else {
+        sample_component(component, &search);
+    }
+
+    core_free(state);
+}
+
+/**
+ * \brief Reads the visible board into constraints, frontier variables and the counts of the other cells.
+ * \param board Pointer to the Board structure.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool read_frontier(const Board* board, ProbabilityEngine* engine) {
+    const unsigned char* knowledge = engine->knowledge;
+    int unknown_count = 0;
+    int mines_known = 0;
+
+    for (int row = 0; row < board->rows; row++) {
+        for (int col = 0; col < board->cols; col++) {
+            int index = row * board->cols + col;
+            unsigned char cell = board->cells[index];
+            unsigned char known = knowledge ? knowledge[index] : 0;
+
+            if (!(cell & CELL_REVEALED)) {
+                if ((cell & CELL_FLAGGED) || (known & SOLVER_MINE))
+                    mines_known++;
+                else if (!(known & SOLVER_SAFE))
+                    unknown_count++;
+                continue;
+            }
+            if ((cell & CELL_MINE) || !(cell & CELL_COUNT_MASK))
+                continue;
+
+            ProbabilityConstraint constraint;
+            constraint.var_count = 0;
+            constraint.required = cell & CELL_COUNT_MASK;
+
+            for (int r = row - 1; r <= row + 1; r++) {
+                if (r < 0 || r >= board->rows)
+                    continue;
+                for (int c = col - 1; c <= col + 1; c++) {
+                    if (c < 0 || c >= board->cols)
+                        continue;
+
+                    int neighbour = r * board->cols + c;
+                    unsigned char neighbour_cell = board->cells[neighbour];
+                    unsigned char neighbour_known = knowledge ? knowledge[neighbour] : 0;
+                    if ((neighbour_cell & CELL_REVEALED) || (neighbour_known & SOLVER_SAFE))
+                        continue;
+                    if ((neighbour_cell & CELL_FLAGGED) || (neighbour_known & SOLVER_MINE)) {
+                        constraint.required--;
+                        continue;
+                    }
+
+                    int id = map_insert(neighbour, engine);
+                    if (id < 0)
+                        return false;
+                    constraint.vars[constraint.var_count++] = id;
+                }
+            }
+
+            if (constraint.var_count == 0)
+                continue;
+            if (!grow_buffer((void**)&engine->constraints, &engine->constraints_capacity, engine->constraint_count + 1, sizeof(ProbabilityConstraint)))
+                return false;
+            engine->constraints[engine->constraint_count++] = constraint;
+        }
+    }
+
+    engine->mines_left = board->mines - mines_known;
+    engine->interior_count = unknown_count - engine->frontier_count;
+
+    for (int c = 0; c < engine->constraint_count; c++) {
+        const ProbabilityConstraint* constraint = &engine->constraints[c];
+        for (int i = 0; i < constraint->var_count; i++) {
+            ProbabilityVariable* var = &engine->vars[constraint->vars[i]];
+            var->constraints[var->constraint_count++] = c;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Splits the frontier into components with a breadth-first search and renumbers the variables and constraints
+ * so that each component owns consecutive ranges of both.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool split_components(ProbabilityEngine* engine) {
+    int var_count = engine->frontier_count;
+    int constraint_count = engine->constraint_count;
+    if (var_count == 0) { // Only interior cells are left, the buffers may not even exist yet
+        engine->component_count = 0;
+        return true;
+    }
+
+    int* order = core_malloc(((size_t)var_count * 2 + (size_t)constraint_count * 2 + 1) * sizeof(int));
+    ProbabilityVariable* old_vars = core_malloc((size_t)var_count * sizeof(ProbabilityVariable) + 1);
+    ProbabilityConstraint* old_constraints = core_malloc((size_t)constraint_count * sizeof(ProbabilityConstraint) + 1);
+    if (!order || !old_vars || !old_constraints) {
+        core_free(order);
+        core_free(old_vars);
+        core_free(old_constraints);
+        return false;
+    }
+    int* var_order = order;
+    int* var_new = var_order + var_count;
+    int* constraint_order = var_new + var_count;
+    int* constraint_new = constraint_order + constraint_count;
+    memset(var_new, 0xFF, (size_t)var_count * sizeof(int));
+    memset(constraint_new, 0xFF, (size_t)constraint_count * sizeof(int));
+
+    int next_var = 0;
+    int next_constraint = 0;
+    engine->component_count = 0;
+
+    for (int start = 0; start < var_count; start++) {
+        if (var_new[start] >= 0)
+            continue;
+
+        if (!grow_buffer((void**)&engine->components, &engine->components_capacity, engine->component_count + 1, sizeof(ProbabilityComponent))) {
+            core_free(order);
+            core_free(old_vars);
+            core_free(old_constraints);
+            return false;
+        }
+        ProbabilityComponent* component = &engine->components[engine->component_count++];
+        memset(component, 0, sizeof(ProbabilityComponent));
+        component->var_start = next_var;
+        component->constraint_start = next_constraint;
+        component->engine = engine;
+
+        var_new[start] = next_var;
+        var_order[next_var++] = start;
+        for (int head = component->var_start; head < next_var; head++) {
+            const ProbabilityVariable* var = &engine->vars[var_order[head]];
+            for (int i = 0; i < var->constraint_count; i++) {
+                int c = var->constraints[i];
+                if (constraint_new[c] >= 0)
+                    continue;
+                constraint_new[c] = next_constraint;
+                constraint_order[next_constraint++] = c;
+
+                const ProbabilityConstraint* constraint = &engine->constraints[c];
+                for (int j = 0; j < constraint->var_count; j++) {
+                    int v = constraint->vars[j];
+                    if (var_new[v] < 0) {
+                        var_new[v] = next_var;
+                        var_order[next_var++] = v;
+                    }
+                }
+            }
+        }
+
+        component->var_count = next_var - component->var_start;
+        component->constraint_count = next_constraint - component->constraint_start;
+    }
+
+    // Renumbering
+    memcpy(old_vars, engine->vars, (size_t)var_count * sizeof(ProbabilityVariable));
+    memcpy(old_constraints, engine->constraints, (size_t)constraint_count * sizeof(ProbabilityConstraint));
+    for (int v = 0; v < var_count; v++) {
+        ProbabilityVariable* var = &engine->vars[v];
+        *var = old_vars[var_order[v]];
+        for (int i = 0; i < var->constraint_count; i++)
+            var->constraints[i] = constraint_new[var->constraints[i]];
+        engine->frontier_cells[v] = var->cell;
+    }
+    for (int c = 0; c < constraint_count; c++) {
+        ProbabilityConstraint* constraint = &engine->constraints[c];
+        *constraint = old_constraints[constraint_order[c]];
+        for (int i = 0; i < constraint->var_count; i++)
+            constraint->vars[i] = var_new[constraint->vars[i]];
+    }
+    for (int slot = 0; slot < engine->map_capacity; slot++) {
+        if (engine->map_keys[slot] >= 0)
+            engine->map_values[slot] = var_new[engine->map_values[slot]];
+    }
+    //
+
+    core_free(order);
+    core_free(old_vars);
+    core_free(old_constraints);
+    return true;
+}
+
+/**
+ * \brief Sets the probability of every variable of a component from the weight of each of its mine counts.
+ * \param component Pointer to the ProbabilityComponent structure.
+ * \param weights Weight of the solutions using k_min + i mines, for i below k_width.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return false if no solution has a weight, which means the flags or the mine count are wrong.
+ */
+static bool apply_weights(const ProbabilityComponent* component, const double* weights, ProbabilityEngine* engine) {
+    double total = 0.0;
+    for (int i = 0; i < component->k_width; i++)
+        total += component->counts[i] * weights[i];
+    if (!(total > 0.0))
+        return false;
+
+    for (int v = 0; v < component->var_count; v++) {
+        const double* mine_counts = component->mine_counts + (size_t)v * component->k_width;
+        double mine_total = 0.0;
+        for (int i = 0; i < component->k_width; i++)
+            mine_total += mine_counts[i] * weights[i];
+        engine->frontier_probability[component->var_start + v] = mine_total / total;
+    }
+    return true;
+}
+
+/**
+ * \brief Scales an array so that its largest value is 1, which keeps long products of counts in range.
+ */
+static void normalize(double* values, int count) {
+    double max = 0.0;
+    for (int i = 0; i < count; i++) {
+        if (values[i] > max)
+            max = values[i];
+    }
+    if (max > 0.0) {
+        for (int i = 0; i < count; i++)
+            values[i] /= max;
+    }
+}
+
+/**
+ * \brief Combines the components exactly.
+ *
+ * With M mines left and I interior cells, a choice of k_c mines in every component c has the weight of the
+ * product of its solution counts times C(I, M - sum k_c). A backward pass stores, for every component, the weight
+ * of the components after it and of the interior as a function of the mines left for them, and a forward pass
+ * convolves the components before it, so each component costs time proportional to its width times the frontier.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return true on success, false if the memory could not be allocated or no solution is possible.
+ */
+static bool combine_exact(ProbabilityEngine* engine) {
+    int m = engine->mines_left;
+    int interior = engine->interior_count;
+    int count = engine->component_count;
+
+    double* weights = core_malloc(((size_t)count + 1) * (m + 1) * sizeof(double));
+    double* prefix = core_calloc((size_t)engine->frontier_count + 1, sizeof(double));
+    double* next_prefix = core_calloc((size_t)engine->frontier_count + 1, sizeof(double));
+    double* component_weights = core_malloc(((size_t)engine->frontier_count + 1) * sizeof(double));
+    if (!weights || !prefix || !next_prefix || !component_weights) {
+        core_free(weights);
+        core_free(prefix);
+        core_free(next_prefix);
+        core_free(component_weights);
+        return false;
+    }
+
+    // Interior weights C(I, j) for j mines in the interior, in logarithms to stay in range
+    // Built from C(I, j) = C(I, j - 1) * (I - j + 1) / j rather than lgamma, which writes the global signgam and races between engines
+    double* interior_weights = weights + (size_t)count * (m + 1);
+    double log_max = -INFINITY;
+    double log_binomial = 0.0;
+    for (int j = 0; j <= m; j++) {
+        if (j > 0 && j <= interior)
+            log_binomial += log((double)(interior - j + 1) / j);
+        double log_weight = j <= interior ? log_binomial : -INFINITY;
+        interior_weights[j] = log_weight;
+        if (log_weight > log_max)
+            log_max = log_weight;
+    }
+    for (int j = 0; j <= m; j++)
+        interior_weights[j] = exp(interior_weights[j] - log_max);
+    //
+
+    // Backward pass: after[c][j] is the weight of the components after c and of the interior holding j mines
+    for (int c = count - 1; c >= 0; c--) {
+        double* after = weights + (size_t)c * (m + 1);
+        if (c == count - 1) {
+            memcpy(after, interior_weights, ((size_t)m + 1) * sizeof(double));
+            continue;
+        }
+
+        const ProbabilityComponent* next = &engine->components[c + 1];
+        const double* later = weights + (size_t)(c + 1) * (m + 1);
+        for (int j = 0; j <= m; j++) {
+            double sum = 0.0;
+            for (int i = 0; i < next->k_width; i++) {
+                int rest = j - next->k_min - i;
+                if (rest >= 0)
+                    sum += next->counts[i] * later[rest];
+            }
+            after[j] = sum;
+        }
+        normalize(after, m + 1);
+    }
+    //
+
+    // Forward pass: prefix[t] is the weight of the components before c holding base + t mines
+    bool valid = true;
+    int base = 0;
+    int prefix_length = 1;
+    prefix[0] = 1.0;
+    for (int c = 0; c < count; c++) {
+        const ProbabilityComponent* component = &engine->components[c];
+        const double* after = weights + (size_t)c * (m + 1);
+
+        for (int i = 0; i < component->k_width; i++) {
+            double sum = 0.0;
+            for (int t = 0; t < prefix_length; t++) {
+                int rest = m - base - t - component->k_min - i;
+                if (rest >= 0 && rest <= m)
+                    sum += prefix[t] * after[rest];
+            }
+            component_weights[i] = sum;
+        }
+        valid &= apply_weights(component, component_weights, engine);
+
+        int next_length = prefix_length + component->k_width - 1;
+        memset(next_prefix, 0, (size_t)next_length * sizeof(double));
+        for (int t = 0; t < prefix_length; t++) {
+            for (int i = 0; i < component->k_width; i++)
+                next_prefix[t + i] += prefix[t] * component->counts[i];
+        }
+        normalize(next_prefix, next_length);
+
+        double* swap = prefix;
+        prefix = next_prefix;
+        next_prefix = swap;
+        prefix_length = next_length;
+        base += component->k_min;
+    }
+    //
+
+    // Interior cells share the mines the frontier leaves
+    if (interior > 0) {
+        double total = 0.0;
+        double mine_total = 0.0;
+        for (int t = 0; t < prefix_length; t++) {
+            int rest = m - base - t;
+            if (rest < 0 || rest > m)
+                continue;
+            double weight = prefix[t] * interior_weights[rest];
+            total += weight;
+            mine_total += weight * rest / interior;
+        }
+        if (total > 0.0)
+            engine->interior_probability = mine_total / total;
+        else
+            valid = false;
+    }
+    //
+
+    core_free(weights);
+    core_free(prefix);
+    core_free(next_prefix);
+    core_free(component_weights);
+    return valid;
+}
+
+/**
+ * \brief Combines the components as if every unknown cell held a mine independently with the average density,
+ * used when the exact combination would need too much memory.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return true on success, false if the memory could not be allocated or no solution is possible.
+ */
+static bool combine_independent(ProbabilityEngine* engine) {
+    int unknown = engine->frontier_count + engine->interior_count;
+    double density = unknown > 0 ? (double)engine->mines_left / unknown : 0.0;
+    if (density < 1e-9)
+        density = 1e-9;
+    if (density > 1.0 - 1e-9)
+        density = 1.0 - 1e-9;
+    double log_ratio = log(density / (1.0 - density));
+
+    double* component_weights = core_malloc(((size_t)engine->frontier_count + 1) * sizeof(double));
+    if (!component_weights)
+        return false;
+
+    bool valid = true;
+    for (int c = 0; c < engine->component_count; c++) {
+        const ProbabilityComponent* component = &engine->components[c];
+        double log_max = log_ratio > 0.0 ? (component->k_width - 1) * log_ratio : 0.0;
+        for (int i = 0; i < component->k_width; i++)
+            component_weights[i] = exp(i * log_ratio - log_max);
+        valid &= apply_weights(component, component_weights, engine);
+    }
+    engine->interior_probability = density;
+
+    core_free(component_weights);
+    return valid;
+}
+
+/**
+ * \brief Sets up an engine with the default budget: 50 ms, one million nodes per component and 1000 samples.
+ * \param pool Workers enumerating the components, NULL to enumerate on the calling thread.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ */
+void probability_init(ThreadPool* pool, ProbabilityEngine* engine) {
+    memset(engine, 0, sizeof(ProbabilityEngine));
+    engine->pool = pool;
+    engine->time_limit = 0.05;
+    engine->node_limit = 1000000;
+    engine->sample_count = 1000;
+}
+
+/**
+ * \brief Frees the buffers of an engine.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ */
+void probability_destroy(ProbabilityEngine* engine) {
+    core_free(engine->frontier_cells);
+    core_free(engine->frontier_probability);
+    core_free(engine->vars);
+    core_free(engine->constraints);
+    core_free(engine->components);
+    core_free(engine->map_keys);
+    core_free(engine->map_values);
+    probability_init(engine->pool, engine);
+}
+
+/**
+ * \brief Computes the mine probability of every hidden cell of a board.
+ *
+ * Only the visible state is read: revealed numbers, flags, which are trusted, and the total mine count.
+ * The results stay valid until the board or the solver changes.
+ * \param board Pointer to the Board structure.
+ * \param solver Solver whose proofs are used to shrink the frontier, NULL to start from the board alone.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return true on success, false if the memory could not be allocated or the flags allow no solution.
+ */
+bool probability_compute(const Board* board, const Solver* solver, ProbabilityEngine* engine) {
+    engine->deadline = now_seconds() + engine->time_limit;
+    engine->knowledge = solver ? solver->knowledge : NULL;
+    engine->exact = true;
+    engine->frontier_count = 0;
+    engine->constraint_count = 0;
+    engine->component_count = 0;
+    engine->interior_probability = 0.0;
+
+    if (!map_clear(engine->map_capacity > 0 ? engine->map_capacity : 1024, engine)
+        || !read_frontier(board, engine)
+        || !split_components(engine))
+        return false;
+
+    // Components are independent, the larger ones go to the pool and the tiny ones are counted right away
+    ThreadBatch batch = { 0 };
+    bool parallel = engine->pool && engine->component_count > 1;
+    for (int c = 0; c < engine->component_count; c++) {
+        ProbabilityComponent* component = &engine->components[c];
+        if (!parallel || component->var_count <= 8 || !threadpool_submit_batch(solve_component, component, &batch, engine->pool))
+            solve_component(component);
+    }
+    if (parallel)
+        threadpool_wait_batch(&batch, engine->pool);
+    //
+
+    bool valid = true;
+    long long combine_values = ((long long)engine->component_count + 1) * ((long long)engine->mines_left + 1);
+    for (int c = 0; c < engine->component_count; c++) {
+        const ProbabilityComponent* component = &engine->components[c];
+        if (!component->exact)
+            engine->exact = false;
+        if (!component->counts || component->k_width == 0)
+            valid = false;
+    }
+
+    if (valid && engine->mines_left >= 0) {
+        if (combine_values <= PROBABILITY_MAX_COMBINE_VALUES) {
+            valid = combine_exact(engine);
+        }
+        else {
+            engine->exact = false;
+            valid = combine_independent(engine);
+        }
+    }
+    else {
+        valid = false;
+    }
+
+    for (int c = 0; c < engine->component_count; c++) {
+        core_free(engine->components[c].counts);
+        core_free(engine->components[c].mine_counts);
+        engine->components[c].counts = NULL;
+        engine->components[c].mine_counts = NULL;
+    }
+
+    if (!valid) {
+        engine->exact = false;
+    }
+    return valid;
+}
+
+/**
+ * \brief Returns the mine probability of a cell computed by the last probability_compute.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param board Pointer to the Board structure.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return Probability between 0 and 1, 0 for revealed cells and 1 for flagged ones.
+ */
+double probability_of_cell(int row, int col, const Board* board, const ProbabilityEngine* engine) {
+    int index = row * board->cols + col;
+    unsigned char cell = board->cells[index];
+    unsigned char known = engine->knowledge ? engine->knowledge[index] : 0;
+
+    if ((cell & CELL_REVEALED) || (known & SOLVER_SAFE))
+        return 0.0;
+    if ((cell & CELL_FLAGGED) || (known & SOLVER_MINE))
+        return 1.0;
+
+    int slot = map_slot(index, engine);
+    if (engine->map_keys[slot] == index)
+        return engine->frontier_probability[engine->map_values[slot]];
+    return engine->interior_probability;
+}
+
+/**
+ * \brief Finds the hidden cell least likely to hold a mine, the best guess when nothing can be proven.
+ * \param board Pointer to the Board structure.
+ * \param engine Pointer to the ProbabilityEngine structure.
+ * \return Index of the cell, or -1 if every cell is revealed or flagged.
+ */
+int probability_safest_cell(const Board* board, const ProbabilityEngine* engine) {
+    int best = -1;
+    double best_probability = 2.0;
+
+    // Frontier cells first, so an interior cell only wins when it is strictly safer
+    for (int v = 0; v < engine->frontier_count; v++) {
+        if (engine->frontier_probability[v] < best_probability) {
+            best_probability = engine->frontier_probability[v];
+            best = engine->frontier_cells[v];
+        }
+    }
+
+    int cell_count = board->rows * board->cols;
+    for (int i = 0; i < cell_count && best_probability > 0.0; i++) {
+        if (board->cells[i] & (CELL_REVEALED | CELL_FLAGGED))
+            continue;
+        double probability = probability_of_cell(i / board->cols, i % board->cols, board, engine);
+        if (probability < best_probability) {
+            best_probability = probability;
+            best = i;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,104 @@
+/*****************************************************************//**
+ * \file   probability.h
+ * \brief  Exact mine probabilities of the hidden cells, from the visible board and the total mine count.
+ *
+ * The frontier, the hidden cells next to a revealed number, is split into components that share no constraint.
+ * Each component is enumerated on its own with backtracking, counting its solutions by the number of mines they
+ * use, and the components are then combined with the binomial weight of the remaining mines spread over the
+ * unconstrained interior cells. Components run in parallel on a thread pool. A component that exceeds the node
+ * or time budget is sampled instead, and the result is then flagged as approximate. Like the solver, it only
+ * handles classic boards.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+#include "solver.h"
+#include "threadpool.h"
+
+/**
+ * \def PROBABILITY_MAX_EXACT_CELLS
+ * \brief Size of the largest component that is enumerated, larger ones are sampled directly.
+ */
+#define PROBABILITY_MAX_EXACT_CELLS 256
+
+/**
+ * \def PROBABILITY_MAX_COMBINE_VALUES
+ * \brief Number of weights the exact combination of the components may store, past it a fixed mine density is assumed.
+ */
+#define PROBABILITY_MAX_COMBINE_VALUES (8 * 1024 * 1024)
+
+/**
+ * \typedef ProbabilityConstraint
+ * \brief A revealed number and the frontier cells it covers.
+ */
+typedef struct ProbabilityConstraint {
+    int vars[8]; /**< Frontier variables among the neighbours. */
+    int var_count; /**< Number of variables in vars. */
+    int required; /**< Number of mines among the variables. */
+} ProbabilityConstraint;
+
+/**
+ * \typedef ProbabilityVariable
+ * \brief A frontier cell and the constraints covering it.
+ */
+typedef struct ProbabilityVariable {
+    int cell; /**< Index of the cell on the board. */
+    int constraints[8]; /**< Constraints covering the cell. */
+    int constraint_count; /**< Number of constraints in constraints. */
+} ProbabilityVariable;
+
+/**
+ * \typedef ProbabilityComponent
+ * \brief A set of frontier cells linked by constraints, and its solutions counted by their number of mines.
+ */
+typedef struct ProbabilityComponent {
+    int var_start; /**< First variable of the component, its variables are consecutive. */
+    int var_count; /**< Number of variables of the component. */
+    int constraint_start; /**< First constraint of the component, its constraints are consecutive. */
+    int constraint_count; /**< Number of constraints of the component. */
+    int k_min; /**< Smallest number of mines of a counted solution. */
+    int k_width; /**< Number of mine counts from k_min stored in counts. */
+    double* counts; /**< Number of solutions using k_min + i mines, for i below k_width. */
+    double* mine_counts; /**< Number of those solutions with a mine on each variable, k_width values per variable. */
+    bool exact; /**< Indicates if the solutions were enumerated rather than sampled. */
+    long long nodes; /**< Number of backtracking nodes visited. */
+    const struct ProbabilityEngine* engine; /**< Engine owning the component, read by the worker enumerating it. */
+} ProbabilityComponent;
+
+/**
+ * \typedef ProbabilityEngine
+ * \brief Settings, results and reusable buffers of the probability computation.
+ */
+typedef struct ProbabilityEngine {
+    ThreadPool* pool; /**< Workers enumerating the components, NULL to enumerate on the calling thread. */
+    double time_limit; /**< Seconds the enumeration may take, components still running afterwards are sampled. */
+    long long node_limit; /**< Backtracking nodes a component may visit before it is sampled. */
+    int sample_count; /**< Number of solutions drawn from a sampled component. */
+    bool exact; /**< Indicates if the last results are exact, false if a budget was exceeded. */
+    int mines_left; /**< Mines not flagged nor proven, spread over the frontier and the interior. */
+    int interior_count; /**< Number of hidden cells no number touches. */
+    double interior_probability; /**< Mine probability of each interior cell. */
+    int frontier_count; /**< Number of frontier cells. */
+    int* frontier_cells; /**< Board index of every frontier cell. */
+    double* frontier_probability; /**< Mine probability of every frontier cell. */
+    const unsigned char* knowledge; /**< Proofs of the solver used by the last computation, NULL if none was given. */
+    ProbabilityVariable* vars; /**< Frontier variables, grouped by component. */
+    int vars_capacity; /**< Number of variables the buffers hold before they grow. */
+    ProbabilityConstraint* constraints; /**< Constraints, grouped by component. */
+    int constraint_count; /**< Number of constraints. */
+    int constraints_capacity; /**< Number of constraints the buffer holds before it grows. */
+    ProbabilityComponent* components; /**< Independent components of the frontier. */
+    int component_count; /**< Number of components. */
+    int components_capacity; /**< Number of components the buffer holds before it grows. */
+    int* map_keys; /**< Open addressing table from board index to variable, -1 in free slots. */
+    int* map_values; /**< Variable of each used slot of map_keys. */
+    int map_capacity; /**< Number of slots of the table, a power of two. */
+    double deadline; /**< Time at which the running enumeration gives up. */
+} ProbabilityEngine;
+
+void probability_init(ThreadPool* pool, ProbabilityEngine* engine);
+void probability_destroy(ProbabilityEngine* engine);
+bool probability_compute(const Board* board, const Solver* solver, ProbabilityEngine* engine);
+double probability_of_cell(int row, int col, const Board* board, const ProbabilityEngine* engine);
+int probability_safest_cell(const Board* board, const ProbabilityEngine* engine);
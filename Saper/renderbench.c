@@ -0,0 +1,120 @@
+/*****************************************************************//**
+ * \file   renderbench.c
+ * \brief  Frame time comparison between redrawing every cell and blitting the cached board bitmap.
+ *********************************************************************/
+
+#include <stdio.h>
+#include "renderbench.h"
+#include "gameboard.h"
+#include "camera.h"
+
+/**
+ * \brief Draws one frame the way draw_board did before the board bitmap cache, every cell included.
+ * \param game Pointer to the Game structure.
+ */
+static void draw_full_frame(Game* game) {
+    al_clear_to_color(al_map_rgb(255, 255, 255));
+    draw_all_cells(game, game->start_x, game->start_y, false);
+    update_timer(game);
+    draw_mines_counter(game);
+    al_flip_display();
+}
+
+/**
+ * \brief Measures the average frame time of the drawing paths on one board.
+ *
+ * The full redraw is skipped on boards over a million cells, it would take seconds per frame.
+ * \param game Pointer to the Game structure.
+ * \param rows Number of rows in the board.
+ * \param cols Number of columns in the board.
+ * \param mines Number of mines in the board.
+ * \param frames Number of frames drawn by each path.
+ */
+static void measure_board(Game* game, int rows, int cols, int mines, int frames) {
+    if (!initialize_custom_game(rows, cols, mines, 1, game)) { // A fixed seed, every run draws the same boards
+        printf("%5dx%-5d  the board could not be allocated\n", rows, cols);
+        return;
+    }
+
+    // The top half of the visible area is revealed so that every kind of cell is drawn
+    reveal_cell(0, 0, &game->board);
+    int reveal_rows = rows / 2 < 200 ? rows / 2 : 200;
+    int reveal_cols = cols < 300 ? cols : 300;
+    for (int i = 0; i < reveal_rows && !game->board.game_over; i++) {
+        for (int j = 0; j < reveal_cols; j++) {
+            if (!cell_is_mine(&game->board, i, j)) {
+                reveal_cell(i, j, &game->board);
+            }
+            else {
+                toggle_flag(i, j, &game->board);
+            }
+        }
+    }
+
+    double begin = al_get_time();
+    create_board_bitmap(game);
+    double create_time = al_get_time() - begin;
+
+    double full_time = 0.0;
+    if ((long long)rows * cols <= 1000000) {
+        begin = al_get_time();
+        for (int f = 0; f < frames; f++) {
+            draw_full_frame(game);
+        }
+        full_time = (al_get_time() - begin) / frames;
+    }
+
+    begin = al_get_time();
+    for (int f = 0; f < frames; f++) {
+        draw_board(game);
+    }
+    double frame_time = (al_get_time() - begin) / frames;
+
+    // A single flag toggle per frame, the usual dirty update during play
+    begin = al_get_time();
+    for (int f = 0; f < frames; f++) {
+        int row = reveal_rows + f % 8;
+        int col = f % reveal_cols;
+        toggle_flag(row, col, &game->board);
+        int index = row * cols + col;
+        update_board_cells(game, &index, 1, false);
+        draw_board(game);
+    }
+    double dirty_time = (al_get_time() - begin) / frames;
+
+    // The most cells the camera can show at once
+    zoom_camera(MIN_ZOOM, game->start_x, game->start_y, game);
+    begin = al_get_time();
+    for (int f = 0; f < frames; f++) {
+        draw_board(game);
+    }
+    double zoomed_time = (al_get_time() - begin) / frames;
+
+    char full[32] = "-";
+    if (full_time > 0.0)
+        snprintf(full, sizeof(full), "%.3f ms", full_time * 1e3);
+
+    printf("%5dx%-5d  %-6s  bitmap build %8.3f ms  full redraw %12s  frame %7.3f ms  + 1 dirty cell %7.3f ms  min zoom %7.3f ms\n",
+        rows, cols, game->board_bitmap ? "cached" : "culled", create_time * 1e3, full, frame_time * 1e3, dirty_time * 1e3, zoomed_time * 1e3);
+
+    if (game->board_bitmap) {
+        al_destroy_bitmap(game->board_bitmap);
+        game->board_bitmap = NULL;
+    }
+    free_board(&game->board);
+}
+
+/**
+ * \brief Prints the average frame time of the drawing paths on a 16x16 board and on large custom boards.
+ *
+ * The 16x16 board is cached in a bitmap, the larger ones are drawn through the camera with culling,
+ * so their frame time should not grow with the size of the board.
+ * \param game Pointer to the Game structure.
+ */
+void run_render_benchmark(Game* game) {
+    printf("Average frame time, vsync disabled when the driver allows it\n");
+    measure_board(game, 16, 16, 40, 300);
+    measure_board(game, 200, 200, 6000, 30);
+    measure_board(game, 1000, 1000, 160000, 30);
+    measure_board(game, 10000, 10000, 16000000, 30);
+}
@@ -0,0 +1,10 @@
+/*****************************************************************//**
+ * \file   renderbench.h
+ * \brief  Frame time comparison between redrawing every cell and blitting the cached board bitmap.
+ *********************************************************************/
+
+#pragma once
+
+#include "game.h"
+
+void run_render_benchmark(Game* game);
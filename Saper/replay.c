@@ -0,0 +1,534 @@
+/*****************************************************************//**
+ * \file   replay.c
+ * \brief  Recording, appending and verifying replays.
+ *
+ * Header layout, every field little-endian:
+ *   0 magic "SAPERRPL", 8 version, 12 rows, 16 columns, 20 mines, 24 seed, 32 action count,
+ *   36 claimed time in milliseconds, 40 claimed outcome, in the low byte with the topology in the next one
+ *   since version 2, 44 size of the records in bytes.
+ * The magic and the size of the records are where they are in every version, so that the replays
+ * following one of another version can still be found.
+ *********************************************************************/
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "allocator.h"
+#include "mapfile.h"
+#include "replay.h"
+
+/**
+ * \def REPLAY_MAGIC
+ * \brief First bytes of every replay.
+ */
+#define REPLAY_MAGIC "SAPERRPL"
+
+/**
+ * \def REPLAY_MAX_RECORD_SIZE
+ * \brief Largest size of a record: a 32-bit and a 64-bit variable-length integer.
+ */
+#define REPLAY_MAX_RECORD_SIZE 15
+
+/**
+ * \def REPLAY_JOBS_PER_THREAD
+ * \brief Number of jobs a batch is split in per worker, so that workers given short replays help the others.
+ */
+#define REPLAY_JOBS_PER_THREAD 4
+
+/**
+ * \typedef ReplayJob
+ * \brief Consecutive replays of a batch verified by one job, on a board of its own.
+ */
+typedef struct ReplayJob {
+    ReplayBatch* batch; /**< The batch. */
+    int first; /**< Index of the first replay of the job. */
+    int count; /**< Number of replays of the job. */
+} ReplayJob;
+
+// Little-endian fields
+
+/**
+ * \brief Writes a 32-bit little-endian field.
+ */
+static void put_u32(unsigned char* data, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        data[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * \brief Writes a 64-bit little-endian field.
+ */
+static void put_u64(unsigned char* data, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        data[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * \brief Reads a 32-bit little-endian field.
+ */
+static uint32_t get_u32(const unsigned char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * \brief Reads a 64-bit little-endian field.
+ */
+static uint64_t get_u64(const unsigned char* data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+//
+
+// Variable-length integers, 7 bits per byte from the lowest, the high bit set on every byte but the last
+
+/**
+ * \brief Writes a variable-length integer.
+ * \param data Where to write, with room for 10 bytes.
+ * \param value The integer.
+ * \return Number of bytes written.
+ */
+static size_t put_varint(unsigned char* data, uint64_t value) {
+    size_t size = 0;
+    while (value >= 0x80) {
+        data[size++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    data[size++] = (unsigned char)value;
+    return size;
+}
+
+/**
+ * \brief Reads a variable-length integer.
+ * \param data Pointer to the next byte to read, moved past the integer.
+ * \param end End of the bytes that can be read.
+ * \param value Receives the integer.
+ * \return false if the integer runs past end or is longer than 64 bits.
+ */
+static bool get_varint(const unsigned char** data, const unsigned char* end, uint64_t* value) {
+    const unsigned char* p = *data;
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            return false;
+        }
+        unsigned char byte = *p++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *data = p;
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+
+// Recording
+
+/**
+ * \brief Makes room for more bytes at the end of a recorder, doubling its buffer when it is full.
+ * \param extra Number of bytes needed after the ones used.
+ * \param recorder Pointer to the ReplayRecorder structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool reserve_replay(size_t extra, ReplayRecorder* recorder) {
+    if (recorder->size + extra <= recorder->capacity) {
+        return true;
+    }
+
+    size_t capacity = recorder->capacity > 0 ? recorder->capacity : 4096;
+    while (capacity < recorder->size + extra) {
+        capacity *= 2;
+    }
+
+    unsigned char* data = core_malloc(capacity);
+    if (!data) {
+        return false;
+    }
+    if (recorder->data) {
+        memcpy(data, recorder->data, recorder->size);
+        core_free(recorder->data);
+    }
+    recorder->data = data;
+    recorder->capacity = capacity;
+    return true;
+}
+
+/**
+ * \brief Starts recording the game of a board, before its first reveal. The buffer of the last game is reused.
+ * \param board Pointer to the Board structure of the game, nothing revealed yet.
+ * \param recorder Pointer to the ReplayRecorder structure, zeroed before its first use.
+ */
+void replay_begin(const Board* board, ReplayRecorder* recorder) {
+    recorder->size = 0;
+    recorder->active = reserve_replay(REPLAY_HEADER_SIZE, recorder); // Without memory the game is not recorded
+    recorder->size = REPLAY_HEADER_SIZE; // Filled by replay_append
+    recorder->rows = board->rows;
+    recorder->cols = board->cols;
+    recorder->mines = board->mines;
+    recorder->seed = board->seed;
+    recorder->topology = board->topology;
+    recorder->action_count = 0;
+    recorder->last_time = 0;
+    recorder->last_index = 0;
+}
+
+/**
+ * \brief Records an action, in memory.
+ * \param time Time of the action in milliseconds since the game started, raised to the time of the last action if it is earlier.
+ * \param action The action.
+ * \param row The row index of the cell.
+ * \param col The column index of the cell.
+ * \param recorder Pointer to the ReplayRecorder structure.
+ * \return false if the game is not recorded, or no longer is because the memory ran out.
+ */
+bool replay_record(uint32_t time, enum ReplayAction action, int row, int col, ReplayRecorder* recorder) {
+    if (!recorder->active) {
+        return false;
+    }
+    if (!reserve_replay(REPLAY_MAX_RECORD_SIZE, recorder)) {
+        recorder->active = false;
+        return false;
+    }
+
+    if (time < recorder->last_time) {
+        time = recorder->last_time;
+    }
+    int index = row * recorder->cols + col;
+    int64_t distance = (int64_t)index - recorder->last_index;
+    uint64_t zigzag = ((uint64_t)distance << 1) ^ (uint64_t)(distance >> 63); // Small distances of either sign stay small
+
+    recorder->size += put_varint(recorder->data + recorder->size, time - recorder->last_time);
+    recorder->size += put_varint(recorder->data + recorder->size, (zigzag << 1) | (uint64_t)action);
+    recorder->action_count++;
+    recorder->last_time = time;
+    recorder->last_index = index;
+    return true;
+}
+
+/**
+ * \brief Ends the recording and appends the replay to a file, with a single write.
+ *
+ * The claimed time is the time of the last action. Games without actions are not written.
+ * \param path Path of the file, created if it does not exist.
+ * \param outcome Result of the game.
+ * \param recorder Pointer to the ReplayRecorder structure, inactive afterwards.
+ * \return true if the replay was written.
+ */
+bool replay_append(const char* path, enum ReplayOutcome outcome, ReplayRecorder* recorder) {
+    if (!recorder->active || recorder->action_count == 0) {
+        recorder->active = false;
+        return false;
+    }
+    recorder->active = false;
+
+    unsigned char* header = recorder->data;
+    memcpy(header, REPLAY_MAGIC, 8);
+    put_u32(header + 8, REPLAY_VERSION);
+    put_u32(header + 12, (uint32_t)recorder->rows);
+    put_u32(header + 16, (uint32_t)recorder->cols);
+    put_u32(header + 20, (uint32_t)recorder->mines);
+    put_u64(header + 24, recorder->seed);
+    put_u32(header + 32, (uint32_t)recorder->action_count);
+    put_u32(header + 36, recorder->last_time);
+    put_u32(header + 40, (uint32_t)outcome | (uint32_t)recorder->topology << 8);
+    put_u32(header + 44, (uint32_t)(recorder->size - REPLAY_HEADER_SIZE));
+
+    FILE* output = fopen(path, "ab");
+    bool written = output && fwrite(recorder->data, 1, recorder->size, output) == recorder->size;
+    if (output && fclose(output) != 0) {
+        written = false;
+    }
+    return written;
+}
+
+/**
+ * \brief Frees the buffer of a recorder.
+ * \param recorder Pointer to the ReplayRecorder structure.
+ */
+void replay_free(ReplayRecorder* recorder) {
+    core_free(recorder->data);
+    recorder->data = NULL;
+    recorder->size = 0;
+    recorder->capacity = 0;
+    recorder->active = false;
+}
+
+//
+
+// Verification
+
+/**
+ * \brief Replays the actions of a replay on a new board and checks that they end as claimed.
+ *
+ * The board of the last replay is cleared and reused when the size is the same, so verifying many replays
+ * of the same preset allocates nothing.
+ * \param data The replay, starting with its header.
+ * \param size Size of the replay in bytes, header included.
+ * \param board Pointer to the Board structure played on, its cells NULL before the first replay. Freed by the caller.
+ * \param info Receives the header of the replay.
+ * \return REPLAY_VERIFIED, or why the replay was rejected.
+ */
+enum ReplayStatus verify_replay(const unsigned char* data, size_t size, Board* board, ReplayInfo* info) {
+    if (size < REPLAY_HEADER_SIZE || memcmp(data, REPLAY_MAGIC, 8) != 0) {
+        return REPLAY_CORRUPT;
+    }
+    uint32_t version = get_u32(data + 8);
+    if (version != REPLAY_VERSION && version != 1) {
+        return REPLAY_BAD_VERSION;
+    }
+
+    // Header
+    uint32_t rows = get_u32(data + 12);
+    uint32_t cols = get_u32(data + 16);
+    uint32_t mines = get_u32(data + 20);
+    uint32_t action_count = get_u32(data + 32);
+    uint32_t outcome = version == 1 ? get_u32(data + 40) : get_u32(data + 40) & 0xFF; // Version 1 games are classic
+    uint32_t topology = version == 1 ? TOPOLOGY_CLASSIC : get_u32(data + 40) >> 8;
+    long long cell_count = (long long)rows * cols;
+    if (rows == 0 || cols == 0 || cell_count > INT_MAX || mines >= cell_count || action_count > INT_MAX
+        || outcome > REPLAY_WON || topology >= TOPOLOGY_COUNT || get_u32(data + 44) != size - REPLAY_HEADER_SIZE) {
+        return REPLAY_CORRUPT;
+    }
+
+    info->rows = (int)rows;
+    info->cols = (int)cols;
+    info->mines = (int)mines;
+    info->seed = get_u64(data + 24);
+    info->action_count = (int)action_count;
+    info->time = get_u32(data + 36);
+    info->outcome = (enum ReplayOutcome)outcome;
+    info->topology = (int)topology;
+    //
+
+    // Board of the last replay, or a new one
+    if (board->cells && !board->mapping && board->rows == info->rows && board->cols == info->cols) {
+        reset_board(info->mines, info->seed, board);
+    }
+    else {
+        free_board(board);
+        if (!initialize_board(info->rows, info->cols, info->mines, info->seed, board)) {
+            return REPLAY_NO_MEMORY;
+        }
+    }
+    if (!set_board_topology((enum Topology)info->topology, board)) {
+        return REPLAY_CORRUPT;
+    }
+    //
+
+    // Actions
+    const unsigned char* p = data + REPLAY_HEADER_SIZE;
+    const unsigned char* end = data + size;
+    uint64_t time = 0;
+    int64_t index = 0;
+    for (uint32_t a = 0; a < action_count; a++) {
+        uint64_t delay, record;
+        if (!get_varint(&p, end, &delay) || !get_varint(&p, end, &record)) {
+            return REPLAY_CORRUPT;
+        }
+
+        time += delay;
+        uint64_t zigzag = record >> 1;
+        index += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        if (time > UINT32_MAX || index < 0 || index >= cell_count) {
+            return REPLAY_CORRUPT;
+        }
+        if (board->game_over || board->game_won) { // Nothing can be played after the end
+            return REPLAY_MISMATCH;
+        }
+
+        int row = (int)(index / info->cols);
+        int col = (int)(index % info->cols);
+        if (record & 1)
+            toggle_flag(row, col, board);
+        else
+            reveal_cell(row, col, board);
+    }
+    if (p != end) {
+        return REPLAY_CORRUPT;
+    }
+    //
+
+    enum ReplayOutcome result = board->game_won ? REPLAY_WON : board->game_over ? REPLAY_LOST : REPLAY_UNFINISHED;
+    return result == info->outcome && time == info->time ? REPLAY_VERIFIED : REPLAY_MISMATCH;
+}
+
+/**
+ * \brief Sets up an empty batch.
+ * \param batch Pointer to the ReplayBatch structure.
+ */
+void replay_batch_init(ReplayBatch* batch) {
+    memset(batch, 0, sizeof(*batch));
+}
+
+/**
+ * \brief Grows an array of a batch to hold at least one more element.
+ * \param array Pointer to the array, replaced by a larger copy when it is full.
+ * \param capacity Pointer to the number of elements the array can hold, updated.
+ * \param count Number of elements in the array.
+ * \param size Size of an element.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool grow_batch_array(void** array, int* capacity, int count, size_t size) {
+    if (count < *capacity) {
+        return true;
+    }
+
+    int new_capacity = *capacity > 0 ? *capacity * 2 : 16;
+    void* grown = core_malloc((size_t)new_capacity * size);
+    if (!grown) {
+        return false;
+    }
+    if (*array) {
+        memcpy(grown, *array, (size_t)count * size);
+        core_free(*array);
+    }
+    *array = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * \brief Maps a replay file and adds its replays to a batch, without verifying them yet.
+ *
+ * Replays are found from their headers. When one is truncated or its header is damaged, the rest of the
+ * file is added as a single corrupt replay.
+ * \param path Path of the file.
+ * \param batch Pointer to the ReplayBatch structure.
+ * \return false if the file could not be mapped or the memory ran out.
+ */
+bool replay_batch_add_file(const char* path, ReplayBatch* batch) {
+    int file_capacity = batch->file_capacity;
+    if (!grow_batch_array((void**)&batch->files, &file_capacity, batch->file_count, sizeof(void*))
+        || !grow_batch_array((void**)&batch->file_sizes, &batch->file_capacity, batch->file_count, sizeof(size_t))) {
+        return false;
+    }
+
+    size_t size;
+    unsigned char* file = map_file(path, &size);
+    if (!file) {
+        return false;
+    }
+    int file_index = batch->file_count++;
+    batch->files[file_index] = file;
+    batch->file_sizes[file_index] = size;
+
+    size_t offset = 0;
+    while (offset < size) {
+        if (!grow_batch_array((void**)&batch->checks, &batch->check_capacity, batch->check_count, sizeof(ReplayCheck))) {
+            return false;
+        }
+
+        size_t remaining = size - offset;
+        size_t replay_size = remaining;
+        if (remaining >= REPLAY_HEADER_SIZE && memcmp(file + offset, REPLAY_MAGIC, 8) == 0
+            && get_u32(file + offset + 44) <= remaining - REPLAY_HEADER_SIZE) {
+            replay_size = REPLAY_HEADER_SIZE + get_u32(file + offset + 44);
+        }
+
+        ReplayCheck* check = &batch->checks[batch->check_count++];
+        check->data = file + offset;
+        check->size = replay_size;
+        check->file = file_index;
+        check->status = REPLAY_CORRUPT;
+        offset += replay_size;
+    }
+    return true;
+}
+
+/**
+ * \brief Verifies the replays of a job, the function run by a worker.
+ * \param arg Pointer to the ReplayJob structure.
+ */
+static void verify_replay_job(void* arg) {
+    ReplayJob* job = arg;
+    Board board;
+    board.cells = NULL;
+    board.opened = NULL;
+    board.mapping = NULL;
+
+    for (int i = job->first; i < job->first + job->count; i++) {
+        ReplayCheck* check = &job->batch->checks[i];
+        check->status = verify_replay(check->data, check->size, &board, &check->info);
+    }
+    free_board(&board);
+}
+
+/**
+ * \brief Verifies every replay of a batch, split in runs of consecutive replays spread over a thread pool.
+ * \param threads Workers verifying the replays, NULL to verify them on the calling thread, which must not be one of them.
+ * \param batch Pointer to the ReplayBatch structure, the status of every replay is set.
+ */
+void replay_batch_verify(ThreadPool* threads, ReplayBatch* batch) {
+    int job_count = threads ? threads->thread_count * REPLAY_JOBS_PER_THREAD : 1;
+    if (job_count > batch->check_count) {
+        job_count = batch->check_count;
+    }
+    if (job_count == 0) {
+        return;
+    }
+
+    ReplayJob* jobs = core_malloc((size_t)job_count * sizeof(ReplayJob));
+    if (!jobs) { // Verified on this thread as a single job
+        ReplayJob job = { batch, 0, batch->check_count };
+        verify_replay_job(&job);
+        return;
+    }
+
+    ThreadBatch thread_batch = { 0 };
+    for (int j = 0; j < job_count; j++) {
+        jobs[j].batch = batch;
+        jobs[j].first = (int)((long long)batch->check_count * j / job_count);
+        jobs[j].count = (int)((long long)batch->check_count * (j + 1) / job_count) - jobs[j].first;
+        if (!threads || !threadpool_submit_batch(verify_replay_job, &jobs[j], &thread_batch, threads)) {
+            verify_replay_job(&jobs[j]);
+        }
+    }
+    if (threads) {
+        threadpool_wait_batch(&thread_batch, threads);
+    }
+    core_free(jobs);
+}
+
+/**
+ * \brief Unmaps the files of a batch and frees its replays.
+ * \param batch Pointer to the ReplayBatch structure, empty afterwards.
+ */
+void replay_batch_free(ReplayBatch* batch) {
+    for (int f = 0; f < batch->file_count; f++) {
+        unmap_file(batch->files[f], batch->file_sizes[f]);
+    }
+    core_free(batch->files);
+    core_free(batch->file_sizes);
+    core_free(batch->checks);
+    replay_batch_init(batch);
+}
+
+/**
+ * \brief Describes a replay status.
+ * \param status The status.
+ * \return A short lowercase description.
+ */
+const char* replay_status_text(enum ReplayStatus status) {
+    switch (status) {
+    case REPLAY_VERIFIED: return "verified";
+    case REPLAY_MISMATCH: return "does not match its claim";
+    case REPLAY_CORRUPT: return "corrupt";
+    case REPLAY_BAD_VERSION: return "unsupported version";
+    case REPLAY_NO_MEMORY: return "out of memory";
+    }
+    return "unknown error";
+}
+
+//
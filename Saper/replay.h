@@ -0,0 +1,132 @@
+/*****************************************************************//**
+ * \file   replay.h
+ * \brief  Compact logs of the actions of a game, and their headless verification.
+ *
+ * A replay starts with a fixed little-endian header holding the board parameters, the number of actions and
+ * the claimed result and time, followed by one record per reveal or flag. A record is two variable-length
+ * integers: the milliseconds since the previous action, and the distance from the previous cell, zigzag
+ * encoded, with the action in its lowest bit. Clicks close in time and space take two or three bytes.
+ *
+ * Since a board only depends on its size, mines, topology, seed and first revealed cell, replaying the actions on a new
+ * board gives the game back exactly, which is how the claimed result and time are checked. Replays are
+ * appended one after the other to a file, a ReplayBatch verifies the replays of many files on a thread pool.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+#include "threadpool.h"
+
+/**
+ * \def REPLAY_VERSION
+ * \brief Version of the replay format written. Version 1 replays, older than topologies, are still verified as classic games.
+ */
+#define REPLAY_VERSION 2
+
+/**
+ * \def REPLAY_HEADER_SIZE
+ * \brief Size of the header of a replay in bytes.
+ */
+#define REPLAY_HEADER_SIZE 48
+
+/**
+ * \enum ReplayAction
+ * \brief Actions recorded in a replay.
+ */
+enum ReplayAction {
+    REPLAY_REVEAL, /**< A cell was revealed. */
+    REPLAY_FLAG /**< A flag was placed on a cell or taken off. */
+};
+
+/**
+ * \enum ReplayOutcome
+ * \brief Result of a game claimed by its replay.
+ */
+enum ReplayOutcome {
+    REPLAY_UNFINISHED, /**< The game was left before it ended. */
+    REPLAY_LOST, /**< A mine was revealed by the last action. */
+    REPLAY_WON /**< Every safe cell was revealed by the last action. */
+};
+
+/**
+ * \enum ReplayStatus
+ * \brief Results of verifying a replay.
+ */
+enum ReplayStatus {
+    REPLAY_VERIFIED, /**< Replaying the actions gives the claimed result at the claimed time. */
+    REPLAY_MISMATCH, /**< The actions replay, but not to the claimed result or time, or go on after the game ended. */
+    REPLAY_CORRUPT, /**< The replay is truncated or a field or an action is out of range. */
+    REPLAY_BAD_VERSION, /**< The replay was written by another version of the format. */
+    REPLAY_NO_MEMORY /**< The board could not be allocated. */
+};
+
+/**
+ * \typedef ReplayRecorder
+ * \brief Replay of the game being played, built in memory so that recording an action makes no system call.
+ */
+typedef struct ReplayRecorder {
+    unsigned char* data; /**< Header space followed by the records, kept from game to game. */
+    size_t size; /**< Number of bytes used in data. */
+    size_t capacity; /**< Number of bytes allocated for data. */
+    bool active; /**< Indicates if the actions of the current game are recorded. */
+    int rows; /**< Number of rows of the board. */
+    int cols; /**< Number of columns of the board. */
+    int mines; /**< Number of mines of the board. */
+    uint64_t seed; /**< Seed of the board. */
+    int topology; /**< Topology of the board, a value of enum Topology. */
+    int action_count; /**< Number of actions recorded. */
+    uint32_t last_time; /**< Time of the last action, in milliseconds since the game started. */
+    int last_index; /**< Cell index of the last action, 0 before the first one. */
+} ReplayRecorder;
+
+/**
+ * \typedef ReplayInfo
+ * \brief Header of a replay.
+ */
+typedef struct ReplayInfo {
+    int rows; /**< Number of rows of the board. */
+    int cols; /**< Number of columns of the board. */
+    int mines; /**< Number of mines of the board. */
+    uint64_t seed; /**< Seed of the board. */
+    int topology; /**< Topology of the board, a value of enum Topology. */
+    int action_count; /**< Number of actions. */
+    uint32_t time; /**< Claimed time of the game, in milliseconds. */
+    enum ReplayOutcome outcome; /**< Claimed result of the game. */
+} ReplayInfo;
+
+/**
+ * \typedef ReplayCheck
+ * \brief One replay of a ReplayBatch and the result of its verification.
+ */
+typedef struct ReplayCheck {
+    const unsigned char* data; /**< The replay, inside the mapped file. */
+    size_t size; /**< Size of the replay in bytes. */
+    int file; /**< Index of the file in the batch. */
+    enum ReplayStatus status; /**< Result of the verification. */
+    ReplayInfo info; /**< Header of the replay, valid unless the replay is corrupt or of another version. */
+} ReplayCheck;
+
+/**
+ * \typedef ReplayBatch
+ * \brief Replay files mapped in memory and the replays found in them.
+ */
+typedef struct ReplayBatch {
+    void** files; /**< Mapped files. */
+    size_t* file_sizes; /**< Sizes of the mapped files in bytes. */
+    int file_count; /**< Number of mapped files. */
+    int file_capacity; /**< Number of files the arrays can hold. */
+    ReplayCheck* checks; /**< Replays of every file, in file order. */
+    int check_count; /**< Number of replays. */
+    int check_capacity; /**< Number of replays checks can hold. */
+} ReplayBatch;
+
+void replay_begin(const Board* board, ReplayRecorder* recorder);
+bool replay_record(uint32_t time, enum ReplayAction action, int row, int col, ReplayRecorder* recorder);
+bool replay_append(const char* path, enum ReplayOutcome outcome, ReplayRecorder* recorder);
+void replay_free(ReplayRecorder* recorder);
+enum ReplayStatus verify_replay(const unsigned char* data, size_t size, Board* board, ReplayInfo* info);
+void replay_batch_init(ReplayBatch* batch);
+bool replay_batch_add_file(const char* path, ReplayBatch* batch);
+void replay_batch_verify(ThreadPool* threads, ReplayBatch* batch);
+void replay_batch_free(ReplayBatch* batch);
+const char* replay_status_text(enum ReplayStatus status);
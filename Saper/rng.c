@@ -0,0 +1,47 @@
+/*****************************************************************//**
+ * \file   rng.c
+ * \brief  Seeding and stream splitting of the xoshiro256** generator.
+ *********************************************************************/
+
+#include "rng.h"
+
+/**
+ * \brief Seeds a generator, expanding the 64-bit seed with splitmix64 as the xoshiro authors recommend.
+ * \param seed Any value, zero included.
+ * \param rng Pointer to the Rng structure.
+ */
+void rng_seed(uint64_t seed, Rng* rng) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->state[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * \brief Advances a generator by 2^128 steps, giving a stream that never overlaps the original one.
+ *
+ * Seeding once and jumping for every worker gives threads independent generators from a single seed.
+ * \param rng Pointer to the Rng structure.
+ */
+void rng_jump(Rng* rng) {
+    static const uint64_t jump[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & (1ULL << b)) {
+                s0 ^= rng->state[0];
+                s1 ^= rng->state[1];
+                s2 ^= rng->state[2];
+                s3 ^= rng->state[3];
+            }
+            rng_next(rng);
+        }
+    }
+    rng->state[0] = s0;
+    rng->state[1] = s1;
+    rng->state[2] = s2;
+    rng->state[3] = s3;
+}
@@ -0,0 +1,72 @@
+/*****************************************************************//**
+ * \file   rng.h
+ * \brief  Small seedable pseudo-random generator (xoshiro256**), one instance per board, game or thread.
+ *
+ * Only 64-bit integer arithmetic is used, so a seed gives the same sequence on every platform and compiler.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \typedef Rng
+ * \brief State of a xoshiro256** generator. Never all zero once seeded.
+ */
+typedef struct Rng {
+    uint64_t state[4]; /**< The 256 bits of state. */
+} Rng;
+
+/**
+ * \brief Rotates a 64-bit value left.
+ * \param value The value to rotate.
+ * \param shift Number of bits, between 1 and 63.
+ * \return The rotated value.
+ */
+static inline uint64_t rng_rotl(uint64_t value, int shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+/**
+ * \brief Returns the next 64 random bits.
+ * \param rng Pointer to the Rng structure.
+ * \return The random value.
+ */
+static inline uint64_t rng_next(Rng* rng) {
+    uint64_t* s = rng->state;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+/**
+ * \brief Returns a uniformly distributed number below a bound, without modulo bias.
+ *
+ * Multiplies 32 random bits by the bound and keeps the high half, rejecting the few low halves that would bias it (Lemire's method).
+ * \param bound Upper bound (exclusive), at least 1.
+ * \param rng Pointer to the Rng structure.
+ * \return Random number in the range [0, bound).
+ */
+static inline uint32_t rng_below(uint32_t bound, Rng* rng) {
+    uint64_t product = (rng_next(rng) >> 32) * bound;
+    uint32_t low = (uint32_t)product;
+    if (low < bound) {
+        uint32_t threshold = (uint32_t)(-bound) % bound;
+        while (low < threshold) {
+            product = (rng_next(rng) >> 32) * bound;
+            low = (uint32_t)product;
+        }
+    }
+    return (uint32_t)(product >> 32);
+}
+
+void rng_seed(uint64_t seed, Rng* rng);
+void rng_jump(Rng* rng);
@@ -0,0 +1,535 @@
+/*****************************************************************//**
+ * \file   savestate.c
+ * \brief  Writing, checking and loading save files.
+ *
+ * Header layout, every field little-endian:
+ *   0 magic "SAPERSAV", 8 version, 12 encoding, 16 rows, 20 columns, 24 mines, 28 state bits, with the topology since version 2,
+ *   32 revealed cells, 36 flags, 40 seed, 48 elapsed time (IEEE 754 double), 56 payload offset,
+ *   64 payload size, 72 payload checksum, 80 header checksum of the 80 bytes before it.
+ *********************************************************************/
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include "allocator.h"
+#include "mapfile.h"
+#include "savestate.h"
+
+/**
+ * \def SAVE_MAGIC
+ * \brief First bytes of every save file.
+ */
+#define SAVE_MAGIC "SAPERSAV"
+
+// State bits of the header
+#define SAVE_MINES_PLACED 1
+#define SAVE_SAFE_AREA 2
+#define SAVE_GAME_OVER 4
+#define SAVE_GAME_WON 8
+#define SAVE_TOPOLOGY_SHIFT 4 /**< The topology is stored in the two bits above the flags since version 2. */
+#define SAVE_TOPOLOGY_MASK 0x30
+#define SAVE_STATE_BITS_V1 0x0F /**< Bits a version 1 file may set, the others are reserved and must be zero. */
+#define SAVE_STATE_BITS 0x3F /**< Bits the current version may set, the others are reserved and must be zero. */
+//
+
+// Little-endian fields
+
+/**
+ * \brief Writes a 32-bit little-endian field.
+ */
+static void put_u32(unsigned char* data, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        data[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * \brief Writes a 64-bit little-endian field.
+ */
+static void put_u64(unsigned char* data, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        data[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * \brief Reads a 32-bit little-endian field.
+ */
+static uint32_t get_u32(const unsigned char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * \brief Reads a 64-bit little-endian field.
+ */
+static uint64_t get_u64(const unsigned char* data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+//
+
+/**
+ * \brief Checksums bytes, 32 at a time over four independent lanes so that gigabytes are checked in milliseconds.
+ * \param data The bytes.
+ * \param size Number of bytes.
+ * \return The checksum, the same on every platform.
+ */
+static uint64_t save_checksum(const unsigned char* data, size_t size) {
+    uint64_t lanes[4] = { 0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int lane = 0; lane < 4; lane++) {
+            lanes[lane] = (lanes[lane] ^ get_u64(data + i + 8 * lane)) * 0xFF51AFD7ED558CCDULL;
+            lanes[lane] ^= lanes[lane] >> 29;
+        }
+    }
+
+    uint64_t hash = (uint64_t)size;
+    for (int lane = 0; lane < 4; lane++) {
+        hash = (hash ^ lanes[lane]) * 0x100000001B3ULL;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Run-length encoding: a control byte c < 128 is followed by c + 1 literal bytes, c >= 128 by one byte repeated c - 125 times
+
+/**
+ * \brief Encodes bytes with runs of three or more identical bytes collapsed.
+ * \param input The bytes.
+ * \param size Number of bytes.
+ * \param output Receives the encoding, at least size + size / 128 + 1 bytes.
+ * \return Size of the encoding.
+ */
+static size_t rle_encode(const unsigned char* input, size_t size, unsigned char* output) {
+    size_t out = 0;
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < 130 && input[i + run] == input[i]) {
+            run++;
+        }
+
+        if (run >= 3) {
+            output[out++] = (unsigned char)(run + 125);
+            output[out++] = input[i];
+            i += run;
+            continue;
+        }
+
+        // Literals up to the next run of three
+        size_t start = i;
+        while (i < size && i - start < 128 && !(i + 2 < size && input[i] == input[i + 1] && input[i] == input[i + 2])) {
+            i++;
+        }
+        output[out++] = (unsigned char)(i - start - 1);
+        memcpy(output + out, input + start, i - start);
+        out += i - start;
+    }
+    return out;
+}
+
+/**
+ * \brief Decodes bytes encoded by rle_encode, checking every bound.
+ * \param input The encoding.
+ * \param size Size of the encoding.
+ * \param output Receives the bytes.
+ * \param output_size Number of bytes expected.
+ * \return true if the encoding decodes to exactly output_size bytes.
+ */
+static bool rle_decode(const unsigned char* input, size_t size, unsigned char* output, size_t output_size) {
+    size_t out = 0;
+    size_t i = 0;
+    while (i < size) {
+        unsigned char control = input[i++];
+        if (control < 128) {
+            size_t count = (size_t)control + 1;
+            if (count > size - i || count > output_size - out) {
+                return false;
+            }
+            memcpy(output + out, input + i, count);
+            i += count;
+            out += count;
+        }
+        else {
+            size_t count = (size_t)control - 125;
+            if (i == size || count > output_size - out) {
+                return false;
+            }
+            memset(output + out, input[i++], count);
+            out += count;
+        }
+    }
+    return out == output_size;
+}
+
+//
+
+/**
+ * \brief Writes a board to a save file, built in memory and written with a single write.
+ * \param path Path of the file, replaced if it exists. On Windows a file the board being saved was loaded from cannot be replaced.
+ * \param elapsed_time Time spent on the game so far, in seconds.
+ * \param encoding How the cells are stored, SAVE_CELLS for boards that must load instantly.
+ * \param board Pointer to the Board structure.
+ * \return SAVE_OK, SAVE_NO_MEMORY or SAVE_IO_ERROR.
+ */
+enum SaveStatus save_board(const char* path, double elapsed_time, enum SaveEncoding encoding, const Board* board) {
+    size_t cell_count = (size_t)board->rows * board->cols;
+    size_t plane_size = (cell_count + 7) / 8;
+
+    size_t payload_offset = encoding == SAVE_CELLS ? SAVE_CELLS_OFFSET : SAVE_HEADER_SIZE;
+    size_t payload_capacity = encoding == SAVE_CELLS ? cell_count : 3 * plane_size;
+    if (encoding == SAVE_PLANES_RLE) {
+        payload_capacity += payload_capacity / 128 + 1;
+    }
+
+    unsigned char* file = core_calloc(payload_offset + payload_capacity, 1);
+    unsigned char* planes = encoding == SAVE_PLANES_RLE ? core_calloc(3 * plane_size, 1) : NULL;
+    if (!file || (encoding == SAVE_PLANES_RLE && !planes)) {
+        core_free(file);
+        core_free(planes);
+        return SAVE_NO_MEMORY;
+    }
+
+    // Payload
+    unsigned char* payload = file + payload_offset;
+    size_t payload_size;
+    if (encoding == SAVE_CELLS) {
+        memcpy(payload, board->cells, cell_count);
+        payload_size = cell_count;
+    }
+    else {
+        unsigned char* mine_plane = planes ? planes : payload;
+        unsigned char* revealed_plane = mine_plane + plane_size;
+        unsigned char* flag_plane = revealed_plane + plane_size;
+        for (size_t byte = 0; byte < plane_size; byte++) { // Eight cells per byte of each plane, without branches
+            unsigned mine_bits = 0, revealed_bits = 0, flag_bits = 0;
+            for (size_t bit = 0; bit < 8 && byte * 8 + bit < cell_count; bit++) {
+                unsigned cell = board->cells[byte * 8 + bit];
+                mine_bits |= ((cell & CELL_MINE) != 0) << bit;
+                revealed_bits |= ((cell & CELL_REVEALED) != 0) << bit;
+                flag_bits |= ((cell & CELL_FLAGGED) != 0) << bit;
+            }
+            mine_plane[byte] = (unsigned char)mine_bits;
+            revealed_plane[byte] = (unsigned char)revealed_bits;
+            flag_plane[byte] = (unsigned char)flag_bits;
+        }
+        payload_size = planes ? rle_encode(planes, 3 * plane_size, payload) : 3 * plane_size;
+    }
+    core_free(planes);
+    //
+
+    // Header
+    uint32_t state = (board->mines_placed ? SAVE_MINES_PLACED : 0) | (board->safe_area ? SAVE_SAFE_AREA : 0)
+        | (board->game_over ? SAVE_GAME_OVER : 0) | (board->game_won ? SAVE_GAME_WON : 0)
+        | ((uint32_t)board->topology << SAVE_TOPOLOGY_SHIFT);
+    uint64_t elapsed_bits;
+    memcpy(&elapsed_bits, &elapsed_time, sizeof(elapsed_bits));
+
+    memcpy(file, SAVE_MAGIC, 8);
+    put_u32(file + 8, SAVE_VERSION);
+    put_u32(file + 12, (uint32_t)encoding);
+    put_u32(file + 16, (uint32_t)board->rows);
+    put_u32(file + 20, (uint32_t)board->cols);
+    put_u32(file + 24, (uint32_t)board->mines);
+    put_u32(file + 28, state);
+    put_u32(file + 32, (uint32_t)board->revealed_count);
+    put_u32(file + 36, (uint32_t)board->flags_placed);
+    put_u64(file + 40, board->seed);
+    put_u64(file + 48, elapsed_bits);
+    put_u64(file + 56, payload_offset);
+    put_u64(file + 64, payload_size);
+    put_u64(file + 72, save_checksum(payload, payload_size));
+    put_u64(file + 80, save_checksum(file, 80));
+    //
+
+    // Written next to the file and renamed over it: a board loaded from the file may still be mapped, and
+    // truncating the file under the mapping would fault. A failed save also leaves the previous one intact.
+    char temporary_path[1024];
+    if (snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path) >= (int)sizeof(temporary_path)) {
+        core_free(file);
+        return SAVE_IO_ERROR;
+    }
+
+    FILE* output = fopen(temporary_path, "wb");
+    bool written = output && fwrite(file, 1, payload_offset + payload_size, output) == payload_offset + payload_size;
+    if (output && fclose(output) != 0) {
+        written = false;
+    }
+    core_free(file);
+
+    if (!written || !replace_file(temporary_path, path)) {
+        remove(temporary_path);
+        return SAVE_IO_ERROR;
+    }
+    return SAVE_OK;
+}
+
+/**
+ * \brief Counts the mines in the 1x3 window centred on every cell of a row.
+ * \param row The row index.
+ * \param board Pointer to the Board structure.
+ * \param sums Receives one count per column.
+ */
+static void row_mine_sums(int row, const Board* board, unsigned char* sums) {
+    const unsigned char* cells = board->cells + (size_t)row * board->cols;
+    for (int col = 0; col < board->cols; col++) {
+        int sum = (cells[col] & CELL_MINE) != 0;
+        if (col > 0)
+            sum += (cells[col - 1] & CELL_MINE) != 0;
+        if (col + 1 < board->cols)
+            sum += (cells[col + 1] & CELL_MINE) != 0;
+        sums[col] = (unsigned char)sum;
+    }
+}
+
+/**
+ * \brief Sets the adjacent mine count of every cell, from the sums of the windows of three consecutive rows.
+ * \param board Pointer to the Board structure, whose counts are zero.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool count_adjacent_mines(Board* board) {
+    int cols = board->cols;
+    unsigned char* sums = core_calloc((size_t)3 * cols, 1);
+    if (!sums) {
+        return false;
+    }
+
+    unsigned char* above = sums; // Zero above the first row
+    unsigned char* current = sums + cols;
+    unsigned char* below = sums + 2 * (size_t)cols;
+    row_mine_sums(0, board, current);
+    for (int row = 0; row < board->rows; row++) {
+        if (row + 1 < board->rows)
+            row_mine_sums(row + 1, board, below);
+        else
+            memset(below, 0, (size_t)cols);
+
+        unsigned char* cells = board->cells + (size_t)row * cols;
+        for (int col = 0; col < cols; col++) {
+            cells[col] |= (unsigned char)(above[col] + current[col] + below[col] - ((cells[col] & CELL_MINE) != 0));
+        }
+
+        unsigned char* rotated = above;
+        above = current;
+        current = below;
+        below = rotated;
+    }
+
+    core_free(sums);
+    return true;
+}
+
+/**
+ * \brief Sets the adjacent mine count of every cell of a board of another topology, mine by mine.
+ * \param board Pointer to the Board structure, whose counts are zero.
+ */
+static void count_topology_mines(Board* board) {
+    int cell_count = board->rows * board->cols;
+    for (int i = 0; i < cell_count; i++) {
+        if (!(board->cells[i] & CELL_MINE))
+            continue;
+        int neighbours[TOPOLOGY_MAX_NEIGHBOURS];
+        int count = board_neighbours(i, board, neighbours);
+        for (int n = 0; n < count; n++) {
+            board->cells[neighbours[n]]++;
+        }
+    }
+}
+
+/**
+ * \brief Rebuilds the cells of a board from the bit planes of a save file, adjacency counts included.
+ * \param planes The mine, revealed and flag planes, one after the other.
+ * \param board Pointer to the Board structure, its cells allocated and its topology set.
+ * \return true on success, false if the memory could not be allocated.
+ */
+static bool unpack_planes(const unsigned char* planes, Board* board) {
+    size_t cell_count = (size_t)board->rows * board->cols;
+    size_t plane_size = (cell_count + 7) / 8;
+    const unsigned char* mine_plane = planes;
+    const unsigned char* revealed_plane = planes + plane_size;
+    const unsigned char* flag_plane = revealed_plane + plane_size;
+
+    // Spreading each plane byte to eight cell bytes, as 0 or 1 in each byte of a word
+    uint64_t spread[256];
+    for (int value = 0; value < 256; value++) {
+        spread[value] = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            spread[value] |= (uint64_t)((value >> bit) & 1) << (8 * bit);
+        }
+    }
+
+    size_t full_bytes = cell_count / 8;
+    for (size_t byte = 0; byte < full_bytes; byte++) {
+        uint64_t cells = spread[mine_plane[byte]] * CELL_MINE | spread[revealed_plane[byte]] * CELL_REVEALED | spread[flag_plane[byte]] * CELL_FLAGGED;
+        for (int bit = 0; bit < 8; bit++) {
+            board->cells[byte * 8 + bit] = (unsigned char)(cells >> (8 * bit));
+        }
+    }
+    for (size_t i = full_bytes * 8; i < cell_count; i++) {
+        unsigned bit = (unsigned)(i & 7);
+        board->cells[i] = (unsigned char)((((mine_plane[i >> 3] >> bit) & 1) * CELL_MINE)
+            | (((revealed_plane[i >> 3] >> bit) & 1) * CELL_REVEALED)
+            | (((flag_plane[i >> 3] >> bit) & 1) * CELL_FLAGGED));
+    }
+    //
+
+    if (board->topology != TOPOLOGY_CLASSIC) { // The row sums only add up 3x3 neighbourhoods
+        count_topology_mines(board);
+        return true;
+    }
+    return count_adjacent_mines(board);
+}
+
+/**
+ * \brief Loads a board from a save file.
+ *
+ * The file is mapped in memory. SAVE_CELLS files are used in place: the cells of the board point into the
+ * private mapping, whose pages are only read when touched and copied when written, so a board of any size
+ * resumes in the time it takes to check its checksum. Other files are unpacked into allocated cells.
+ * \param path Path of the file.
+ * \param elapsed_time Receives the time spent on the game so far, in seconds.
+ * \param board Pointer to the Board structure receiving the board, freed with free_board.
+ * \return SAVE_OK, or why the file was rejected. The board is untouched unless SAVE_OK is returned.
+ */
+enum SaveStatus load_board(const char* path, double* elapsed_time, Board* board) {
+    size_t file_size;
+    unsigned char* file = map_file(path, &file_size);
+    if (!file) {
+        return SAVE_IO_ERROR;
+    }
+
+    // Checking the header
+    enum SaveStatus status = SAVE_OK;
+    if (file_size < SAVE_HEADER_SIZE || memcmp(file, SAVE_MAGIC, 8) != 0) {
+        status = file_size >= 8 && memcmp(file, SAVE_MAGIC, 8) == 0 ? SAVE_CORRUPT : SAVE_NOT_A_SAVE;
+    }
+    else if (get_u64(file + 80) != save_checksum(file, 80)) {
+        status = SAVE_CORRUPT;
+    }
+    else if (get_u32(file + 8) != SAVE_VERSION && get_u32(file + 8) != 1) {
+        status = SAVE_BAD_VERSION;
+    }
+    if (status != SAVE_OK) {
+        unmap_file(file, file_size);
+        return status;
+    }
+
+    uint32_t encoding = get_u32(file + 12);
+    uint32_t rows = get_u32(file + 16);
+    uint32_t cols = get_u32(file + 20);
+    uint32_t mines = get_u32(file + 24);
+    uint32_t state = get_u32(file + 28);
+    uint32_t state_bits = get_u32(file + 8) == 1 ? SAVE_STATE_BITS_V1 : SAVE_STATE_BITS; // Version 1 boards are classic
+    uint64_t payload_offset = get_u64(file + 56);
+    uint64_t payload_size = get_u64(file + 64);
+    uint32_t topology = (state & SAVE_TOPOLOGY_MASK) >> SAVE_TOPOLOGY_SHIFT;
+
+    uint64_t cell_count = (uint64_t)rows * cols;
+    uint64_t plane_size = (cell_count + 7) / 8;
+    bool valid = rows > 0 && cols > 0 && cell_count <= INT_MAX && mines < cell_count && encoding <= SAVE_PLANES_RLE
+        && (state & ~state_bits) == 0
+        && get_u32(file + 32) <= cell_count && get_u32(file + 36) <= cell_count
+        && (topology != TOPOLOGY_TORUS || (rows >= 3 && cols >= 3))
+        && payload_offset >= SAVE_HEADER_SIZE && payload_offset <= file_size && payload_size == file_size - payload_offset
+        && (encoding != SAVE_CELLS || payload_size == cell_count)
+        && (encoding != SAVE_PLANES || payload_size == 3 * plane_size);
+    for (uint64_t i = SAVE_HEADER_SIZE; valid && i < payload_offset; i++) { // The padding is not checksummed, it must stay zero
+        valid = file[i] == 0;
+    }
+    if (!valid || get_u64(file + 72) != save_checksum(file + payload_offset, (size_t)payload_size)) {
+        unmap_file(file, file_size);
+        return SAVE_CORRUPT;
+    }
+    //
+
+    // Cells
+    bool mapped = encoding == SAVE_CELLS;
+    unsigned char* cells = mapped ? file + payload_offset : core_calloc((size_t)cell_count, 1);
+    int* opened = core_malloc((size_t)cell_count * sizeof(int));
+    unsigned char* planes = encoding == SAVE_PLANES_RLE ? core_malloc((size_t)(3 * plane_size)) : NULL;
+    if (!cells || !opened || (encoding == SAVE_PLANES_RLE && !planes)) {
+        status = SAVE_NO_MEMORY;
+    }
+    else if (planes && !rle_decode(file + payload_offset, (size_t)payload_size, planes, (size_t)(3 * plane_size))) {
+        status = SAVE_CORRUPT;
+    }
+    else if (!mapped) {
+        Board unpacked = { .rows = (int)rows, .cols = (int)cols, .topology = (int)topology, .cells = cells };
+        if (!unpack_planes(planes ? planes : file + payload_offset, &unpacked)) {
+            status = SAVE_NO_MEMORY;
+        }
+    }
+    core_free(planes);
+
+    if (status != SAVE_OK) {
+        if (!mapped) {
+            core_free(cells);
+        }
+        core_free(opened);
+        unmap_file(file, file_size);
+        return status;
+    }
+    //
+
+    board->rows = (int)rows;
+    board->cols = (int)cols;
+    board->mines = (int)mines;
+    board->topology = (int)topology;
+    board->seed = get_u64(file + 40);
+    board->cells = cells;
+    board->opened = opened;
+    board->opened_count = 0;
+    board->revealed_count = (int)get_u32(file + 32);
+    board->flags_placed = (int)get_u32(file + 36);
+    board->mines_placed = (state & SAVE_MINES_PLACED) != 0;
+    board->safe_area = (state & SAVE_SAFE_AREA) != 0;
+    board->game_over = (state & SAVE_GAME_OVER) != 0;
+    board->game_won = (state & SAVE_GAME_WON) != 0;
+
+    uint64_t elapsed_bits = get_u64(file + 48);
+    memcpy(elapsed_time, &elapsed_bits, sizeof(*elapsed_time));
+
+    if (mapped) { // The mapping is the board now, free_board unmaps it
+        board->mapping = file;
+        board->mapping_size = file_size;
+    }
+    else {
+        board->mapping = NULL;
+        board->mapping_size = 0;
+        unmap_file(file, file_size);
+    }
+    return SAVE_OK;
+}
+
+/**
+ * \brief Describes the result of saving or loading, for the player.
+ * \param status The result.
+ * \return A sentence fragment, such as "the file is corrupt".
+ */
+const char* save_status_text(enum SaveStatus status) {
+    switch (status) {
+    case SAVE_OK: return "success";
+    case SAVE_IO_ERROR: return "the file could not be read or written";
+    case SAVE_NOT_A_SAVE: return "the file is not a save file";
+    case SAVE_BAD_VERSION: return "the file was saved by another version";
+    case SAVE_CORRUPT: return "the file is corrupt or truncated";
+    case SAVE_NO_MEMORY: return "out of memory";
+    }
+    return "unknown error";
+}
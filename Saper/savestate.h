@@ -0,0 +1,59 @@
+/*****************************************************************//**
+ * \file   savestate.h
+ * \brief  Versioned binary snapshots of a board, loaded by mapping the file in memory.
+ *
+ * A save file starts with a fixed little-endian header holding the dimensions, the seed, the counters,
+ * the elapsed time and two checksums, one of the header and one of the payload. The payload is either the
+ * packed cells themselves, at a page-aligned offset so that the mapped file becomes the working board, or
+ * three bit planes (mines, revealed cells and flags), optionally run-length encoded, from which the cells
+ * are rebuilt. Truncated and corrupt files are rejected before anything is used.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+
+/**
+ * \def SAVE_VERSION
+ * \brief Version of the save format written. Version 1 files, older than topologies, are still loaded as classic boards.
+ */
+#define SAVE_VERSION 2
+
+/**
+ * \def SAVE_HEADER_SIZE
+ * \brief Size of the header in bytes.
+ */
+#define SAVE_HEADER_SIZE 88
+
+/**
+ * \def SAVE_CELLS_OFFSET
+ * \brief Offset of the payload of SAVE_CELLS files, a multiple of the page size so that the cells are page aligned.
+ */
+#define SAVE_CELLS_OFFSET 4096
+
+/**
+ * \enum SaveEncoding
+ * \brief Ways of storing the cells in a save file.
+ */
+enum SaveEncoding {
+    SAVE_CELLS, /**< Packed cells as in Board.cells, one byte each, loaded without any parsing. */
+    SAVE_PLANES, /**< Mine, revealed and flag bit planes, three bits per cell. */
+    SAVE_PLANES_RLE /**< Bit planes with runs of identical bytes encoded, small for boards mostly hidden or mostly revealed. */
+};
+
+/**
+ * \enum SaveStatus
+ * \brief Results of saving and loading.
+ */
+enum SaveStatus {
+    SAVE_OK, /**< The board was saved or loaded. */
+    SAVE_IO_ERROR, /**< The file could not be opened, written or mapped. */
+    SAVE_NOT_A_SAVE, /**< The file does not start like a save file. */
+    SAVE_BAD_VERSION, /**< The file was written by another version of the format. */
+    SAVE_CORRUPT, /**< The file is truncated, a checksum does not match or a field is out of range. */
+    SAVE_NO_MEMORY /**< The memory could not be allocated. */
+};
+
+enum SaveStatus save_board(const char* path, double elapsed_time, enum SaveEncoding encoding, const Board* board);
+enum SaveStatus load_board(const char* path, double* elapsed_time, Board* board);
+const char* save_status_text(enum SaveStatus status);
@@ -0,0 +1,361 @@
+/*****************************************************************//**
+ * \file   solver.c
+ * \brief  Single-constraint and overlapping-pair rules applied incrementally to the frontier of a board.
+ *********************************************************************/
+
+#include <string.h>
+#include "allocator.h"
+#include "solver.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * \def WINDOW_SIDE
+ * \brief Side of the square window a constraint is examined in. A cell at distance 2 still has its
+ * neighbours at distance 3 inside it, so the 49 cells fit in one 64-bit mask.
+ */
+#define WINDOW_SIDE 7
+
+/**
+ * \brief Counts the set bits of a word.
+ */
+static inline int popcount64(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return (int)__popcnt64(value);
+#elif defined(__GNUC__)
+    return __builtin_popcountll(value);
+#else
+    int count = 0;
+    while (value) {
+        value &= value - 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/**
+ * \brief Checks if a revealed cell holds a number the solver can use, an exploded mine is visible but says nothing.
+ */
+static inline bool is_constraint(const Board* board, int index) {
+    unsigned char cell = board->cells[index];
+    return (cell & (CELL_REVEALED | CELL_MINE)) == CELL_REVEALED && (cell & CELL_COUNT_MASK) != 0;
+}
+
+/**
+ * \brief Adds the constraint of a revealed cell to the queue, unless it is already waiting there.
+ * \param index Index of the revealed cell.
+ * \param solver Pointer to the Solver structure.
+ */
+static void queue_constraint(int index, Solver* solver) {
+    if (solver->knowledge[index] & SOLVER_QUEUED)
+        return;
+
+    int cell_count = solver->rows * solver->cols;
+    int tail = solver->queue_head + solver->queue_count;
+    if (tail >= cell_count)
+        tail -= cell_count;
+
+    solver->knowledge[index] |= SOLVER_QUEUED;
+    solver->queue[tail] = index;
+    solver->queue_count++;
+}
+
+/**
+ * \brief Queues the constraints of a cell and of its revealed neighbours, the ones that changed with it.
+ * \param row The row index of the changed cell.
+ * \param col The column index of the changed cell.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ */
+static void queue_around(int row, int col, const Board* board, Solver* solver) {
+    for (int r = row - 1; r <= row + 1; r++) {
+        if (r < 0 || r >= board->rows)
+            continue;
+        for (int c = col - 1; c <= col + 1; c++) {
+            if (c < 0 || c >= board->cols)
+                continue;
+            int index = r * board->cols + c;
+            if (is_constraint(board, index))
+                queue_constraint(index, solver);
+        }
+    }
+}
+
+/**
+ * \brief Records a proof about a hidden cell and queues the constraints it changes.
+ * \param index Index of the cell.
+ * \param mine true if the cell holds a mine, false if it is safe.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ */
+static void prove_cell(int index, bool mine, const Board* board, Solver* solver) {
+    if (solver->knowledge[index] & (SOLVER_SAFE | SOLVER_MINE))
+        return;
+
+    if (mine) {
+        solver->knowledge[index] |= SOLVER_MINE;
+        solver->mines[solver->mine_count++] = index;
+    }
+    else {
+        solver->knowledge[index] |= SOLVER_SAFE;
+        solver->safe[solver->safe_count++] = index;
+    }
+    queue_around(index / board->cols, index % board->cols, board, solver);
+}
+
+/**
+ * \brief Proves every cell of a window mask.
+ * \param mask Cells of the window centered on (center_row, center_col).
+ * \param center_row The row index of the center of the window.
+ * \param center_col The column index of the center of the window.
+ * \param mine true if the cells hold mines, false if they are safe.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ */
+static void prove_mask(uint64_t mask, int center_row, int center_col, bool mine, const Board* board, Solver* solver) {
+    for (int bit = 0; mask; bit++, mask >>= 1) {
+        if (mask & 1) {
+            int row = center_row + bit / WINDOW_SIDE - WINDOW_SIDE / 2;
+            int col = center_col + bit % WINDOW_SIDE - WINDOW_SIDE / 2;
+            prove_cell(row * board->cols + col, mine, board, solver);
+        }
+    }
+}
+
+/**
+ * \brief Reads the constraint of a revealed cell: its unknown neighbours and the mines still among them.
+ *
+ * Cells proven safe are not unknown, flags and cells proven to be mines are subtracted from the number.
+ * \param row The row index of the revealed cell.
+ * \param col The column index of the revealed cell.
+ * \param center_row The row index of the center of the window the mask is expressed in.
+ * \param center_col The column index of the center of the window.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ * \param unknown Receives the unknown neighbours as a window mask.
+ * \return Number of mines among the unknown neighbours.
+ */
+static int read_constraint(int row, int col, int center_row, int center_col, const Board* board, const Solver* solver, uint64_t* unknown) {
+    int required = board->cells[row * board->cols + col] & CELL_COUNT_MASK;
+    uint64_t mask = 0;
+
+    for (int r = row - 1; r <= row + 1; r++) {
+        if (r < 0 || r >= board->rows)
+            continue;
+        for (int c = col - 1; c <= col + 1; c++) {
+            if (c < 0 || c >= board->cols)
+                continue;
+
+            int index = r * board->cols + c;
+            unsigned char cell = board->cells[index];
+            unsigned char known = solver->knowledge[index];
+            if ((cell & CELL_REVEALED) || (known & SOLVER_SAFE))
+                continue;
+            if ((known & SOLVER_MINE) || (cell & CELL_FLAGGED)) {
+                required--;
+                continue;
+            }
+
+            int bit = (r - center_row + WINDOW_SIDE / 2) * WINDOW_SIDE + (c - center_col + WINDOW_SIDE / 2);
+            mask |= 1ull << bit;
+        }
+    }
+
+    *unknown = mask;
+    return required;
+}
+
+/**
+ * \brief Applies the rules to the constraint of one revealed cell.
+ *
+ * A constraint whose number is zero or equal to its unknown cells decides them all. Otherwise it is paired with
+ * every constraint within two cells sharing unknown cells with it: when the difference of the numbers equals the
+ * cells only one side has, those cells are all mines and the cells only the other side has are all safe, which
+ * covers the subset rule and the classic 1-2 pattern. A deduction queues the cell again, as its constraint changed.
+ * \param index Index of the revealed cell.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ */
+static void examine_constraint(int index, const Board* board, Solver* solver) {
+    int row = index / board->cols;
+    int col = index % board->cols;
+    solver->steps++;
+
+    uint64_t unknown;
+    int required = read_constraint(row, col, row, col, board, solver, &unknown);
+    if (!unknown)
+        return;
+
+    int unknown_count = popcount64(unknown);
+    if (required < 0 || required > unknown_count) // Wrong flags, nothing can be proven from them
+        return;
+    if (required == 0 || required == unknown_count) {
+        prove_mask(unknown, row, col, required != 0, board, solver);
+        return;
+    }
+
+    for (int r = row - 2; r <= row + 2; r++) {
+        if (r < 0 || r >= board->rows)
+            continue;
+        for (int c = col - 2; c <= col + 2; c++) {
+            if (c < 0 || c >= board->cols || (r == row && c == col))
+                continue;
+            if (!is_constraint(board, r * board->cols + c))
+                continue;
+
+            uint64_t other;
+            int other_required = read_constraint(r, c, row, col, board, solver, &other);
+            if (!(unknown & other))
+                continue;
+
+            uint64_t only_this = unknown & ~other;
+            uint64_t only_other = other & ~unknown;
+            if (!only_this && !only_other)
+                continue;
+
+            if (other_required - required == popcount64(only_other)) {
+                prove_mask(only_other, row, col, true, board, solver);
+                prove_mask(only_this, row, col, false, board, solver);
+            }
+            else if (required - other_required == popcount64(only_this)) {
+                prove_mask(only_this, row, col, true, board, solver);
+                prove_mask(only_other, row, col, false, board, solver);
+            }
+            else {
+                continue;
+            }
+
+            queue_constraint(index, solver);
+            return;
+        }
+    }
+}
+
+/**
+ * \brief Examines the queued constraints until the queue is empty.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ * \return Number of cells proven safe or mined.
+ */
+static int run_solver(const Board* board, Solver* solver) {
+    int cell_count = solver->rows * solver->cols;
+    int proven_before = solver->safe_count + solver->mine_count;
+
+    while (solver->queue_count > 0) {
+        int index = solver->queue[solver->queue_head];
+        if (++solver->queue_head == cell_count)
+            solver->queue_head = 0;
+        solver->queue_count--;
+
+        solver->knowledge[index] &= ~SOLVER_QUEUED;
+        examine_constraint(index, board, solver);
+    }
+
+    return solver->safe_count + solver->mine_count - proven_before;
+}
+
+/**
+ * \brief Allocates a solver for a board and examines the cells already revealed on it.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool solver_create(const Board* board, Solver* solver) {
+    size_t cell_count = (size_t)board->rows * board->cols;
+    solver->rows = board->rows;
+    solver->cols = board->cols;
+
+    // Each cell is queued and proven at most once, so the buffers never grow
+    solver->knowledge = core_malloc(cell_count);
+    solver->queue = core_malloc(cell_count * sizeof(int));
+    solver->safe = core_malloc(cell_count * sizeof(int));
+    solver->mines = core_malloc(cell_count * sizeof(int));
+    if (!solver->knowledge || !solver->queue || !solver->safe || !solver->mines) {
+        solver_destroy(solver);
+        return false;
+    }
+
+    solver_reset(board, solver);
+    return true;
+}
+
+/**
+ * \brief Frees the memory of a solver.
+ * \param solver Pointer to the Solver structure.
+ */
+void solver_destroy(Solver* solver) {
+    core_free(solver->knowledge);
+    core_free(solver->queue);
+    core_free(solver->safe);
+    core_free(solver->mines);
+    solver->knowledge = NULL;
+    solver->queue = NULL;
+    solver->safe = NULL;
+    solver->mines = NULL;
+}
+
+/**
+ * \brief Forgets every deduction and examines the board again, for a new game on a board of the same size.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ */
+void solver_reset(const Board* board, Solver* solver) {
+    int cell_count = solver->rows * solver->cols;
+    memset(solver->knowledge, 0, (size_t)cell_count);
+    solver->queue_head = 0;
+    solver->queue_count = 0;
+    solver->safe_count = 0;
+    solver->mine_count = 0;
+    solver->steps = 0;
+
+    for (int i = 0; i < cell_count; i++) {
+        if (is_constraint(board, i))
+            queue_constraint(i, solver);
+    }
+    run_solver(board, solver);
+}
+
+/**
+ * \brief Updates the deductions after reveal_cell, examining only the constraints around the opened cells.
+ * \param board Pointer to the Board structure, board->opened must hold the cells of the last reveal.
+ * \param solver Pointer to the Solver structure.
+ * \return Number of cells newly proven safe or mined.
+ */
+int solver_update(const Board* board, Solver* solver) {
+    for (int i = 0; i < board->opened_count; i++) {
+        int index = board->opened[i];
+        queue_around(index / board->cols, index % board->cols, board, solver);
+    }
+    return run_solver(board, solver);
+}
+
+/**
+ * \brief Updates the deductions after a cell changed outside of reveal_cell, typically a flag placed or removed.
+ * \param row The row index of the changed cell.
+ * \param col The column index of the changed cell.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ * \return Number of cells newly proven safe or mined.
+ */
+int solver_cell_changed(int row, int col, const Board* board, Solver* solver) {
+    queue_around(row, col, board, solver);
+    return run_solver(board, solver);
+}
+
+/**
+ * \brief Hands out a cell proven safe that is still hidden.
+ * \param board Pointer to the Board structure.
+ * \param solver Pointer to the Solver structure.
+ * \return Index of the cell, or -1 if no hidden cell is proven safe.
+ */
+int solver_next_safe(const Board* board, Solver* solver) {
+    while (solver->safe_count > 0) {
+        int index = solver->safe[--solver->safe_count];
+        if (!(board->cells[index] & (CELL_REVEALED | CELL_FLAGGED)))
+            return index;
+    }
+    return -1;
+}
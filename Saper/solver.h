@@ -0,0 +1,61 @@
+/*****************************************************************//**
+ * \file   solver.h
+ * \brief  Deterministic constraint propagation solver over the player-visible state of a board.
+ *
+ * The solver only reads what the player sees: the revealed cells, their numbers and the flags, which it
+ * trusts to be mines. Every revealed number is a constraint on its hidden neighbours; single constraints
+ * and pairs of overlapping constraints are applied until nothing changes, proving cells safe or mined.
+ * It only reads the CELL_MINE bit of revealed cells, to skip an exploded mine the player can see, so its
+ * deductions are exactly those a careful player could make.
+ * Neighbourhoods are the classic 3x3 ones, the solver is not meant for boards of another topology.
+ *********************************************************************/
+
+#pragma once
+
+#include "board.h"
+
+/**
+ * \def SOLVER_SAFE
+ * \brief Bit of a knowledge byte set when the cell was proven safe.
+ */
+#define SOLVER_SAFE 0x01
+
+/**
+ * \def SOLVER_MINE
+ * \brief Bit of a knowledge byte set when the cell was proven to hold a mine.
+ */
+#define SOLVER_MINE 0x02
+
+/**
+ * \def SOLVER_QUEUED
+ * \brief Bit of a knowledge byte set while the constraint of a revealed cell waits in the queue.
+ */
+#define SOLVER_QUEUED 0x04
+
+/**
+ * \typedef Solver
+ * \brief Deductions made on one board and the constraints still to examine.
+ *
+ * The solver is updated incrementally: after every reveal or flag only the constraints around the changed
+ * cells are queued again, so the work per action is proportional to the frontier it touched.
+ */
+typedef struct Solver {
+    int rows; /**< Number of rows of the board. */
+    int cols; /**< Number of columns of the board. */
+    unsigned char* knowledge; /**< Row-major SOLVER_* bits of every cell. */
+    int* queue; /**< Ring buffer of the revealed cells whose constraint must be examined again. */
+    int queue_head; /**< Position of the next cell to examine in the queue. */
+    int queue_count; /**< Number of cells in the queue. */
+    int* safe; /**< Cells proven safe and not handed out by solver_next_safe yet, used as a stack. */
+    int safe_count; /**< Number of cells in safe. */
+    int* mines; /**< Every cell proven to hold a mine, in the order of the proofs. */
+    int mine_count; /**< Number of cells in mines. */
+    long long steps; /**< Number of constraints examined since the solver was created or reset. */
+} Solver;
+
+bool solver_create(const Board* board, Solver* solver);
+void solver_destroy(Solver* solver);
+void solver_reset(const Board* board, Solver* solver);
+int solver_update(const Board* board, Solver* solver);
+int solver_cell_changed(int row, int col, const Board* board, Solver* solver);
+int solver_next_safe(const Board* board, Solver* solver);
@@ -0,0 +1,304 @@
+/*****************************************************************//**
+ * \file   threadpool.c
+ * \brief  Worker threads taking jobs from a shared queue guarded by one lock.
+ *********************************************************************/
+
+#include "allocator.h"
+#include "threadpool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+
+#define mutex_init(m) InitializeCriticalSection(m)
+#define mutex_destroy(m) DeleteCriticalSection(m)
+#define mutex_lock(m) EnterCriticalSection(m)
+#define mutex_unlock(m) LeaveCriticalSection(m)
+#define condition_init(c) InitializeConditionVariable(c)
+#define condition_destroy(c) ((void)(c))
+#define condition_wait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+#define condition_signal(c) WakeConditionVariable(c)
+#define condition_broadcast(c) WakeAllConditionVariable(c)
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+
+#define mutex_init(m) pthread_mutex_init(m, NULL)
+#define mutex_destroy(m) pthread_mutex_destroy(m)
+#define mutex_lock(m) pthread_mutex_lock(m)
+#define mutex_unlock(m) pthread_mutex_unlock(m)
+#define condition_init(c) pthread_cond_init(c, NULL)
+#define condition_destroy(c) pthread_cond_destroy(c)
+#define condition_wait(c, m) pthread_cond_wait(c, m)
+#define condition_signal(c) pthread_cond_signal(c)
+#define condition_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+/**
+ * \typedef PoolJob
+ * \brief A submitted job waiting in the queue.
+ */
+typedef struct PoolJob {
+    ThreadJob run; /**< Function to run. */
+    void* arg; /**< Argument of the function. */
+    ThreadBatch* batch; /**< Batch of the job, NULL if it has none. */
+} PoolJob;
+
+/**
+ * \typedef PoolState
+ * \brief Platform part of a ThreadPool.
+ */
+typedef struct PoolState {
+    Thread* threads; /**< Handles of the worker threads. */
+    Mutex lock; /**< Guards every other field. */
+    Condition job_ready; /**< Signalled when a job is queued or the pool stops. */
+    Condition all_done; /**< Broadcast when the last pending job of the pool or of a batch finished. */
+    PoolJob* jobs; /**< Ring buffer of the queued jobs. */
+    int job_capacity; /**< Number of jobs the ring buffer holds before it grows. */
+    int job_head; /**< Position of the next job to run. */
+    int job_count; /**< Number of queued jobs. */
+    int pending; /**< Number of jobs queued or running. */
+    bool stopping; /**< Set when the pool is destroyed, the workers exit once the queue is empty. */
+} PoolState;
+
+/**
+ * \brief Returns the number of logical processors.
+ * \return Number of processors, at least 1.
+ */
+int threadpool_cpu_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+/**
+ * \brief Runs queued jobs until the pool stops.
+ * \param state Pointer to the PoolState structure.
+ */
+static void worker_loop(PoolState* state) {
+    mutex_lock(&state->lock);
+    while (true) {
+        while (state->job_count == 0 && !state->stopping) {
+            condition_wait(&state->job_ready, &state->lock);
+        }
+        if (state->job_count == 0) {
+            break;
+        }
+
+        PoolJob job = state->jobs[state->job_head];
+        state->job_head = (state->job_head + 1) % state->job_capacity;
+        state->job_count--;
+        mutex_unlock(&state->lock);
+
+        job.run(job.arg);
+
+        mutex_lock(&state->lock);
+        bool batch_done = job.batch && --job.batch->pending == 0;
+        if (--state->pending == 0 || batch_done) {
+            condition_broadcast(&state->all_done);
+        }
+    }
+    mutex_unlock(&state->lock);
+}
+
+/**
+ * \brief Entry point of a worker thread.
+ * \param arg Pointer to the PoolState structure.
+ */
+#if defined(_WIN32)
+static unsigned __stdcall worker_main(void* arg) {
+    worker_loop((PoolState*)arg);
+    return 0;
+}
+#else
+static void* worker_main(void* arg) {
+    worker_loop((PoolState*)arg);
+    return NULL;
+}
+#endif
+
+/**
+ * \brief Starts the worker threads of a pool.
+ * \param thread_count Number of worker threads, 0 or less starts one per logical processor.
+ * \param pool Pointer to the ThreadPool structure.
+ * \return true on success, false if the memory or the threads could not be allocated.
+ */
+bool threadpool_create(int thread_count, ThreadPool* pool) {
+    if (thread_count <= 0)
+        thread_count = threadpool_cpu_count();
+
+    PoolState* state = core_calloc(1, sizeof(PoolState));
+    if (!state) {
+        return false;
+    }
+    state->job_capacity = 64;
+    state->threads = core_malloc((size_t)thread_count * sizeof(Thread));
+    state->jobs = core_malloc((size_t)state->job_capacity * sizeof(PoolJob));
+    if (!state->threads || !state->jobs) {
+        core_free(state->threads);
+        core_free(state->jobs);
+        core_free(state);
+        return false;
+    }
+
+    mutex_init(&state->lock);
+    condition_init(&state->job_ready);
+    condition_init(&state->all_done);
+    pool->state = state;
+
+    // A pool with fewer threads than asked is still usable, so only a pool without any thread fails
+    pool->thread_count = 0;
+    for (int i = 0; i < thread_count; i++) {
+#if defined(_WIN32)
+        Thread thread = (Thread)_beginthreadex(NULL, 0, worker_main, state, 0, NULL);
+        if (!thread)
+            break;
+#else
+        Thread thread;
+        if (pthread_create(&thread, NULL, worker_main, state) != 0)
+            break;
+#endif
+        state->threads[pool->thread_count++] = thread;
+    }
+
+    if (pool->thread_count == 0) {
+        threadpool_destroy(pool);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Lets the workers finish the queued jobs, then stops them and frees the pool.
+ * \param pool Pointer to the ThreadPool structure.
+ */
+void threadpool_destroy(ThreadPool* pool) {
+    PoolState* state = pool->state;
+    if (!state) {
+        return;
+    }
+
+    mutex_lock(&state->lock);
+    state->stopping = true;
+    condition_broadcast(&state->job_ready);
+    mutex_unlock(&state->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+#if defined(_WIN32)
+        WaitForSingleObject(state->threads[i], INFINITE);
+        CloseHandle(state->threads[i]);
+#else
+        pthread_join(state->threads[i], NULL);
+#endif
+    }
+
+    condition_destroy(&state->all_done);
+    condition_destroy(&state->job_ready);
+    mutex_destroy(&state->lock);
+    core_free(state->threads);
+    core_free(state->jobs);
+    core_free(state);
+    pool->state = NULL;
+    pool->thread_count = 0;
+}
+
+/**
+ * \brief Queues a job for the next idle worker.
+ * \param job Function to run.
+ * \param arg Argument of the function.
+ * \param batch Batch the job belongs to, NULL if it has none.
+ * \param pool Pointer to the ThreadPool structure.
+ * \return true on success, false if the queue could not grow, in which case the job is not run.
+ */
+static bool submit_job(ThreadJob job, void* arg, ThreadBatch* batch, ThreadPool* pool) {
+    PoolState* state = pool->state;
+    mutex_lock(&state->lock);
+
+    if (state->job_count == state->job_capacity) {
+        PoolJob* jobs = core_malloc((size_t)state->job_capacity * 2 * sizeof(PoolJob));
+        if (!jobs) {
+            mutex_unlock(&state->lock);
+            return false;
+        }
+        for (int i = 0; i < state->job_count; i++) {
+            jobs[i] = state->jobs[(state->job_head + i) % state->job_capacity];
+        }
+        core_free(state->jobs);
+        state->jobs = jobs;
+        state->job_head = 0;
+        state->job_capacity *= 2;
+    }
+
+    state->jobs[(state->job_head + state->job_count) % state->job_capacity] = (PoolJob){ job, arg, batch };
+    state->job_count++;
+    state->pending++;
+    if (batch)
+        batch->pending++;
+    condition_signal(&state->job_ready);
+    mutex_unlock(&state->lock);
+    return true;
+}
+
+/**
+ * \brief Queues a job for the next idle worker.
+ * \param job Function to run.
+ * \param arg Argument of the function.
+ * \param pool Pointer to the ThreadPool structure.
+ * \return true on success, false if the queue could not grow, in which case the job is not run.
+ */
+bool threadpool_submit(ThreadJob job, void* arg, ThreadPool* pool) {
+    return submit_job(job, arg, NULL, pool);
+}
+
+/**
+ * \brief Queues a job of a batch for the next idle worker.
+ * \param job Function to run.
+ * \param arg Argument of the function.
+ * \param batch Pointer to the ThreadBatch structure.
+ * \param pool Pointer to the ThreadPool structure.
+ * \return true on success, false if the queue could not grow, in which case the job is not run.
+ */
+bool threadpool_submit_batch(ThreadJob job, void* arg, ThreadBatch* batch, ThreadPool* pool) {
+    return submit_job(job, arg, batch, pool);
+}
+
+/**
+ * \brief Waits until every submitted job has finished.
+ * \param pool Pointer to the ThreadPool structure.
+ */
+void threadpool_wait(ThreadPool* pool) {
+    PoolState* state = pool->state;
+    mutex_lock(&state->lock);
+    while (state->pending > 0) {
+        condition_wait(&state->all_done, &state->lock);
+    }
+    mutex_unlock(&state->lock);
+}
+
+/**
+ * \brief Waits until every job of a batch has finished. Must not be called from a job of the same pool,
+ * which could wait for a job queued behind it.
+ * \param batch Pointer to the ThreadBatch structure.
+ * \param pool Pointer to the ThreadPool structure.
+ */
+void threadpool_wait_batch(ThreadBatch* batch, ThreadPool* pool) {
+    PoolState* state = pool->state;
+    mutex_lock(&state->lock);
+    while (batch->pending > 0) {
+        condition_wait(&state->all_done, &state->lock);
+    }
+    mutex_unlock(&state->lock);
+}
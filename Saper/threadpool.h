@@ -0,0 +1,39 @@
+/*****************************************************************//**
+ * \file   threadpool.h
+ * \brief  Fixed set of worker threads running submitted jobs, on POSIX threads or the Windows API.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * \typedef ThreadJob
+ * \brief Function run by a worker thread, with the argument given to threadpool_submit.
+ */
+typedef void (*ThreadJob)(void* arg);
+
+/**
+ * \typedef ThreadBatch
+ * \brief Group of jobs that can be waited for without waiting for the other jobs of the pool. Starts zeroed.
+ */
+typedef struct ThreadBatch {
+    int pending; /**< Number of jobs of the batch queued or running, guarded by the lock of the pool. */
+} ThreadBatch;
+
+/**
+ * \typedef ThreadPool
+ * \brief Worker threads and the queue of jobs they take from.
+ */
+typedef struct ThreadPool {
+    int thread_count; /**< Number of worker threads. */
+    struct PoolState* state; /**< Threads, lock, condition variables and job queue, behind a pointer so platform headers stay out of this one. */
+} ThreadPool;
+
+int threadpool_cpu_count(void);
+bool threadpool_create(int thread_count, ThreadPool* pool);
+void threadpool_destroy(ThreadPool* pool);
+bool threadpool_submit(ThreadJob job, void* arg, ThreadPool* pool);
+void threadpool_wait(ThreadPool* pool);
+bool threadpool_submit_batch(ThreadJob job, void* arg, ThreadBatch* batch, ThreadPool* pool);
+void threadpool_wait_batch(ThreadBatch* batch, ThreadPool* pool);
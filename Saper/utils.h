@@ -22,3 +22,21 @@
 	* \brief Size of each cell in the game board.
 	*/
 #define CELL_SIZE 45
+
+/**
+ * \def VIEW_MARGIN
+ * \brief Left and right margin of the viewport of boards too large for the window.
+ */
+#define VIEW_MARGIN 20
+
+/**
+ * \def VIEW_TOP
+ * \brief Top edge of the viewport of boards too large for the window, leaving room for the timer and the texts above.
+ */
+#define VIEW_TOP 130
+
+/**
+ * \def VIEW_BOTTOM
+ * \brief Room left under the viewport of boards too large for the window, for the return button.
+ */
+#define VIEW_BOTTOM 100
@@ -0,0 +1,475 @@
+/*****************************************************************//**
+ * \file   world.c
+ * \brief  Unbounded board made of lazily generated chunks, for the infinite mode.
+ *********************************************************************/
+
+#include <string.h>
+#include "allocator.h"
+#include "world.h"
+
+/**
+ * \brief Mixes the bits of a 64-bit value (splitmix64 finalizer), used as a hash.
+ * \param z The value to mix.
+ * \return The mixed value.
+ */
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * \brief Returns the chunk coordinate of a cell coordinate, rounding towards minus infinity.
+ * \param value The row or column of a cell.
+ * \return The row or column of its chunk.
+ */
+static int chunk_of(int value) {
+    return (value < 0 ? value - (CHUNK_SIZE - 1) : value) / CHUNK_SIZE;
+}
+
+/**
+ * \brief Packs chunk coordinates in one 64-bit key.
+ * \param chunk_row The row of the chunk.
+ * \param chunk_col The column of the chunk.
+ * \return The key.
+ */
+static uint64_t chunk_key(int chunk_row, int chunk_col) {
+    return ((uint64_t)(uint32_t)chunk_row << 32) | (uint32_t)chunk_col;
+}
+
+/**
+ * \brief Tells whether a cell holds a mine. Only depends on the seed, the cell and the safe area.
+ * \param row The row of the cell.
+ * \param col The column of the cell.
+ * \param world Pointer to the World structure.
+ * \return True if the cell holds a mine.
+ */
+static bool is_mine(int row, int col, const World* world) {
+    if (world->started && row >= world->safe_row - 1 && row <= world->safe_row + 1 && col >= world->safe_col - 1 && col <= world->safe_col + 1) {
+        return false;
+    }
+
+    int chunk_row = chunk_of(row);
+    int chunk_col = chunk_of(col);
+    uint64_t chunk_seed = mix64(world->seed ^ mix64(chunk_key(chunk_row, chunk_col)));
+    uint64_t index = (uint64_t)(row - chunk_row * CHUNK_SIZE) * CHUNK_SIZE + (uint64_t)(col - chunk_col * CHUNK_SIZE);
+    return mix64(chunk_seed + (index + 1) * 0x9E3779B97F4A7C15ULL) < world->mine_threshold;
+}
+
+/**
+ * \brief Creates an empty world. Chunks are generated later, when cells are looked at.
+ * \param seed Seed the mines are derived from.
+ * \param mine_percent Mine density in percent, clamped to [WORLD_MIN_MINE_PERCENT, WORLD_MAX_MINE_PERCENT].
+ * \param max_expanded Number of expanded chunks kept before the least recently used ones are compressed or dropped, at least 16.
+ * \param world Pointer to the World structure.
+ * \return true on success, false if the memory could not be allocated.
+ */
+bool world_create(uint64_t seed, int mine_percent, int max_expanded, World* world) {
+    if (mine_percent < WORLD_MIN_MINE_PERCENT)
+        mine_percent = WORLD_MIN_MINE_PERCENT;
+    if (mine_percent > WORLD_MAX_MINE_PERCENT)
+        mine_percent = WORLD_MAX_MINE_PERCENT;
+
+    world->seed = seed;
+    world->mine_threshold = UINT64_MAX / 100 * (uint64_t)mine_percent;
+    world->table_size = 256;
+    world->chunk_count = 0;
+    world->lru_head = NULL;
+    world->lru_tail = NULL;
+    world->last_chunk = NULL;
+    world->expanded_count = 0;
+    world->max_expanded = max_expanded < 16 ? 16 : max_expanded;
+    world->opened_count = 0;
+    world->opened_capacity = 4096;
+    world->started = false;
+    world->safe_row = 0;
+    world->safe_col = 0;
+    world->revealed_count = 0;
+    world->flags_placed = 0;
+    world->game_over = false;
+
+    world->table = core_calloc(world->table_size, sizeof(Chunk*));
+    world->opened = core_malloc((size_t)world->opened_capacity * 2 * sizeof(int));
+    if (!world->table || !world->opened) {
+        core_free(world->table);
+        core_free(world->opened);
+        world->table = NULL;
+        world->opened = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Frees all memory of a world.
+ * \param world Pointer to the World structure.
+ */
+void world_destroy(World* world) {
+    if (world->table) {
+        for (int i = 0; i < world->table_size; i++) {
+            if (world->table[i]) {
+                core_free(world->table[i]->cells);
+                core_free(world->table[i]);
+            }
+        }
+    }
+    core_free(world->table);
+    core_free(world->opened);
+    world->table = NULL;
+    world->opened = NULL;
+    world->chunk_count = 0;
+    world->lru_head = NULL;
+    world->lru_tail = NULL;
+    world->last_chunk = NULL;
+    world->expanded_count = 0;
+}
+
+/**
+ * \brief Finds the table slot of a chunk, or the empty slot where it would go.
+ * \param chunk_row The row of the chunk.
+ * \param chunk_col The column of the chunk.
+ * \param world Pointer to the World structure.
+ * \return The slot index.
+ */
+static int find_slot(int chunk_row, int chunk_col, const World* world) {
+    int mask = world->table_size - 1;
+    int slot = (int)(mix64(chunk_key(chunk_row, chunk_col)) & (uint64_t)mask);
+    while (world->table[slot] && (world->table[slot]->chunk_row != chunk_row || world->table[slot]->chunk_col != chunk_col)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/**
+ * \brief Doubles the size of the chunk table.
+ * \param world Pointer to the World structure.
+ * \return false if the memory could not be allocated.
+ */
+static bool grow_table(World* world) {
+    Chunk** old_table = world->table;
+    int old_size = world->table_size;
+
+    world->table = core_calloc((size_t)old_size * 2, sizeof(Chunk*));
+    if (!world->table) {
+        world->table = old_table;
+        return false;
+    }
+    world->table_size = old_size * 2;
+
+    for (int i = 0; i < old_size; i++) {
+        if (old_table[i]) {
+            world->table[find_slot(old_table[i]->chunk_row, old_table[i]->chunk_col, world)] = old_table[i];
+        }
+    }
+    core_free(old_table);
+    return true;
+}
+
+/**
+ * \brief Removes a chunk from the table, shifting back the chunks probed after it so that no lookup breaks.
+ * \param chunk Pointer to the chunk.
+ * \param world Pointer to the World structure.
+ */
+static void remove_chunk(const Chunk* chunk, World* world) {
+    int mask = world->table_size - 1;
+    int hole = find_slot(chunk->chunk_row, chunk->chunk_col, world);
+    world->table[hole] = NULL;
+    world->chunk_count--;
+
+    for (int slot = (hole + 1) & mask; world->table[slot]; slot = (slot + 1) & mask) {
+        Chunk* moved = world->table[slot];
+        int home = (int)(mix64(chunk_key(moved->chunk_row, moved->chunk_col)) & (uint64_t)mask);
+
+        // The chunk may fill the hole only if the hole lies on its probe path, between its home slot and its slot
+        bool reachable = hole <= slot ? (home <= hole || home > slot) : (home <= hole && home > slot);
+        if (reachable) {
+            world->table[hole] = moved;
+            world->table[slot] = NULL;
+            hole = slot;
+        }
+    }
+}
+
+/**
+ * \brief Unlinks an expanded chunk from the LRU list.
+ * \param chunk Pointer to the chunk.
+ * \param world Pointer to the World structure.
+ */
+static void lru_unlink(Chunk* chunk, World* world) {
+    if (chunk->lru_prev)
+        chunk->lru_prev->lru_next = chunk->lru_next;
+    else
+        world->lru_head = chunk->lru_next;
+
+    if (chunk->lru_next)
+        chunk->lru_next->lru_prev = chunk->lru_prev;
+    else
+        world->lru_tail = chunk->lru_prev;
+
+    chunk->lru_prev = NULL;
+    chunk->lru_next = NULL;
+}
+
+/**
+ * \brief Links an expanded chunk at the head of the LRU list.
+ * \param chunk Pointer to the chunk.
+ * \param world Pointer to the World structure.
+ */
+static void lru_push_front(Chunk* chunk, World* world) {
+    chunk->lru_prev = NULL;
+    chunk->lru_next = world->lru_head;
+    if (world->lru_head)
+        world->lru_head->lru_prev = chunk;
+    else
+        world->lru_tail = chunk;
+    world->lru_head = chunk;
+}
+
+/**
+ * \brief Compresses the least recently used expanded chunk, or drops it from the world if it was never touched.
+ * \param world Pointer to the World structure.
+ */
+static void evict_chunk(World* world) {
+    Chunk* chunk = world->lru_tail;
+    lru_unlink(chunk, world);
+    world->expanded_count--;
+
+    if (world->last_chunk == chunk) {
+        world->last_chunk = NULL;
+    }
+
+    if (!chunk->touched) { // Nothing to keep, it is generated again the same way when needed
+        remove_chunk(chunk, world);
+        core_free(chunk->cells);
+        core_free(chunk);
+        return;
+    }
+
+    for (int r = 0; r < CHUNK_SIZE; r++) {
+        uint32_t revealed = 0;
+        uint32_t flagged = 0;
+        for (int c = 0; c < CHUNK_SIZE; c++) {
+            unsigned char cell = chunk->cells[r * CHUNK_SIZE + c];
+            revealed |= (uint32_t)((cell & CELL_REVEALED) != 0) << c;
+            flagged |= (uint32_t)((cell & CELL_FLAGGED) != 0) << c;
+        }
+        chunk->revealed[r] = revealed;
+        chunk->flagged[r] = flagged;
+    }
+    core_free(chunk->cells);
+    chunk->cells = NULL;
+}
+
+/**
+ * \brief Generates the packed cells of a chunk: mines, numbers, and the revealed and flagged bits it was compressed with.
+ * \param chunk Pointer to the chunk.
+ * \param world Pointer to the World structure.
+ * \return false if the memory could not be allocated.
+ */
+static bool expand_chunk(Chunk* chunk, World* world) {
+    chunk->cells = core_malloc(CHUNK_SIZE * CHUNK_SIZE);
+    if (!chunk->cells) {
+        return false;
+    }
+
+    // Mines of the chunk and of a one cell border around it, read from the neighbouring chunks without generating them
+    enum { HALO = CHUNK_SIZE + 2 };
+    bool mines[HALO * HALO];
+    int first_row = chunk->chunk_row * CHUNK_SIZE - 1;
+    int first_col = chunk->chunk_col * CHUNK_SIZE - 1;
+    for (int r = 0; r < HALO; r++) {
+        for (int c = 0; c < HALO; c++) {
+            mines[r * HALO + c] = is_mine(first_row + r, first_col + c, world);
+        }
+    }
+
+    for (int r = 0; r < CHUNK_SIZE; r++) {
+        for (int c = 0; c < CHUNK_SIZE; c++) {
+            const bool* center = &mines[(r + 1) * HALO + c + 1];
+            unsigned char cell = (unsigned char)(center[-HALO - 1] + center[-HALO] + center[-HALO + 1] + center[-1] + center[1] + center[HALO - 1] + center[HALO] + center[HALO + 1]);
+            if (*center)
+                cell |= CELL_MINE;
+            if (chunk->revealed[r] >> c & 1)
+                cell |= CELL_REVEALED;
+            if (chunk->flagged[r] >> c & 1)
+                cell |= CELL_FLAGGED;
+            chunk->cells[r * CHUNK_SIZE + c] = cell;
+        }
+    }
+
+    lru_push_front(chunk, world);
+    world->expanded_count++;
+    while (world->expanded_count > world->max_expanded) {
+        evict_chunk(world);
+    }
+    return true;
+}
+
+/**
+ * \brief Returns the packed cell at the specified coordinates, generating or expanding its chunk when needed.
+ * \param row The row of the cell.
+ * \param col The column of the cell.
+ * \param touch Marks the chunk as touched, so that it is compressed instead of dropped.
+ * \param world Pointer to the World structure.
+ * \return Pointer to the packed cell, valid until the next lookup, or NULL if the memory could not be allocated.
+ */
+static unsigned char* cell_pointer(int row, int col, bool touch, World* world) {
+    int chunk_row = chunk_of(row);
+    int chunk_col = chunk_of(col);
+    Chunk* chunk = world->last_chunk;
+
+    if (!chunk || chunk->chunk_row != chunk_row || chunk->chunk_col != chunk_col) {
+        int slot = find_slot(chunk_row, chunk_col, world);
+        chunk = world->table[slot];
+
+        if (!chunk) {
+            if ((world->chunk_count + 1) * 2 > world->table_size) {
+                if (!grow_table(world))
+                    return NULL;
+                slot = find_slot(chunk_row, chunk_col, world);
+            }
+            chunk = core_calloc(1, sizeof(Chunk));
+            if (!chunk)
+                return NULL;
+            chunk->chunk_row = chunk_row;
+            chunk->chunk_col = chunk_col;
+            world->table[slot] = chunk;
+            world->chunk_count++;
+        }
+
+        if (!chunk->cells) {
+            if (!expand_chunk(chunk, world))
+                return NULL;
+        }
+        else if (world->lru_head != chunk) {
+            lru_unlink(chunk, world);
+            lru_push_front(chunk, world);
+        }
+        world->last_chunk = chunk;
+    }
+
+    if (touch)
+        chunk->touched = true;
+    return &chunk->cells[(row - chunk_row * CHUNK_SIZE) * CHUNK_SIZE + (col - chunk_col * CHUNK_SIZE)];
+}
+
+/**
+ * \brief Returns the packed cell at the specified coordinates, generating its chunk when needed.
+ * \param row The row of the cell.
+ * \param col The column of the cell.
+ * \param world Pointer to the World structure.
+ * \return The packed cell, or an unrevealed empty cell if the memory could not be allocated.
+ */
+unsigned char world_cell(int row, int col, World* world) {
+    const unsigned char* cell = cell_pointer(row, col, false, world);
+    return cell ? *cell : 0;
+}
+
+/**
+ * \brief Appends a cell to the opened list, growing it when full.
+ * \param row The row of the cell.
+ * \param col The column of the cell.
+ * \param world Pointer to the World structure.
+ * \return false if the memory could not be allocated.
+ */
+static bool push_opened(int row, int col, World* world) {
+    if (world->opened_count == world->opened_capacity) {
+        int* opened = core_malloc((size_t)world->opened_capacity * 4 * sizeof(int));
+        if (!opened)
+            return false;
+        memcpy(opened, world->opened, (size_t)world->opened_count * 2 * sizeof(int));
+        core_free(world->opened);
+        world->opened = opened;
+        world->opened_capacity *= 2;
+    }
+    world->opened[2 * world->opened_count] = row;
+    world->opened[2 * world->opened_count + 1] = col;
+    world->opened_count++;
+    return true;
+}
+
+/**
+ * \brief Reveals a cell and, if it has no adjacent mines, the whole empty area around it, across chunk borders.
+ *
+ * The first reveal fixes the safe area: chunks generated before it are compressed or dropped,
+ * so that they are generated again without mines around the first revealed cell.
+ * \param row The row of the cell.
+ * \param col The column of the cell.
+ * \param world Pointer to the World structure.
+ * \return Number of cells opened, stored as row and column pairs in world->opened.
+ */
+int world_reveal(int row, int col, World* world) {
+    world->opened_count = 0;
+
+    if (!world->started) { // The first revealed cell is always safe
+        while (world->expanded_count > 0) {
+            evict_chunk(world);
+        }
+        world->started = true;
+        world->safe_row = row;
+        world->safe_col = col;
+    }
+
+    unsigned char* cell = cell_pointer(row, col, true, world);
+    if (!cell || (*cell & (CELL_REVEALED | CELL_FLAGGED))) {
+        return 0;
+    }
+
+    *cell |= CELL_REVEALED;
+    push_opened(row, col, world);
+
+    if (*cell & CELL_MINE) { // Game over condition
+        world->game_over = true;
+        return world->opened_count;
+    }
+
+    // Reveal all empty adjacent cells, cells are marked as revealed when queued so each one is visited once
+    for (int next = 0; next < world->opened_count; next++) {
+        int r = world->opened[2 * next];
+        int c = world->opened[2 * next + 1];
+        const unsigned char* current = cell_pointer(r, c, false, world);
+        if (!current || (*current & CELL_COUNT_MASK)) {
+            continue;
+        }
+
+        for (int x = -1; x <= 1; x++) {
+            for (int y = -1; y <= 1; y++) {
+                unsigned char* neighbour = cell_pointer(r + x, c + y, true, world);
+                if (neighbour && !(*neighbour & (CELL_REVEALED | CELL_FLAGGED))) {
+                    if (!push_opened(r + x, c + y, world))
+                        continue;
+                    *neighbour |= CELL_REVEALED;
+                }
+            }
+        }
+    }
+
+    world->revealed_count += world->opened_count;
+    return world->opened_count;
+}
+
+/**
+ * \brief Toggles a flag on an unrevealed cell.
+ * \param row The row of the cell.
+ * \param col The column of the cell.
+ * \param world Pointer to the World structure.
+ */
+void world_toggle_flag(int row, int col, World* world) {
+    unsigned char* cell = cell_pointer(row, col, true, world);
+    if (cell && !(*cell & CELL_REVEALED)) {
+        *cell ^= CELL_FLAGGED;
+        world->flags_placed += (*cell & CELL_FLAGGED) ? 1 : -1;
+    }
+}
+
+/**
+ * \brief Returns the heap memory held by a world, which grows with the explored area and not with the coordinates.
+ * \param world Pointer to the World structure.
+ * \return Number of bytes.
+ */
+size_t world_memory_usage(const World* world) {
+    return (size_t)world->table_size * sizeof(Chunk*)
+        + (size_t)world->chunk_count * sizeof(Chunk)
+        + (size_t)world->expanded_count * CHUNK_SIZE * CHUNK_SIZE
+        + (size_t)world->opened_capacity * 2 * sizeof(int);
+}
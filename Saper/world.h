@@ -0,0 +1,88 @@
+/*****************************************************************//**
+ * \file   world.h
+ * \brief  Unbounded board made of lazily generated chunks, for the infinite mode.
+ *
+ * The mines of a chunk are a pure function of the world seed and the chunk coordinates, so chunks are
+ * only generated when a reveal or the viewport touches them, and chunks nobody changed can be dropped
+ * and generated again later. Cells use the same packed format as Board, see the CELL_* bits.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include "board.h"
+
+/**
+ * \def CHUNK_SHIFT
+ * \brief Log2 of the chunk side.
+ */
+#define CHUNK_SHIFT 5
+
+/**
+ * \def CHUNK_SIZE
+ * \brief Number of cells on each side of a chunk.
+ */
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+
+/**
+ * \def WORLD_MIN_MINE_PERCENT
+ * \brief Lowest mine density of a world. Below it empty areas can grow without bound and a flood fill would never end.
+ */
+#define WORLD_MIN_MINE_PERCENT 15
+
+/**
+ * \def WORLD_MAX_MINE_PERCENT
+ * \brief Highest mine density of a world.
+ */
+#define WORLD_MAX_MINE_PERCENT 50
+
+/**
+ * \typedef Chunk
+ * \brief Square of CHUNK_SIZE x CHUNK_SIZE cells of a world.
+ *
+ * An expanded chunk holds its packed cells. A compressed one only keeps its revealed and flagged cells as bits,
+ * the mines and the numbers are generated again when it is expanded.
+ */
+typedef struct Chunk {
+    int chunk_row; /**< Row of the chunk, the cell rows it covers start at chunk_row * CHUNK_SIZE. */
+    int chunk_col; /**< Column of the chunk, the cell columns it covers start at chunk_col * CHUNK_SIZE. */
+    unsigned char* cells; /**< Packed cells of an expanded chunk, NULL while compressed. */
+    uint32_t revealed[CHUNK_SIZE]; /**< Revealed cells of a compressed chunk, one bit per cell and one word per row. */
+    uint32_t flagged[CHUNK_SIZE]; /**< Flagged cells of a compressed chunk, one bit per cell and one word per row. */
+    bool touched; /**< Indicates if a cell was ever revealed or flagged, untouched chunks are dropped instead of compressed. */
+    struct Chunk* lru_prev; /**< More recently used expanded chunk. */
+    struct Chunk* lru_next; /**< Less recently used expanded chunk. */
+} Chunk;
+
+/**
+ * \typedef World
+ * \brief Unbounded minesweeper board and its chunk cache.
+ */
+typedef struct World {
+    uint64_t seed; /**< Seed the mines of every chunk are derived from. */
+    uint64_t mine_threshold; /**< A cell holds a mine when its 64-bit hash is below this value. */
+    Chunk** table; /**< Open addressing hash table of the chunks, linear probing. */
+    int table_size; /**< Number of slots of the table, a power of two. */
+    int chunk_count; /**< Number of chunks in the table. */
+    Chunk* lru_head; /**< Most recently used expanded chunk. */
+    Chunk* lru_tail; /**< Least recently used expanded chunk, the next one to be compressed or dropped. */
+    Chunk* last_chunk; /**< Chunk of the last cell lookup, most lookups hit it again. */
+    int expanded_count; /**< Number of expanded chunks. */
+    int max_expanded; /**< Number of expanded chunks above which the least recently used one is compressed or dropped. */
+    int* opened; /**< Row and column pairs of the cells opened by the last reveal, also used as the flood fill work queue. */
+    int opened_count; /**< Number of cells stored in opened by the last reveal. */
+    int opened_capacity; /**< Number of pairs opened can hold before it grows. */
+    bool started; /**< Indicates if a cell was revealed, which fixes the safe area. */
+    int safe_row; /**< Row of the first revealed cell, the 3x3 area around it holds no mine. */
+    int safe_col; /**< Column of the first revealed cell. */
+    long long revealed_count; /**< Number of safe cells revealed so far. */
+    long long flags_placed; /**< Number of flags currently placed. */
+    bool game_over; /**< Indicates if a mine was revealed. */
+} World;
+
+bool world_create(uint64_t seed, int mine_percent, int max_expanded, World* world);
+void world_destroy(World* world);
+unsigned char world_cell(int row, int col, World* world);
+int world_reveal(int row, int col, World* world);
+void world_toggle_flag(int row, int col, World* world);
+size_t world_memory_usage(const World* world);
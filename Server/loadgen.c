@@ -0,0 +1,464 @@
+/*****************************************************************//**
+ * \file   loadgen.c
+ * \brief  Load generator for the game server: many clients playing at random, with the latency of every request.
+ *
+ * Every client keeps one request in flight and sends the next one as soon as the reply arrives, revealing
+ * random hidden cells and starting a new game once the previous one is over. Clients are split over
+ * threads, each waiting on its own epoll instance, and every thread records its latencies in a histogram
+ * merged at the end.
+ *
+ * Usage: saper_loadgen [--port PORT | --unix PATH] [--connections COUNT] [--threads COUNT] [--seconds SECONDS] [--board ROWS COLS MINES]
+ *********************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "allocator.h"
+#include "histogram.h"
+#include "rng.h"
+#include "threadpool.h"
+
+/**
+ * \def LOADGEN_MAX_EVENTS
+ * \brief Number of epoll events taken at once by a thread.
+ */
+#define LOADGEN_MAX_EVENTS 256
+
+/**
+ * \typedef LoadOptions
+ * \brief Where to connect, how many clients to run and for how long.
+ */
+typedef struct LoadOptions {
+    int port; /**< Loopback TCP port, used when path is NULL. */
+    const char* path; /**< Path of the Unix-domain socket, or NULL. */
+    int connections; /**< Number of clients. */
+    int threads; /**< Number of threads running the clients. */
+    double seconds; /**< Duration of the measure. */
+    int rows; /**< Number of rows of the boards played. */
+    int cols; /**< Number of columns of the boards played. */
+    int mines; /**< Number of mines of the boards played. */
+} LoadOptions;
+
+/**
+ * \typedef Client
+ * \brief One connection to the server and the game it plays.
+ */
+typedef struct Client {
+    int fd; /**< Socket connected to the server. */
+    char* input; /**< Received bytes of the reply being read. */
+    size_t input_size; /**< Number of bytes in input. */
+    int* hidden; /**< Cells not revealed yet, in no order. */
+    int* position; /**< Position of every cell in hidden, -1 once revealed. */
+    int hidden_count; /**< Number of cells in hidden. */
+    uint64_t sent_at; /**< Time the request in flight was sent, in nanoseconds. */
+} Client;
+
+/**
+ * \typedef LoadWorker
+ * \brief The clients of one thread and what they measured.
+ */
+typedef struct LoadWorker {
+    const LoadOptions* options; /**< The shared options. */
+    Client* clients; /**< Clients of the thread. */
+    int client_count; /**< Number of clients. */
+    size_t input_capacity; /**< Size of the input buffer of every client, the longest reply included. */
+    Rng rng; /**< Cells to reveal. */
+    Histogram latency; /**< Latency of every request, in nanoseconds. */
+    long long requests; /**< Number of replies received. */
+    long long wins; /**< Number of games won. */
+    long long losses; /**< Number of games lost. */
+    long long errors; /**< Number of E replies and lost connections. */
+    bool failed; /**< Indicates the clients could not be set up. */
+} LoadWorker;
+
+/**
+ * \brief Returns a monotonic time in nanoseconds.
+ */
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Clients
+
+/**
+ * \brief Connects a socket to the server and makes it non-blocking.
+ * \param options Pointer to the LoadOptions structure.
+ * \return The socket, -1 on failure.
+ */
+static int connect_server(const LoadOptions* options) {
+    int fd = socket(options->path ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int connected;
+    if (options->path) {
+        struct sockaddr_un address = { .sun_family = AF_UNIX };
+        strncpy(address.sun_path, options->path, sizeof(address.sun_path) - 1);
+        connected = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+    else {
+        struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons((uint16_t)options->port) };
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected = connect(fd, (struct sockaddr*)&address, sizeof(address));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    if (connected != 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * \brief Sends a request and starts timing it. Requests are short enough for an empty socket buffer.
+ * \param text The request, with its line ending.
+ * \param client Pointer to the Client structure.
+ * \return false if the connection broke.
+ */
+static bool send_request(const char* text, Client* client) {
+    size_t length = strlen(text);
+    client->sent_at = monotonic_ns();
+    return send(client->fd, text, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+/**
+ * \brief Asks for a new game.
+ * \param worker Pointer to the LoadWorker structure.
+ * \param client Pointer to the Client structure.
+ * \return false if the connection broke.
+ */
+static bool send_new_game(const LoadWorker* worker, Client* client) {
+    char text[64];
+    snprintf(text, sizeof(text), "N %d %d %d\n", worker->options->rows, worker->options->cols, worker->options->mines);
+    return send_request(text, client);
+}
+
+/**
+ * \brief Reveals a random hidden cell.
+ * \param worker Pointer to the LoadWorker structure.
+ * \param client Pointer to the Client structure, with a cell hidden.
+ * \return false if the connection broke.
+ */
+static bool send_reveal(LoadWorker* worker, Client* client) {
+    int cols = worker->options->cols;
+    int index = client->hidden[rng_below((uint32_t)client->hidden_count, &worker->rng)];
+    char text[64];
+    snprintf(text, sizeof(text), "R %d %d\n", index / cols, index % cols);
+    return send_request(text, client);
+}
+
+/**
+ * \brief Marks every cell of a new game as hidden.
+ * \param cell_count Number of cells of the board.
+ * \param client Pointer to the Client structure.
+ */
+static void hide_cells(int cell_count, Client* client) {
+    for (int i = 0; i < cell_count; i++) {
+        client->hidden[i] = i;
+        client->position[i] = i;
+    }
+    client->hidden_count = cell_count;
+}
+
+/**
+ * \brief Removes the cells revealed by a D reply from the hidden ones.
+ * \param cursor The changes of the reply, after its count.
+ * \param cell_count Number of cells of the board.
+ * \param client Pointer to the Client structure.
+ */
+static void reveal_changes(char* cursor, int cell_count, Client* client) {
+    while (*cursor == ' ') {
+        char* end;
+        long index = strtol(cursor + 1, &end, 10);
+        if (*end != ':' || index < 0 || index >= cell_count)
+            return;
+        char value = end[1];
+        cursor = end + 2;
+        int position = client->position[index];
+        if (value == '.' || value == 'F' || position < 0)
+            continue;
+
+        int moved = client->hidden[--client->hidden_count]; // The last hidden cell takes its place
+        client->hidden[position] = moved;
+        client->position[moved] = position;
+        client->position[index] = -1;
+    }
+}
+
+/**
+ * \brief Handles a reply and sends the next request.
+ * \param line The reply, without its line ending.
+ * \param worker Pointer to the LoadWorker structure.
+ * \param client Pointer to the Client structure.
+ * \return false if the connection broke.
+ */
+static bool handle_reply(char* line, LoadWorker* worker, Client* client) {
+    histogram_record(monotonic_ns() - client->sent_at, &worker->latency);
+    worker->requests++;
+    int cell_count = worker->options->rows * worker->options->cols;
+
+    if (line[0] == 'G') {
+        hide_cells(cell_count, client);
+        return send_reveal(worker, client);
+    }
+    if (line[0] == 'D' && line[1] == ' ') {
+        char state = line[2];
+        char* cursor;
+        strtol(line + 3, &cursor, 10);
+        reveal_changes(cursor, cell_count, client);
+        if (state == 'W')
+            worker->wins++;
+        else if (state == 'L')
+            worker->losses++;
+        if (state == 'P' && client->hidden_count > 0)
+            return send_reveal(worker, client);
+        return send_new_game(worker, client);
+    }
+    worker->errors++;
+    return send_new_game(worker, client);
+}
+
+/**
+ * \brief Reads what the socket of a client holds and handles the complete replies.
+ * \param worker Pointer to the LoadWorker structure.
+ * \param client Pointer to the Client structure.
+ * \return false if the connection broke or a reply did not fit the input buffer.
+ */
+static bool receive_replies(LoadWorker* worker, Client* client) {
+    while (true) {
+        ssize_t received = recv(client->fd, client->input + client->input_size, worker->input_capacity - client->input_size, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (received <= 0)
+            return false;
+        client->input_size += (size_t)received;
+
+        size_t consumed = 0;
+        char* end;
+        while ((end = memchr(client->input + consumed, '\n', client->input_size - consumed)) != NULL) {
+            *end = '\0';
+            if (!handle_reply(client->input + consumed, worker, client))
+                return false;
+            consumed = (size_t)(end - client->input) + 1;
+        }
+        memmove(client->input, client->input + consumed, client->input_size - consumed);
+        client->input_size -= consumed;
+        if (client->input_size == worker->input_capacity)
+            return false;
+    }
+}
+
+//
+
+/**
+ * \brief Connects the clients of a thread and plays until the time is up, the job run by the threads.
+ * \param arg Pointer to the LoadWorker structure.
+ */
+static void run_clients(void* arg) {
+    LoadWorker* worker = arg;
+    const LoadOptions* options = worker->options;
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        worker->failed = true;
+        return;
+    }
+
+    for (int c = 0; c < worker->client_count; c++) {
+        Client* client = &worker->clients[c];
+        client->fd = connect_server(options);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+        if (client->fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->fd, &event) != 0 || !send_new_game(worker, client)) {
+            worker->failed = true;
+            worker->client_count = c + (client->fd >= 0); // Only the clients connected so far are closed
+            break;
+        }
+    }
+
+    // Closed loop: a reply sends the next request of its client
+    uint64_t deadline = monotonic_ns() + (uint64_t)(options->seconds * 1e9);
+    struct epoll_event events[LOADGEN_MAX_EVENTS];
+    int open = worker->failed ? 0 : worker->client_count;
+    while (open > 0 && monotonic_ns() < deadline) {
+        int count = epoll_wait(epoll_fd, events, LOADGEN_MAX_EVENTS, 100);
+        for (int i = 0; i < count; i++) {
+            Client* client = events[i].data.ptr;
+            if (!receive_replies(worker, client)) {
+                worker->errors++;
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+                open--;
+            }
+        }
+    }
+    //
+
+    for (int c = 0; c < worker->client_count; c++) {
+        if (worker->clients[c].fd >= 0)
+            close(worker->clients[c].fd);
+    }
+    close(epoll_fd);
+}
+
+/**
+ * \brief Allocates the clients of a thread.
+ * \param client_count Number of clients of the thread.
+ * \param seed Seed of the cells to reveal.
+ * \param options Pointer to the LoadOptions structure.
+ * \param worker Pointer to the LoadWorker structure.
+ * \return false if the memory could not be allocated.
+ */
+static bool create_worker(int client_count, uint64_t seed, const LoadOptions* options, LoadWorker* worker) {
+    memset(worker, 0, sizeof(LoadWorker));
+    worker->options = options;
+    worker->client_count = client_count;
+    worker->input_capacity = 64 + (size_t)options->rows * options->cols * 10;
+    rng_seed(seed, &worker->rng);
+    histogram_reset(&worker->latency);
+
+    worker->clients = core_calloc((size_t)client_count, sizeof(Client));
+    if (!worker->clients) {
+        return false;
+    }
+    size_t cell_count = (size_t)options->rows * options->cols;
+    for (int c = 0; c < client_count; c++) {
+        Client* client = &worker->clients[c];
+        client->fd = -1;
+        client->input = core_malloc(worker->input_capacity);
+        client->hidden = core_malloc(cell_count * sizeof(int));
+        client->position = core_malloc(cell_count * sizeof(int));
+        if (!client->input || !client->hidden || !client->position) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Frees the clients of a thread.
+ * \param worker Pointer to the LoadWorker structure.
+ */
+static void destroy_worker(LoadWorker* worker) {
+    for (int c = 0; worker->clients && c < worker->client_count; c++) {
+        core_free(worker->clients[c].input);
+        core_free(worker->clients[c].hidden);
+        core_free(worker->clients[c].position);
+    }
+    core_free(worker->clients);
+}
+
+/**
+ * \brief Runs the clients and prints the throughput and the latency percentiles.
+ * \param argc Number of command line arguments.
+ * \param argv Command line arguments.
+ * \return 0 on success, 1 on invalid arguments or if the clients could not connect.
+ */
+int main(int argc, char** argv) {
+    LoadOptions options = { .port = 7878, .path = NULL, .connections = 64, .threads = 0, .seconds = 10.0, .rows = 16, .cols = 30, .mines = 99 };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+            options.port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+            options.path = argv[++i];
+        else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc)
+            options.connections = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            options.seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--board") == 0 && i + 3 < argc) {
+            options.rows = atoi(argv[++i]);
+            options.cols = atoi(argv[++i]);
+            options.mines = atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--port PORT | --unix PATH] [--connections COUNT] [--threads COUNT] [--seconds SECONDS] [--board ROWS COLS MINES]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.connections < 1 || options.seconds <= 0.0 || options.rows < 1 || options.cols < 1 || options.mines < 0 || options.mines >= options.rows * options.cols) {
+        fprintf(stderr, "Invalid options.\n");
+        return 1;
+    }
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    ThreadPool pool;
+    if (!threadpool_create(options.threads, &pool)) {
+        fprintf(stderr, "Cannot start the threads.\n");
+        return 1;
+    }
+    int worker_count = pool.thread_count < options.connections ? pool.thread_count : options.connections;
+    LoadWorker* workers = core_calloc((size_t)worker_count, sizeof(LoadWorker));
+    bool created = workers != NULL;
+    for (int w = 0; created && w < worker_count; w++) {
+        int first = (int)((long long)options.connections * w / worker_count);
+        int last = (int)((long long)options.connections * (w + 1) / worker_count);
+        created = create_worker(last - first, (uint64_t)time(NULL) + (uint64_t)w, &options, &workers[w]);
+        if (!created) {
+            worker_count = w + 1; // Only the workers set up so far are destroyed
+        }
+    }
+
+    // Every thread plays its clients, the measure covers the slowest one
+    uint64_t begin = monotonic_ns();
+    if (created) {
+        ThreadBatch batch = { 0 };
+        for (int w = 0; w < worker_count; w++) {
+            if (!threadpool_submit_batch(run_clients, &workers[w], &batch, &pool))
+                run_clients(&workers[w]);
+        }
+        threadpool_wait_batch(&batch, &pool);
+    }
+    double seconds = (monotonic_ns() - begin) / 1e9;
+    //
+
+    Histogram latency;
+    histogram_reset(&latency);
+    long long requests = 0, wins = 0, losses = 0, errors = 0;
+    bool failed = !created;
+    for (int w = 0; workers && w < worker_count; w++) {
+        histogram_merge(&workers[w].latency, &latency);
+        requests += workers[w].requests;
+        wins += workers[w].wins;
+        losses += workers[w].losses;
+        errors += workers[w].errors;
+        failed = failed || workers[w].failed;
+        destroy_worker(&workers[w]);
+    }
+    core_free(workers);
+    threadpool_destroy(&pool);
+    if (failed) {
+        fprintf(stderr, "Cannot connect %d clients to the server.\n", options.connections);
+        return 1;
+    }
+
+    printf("%d connections on %d threads, %dx%d boards with %d mines, %.1f s\n", options.connections, worker_count, options.rows, options.cols, options.mines, seconds);
+    printf("%lld requests, %.0f requests per second\n", requests, requests / seconds);
+    printf("%lld games won, %lld games lost, %lld errors\n", wins, losses, errors);
+    printf("latency us: mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n", histogram_mean(&latency) / 1e3,
+        histogram_percentile(50.0, &latency) / 1e3, histogram_percentile(90.0, &latency) / 1e3, histogram_percentile(99.0, &latency) / 1e3,
+        histogram_percentile(99.9, &latency) / 1e3, latency.max / 1e3);
+    return 0;
+}
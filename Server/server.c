@@ -0,0 +1,403 @@
+/*****************************************************************//**
+ * \file   server.c
+ * \brief  Game server hosting many sessions over a Unix-domain or loopback TCP socket.
+ *
+ * One thread waits on epoll for every socket. Client sockets are registered one-shot, so a ready session is
+ * handed to a worker of the thread pool, which reads it, runs its requests, sends the replies and arms it
+ * again. A session is thus only ever touched by one thread at a time, without a lock of its own.
+ *
+ * Usage: saper_server [--port PORT | --unix PATH] [--threads COUNT]
+ *********************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "allocator.h"
+#include "atomics.h"
+#include "session.h"
+#include "threadpool.h"
+
+/**
+ * \def SERVER_DEFAULT_PORT
+ * \brief Loopback TCP port listened on when no socket is given.
+ */
+#define SERVER_DEFAULT_PORT 7878
+
+/**
+ * \def SERVER_MAX_EVENTS
+ * \brief Number of epoll events taken at once by the I/O thread.
+ */
+#define SERVER_MAX_EVENTS 256
+
+/**
+ * \def SERVER_REPORT_SECONDS
+ * \brief Interval between two lines of activity on the standard error.
+ */
+#define SERVER_REPORT_SECONDS 5
+
+/**
+ * \typedef Server
+ * \brief Listening socket, epoll instance, workers and open connections.
+ */
+typedef struct Server {
+    int epoll_fd; /**< The epoll instance every socket is registered with. */
+    int listen_fd; /**< The listening socket. */
+    bool tcp; /**< Indicates a TCP socket rather than a Unix-domain one. */
+    ThreadPool pool; /**< Workers serving the ready connections. */
+    pthread_mutex_t lock; /**< Guards the list of connections. */
+    struct Connection* connections; /**< Open connections, for the shutdown. */
+    AtomicInt connection_count; /**< Number of open connections. */
+    AtomicInt request_count; /**< Requests run since the start, wrapping around. */
+    Rng rng; /**< Seeds of the sessions, used by the I/O thread only. */
+} Server;
+
+/**
+ * \typedef Connection
+ * \brief A session with what the server needs to serve it.
+ */
+typedef struct Connection {
+    Session session; /**< The client, its game and its buffers. */
+    Server* server; /**< The server the connection belongs to. */
+    uint32_t events; /**< Epoll events of the wake-up being served. */
+    struct Connection* previous; /**< Previous connection of the server. */
+    struct Connection* next; /**< Next connection of the server. */
+} Connection;
+
+/**
+ * \brief Set by SIGINT and SIGTERM, the I/O loop stops when it sees it.
+ */
+static volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * \brief Asks the I/O loop to stop.
+ */
+static void request_stop(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+// Connections
+
+/**
+ * \brief Sends as much of the output of a session as the socket takes, and moves what is left to the front.
+ * \param session Pointer to the Session structure.
+ * \return false if the connection broke.
+ */
+static bool send_output(Session* session) {
+    while (session->output_sent < session->output_size) {
+        ssize_t sent = send(session->fd, session->output + session->output_sent, session->output_size - session->output_sent, MSG_NOSIGNAL);
+        if (sent > 0)
+            session->output_sent += (size_t)sent;
+        else if (sent < 0 && errno == EINTR)
+            continue;
+        else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            return false;
+    }
+
+    if (session->output_sent > 0) {
+        memmove(session->output, session->output + session->output_sent, session->output_size - session->output_sent);
+        session->output_size -= session->output_sent;
+        session->output_sent = 0;
+    }
+    return true;
+}
+
+/**
+ * \brief Reads what the socket of a session holds, as long as the input has room.
+ * \param session Pointer to the Session structure.
+ * \param peer_closed Set when the client closed its side.
+ * \return false if the connection broke.
+ */
+static bool receive_input(Session* session, bool* peer_closed) {
+    while (session->input_size < SESSION_INPUT_SIZE) {
+        ssize_t received = recv(session->fd, session->input + session->input_size, SESSION_INPUT_SIZE - session->input_size, 0);
+        if (received > 0) {
+            session->input_size += (size_t)received;
+        }
+        else if (received == 0) {
+            *peer_closed = true;
+            return true;
+        }
+        else if (errno == EINTR) {
+            continue;
+        }
+        else {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    return true;
+}
+
+/**
+ * \brief Unregisters a connection, closes its socket and frees it.
+ * \param connection Pointer to the Connection structure, no longer armed in epoll.
+ */
+static void close_connection(Connection* connection) {
+    Server* server = connection->server;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, connection->session.fd, NULL);
+    close(connection->session.fd);
+
+    pthread_mutex_lock(&server->lock);
+    if (connection->previous)
+        connection->previous->next = connection->next;
+    else
+        server->connections = connection->next;
+    if (connection->next)
+        connection->next->previous = connection->previous;
+    pthread_mutex_unlock(&server->lock);
+
+    session_destroy(&connection->session);
+    core_free(connection);
+    atomic_int_add(&server->connection_count, -1);
+}
+
+/**
+ * \brief Serves a connection woken up by epoll, the job run by the workers.
+ *
+ * Reads the socket, runs the requests and sends the replies until the socket is drained or full, then arms
+ * the connection again for what it waits for: input while it has room for it, output while replies are left.
+ * \param arg Pointer to the Connection structure.
+ */
+static void serve_connection(void* arg) {
+    Connection* connection = arg;
+    Session* session = &connection->session;
+    Server* server = connection->server;
+
+    bool peer_closed = false;
+    bool open = !(connection->events & EPOLLERR) && receive_input(session, &peer_closed);
+
+    // Requests and replies, until every request ran or the socket is full
+    while (open) {
+        size_t waiting = session->output_size;
+        int count = session_run_requests(session);
+        atomic_int_add(&server->request_count, count);
+        open = send_output(session);
+        if (session->output_size > 0 || (count == 0 && waiting == 0))
+            break;
+    }
+    //
+
+    uint32_t events = EPOLLONESHOT | EPOLLRDHUP;
+    if (!peer_closed && !session->closing && session->input_size < SESSION_INPUT_SIZE)
+        events |= EPOLLIN;
+    if (session->output_size > 0)
+        events |= EPOLLOUT;
+
+    struct epoll_event event = { .events = events, .data.ptr = connection };
+    if (!open || !(events & (EPOLLIN | EPOLLOUT)) || epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, session->fd, &event) != 0) {
+        close_connection(connection);
+    }
+}
+
+/**
+ * \brief Accepts every pending client and registers its connection.
+ * \param server Pointer to the Server structure.
+ */
+static void accept_connections(Server* server) {
+    while (true) {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EMFILE || errno == ENFILE)
+                fprintf(stderr, "Out of file descriptors, %d sessions open.\n", atomic_int_load(&server->connection_count));
+            return;
+        }
+        if (server->tcp) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Replies are small and awaited
+        }
+
+        Connection* connection = core_malloc(sizeof(Connection));
+        if (!connection || !session_init(fd, rng_next(&server->rng), &connection->session)) {
+            if (connection)
+                session_destroy(&connection->session);
+            core_free(connection);
+            close(fd);
+            continue;
+        }
+        connection->server = server;
+
+        // Listed before it is armed, a worker may close it right away
+        pthread_mutex_lock(&server->lock);
+        connection->previous = NULL;
+        connection->next = server->connections;
+        if (server->connections)
+            server->connections->previous = connection;
+        server->connections = connection;
+        pthread_mutex_unlock(&server->lock);
+        atomic_int_add(&server->connection_count, 1);
+
+        struct epoll_event event = { .events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, .data.ptr = connection };
+        if (epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close_connection(connection);
+        }
+    }
+}
+
+//
+
+// Setup
+
+/**
+ * \brief Opens the listening socket.
+ * \param port Loopback TCP port, used when path is NULL.
+ * \param path Path of the Unix-domain socket, replaced if it exists, or NULL.
+ * \return The socket, -1 on failure.
+ */
+static int open_listener(int port, const char* path) {
+    int fd = socket(path ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int bound;
+    if (path) {
+        struct sockaddr_un address = { .sun_family = AF_UNIX };
+        if (strlen(path) >= sizeof(address.sun_path)) {
+            close(fd);
+            return -1;
+        }
+        strcpy(address.sun_path, path);
+        unlink(path);
+        bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+    else {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Local clients only, the protocol has no authentication
+        bound = bind(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+
+    if (bound != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * \brief Raises the limit of open files to its maximum, so that thousands of sessions fit.
+ */
+static void raise_file_limit(void) {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/**
+ * \brief Returns a monotonic time in seconds.
+ */
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//
+
+/**
+ * \brief Runs the server until SIGINT or SIGTERM.
+ * \param argc Number of command line arguments.
+ * \param argv Command line arguments.
+ * \return 0 on success, 1 if the server could not start.
+ */
+int main(int argc, char** argv) {
+    int port = SERVER_DEFAULT_PORT;
+    const char* path = NULL;
+    int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+            port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--unix") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--port PORT | --unix PATH] [--threads COUNT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    raise_file_limit();
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, request_stop);
+    signal(SIGTERM, request_stop);
+
+    Server server;
+    memset(&server, 0, sizeof(server));
+    rng_seed((uint64_t)time(NULL), &server.rng);
+    pthread_mutex_init(&server.lock, NULL);
+    server.tcp = path == NULL;
+    server.listen_fd = open_listener(port, path);
+    server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (server.listen_fd < 0 || server.epoll_fd < 0 || !threadpool_create(threads, &server.pool)) {
+        fprintf(stderr, "Cannot start the server: %s\n", strerror(errno));
+        return 1;
+    }
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.listen_fd, &listen_event);
+    if (path)
+        fprintf(stderr, "Listening on %s with %d workers.\n", path, server.pool.thread_count);
+    else
+        fprintf(stderr, "Listening on 127.0.0.1:%d with %d workers.\n", port, server.pool.thread_count);
+
+    // I/O loop: accepts clients and hands ready connections to the workers
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    double report_time = monotonic_seconds();
+    unsigned report_requests = 0; // Unsigned, so the difference stays right after the counter wraps around
+    while (!stop_requested) {
+        int count = epoll_wait(server.epoll_fd, events, SERVER_MAX_EVENTS, 1000);
+        for (int i = 0; i < count; i++) {
+            Connection* connection = events[i].data.ptr;
+            if (!connection) {
+                accept_connections(&server);
+                continue;
+            }
+            connection->events = events[i].events;
+            if (!threadpool_submit(serve_connection, connection, &server.pool))
+                serve_connection(connection);
+        }
+
+        double now = monotonic_seconds();
+        if (now - report_time >= SERVER_REPORT_SECONDS) {
+            unsigned requests = (unsigned)atomic_int_load(&server.request_count);
+            fprintf(stderr, "%d sessions, %.0f requests per second\n", atomic_int_load(&server.connection_count),
+                (requests - report_requests) / (now - report_time));
+            report_time = now;
+            report_requests = requests;
+        }
+    }
+    //
+
+    // Shutdown: the workers finish what they were given, then every connection left is closed
+    close(server.listen_fd);
+    threadpool_wait(&server.pool);
+    while (server.connections) {
+        close_connection(server.connections);
+    }
+    threadpool_destroy(&server.pool);
+    close(server.epoll_fd);
+    pthread_mutex_destroy(&server.lock);
+    if (path)
+        unlink(path);
+    fprintf(stderr, "Server stopped.\n");
+    //
+    return 0;
+}
@@ -0,0 +1,373 @@
+/*****************************************************************//**
+ * \file   session.c
+ * \brief  Parsing the requests of a session, running them on its board and writing the replies.
+ *********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "session.h"
+
+/**
+ * \def SESSION_CELL_TEXT
+ * \brief Longest text of a change in a reply: a space, an index below SESSION_MAX_CELLS, a colon and a value.
+ */
+#define SESSION_CELL_TEXT 10
+
+// Replies
+
+/**
+ * \brief Returns the room a reply about the current board may need in the output, the longest line included.
+ */
+static size_t reply_bound(const Session* session) {
+    size_t cell_count = (size_t)session->board.rows * session->board.cols;
+    return 64 + cell_count * SESSION_CELL_TEXT;
+}
+
+/**
+ * \brief Appends text to the output, which has room for it.
+ */
+static void append_text(const char* text, Session* session) {
+    size_t length = strlen(text);
+    memcpy(session->output + session->output_size, text, length);
+    session->output_size += length;
+}
+
+/**
+ * \brief Appends a space and a number to the output, which has room for them.
+ */
+static void append_number(unsigned long long value, Session* session) {
+    char digits[20];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    char* out = session->output + session->output_size;
+    *out++ = ' ';
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    session->output_size = (size_t)(out - session->output);
+}
+
+/**
+ * \brief Appends an error reply to the output, which always has room for it.
+ */
+static void append_error(const char* message, Session* session) {
+    append_text("E ", session);
+    append_text(message, session);
+    append_text("\n", session);
+}
+
+/**
+ * \brief Returns the letter of the state of the game: P while playing, W once won, L once lost.
+ */
+static char game_state(const Board* board) {
+    return board->game_won ? 'W' : board->game_over ? 'L' : 'P';
+}
+
+/**
+ * \brief Returns the character a client sees for a cell.
+ */
+static char cell_value(unsigned char cell) {
+    if (cell & CELL_REVEALED)
+        return (cell & CELL_MINE) ? '*' : (char)('0' + (cell & CELL_COUNT_MASK));
+    return (cell & CELL_FLAGGED) ? 'F' : '.';
+}
+
+/**
+ * \brief Appends a D reply listing cells that changed.
+ * \param indices Indices of the cells.
+ * \param count Number of cells.
+ * \param session Pointer to the Session structure.
+ */
+static void append_changes(const int* indices, int count, Session* session) {
+    char header[3] = { 'D', ' ', game_state(&session->board) };
+    memcpy(session->output + session->output_size, header, sizeof(header));
+    session->output_size += sizeof(header);
+    append_number((unsigned long long)count, session);
+
+    for (int i = 0; i < count; i++) {
+        append_number((unsigned long long)indices[i], session);
+        session->output[session->output_size++] = ':';
+        session->output[session->output_size++] = cell_value(session->board.cells[indices[i]]);
+    }
+    session->output[session->output_size++] = '\n';
+}
+
+//
+
+// Requests
+
+/**
+ * \brief Reads the next number of a request.
+ * \param cursor Pointer to the position in the line, moved past the number.
+ * \param value Receives the number.
+ * \return false if no number follows.
+ */
+static bool parse_number(char** cursor, long long* value) {
+    char* end;
+    *value = strtoll(*cursor, &end, 10);
+    if (end == *cursor)
+        return false;
+    *cursor = end;
+    return true;
+}
+
+/**
+ * \brief Reads the seed of a request, which may not fit a signed number.
+ * \param cursor Pointer to the position in the line, moved past the seed.
+ * \param seed Receives the seed.
+ * \return false if no seed follows.
+ */
+static bool parse_seed(char** cursor, uint64_t* seed) {
+    while (**cursor == ' ' || **cursor == '\t')
+        (*cursor)++;
+    if (**cursor < '0' || **cursor > '9')
+        return false;
+    char* end;
+    *seed = (uint64_t)strtoull(*cursor, &end, 10);
+    *cursor = end;
+    return true;
+}
+
+/**
+ * \brief Tells whether only spaces are left in a request.
+ */
+static bool at_line_end(const char* cursor) {
+    while (*cursor == ' ' || *cursor == '\t')
+        cursor++;
+    return *cursor == '\0';
+}
+
+/**
+ * \brief Makes the arena hold a new game and its output buffer, the previous game being dropped.
+ *
+ * The output must be empty. When the memory runs out, the session keeps an output buffer without a game if it can.
+ * \param rows Number of rows of the board.
+ * \param cols Number of columns of the board.
+ * \param mines Number of mines of the board.
+ * \param seed Seed of the mine placement.
+ * \param session Pointer to the Session structure.
+ * \return false if the memory could not be allocated.
+ */
+static bool start_game(int rows, int cols, int mines, uint64_t seed, Session* session) {
+    size_t cell_count = (size_t)rows * cols;
+    size_t capacity = 64 + cell_count * SESSION_CELL_TEXT;
+    if (capacity < SESSION_MIN_OUTPUT)
+        capacity = SESSION_MIN_OUTPUT;
+
+    Board* board = &session->board;
+    board->rows = 0;
+    board->cols = 0;
+    if (arena_reserve(capacity + cell_count + cell_count * sizeof(int) + 3 * ARENA_ALIGNMENT, &session->arena)) {
+        session->output = arena_alloc(capacity, &session->arena);
+        session->output_capacity = capacity;
+        board->cells = arena_alloc(cell_count, &session->arena);
+        board->opened = arena_alloc(cell_count * sizeof(int), &session->arena);
+        board->mapping = NULL;
+        board->mapping_size = 0;
+        board->rows = rows;
+        board->cols = cols;
+        reset_board(mines, seed, board);
+        return true;
+    }
+
+    bool kept = arena_reserve(SESSION_MIN_OUTPUT, &session->arena);
+    session->output = kept ? arena_alloc(SESSION_MIN_OUTPUT, &session->arena) : NULL;
+    session->output_capacity = kept ? SESSION_MIN_OUTPUT : 0;
+    session->closing = !kept; // Not even an error can be sent back
+    return false;
+}
+
+/**
+ * \brief Runs an N request.
+ * \param cursor The request after its letter.
+ * \param session Pointer to the Session structure, with an empty output.
+ */
+static void run_new_game(char* cursor, Session* session) {
+    long long rows, cols, mines;
+    uint64_t seed = 0;
+    if (!parse_number(&cursor, &rows) || !parse_number(&cursor, &cols) || !parse_number(&cursor, &mines)) {
+        append_error("usage: N rows cols mines [seed]", session);
+        return;
+    }
+    bool seeded = parse_seed(&cursor, &seed);
+    if (!at_line_end(cursor)) {
+        append_error("usage: N rows cols mines [seed]", session);
+        return;
+    }
+    if (rows < 1 || cols < 1 || rows > SESSION_MAX_CELLS || cols > SESSION_MAX_CELLS || rows * cols > SESSION_MAX_CELLS || mines < 0 || mines >= rows * cols) {
+        append_error("board out of range", session);
+        return;
+    }
+
+    uint64_t game_seed = seeded ? seed : rng_next(&session->rng);
+    if (!start_game((int)rows, (int)cols, (int)mines, game_seed, session)) {
+        if (session->output)
+            append_error("out of memory", session);
+        return;
+    }
+
+    append_text("G", session);
+    append_number((unsigned long long)rows, session);
+    append_number((unsigned long long)cols, session);
+    append_number((unsigned long long)mines, session);
+    append_number(game_seed, session);
+    append_text("\n", session);
+}
+
+/**
+ * \brief Runs an R or F request.
+ * \param flag Indicates an F request.
+ * \param cursor The request after its letter.
+ * \param session Pointer to the Session structure.
+ */
+static void run_move(bool flag, char* cursor, Session* session) {
+    Board* board = &session->board;
+    long long row, col;
+    if (!parse_number(&cursor, &row) || !parse_number(&cursor, &col) || !at_line_end(cursor)) {
+        append_error(flag ? "usage: F row col" : "usage: R row col", session);
+        return;
+    }
+    if (board->rows == 0) {
+        append_error("no game", session);
+        return;
+    }
+    if (row < 0 || row >= board->rows || col < 0 || col >= board->cols) {
+        append_error("cell out of range", session);
+        return;
+    }
+    if (board->game_over || board->game_won) {
+        append_error("game over", session);
+        return;
+    }
+
+    int index = (int)row * board->cols + (int)col;
+    if (flag) {
+        bool changed = !(board->cells[index] & CELL_REVEALED);
+        toggle_flag((int)row, (int)col, board);
+        append_changes(&index, changed ? 1 : 0, session);
+    }
+    else {
+        int opened = reveal_cell((int)row, (int)col, board);
+        append_changes(board->opened, opened, session);
+    }
+}
+
+/**
+ * \brief Runs an S request.
+ * \param session Pointer to the Session structure.
+ */
+static void run_show_board(Session* session) {
+    Board* board = &session->board;
+    if (board->rows == 0) {
+        append_error("no game", session);
+        return;
+    }
+
+    append_text("B", session);
+    append_number((unsigned long long)board->rows, session);
+    append_number((unsigned long long)board->cols, session);
+
+    int cell_count = board->rows * board->cols;
+    char* out = session->output + session->output_size;
+    *out++ = ' ';
+    *out++ = game_state(board);
+    *out++ = ' ';
+    for (int i = 0; i < cell_count; i++) {
+        *out++ = cell_value(board->cells[i]);
+    }
+    *out++ = '\n';
+    session->output_size = (size_t)(out - session->output);
+}
+
+/**
+ * \brief Runs one request.
+ * \param line The request, without its line ending.
+ * \param session Pointer to the Session structure.
+ */
+static void run_request(char* line, Session* session) {
+    switch (line[0]) {
+    case 'N': run_new_game(line + 1, session); break;
+    case 'R': run_move(false, line + 1, session); break;
+    case 'F': run_move(true, line + 1, session); break;
+    case 'S': run_show_board(session); break;
+    case 'Q': session->closing = true; break;
+    default: append_error("unknown request", session); break;
+    }
+}
+
+//
+
+/**
+ * \brief Prepares a session with an output buffer and no game.
+ * \param fd Socket of the client.
+ * \param seed Seed of the games requested without one.
+ * \param session Pointer to the Session structure.
+ * \return false if the memory could not be allocated.
+ */
+bool session_init(int fd, uint64_t seed, Session* session) {
+    memset(session, 0, sizeof(Session));
+    session->fd = fd;
+    rng_seed(seed, &session->rng);
+    if (!arena_reserve(SESSION_MIN_OUTPUT, &session->arena)) {
+        return false;
+    }
+    session->output = arena_alloc(SESSION_MIN_OUTPUT, &session->arena);
+    session->output_capacity = SESSION_MIN_OUTPUT;
+    return true;
+}
+
+/**
+ * \brief Frees the buffers of a session. Its socket is left to the caller.
+ * \param session Pointer to the Session structure.
+ */
+void session_destroy(Session* session) {
+    arena_destroy(&session->arena);
+    session->output = NULL;
+    session->board.cells = NULL;
+    session->board.opened = NULL;
+}
+
+/**
+ * \brief Runs the complete requests of the input, in order, as long as the output has room for their replies.
+ *
+ * Stops early when the output is too full for the longest reply about the board, or not empty before an
+ * N request, which replaces the output buffer. The requests left run once the output was sent. A line longer
+ * than the input buffer closes the session.
+ * \param session Pointer to the Session structure.
+ * \return Number of requests run.
+ */
+int session_run_requests(Session* session) {
+    int count = 0;
+    size_t consumed = 0;
+    while (!session->closing) {
+        char* line = session->input + consumed;
+        char* end = memchr(line, '\n', session->input_size - consumed);
+        if (!end) {
+            if (consumed == 0 && session->input_size == SESSION_INPUT_SIZE) {
+                if (session->output_capacity - session->output_size >= 64)
+                    append_error("line too long", session);
+                session->closing = true;
+            }
+            break;
+        }
+        if (session->output_capacity - session->output_size < reply_bound(session))
+            break;
+        if (line[0] == 'N' && session->output_size > 0)
+            break;
+
+        *end = '\0';
+        if (end > line && end[-1] == '\r')
+            end[-1] = '\0';
+        run_request(line, session);
+        consumed = (size_t)(end - session->input) + 1;
+        count++;
+    }
+
+    memmove(session->input, session->input + consumed, session->input_size - consumed);
+    session->input_size -= consumed;
+    return count;
+}
@@ -0,0 +1,68 @@
+/*****************************************************************//**
+ * \file   session.h
+ * \brief  One client of the game server: its game, its buffers and the line protocol it speaks.
+ *
+ * Requests are lines of ASCII text, answered in order with one line each:
+ *
+ *     N rows cols mines [seed]   new game, the previous one is dropped     ->  G rows cols mines seed
+ *     R row col                  reveal a cell                              ->  D state count changes
+ *     F row col                  toggle a flag                              ->  D state count changes
+ *     S                          whole board                                ->  B rows cols state cells
+ *     Q                          close the session                              no reply
+ *
+ * The state is P while playing, W once won and L once lost. A change is index:value, the index being
+ * row * cols + col and the value 0 to 8 for a revealed count, * for a revealed mine, F for a flag and . for
+ * a hidden cell. The board of S gives the value of every cell in row order, without separators. A request
+ * that cannot be served is answered with E and a message, the session goes on.
+ *
+ * Sessions know nothing of sockets: the server fills the input, runs the requests and sends the output.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "arena.h"
+#include "board.h"
+#include "rng.h"
+
+/**
+ * \def SESSION_INPUT_SIZE
+ * \brief Size of the input buffer, the longest request line included.
+ */
+#define SESSION_INPUT_SIZE 4096
+
+/**
+ * \def SESSION_MIN_OUTPUT
+ * \brief Size of the output buffer before the first game, and its smallest size for small boards.
+ */
+#define SESSION_MIN_OUTPUT 4096
+
+/**
+ * \def SESSION_MAX_CELLS
+ * \brief Largest board a session may play, in cells, so that no client can make the server allocate without bound.
+ */
+#define SESSION_MAX_CELLS (1 << 20)
+
+/**
+ * \typedef Session
+ * \brief A client of the server, handled by one thread at a time.
+ */
+typedef struct Session {
+    int fd; /**< Socket of the client. */
+    Arena arena; /**< Output buffer and board buffers of the current game, emptied by every N request. */
+    Board board; /**< The current game, 0 rows before the first N request. */
+    Rng rng; /**< Seeds of the games requested without one. */
+    char input[SESSION_INPUT_SIZE]; /**< Received bytes not yet run as requests. */
+    size_t input_size; /**< Number of bytes in input. */
+    char* output; /**< Replies not yet sent, taken from the arena. */
+    size_t output_capacity; /**< Size of the output buffer. */
+    size_t output_size; /**< Number of bytes in output. */
+    size_t output_sent; /**< Number of bytes of output already sent. */
+    bool closing; /**< Indicates that the client asked to leave or broke the protocol: no request is run any more. */
+} Session;
+
+bool session_init(int fd, uint64_t seed, Session* session);
+void session_destroy(Session* session);
+int session_run_requests(Session* session);
@@ -0,0 +1,61 @@
+/*****************************************************************//**
+ * \file   main.c
+ * \brief  The entry point of the command-line tools.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tools.h"
+
+/**
+ * \typedef Tool
+ * \brief A command that can be selected on the command line.
+ */
+typedef struct Tool {
+    const char* name; /**< Name used on the command line. */
+    const char* usage; /**< Arguments taken after the name. */
+    int (*run)(int count, char** args, uint64_t seed); /**< Function running the command with its arguments and the seed of the boards. */
+} Tool;
+
+/**
+ * \brief Runs one command on the headless core, without opening a window.
+ *
+ * Usage: saper_tools [--seed N] COMMAND ARGUMENTS..., the commands being:
+ * verify FILE..., which verifies the replays of the files;
+ * analyze GAMES [ROWS COLS MINES], which prints the bot win rate, forced guesses and 3BV of the easy, medium and
+ * hard presets, or of the given size;
+ * bots GAMES ROWS COLS MINES PLUGIN [PLUGIN], which plays the same games with one or two bot plugins and compares them.
+ * Without --seed, the boards are drawn from the current time.
+ * \param argc Number of command line arguments.
+ * \param argv Command line arguments.
+ * \return The result of the command, 0 on success, or 1 on invalid arguments.
+ */
+int main(int argc, char** argv) {
+    static const Tool tools[] = {
+        { "verify", "FILE...", tool_verify },
+        { "analyze", "GAMES [ROWS COLS MINES]", tool_analyze },
+        { "bots", "GAMES ROWS COLS MINES PLUGIN [PLUGIN]", tool_bots },
+    };
+    const int tool_count = (int)(sizeof(tools) / sizeof(tools[0]));
+    uint64_t seed = (uint64_t)time(NULL);
+
+    int i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+        seed = strtoull(argv[i + 1], NULL, 10);
+        i += 2;
+    }
+
+    for (int t = 0; i < argc && t < tool_count; t++) {
+        if (strcmp(argv[i], tools[t].name) == 0) {
+            return tools[t].run(argc - i - 1, argv + i + 1, seed);
+        }
+    }
+
+    fprintf(stderr, "Usage: %s [--seed N] COMMAND ARGUMENTS...\n", argv[0]);
+    for (int t = 0; t < tool_count; t++) {
+        fprintf(stderr, "  %s %s\n", tools[t].name, tools[t].usage);
+    }
+    return 1;
+}
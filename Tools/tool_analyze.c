@@ -0,0 +1,79 @@
+/*****************************************************************//**
+ * \file   tool_analyze.c
+ * \brief  Headless difficulty analysis of the board presets or of one board size.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "difficulty.h"
+#include "threadpool.h"
+#include "tools.h"
+
+/**
+ * \brief Prints the report of a difficulty analysis.
+ * \param report Pointer to the DifficultyReport structure.
+ */
+static void print_difficulty_report(const DifficultyReport* report) {
+    double games = (double)report->games;
+    printf("%dx%d, %d mines: %lld games in %.2f s (%.0f per second)\n", report->rows, report->cols, report->mines,
+        report->games, report->seconds, report->seconds > 0.0 ? games / report->seconds : 0.0);
+    printf("  won %.2f %%, %.3f forced guesses per game\n", 100.0 * report->wins / games, report->guess_total / games);
+
+    for (int g = 0; g <= DIFFICULTY_MAX_GUESSES; g++) {
+        if (report->guess_games[g] == 0)
+            continue;
+        printf("  %2d%s guesses: %6.2f %% of the games, %6.2f %% won\n", g, g == DIFFICULTY_MAX_GUESSES ? "+" : " ",
+            100.0 * report->guess_games[g] / games, 100.0 * report->guess_wins[g] / report->guess_games[g]);
+    }
+
+    const Histogram* bv = &report->bv;
+    printf("  3BV: min %llu, p10 %llu, median %llu, p90 %llu, max %llu, mean %.1f\n", (unsigned long long)bv->min,
+        (unsigned long long)histogram_percentile(10.0, bv), (unsigned long long)histogram_percentile(50.0, bv),
+        (unsigned long long)histogram_percentile(90.0, bv), (unsigned long long)bv->max, histogram_mean(bv));
+    printf("  %.2f openings and %.2f islands per board\n", report->openings_total / games, report->islands_total / games);
+}
+
+/**
+ * \brief Plays games with the solver-driven bot on every logical processor and prints how difficult the boards are.
+ * \param count Number of arguments: the number of games per board size, optionally followed by rows, columns and mines.
+ * \param args The arguments. Without a board size, the easy, medium and hard presets are analyzed.
+ * \param seed Seed the boards are drawn from.
+ * \return 0 on success, 1 if the arguments are invalid or the memory ran out.
+ */
+int tool_analyze(int count, char** args, uint64_t seed) {
+    long long games = count >= 1 ? strtoll(args[0], NULL, 10) : 0;
+    if (games <= 0 || (count != 1 && count != 4)) {
+        fprintf(stderr, "Usage: saper_tools [--seed N] analyze GAMES [ROWS COLS MINES]\n");
+        return 1;
+    }
+
+    ThreadPool pool;
+    ThreadPool* workers = threadpool_create(0, &pool) ? &pool : NULL;
+    printf("Seed %llu, %d threads\n", (unsigned long long)seed, workers ? workers->thread_count : 1);
+
+    int result = 0;
+    for (int preset = 1; preset <= (count == 4 ? 1 : 3); preset++) {
+        int rows, cols, mines;
+        if (count == 4) {
+            rows = atoi(args[1]);
+            cols = atoi(args[2]);
+            mines = atoi(args[3]);
+        }
+        else {
+            get_board_preset(preset, &rows, &cols, &mines);
+        }
+
+        DifficultyReport report;
+        if (!analyze_difficulty(rows, cols, mines, games, seed, workers, &report)) {
+            fprintf(stderr, "Cannot analyze %dx%d boards with %d mines.\n", rows, cols, mines);
+            result = 1;
+            break;
+        }
+        print_difficulty_report(&report);
+    }
+
+    if (workers) {
+        threadpool_destroy(workers);
+    }
+    return result;
+}
@@ -0,0 +1,85 @@
+/*****************************************************************//**
+ * \file   tool_bots.c
+ * \brief  Headless runs of bot plugins, compared game by game on the same boards.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "botplay.h"
+#include "threadpool.h"
+#include "tools.h"
+
+/**
+ * \brief Plays the same games with one or two bot plugins on every logical processor and prints how they did.
+ *
+ * With two plugins, the games are also compared one by one, the boards of a seed being the same for both bots.
+ * \param count Number of arguments: the number of games, rows, columns and mines, then one or two plugin paths.
+ * \param args The arguments.
+ * \param seed Seed the boards are drawn from.
+ * \return 0 on success, 1 if the arguments are invalid, a plugin cannot be loaded or the memory ran out.
+ */
+int tool_bots(int count, char** args, uint64_t seed) {
+    long long games = count >= 1 ? strtoll(args[0], NULL, 10) : 0;
+    if (games <= 0 || (count != 5 && count != 6)) {
+        fprintf(stderr, "Usage: saper_tools [--seed N] bots GAMES ROWS COLS MINES PLUGIN [PLUGIN]\n");
+        return 1;
+    }
+    int rows = atoi(args[1]);
+    int cols = atoi(args[2]);
+    int mines = atoi(args[3]);
+    int bot_count = count - 4;
+
+    BotPlugin plugins[2] = { { NULL, NULL }, { NULL, NULL } };
+    BotReport reports[2];
+    memset(reports, 0, sizeof(reports));
+    ThreadPool pool;
+    ThreadPool* workers = threadpool_create(0, &pool) ? &pool : NULL;
+    printf("Seed %llu, %d threads, %dx%d boards with %d mines\n", (unsigned long long)seed, workers ? workers->thread_count : 1, rows, cols, mines);
+
+    int result = 0;
+    for (int b = 0; b < bot_count && result == 0; b++) {
+        const char* path = args[4 + b];
+        if (!bot_plugin_load(path, &plugins[b])) {
+            fprintf(stderr, "Cannot load the bot plugin %s.\n", path);
+            result = 1;
+            break;
+        }
+        if (!run_bot_games(plugins[b].bot, rows, cols, mines, games, seed, workers, &reports[b])) {
+            fprintf(stderr, "Cannot play %dx%d boards with %d mines.\n", rows, cols, mines);
+            result = 1;
+            break;
+        }
+
+        const BotReport* report = &reports[b];
+        double seconds = report->seconds > 0.0 ? report->seconds : 1e-9;
+        printf("%s: won %.2f %%, gave up %.2f %%, %lld games in %.2f s\n", report->name, 100.0 * report->wins / games,
+            100.0 * report->stalls / games, games, report->seconds);
+        printf("  %.2f million actions per second, %.2f per turn, %lld invalid\n", report->actions / seconds / 1e6,
+            report->turns > 0 ? (double)report->actions / report->turns : 0.0, report->invalid);
+    }
+
+    // Game by game, on the same boards
+    if (result == 0 && bot_count == 2) {
+        long long both = 0, first_only = 0, second_only = 0;
+        for (long long g = 0; g < games; g++) {
+            bool first = reports[0].outcomes[g] == BOT_WON;
+            bool second = reports[1].outcomes[g] == BOT_WON;
+            both += first && second;
+            first_only += first && !second;
+            second_only += !first && second;
+        }
+        printf("Head to head: both won %lld, only %s %lld, only %s %lld, neither %lld\n", both, reports[0].name, first_only,
+            reports[1].name, second_only, games - both - first_only - second_only);
+    }
+    //
+
+    for (int b = 0; b < bot_count; b++) {
+        bot_report_free(&reports[b]);
+        bot_plugin_unload(&plugins[b]);
+    }
+    if (workers) {
+        threadpool_destroy(workers);
+    }
+    return result;
+}
@@ -0,0 +1,72 @@
+/*****************************************************************//**
+ * \file   tool_verify.c
+ * \brief  Headless verification of replay files.
+ *********************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include "replay.h"
+#include "threadpool.h"
+#include "tools.h"
+
+/**
+ * \brief Verifies the replays of the given files on every logical processor.
+ *
+ * Prints the replays that do not verify, then a summary with the number of actions replayed per second.
+ * \param count Number of files.
+ * \param paths Paths of the files.
+ * \param seed Unused, every replay holds its own seed.
+ * \return 0 if every replay of every file verified, 1 otherwise.
+ */
+int tool_verify(int count, char** paths, uint64_t seed) {
+    ReplayBatch batch;
+    replay_batch_init(&batch);
+    int unreadable = 0;
+    for (int f = 0; f < count; f++) {
+        if (!replay_batch_add_file(paths[f], &batch)) {
+            fprintf(stderr, "Cannot read the replays of %s.\n", paths[f]);
+            unreadable++;
+        }
+    }
+
+    ThreadPool pool;
+    ThreadPool* workers = threadpool_create(0, &pool) ? &pool : NULL;
+    struct timespec begin, end;
+    timespec_get(&begin, TIME_UTC);
+    replay_batch_verify(workers, &batch);
+    timespec_get(&end, TIME_UTC);
+    double time = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+    if (workers) {
+        threadpool_destroy(workers);
+    }
+
+    // The file index of a replay is the order the files could be mapped in, the paths skip the unreadable ones
+    int verified = 0;
+    long long actions = 0;
+    for (int i = 0, file = -1, ordinal = 0; i < batch.check_count; i++) {
+        ReplayCheck* check = &batch.checks[i];
+        ordinal = check->file == file ? ordinal + 1 : 1;
+        file = check->file;
+
+        if (check->status != REPLAY_CORRUPT && check->status != REPLAY_BAD_VERSION) {
+            actions += check->info.action_count;
+        }
+        if (check->status == REPLAY_VERIFIED) {
+            verified++;
+            continue;
+        }
+        printf("Replay %d of file %d: %s", ordinal, file + 1, replay_status_text(check->status));
+        if (check->status == REPLAY_MISMATCH) {
+            static const char* const outcomes[] = { "unfinished", "lost", "won" };
+            printf(" (claims %s in %.3f s, seed %llu)", outcomes[check->info.outcome], check->info.time / 1000.0, (unsigned long long)check->info.seed);
+        }
+        printf("\n");
+    }
+    printf("%d of %d replays verified, %lld actions in %.1f ms (%.2f million per second).\n",
+        verified, batch.check_count, actions, time * 1e3, time > 0.0 ? actions / time / 1e6 : 0.0);
+    //
+
+    int rejected = batch.check_count - verified + unreadable;
+    replay_batch_free(&batch);
+    return rejected > 0 ? 1 : 0;
+}
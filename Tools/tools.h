@@ -0,0 +1,12 @@
+/*****************************************************************//**
+ * \file   tools.h
+ * \brief  Entry points of the command-line tools, which only need the headless core and no display.
+ *********************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+int tool_verify(int count, char** args, uint64_t seed);
+int tool_analyze(int count, char** args, uint64_t seed);
+int tool_bots(int count, char** args, uint64_t seed);